@@ -0,0 +1,108 @@
+#include "Arena.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace mat_vec {
+
+	// Минимальный размер нового блока
+	const size_t MIN_BLOCK = 1 << 16;
+
+	// -Резервирует initial_bytes байт заранее
+	ScratchArena::ScratchArena(size_t initial_bytes) {
+		if (initial_bytes) {
+			_blocks.push_back({ new char[initial_bytes], initial_bytes });
+			MAT_VEC_COUNT_ALLOC(initial_bytes);
+		}
+	}
+
+	ScratchArena::~ScratchArena() {
+		for (auto& b : _blocks) delete[] b.data;
+	}
+
+	// -Арена текущего потока
+	ScratchArena& ScratchArena::local() {
+		thread_local ScratchArena arena;
+		return arena;
+	}
+
+	// -Выделяет bytes байт, выровненных на align: из текущего блока, иначе
+	// из следующего уже выделенного, где хватает места, иначе из нового
+	void* ScratchArena::allocate(size_t bytes, size_t align) {
+		std::lock_guard<std::mutex> guard(_lock);
+		for (; _current < _blocks.size(); _current++) {
+			Block& b = _blocks[_current];
+			uintptr_t base = reinterpret_cast<uintptr_t>(b.data);
+			size_t start = ((base + _offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+			if (start + bytes <= b.size) {
+				_offset = start + bytes;
+				return b.data + start;
+			}
+			if (_current + 1 == _blocks.size()) break;
+			_before += b.size;
+			_offset = 0;
+		}
+		size_t size = std::max(MIN_BLOCK, bytes + align);
+		if (!_blocks.empty()) {
+			size = std::max(size, _blocks.back().size * 2);
+			_before += _blocks.back().size;
+		}
+		_blocks.push_back({ new char[size], size });
+		MAT_VEC_COUNT_ALLOC(size);
+		_current = _blocks.size() - 1;
+		Block& b = _blocks.back();
+		uintptr_t base = reinterpret_cast<uintptr_t>(b.data);
+		size_t start = ((base + align - 1) & ~(uintptr_t)(align - 1)) - base;
+		_offset = start + bytes;
+		return b.data + start;
+	}
+
+	// -Текущая отметка
+	size_t ScratchArena::mark() const {
+		std::lock_guard<std::mutex> guard(_lock);
+		return _before + _offset;
+	}
+
+	// -Возвращается к блоку отметки; следующие блоки не освобождаются
+	void ScratchArena::rewind(size_t mark) {
+		std::lock_guard<std::mutex> guard(_lock);
+		while (_current > 0 && mark < _before) {
+			_current--;
+			_before -= _blocks[_current].size;
+		}
+		_offset = mark - _before;
+	}
+
+	// -Освобождает всё выделенное
+	void ScratchArena::reset() {
+		std::lock_guard<std::mutex> guard(_lock);
+		if (_blocks.size() > 1) {
+			size_t total = 0;
+			for (auto& b : _blocks) {
+				total += b.size;
+				delete[] b.data;
+			}
+			_blocks.clear();
+			_blocks.push_back({ new char[total], total });
+			MAT_VEC_COUNT_ALLOC(total);
+		}
+		_current = 0;
+		_offset = 0;
+		_before = 0;
+	}
+
+	// -Занято байт
+	size_t ScratchArena::used() const {
+		std::lock_guard<std::mutex> guard(_lock);
+		return _before + _offset;
+	}
+
+	// -Зарезервировано байт
+	size_t ScratchArena::capacity() const {
+		std::lock_guard<std::mutex> guard(_lock);
+		size_t total = 0;
+		for (auto& b : _blocks) total += b.size;
+		return total;
+	}
+
+} // namespace mat_vec
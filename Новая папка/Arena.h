@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace mat_vec {
+
+	// Арена для временных буферов: выделение сдвигом указателя,
+	// освобождение всего сразу через reset(). Потокобезопасна.
+	class ScratchArena {
+	public:
+		// Резервирует initial_bytes байт заранее
+		explicit ScratchArena(size_t initial_bytes = 0);
+
+		~ScratchArena();
+
+		ScratchArena(const ScratchArena&) = delete;
+		ScratchArena& operator=(const ScratchArena&) = delete;
+
+		// Арена текущего потока
+		static ScratchArena& local();
+
+		// Выделяет bytes байт, выровненных на align
+		void* allocate(size_t bytes, size_t align = 64);
+
+		// Выделяет массив из n элементов типа T (без вызова конструкторов)
+		template<typename T>
+		T* allocate_array(size_t n) {
+			return static_cast<T*>(allocate(n * sizeof(T), alignof(T) > 64 ? alignof(T) : 64));
+		}
+
+		// Текущая отметка; rewind(mark) освобождает всё, выделенное после неё.
+		// Блоки, добавленные после отметки, остаются за ареной, так что цикл
+		// mark, allocate, rewind выделяет память только в первый раз
+		size_t mark() const;
+		void rewind(size_t mark);
+
+		// Освобождает всё выделенное. Память остаётся за ареной
+		// одним блоком, поэтому повторное использование не выделяет память
+		void reset();
+
+		// Занято и зарезервировано байт
+		size_t used() const;
+		size_t capacity() const;
+
+	private:
+		struct Block {
+			char* data;
+			size_t size;
+		};
+
+		std::vector<Block> _blocks;
+		size_t _current = 0;  // блок, из которого идёт выделение
+		size_t _offset = 0;   // смещение в текущем блоке
+		size_t _before = 0;   // байт в блоках до текущего
+		mutable std::mutex _lock;
+	};
+
+} // namespace mat_vec
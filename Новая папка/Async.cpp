@@ -0,0 +1,182 @@
+#include "Async.h"
+#include "Decomposition.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <chrono>
+#include <queue>
+
+namespace mat_vec {
+
+	namespace detail {
+
+		namespace {
+
+			// Очередь готовых к запуску операций: по приоритету, затем по порядку
+			struct ReadyQueue {
+				struct Entry {
+					int priority;
+					uint64_t sequence;
+					std::shared_ptr<AsyncNode> node;
+
+					bool operator<(const Entry& rhs) const {
+						if (priority != rhs.priority) return priority < rhs.priority;
+						return sequence > rhs.sequence;
+					}
+				};
+
+				std::mutex lock;
+				std::priority_queue<Entry> entries;
+				uint64_t next = 0;
+			};
+
+			ReadyQueue& ready_queue() {
+				static ReadyQueue queue;
+				return queue;
+			}
+
+			bool finished(AsyncStatus s) {
+				return s == AsyncStatus::DONE || s == AsyncStatus::CANCELLED || s == AsyncStatus::FAILED;
+			}
+
+			void schedule(const std::shared_ptr<AsyncNode>& node);
+
+			// Завершает операцию и будит зависящие от неё. Отмена и ошибка
+			// передаются зависящим, успех уменьшает их счётчик входов.
+			// Отменить можно только ещё не начатую операцию
+			bool finish(const std::shared_ptr<AsyncNode>& node, AsyncStatus status, std::exception_ptr error) {
+				std::vector<std::shared_ptr<AsyncNode>> dependents;
+				{
+					std::lock_guard<std::mutex> guard(node->lock);
+					if (finished(node->status)) return false;
+					if (status == AsyncStatus::CANCELLED && node->status != AsyncStatus::PENDING) return false;
+					node->status = status;
+					node->error = error;
+					node->body = nullptr;
+					dependents.swap(node->dependents);
+				}
+				node->cv.notify_all();
+				for (auto& d : dependents) {
+					if (status != AsyncStatus::DONE) finish(d, status, error);
+					else if (--d->missing == 0) schedule(d);
+				}
+				return true;
+			}
+
+			// Выполняет операцию с наибольшим приоритетом из очереди
+			void run_next() {
+				ReadyQueue& q = ready_queue();
+				std::shared_ptr<AsyncNode> node;
+				{
+					std::lock_guard<std::mutex> guard(q.lock);
+					if (q.entries.empty()) return;
+					node = q.entries.top().node;
+					q.entries.pop();
+				}
+				std::function<void()> body;
+				{
+					std::lock_guard<std::mutex> guard(node->lock);
+					if (node->status != AsyncStatus::PENDING) return;
+					node->status = AsyncStatus::RUNNING;
+					body.swap(node->body);
+				}
+				try {
+					body();
+				}
+				catch (...) {
+					finish(node, AsyncStatus::FAILED, std::current_exception());
+					return;
+				}
+				finish(node, AsyncStatus::DONE, nullptr);
+			}
+
+			// Каждой записи очереди соответствует одна задача пула
+			void schedule(const std::shared_ptr<AsyncNode>& node) {
+				ReadyQueue& q = ready_queue();
+				{
+					std::lock_guard<std::mutex> guard(q.lock);
+					q.entries.push({ node->priority, q.next++, node });
+				}
+				ThreadPool::global().submit(run_next);
+			}
+		}
+
+		// -Подписывает операцию на входы
+		void launch(const std::shared_ptr<AsyncNode>& node, const std::vector<std::shared_ptr<AsyncNode>>& inputs) {
+			// лишняя единица не даёт запустить операцию, пока идёт подписка
+			node->missing = inputs.size() + 1;
+			AsyncStatus failed = AsyncStatus::DONE;
+			std::exception_ptr error;
+			for (const auto& in : inputs) {
+				std::lock_guard<std::mutex> guard(in->lock);
+				if (in->status == AsyncStatus::DONE) node->missing--;
+				else if (finished(in->status)) {
+					failed = in->status;
+					error = in->error;
+					node->missing--;
+				}
+				else in->dependents.push_back(node);
+			}
+			if (failed != AsyncStatus::DONE) finish(node, failed, error);
+			if (--node->missing == 0) schedule(node);
+		}
+
+		// -Ждёт, помогая пулу
+		void wait(AsyncNode& node) {
+			ThreadPool& pool = ThreadPool::global();
+			for (;;) {
+				{
+					std::unique_lock<std::mutex> guard(node.lock);
+					if (finished(node.status)) return;
+					if (pool.size() > 0 && node.status == AsyncStatus::RUNNING) {
+						node.cv.wait_for(guard, std::chrono::milliseconds(1));
+						continue;
+					}
+				}
+				if (!pool.try_run_one()) {
+					std::unique_lock<std::mutex> guard(node.lock);
+					node.cv.wait_for(guard, std::chrono::milliseconds(1), [&] { return finished(node.status); });
+				}
+			}
+		}
+
+		// -Отмена ещё не начатой операции
+		bool cancel(const std::shared_ptr<AsyncNode>& node) {
+			return finish(node, AsyncStatus::CANCELLED, nullptr);
+		}
+
+		AsyncStatus status(AsyncNode& node) {
+			std::lock_guard<std::mutex> guard(node.lock);
+			return node.status;
+		}
+	}
+
+	const char* AsyncCancelled::what() const noexcept { return "mat_vec: operation cancelled"; }
+
+	// -A B
+	Future<Matrix> async_mul(const Future<Matrix>& a, const Future<Matrix>& b, const AsyncOptions& opt) {
+		return async_call<Matrix>(opt, [](const Matrix& x, const Matrix& y) { return x * y; }, a, b);
+	}
+
+	Future<Vector> async_mul(const Future<Matrix>& a, const Future<Vector>& x, const AsyncOptions& opt) {
+		return async_call<Vector>(opt, [](const Matrix& m, const Vector& v) { return m * v; }, a, x);
+	}
+
+	// -Обратная и определитель через LU
+	Future<Matrix> async_inv(const Future<Matrix>& a, const AsyncOptions& opt) {
+		return async_call<Matrix>(opt, [](const Matrix& m) { return LU(m).inv(); }, a);
+	}
+
+	Future<double> async_det(const Future<Matrix>& a, const AsyncOptions& opt) {
+		return async_call<double>(opt, [](const Matrix& m) { return LU(m).det(); }, a);
+	}
+
+	// -Решение систем
+	Future<Vector> async_solve(const Future<Matrix>& a, const Future<Vector>& b, const AsyncOptions& opt) {
+		return async_call<Vector>(opt, [](const Matrix& m, const Vector& v) { return LU(m).solve(v); }, a, b);
+	}
+
+	Future<Matrix> async_solve(const Future<Matrix>& a, const Future<Matrix>& b, const AsyncOptions& opt) {
+		return async_call<Matrix>(opt, [](const Matrix& m, const Matrix& r) { return LU(m).solve(r); }, a, b);
+	}
+
+} // namespace mat_vec
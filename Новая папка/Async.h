@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Base.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace mat_vec {
+
+	// Асинхронные операции на пуле ThreadPool::global().
+	//
+	// Каждая операция возвращает Future. Future можно передать на вход
+	// следующей операции: она встанет в очередь, как только будут готовы
+	// все входы, не занимая поток ожиданием. Готовые к запуску операции
+	// выполняются в порядке приоритета (больше -- раньше), при равном
+	// приоритете -- в порядке запуска. Отмена действует на операции,
+	// которые ещё не начались; зависящие от отменённой (или упавшей с
+	// исключением) операции тоже отменяются (соответственно падают)
+
+	enum class AsyncStatus {
+		PENDING,    // ждёт входов или очереди
+		RUNNING,
+		DONE,
+		CANCELLED,
+		FAILED      // функция бросила исключение
+	};
+
+	// Исключение из Future::get() для отменённой операции
+	class AsyncCancelled : public std::exception {
+	public:
+		const char* what() const noexcept override;
+	};
+
+	struct AsyncOptions {
+		int priority = 0;
+	};
+
+	namespace detail {
+
+		// Нетипизированная часть состояния операции
+		struct AsyncNode {
+			virtual ~AsyncNode() = default;
+
+			std::mutex lock;
+			std::condition_variable cv;
+			AsyncStatus status = AsyncStatus::PENDING;
+			std::exception_ptr error;
+			int priority = 0;
+			std::atomic<size_t> missing{ 0 };                  // неготовых входов
+			std::function<void()> body;
+			std::vector<std::shared_ptr<AsyncNode>> dependents;
+		};
+
+		template <typename T>
+		struct AsyncState : AsyncNode {
+			std::unique_ptr<T> value;
+		};
+
+		// fn(*value входа 0, *value входа 1, ...)
+		template <typename F, typename Tuple, size_t... I>
+		auto apply_inputs(const F& fn, const Tuple& inputs, std::index_sequence<I...>)
+			-> decltype(fn(*std::get<I>(inputs)->value...)) {
+			return fn(*std::get<I>(inputs)->value...);
+		}
+
+		// Подписывает node на входы; если все готовы -- ставит в очередь
+		void launch(const std::shared_ptr<AsyncNode>& node, const std::vector<std::shared_ptr<AsyncNode>>& inputs);
+
+		// Дожидается завершения, выполняя тем временем задачи пула
+		void wait(AsyncNode& node);
+
+		bool cancel(const std::shared_ptr<AsyncNode>& node);
+		AsyncStatus status(AsyncNode& node);
+	}
+
+	// Результат асинхронной операции. Копии ссылаются на одно состояние
+	template <typename T>
+	class Future {
+	public:
+		Future() = default;
+
+		// Уже готовое значение (для передачи на вход операциям)
+		Future(T value) : _state(std::make_shared<detail::AsyncState<T>>()) {
+			_state->value.reset(new T(std::move(value)));
+			_state->status = AsyncStatus::DONE;
+		}
+
+		// Состояние уже запущенной операции (см. async_call)
+		explicit Future(std::shared_ptr<detail::AsyncState<T>> state) : _state(std::move(state)) {}
+
+		bool valid() const { return _state != nullptr; }
+		AsyncStatus status() const { return detail::status(*_state); }
+
+		// true, если операция завершена (успешно, отменена или упала)
+		bool ready() const {
+			AsyncStatus s = status();
+			return s != AsyncStatus::PENDING && s != AsyncStatus::RUNNING;
+		}
+
+		void wait() const { detail::wait(*_state); }
+
+		// Ждёт и возвращает значение. Пробрасывает исключение операции;
+		// для отменённой бросает AsyncCancelled
+		const T& get() const {
+			wait();
+			if (_state->status == AsyncStatus::FAILED) std::rethrow_exception(_state->error);
+			if (_state->status == AsyncStatus::CANCELLED) throw AsyncCancelled();
+			return *_state->value;
+		}
+
+		// Отменяет ещё не начатую операцию; false, если она уже идёт или завершена
+		bool cancel() { return detail::cancel(_state); }
+
+		std::shared_ptr<detail::AsyncState<T>> state() const { return _state; }
+
+	private:
+		std::shared_ptr<detail::AsyncState<T>> _state;
+	};
+
+	// Запускает fn(inputs.get()...) после готовности всех входов
+	template <typename R, typename F, typename... Args>
+	Future<R> async_call(const AsyncOptions& opt, F fn, const Future<Args>&... inputs) {
+		auto state = std::make_shared<detail::AsyncState<R>>();
+		state->priority = opt.priority;
+		detail::AsyncState<R>* self = state.get();
+		auto args = std::make_tuple(inputs.state()...);
+		state->body = [self, fn, args] {
+			self->value.reset(new R(detail::apply_inputs(fn, args, std::index_sequence_for<Args...>())));
+		};
+		detail::launch(state, { inputs.state()... });
+		return Future<R>(state);
+	}
+
+	// A B
+	Future<Matrix> async_mul(const Future<Matrix>& a, const Future<Matrix>& b, const AsyncOptions& opt = AsyncOptions());
+	Future<Vector> async_mul(const Future<Matrix>& a, const Future<Vector>& x, const AsyncOptions& opt = AsyncOptions());
+
+	// A^{-1} и det A через LU-разложение
+	Future<Matrix> async_inv(const Future<Matrix>& a, const AsyncOptions& opt = AsyncOptions());
+	Future<double> async_det(const Future<Matrix>& a, const AsyncOptions& opt = AsyncOptions());
+
+	// Решение A x = b и A X = B
+	Future<Vector> async_solve(const Future<Matrix>& a, const Future<Vector>& b, const AsyncOptions& opt = AsyncOptions());
+	Future<Matrix> async_solve(const Future<Matrix>& a, const Future<Matrix>& b, const AsyncOptions& opt = AsyncOptions());
+
+} // namespace mat_vec
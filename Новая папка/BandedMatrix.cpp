@@ -0,0 +1,222 @@
+#include "BandedMatrix.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace mat_vec {
+
+	// -Конструирует ленточную матрицу
+	BandedMatrix::BandedMatrix(size_t size, size_t lower, size_t upper, double value)
+		: _n(size), _lower(lower), _upper(upper), _data(size * (lower + upper + 1), 0.0) {
+		MAT_VEC_COUNT_ALLOC(_data.size() * sizeof(double));
+		for (size_t i = 0; i < _n; i++) {
+			size_t from = i >= _lower ? i - _lower : 0, to = std::min(_n, i + _upper + 1);
+			for (size_t j = from; j < to; j++) at(i, j) = value;
+		}
+	}
+
+	// -Трёхдиагональная матрица
+	BandedMatrix BandedMatrix::tridiagonal(const Vector& sub, const Vector& diag, const Vector& super) {
+		BandedMatrix m(diag.size(), 1, 1);
+		for (size_t i = 0; i < m._n; i++) {
+			m.at(i, i) = diag[i];
+			if (i + 1 < m._n) {
+				m.at(i + 1, i) = sub[i];
+				m.at(i, i + 1) = super[i];
+			}
+		}
+		return m;
+	}
+
+	// -Лента матрицы mat
+	BandedMatrix::BandedMatrix(const Matrix& mat, size_t lower, size_t upper)
+		: BandedMatrix(mat._size.first, lower, upper) {
+		for (size_t i = 0; i < _n; i++) {
+			size_t from = i >= _lower ? i - _lower : 0, to = std::min(_n, i + _upper + 1);
+			for (size_t j = from; j < to; j++) at(i, j) = mat.a[i][j];
+		}
+	}
+
+	// -Размер матрицы и ширина ленты
+	size_t BandedMatrix::size() const { return _n; }
+	size_t BandedMatrix::lower() const { return _lower; }
+	size_t BandedMatrix::upper() const { return _upper; }
+
+	// -Возвращает элемент на позиции [row, col]
+	double BandedMatrix::get(size_t row, size_t col) const {
+		if (col + _lower < row || col > row + _upper) return 0;
+		return _data[row * (_lower + _upper + 1) + col + _lower - row];
+	}
+
+	// -Ссылка на элемент внутри ленты
+	double& BandedMatrix::at(size_t row, size_t col) {
+		return _data[row * (_lower + _upper + 1) + col + _lower - row];
+	}
+
+	// -Умножение на вектор
+	Vector BandedMatrix::operator*(const Vector& vec) const {
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)_n * (_lower + _upper + 1));
+		Vector c(_n, 0);
+		size_t w = _lower + _upper + 1;
+		for (size_t i = 0; i < _n; i++) {
+			size_t from = i >= _lower ? i - _lower : 0, to = std::min(_n, i + _upper + 1);
+			const double* r = _data.data() + i * w + _lower - i;
+			double s = 0;
+			for (size_t j = from; j < to; j++) s += r[j] * vec[j];
+			c[i] = s;
+		}
+		return c;
+	}
+
+	// -Умножение на плотную матрицу
+	Matrix BandedMatrix::operator*(const Matrix& mat) const {
+		size_t m = mat._size.second;
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)_n * (_lower + _upper + 1) * m);
+		Matrix c(_n, m, 0.0);
+		for (size_t i = 0; i < _n; i++) {
+			size_t from = i >= _lower ? i - _lower : 0, to = std::min(_n, i + _upper + 1);
+			double* ci = c.a[i];
+			for (size_t p = from; p < to; p++) {
+				double t = get(i, p);
+				const double* bp = mat.a[p];
+				for (size_t j = 0; j < m; j++) ci[j] += t * bp[j];
+			}
+		}
+		return c;
+	}
+
+	// -Решение A x = b
+	Vector BandedMatrix::solve(const Vector& b) const {
+		MAT_VEC_SCOPE("BandedMatrix::solve");
+		if (_n == 0) return b;
+		bool thomas = _lower == 1 && _upper == 1;
+		for (size_t i = 0; thomas && i < _n; i++) {
+			double off = (i > 0 ? std::fabs(get(i, i - 1)) : 0) + (i + 1 < _n ? std::fabs(get(i, i + 1)) : 0);
+			thomas = get(i, i) != 0 && std::fabs(get(i, i)) >= off;
+		}
+		if (!thomas) return BandedLU(*this).solve(b);
+
+		// прогонка
+		MAT_VEC_COUNT_FLOPS(8 * (uint64_t)_n);
+		std::vector<double> c(_n);
+		Vector x = b;
+		double denom = get(0, 0);
+		for (size_t i = 0; i < _n; i++) {
+			if (i > 0) {
+				double a = get(i, i - 1);
+				denom = get(i, i) - a * c[i - 1];
+				x[i] -= a * x[i - 1];
+			}
+			c[i] = i + 1 < _n ? get(i, i + 1) / denom : 0;
+			x[i] /= denom;
+		}
+		for (size_t i = _n - 1; i-- > 0;) x[i] -= c[i] * x[i + 1];
+		return x;
+	}
+
+	// -Определитель
+	double BandedMatrix::det() const {
+		return BandedLU(*this).det();
+	}
+
+	// -Плотная матрица
+	Matrix BandedMatrix::to_dense() const {
+		Matrix m(_n, 0.0);
+		for (size_t i = 0; i < _n; i++) {
+			size_t from = i >= _lower ? i - _lower : 0, to = std::min(_n, i + _upper + 1);
+			for (size_t j = from; j < to; j++) m.a[i][j] = get(i, j);
+		}
+		return m;
+	}
+
+	// -Ленточное LU-разложение
+	BandedLU::BandedLU(const BandedMatrix& mat)
+		: _n(mat.size()), _lower(mat.lower()), _width(2 * mat.lower() + mat.upper() + 1),
+		_u(mat.size() * (2 * mat.lower() + mat.upper() + 1), 0.0),
+		_l(mat.size() * mat.lower(), 0.0), _pivot(mat.size()), _sign(1) {
+		MAT_VEC_SCOPE("BandedLU");
+		size_t ku = _lower + mat.upper();   // наддиагоналей U с учётом заполнения
+		for (size_t i = 0; i < _n; i++) {
+			size_t from = i >= _lower ? i - _lower : 0, to = std::min(_n, i + mat.upper() + 1);
+			for (size_t j = from; j < to; j++) u(i, j) = mat.get(i, j);
+		}
+		for (size_t k = 0; k < _n; k++) {
+			size_t last = std::min(_n - 1, k + _lower);
+			size_t p = k;
+			for (size_t i = k + 1; i <= last; i++)
+				if (std::fabs(u(i, k)) > std::fabs(u(p, k))) p = i;
+			_pivot[k] = p;
+			size_t end = std::min(_n, k + ku + 1);
+			if (p != k) {
+				_sign = -_sign;
+				for (size_t j = k; j < end; j++) std::swap(u(k, j), u(p, j));
+			}
+			double pivot = u(k, k);
+			MAT_VEC_COUNT_FLOPS(2 * (uint64_t)(last - k) * (end - k));
+			for (size_t i = k + 1; i <= last; i++) {
+				double l = u(i, k) / pivot;
+				_l[k * _lower + (i - k - 1)] = l;
+				u(i, k) = 0;
+				if (l == 0) continue;
+				for (size_t j = k + 1; j < end; j++) u(i, j) -= l * u(k, j);
+			}
+		}
+	}
+
+	double& BandedLU::u(size_t row, size_t col) { return _u[row * _width + col + _lower - row]; }
+	double BandedLU::u(size_t row, size_t col) const { return _u[row * _width + col + _lower - row]; }
+
+	// -Решение A x = b
+	Vector BandedLU::solve(const Vector& b) const {
+		Vector x = b;
+		size_t ku = _width - _lower - 1;
+		for (size_t k = 0; k < _n; k++) {
+			if (_pivot[k] != k) std::swap(x[k], x[_pivot[k]]);
+			size_t last = std::min(_n - 1, k + _lower);
+			for (size_t i = k + 1; i <= last; i++) x[i] -= _l[k * _lower + (i - k - 1)] * x[k];
+		}
+		for (size_t i = _n; i-- > 0;) {
+			double s = x[i];
+			size_t end = std::min(_n, i + ku + 1);
+			for (size_t j = i + 1; j < end; j++) s -= u(i, j) * x[j];
+			x[i] = s / u(i, i);
+		}
+		return x;
+	}
+
+	// -Решение A X = B
+	Matrix BandedLU::solve(const Matrix& b) const {
+		Matrix x = b;
+		size_t m = x._size.second;
+		size_t ku = _width - _lower - 1;
+		for (size_t k = 0; k < _n; k++) {
+			if (_pivot[k] != k) std::swap_ranges(x.a[k], x.a[k] + m, x.a[_pivot[k]]);
+			size_t last = std::min(_n - 1, k + _lower);
+			for (size_t i = k + 1; i <= last; i++) {
+				double l = _l[k * _lower + (i - k - 1)];
+				for (size_t j = 0; j < m; j++) x.a[i][j] -= l * x.a[k][j];
+			}
+		}
+		for (size_t i = _n; i-- > 0;) {
+			size_t end = std::min(_n, i + ku + 1);
+			for (size_t p = i + 1; p < end; p++) {
+				double t = u(i, p);
+				for (size_t j = 0; j < m; j++) x.a[i][j] -= t * x.a[p][j];
+			}
+			double d = 1 / u(i, i);
+			for (size_t j = 0; j < m; j++) x.a[i][j] *= d;
+		}
+		return x;
+	}
+
+	// -Определитель
+	double BandedLU::det() const {
+		double d = _sign;
+		for (size_t i = 0; i < _n; i++) d *= u(i, i);
+		return d;
+	}
+
+} // namespace mat_vec
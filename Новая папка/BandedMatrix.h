@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Base.h"
+#include <cstddef>
+#include <vector>
+
+namespace mat_vec {
+
+	// Ленточная матрица n x n с lower поддиагоналями и upper наддиагоналями.
+	// Хранится построчно: строка i -- столбцы i - lower .. i + upper
+	class BandedMatrix {
+	public:
+		// Конструирует ленточную матрицу, заполняя ленту значением value
+		BandedMatrix(size_t size, size_t lower, size_t upper, double value = 0);
+
+		// Трёхдиагональная матрица: sub[i] = (i + 1, i), diag[i] = (i, i), super[i] = (i, i + 1)
+		static BandedMatrix tridiagonal(const Vector& sub, const Vector& diag, const Vector& super);
+
+		// Лента матрицы mat
+		BandedMatrix(const Matrix& mat, size_t lower, size_t upper);
+
+		// Размер матрицы и ширина ленты
+		size_t size() const;
+		size_t lower() const;
+		size_t upper() const;
+
+		// Возвращает элемент на позиции [row, col] (0 вне ленты)
+		double get(size_t row, size_t col) const;
+
+		// Ссылка на элемент внутри ленты
+		double& at(size_t row, size_t col);
+
+		// Умножение на вектор, O(n * (lower + upper))
+		Vector operator*(const Vector& vec) const;
+
+		// Умножение на плотную матрицу
+		Matrix operator*(const Matrix& mat) const;
+
+		// Решение A x = b: алгоритм прогонки для трёхдиагональных матриц
+		// с диагональным преобладанием, иначе ленточное LU с выбором ведущего элемента
+		Vector solve(const Vector& b) const;
+
+		// Определитель через ленточное LU
+		double det() const;
+
+		// Плотная матрица
+		Matrix to_dense() const;
+
+	private:
+		size_t _n, _lower, _upper;
+		std::vector<double> _data;
+	};
+
+	// Ленточное LU-разложение с частичным выбором ведущего элемента.
+	// U занимает lower + upper наддиагоналей, память O(n * (2 * lower + upper))
+	class BandedLU {
+	public:
+		explicit BandedLU(const BandedMatrix& mat);
+
+		// Решение A x = b
+		Vector solve(const Vector& b) const;
+
+		// Решение A X = B для всех столбцов B
+		Matrix solve(const Matrix& b) const;
+
+		// Определитель
+		double det() const;
+
+	private:
+		double& u(size_t row, size_t col);
+		double u(size_t row, size_t col) const;
+
+		size_t _n, _lower, _width;
+		std::vector<double> _u;        // строка i -- столбцы i - lower .. i + lower + upper
+		std::vector<double> _l;        // множители: _l[k * lower + (i - k - 1)]
+		std::vector<size_t> _pivot;
+		int _sign;
+	};
+
+} // namespace mat_vec
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 namespace mat_vec {
 	// forward declarations
 	class Matrix;
@@ -0,0 +1,194 @@
+#include "Convolution.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Короче этого фильтр всегда сворачивается напрямую
+		const size_t DIRECT_MIN = 32;
+
+		// Длина БПФ в перекрытии с суммированием -- примерно во столько раз
+		// больше фильтра (чтобы на полезные отсчёты приходилась большая
+		// часть блока), но не меньше MIN_FFT
+		const size_t OLA_FACTOR = 8;
+		const size_t MIN_FFT = 64;
+
+		// Стоимость БПФ-пути в умножениях-сложениях прямого на N log2 N
+		// отсчётов длины БПФ: три действительных БПФ и произведение спектров
+		const double FFT_COST = 1.25;
+
+		// Постоянная часть стоимости БПФ-пути (спектр фильтра, буферы) в тех же единицах
+		const double FFT_OVERHEAD = 4096;
+
+		// Отсчётов результата на задачу прямой свёртки и на плитку внутри
+		// задачи: плитка результата остаётся в L1, пока по ней проходят все h[j]
+		const size_t DIRECT_GRAIN = 16384;
+		const size_t DIRECT_TILE = 1024;
+
+		// Входных отсчётов на блок для фильтра длины m и сигнала длины n
+		size_t ola_block(size_t m, size_t n) {
+			size_t len = std::min(fft_size(std::max(OLA_FACTOR * m, MIN_FFT)), fft_size(n + m - 1));
+			return len - m + 1;
+		}
+
+		// -Для каждого h[j] -- непрерывный проход по x в пределах плитки
+		void convolve_direct(const double* x, size_t n, const double* h, size_t m, double* y) {
+			parallel_for(0, n + m - 1, DIRECT_GRAIN, [&](size_t begin, size_t end) {
+				for (size_t from = begin; from < end; from += DIRECT_TILE) {
+					size_t to = std::min(end, from + DIRECT_TILE);
+					std::fill(y + from, y + to, 0.0);
+					for (size_t j = 0; j < m && j < to; j++) {
+						size_t lo = from > j ? from - j : 0, hi = std::min(n, to - j);
+						double hj = h[j];
+						double* out = y + j;
+						for (size_t i = lo; i < hi; i++) out[i] += hj * x[i];
+					}
+				}
+			});
+		}
+
+		// -Блоки b и b + 2 не пересекаются (block >= m - 1), поэтому сначала
+		// параллельно складываются чётные блоки, потом нечётные
+		void convolve_fft(const double* x, size_t n, const Vector& h, double* y) {
+			size_t m = h.size();
+			OverlapAdd ola(h, ola_block(m, n));
+			size_t block = ola.block(), count = (n + block - 1) / block;
+			std::fill(y, y + n + m - 1, 0.0);
+			for (size_t parity = 0; parity < 2; parity++) {
+				parallel_for(0, (count + 1 - parity) / 2, 1, [&](size_t from, size_t to) {
+					std::vector<double> part(block + m - 1);
+					for (size_t t = from; t < to; t++) {
+						size_t start = (2 * t + parity) * block, len = std::min(block, n - start);
+						ola.convolve_block(x + start, len, part.data());
+						for (size_t i = 0; i < len + m - 1; i++) y[start + i] += part[i];
+					}
+				});
+			}
+		}
+	}
+
+	ConvolutionMethod choose_convolution(size_t n, size_t m) {
+		size_t shorter = std::min(n, m), longer = std::max(n, m);
+		if (shorter < DIRECT_MIN) return ConvolutionMethod::DIRECT;
+		size_t block = ola_block(shorter, longer), len = fft_size(block + shorter - 1);
+		double blocks = std::ceil((double)longer / (double)block);
+		double fft = FFT_OVERHEAD + blocks * FFT_COST * (double)len * std::log2((double)len);
+		return fft < (double)shorter * (double)longer ? ConvolutionMethod::FFT : ConvolutionMethod::DIRECT;
+	}
+
+	Vector convolve(const Vector& x, const Vector& h, ConvolutionMethod method) {
+		MAT_VEC_SCOPE("convolve");
+		if (x.size() == 0 || h.size() == 0) return Vector(0);
+		// -Свёртка коммутативна: фильтром считается более короткий сигнал
+		const Vector& a = x.size() >= h.size() ? x : h;
+		const Vector& b = x.size() >= h.size() ? h : x;
+		if (method == ConvolutionMethod::AUTO) method = choose_convolution(a.size(), b.size());
+		Vector y(a.size() + b.size() - 1);
+		if (method == ConvolutionMethod::DIRECT) convolve_direct(a.data, a.size(), b.data, b.size(), y.data);
+		else convolve_fft(a.data, a.size(), b, y.data);
+		return y;
+	}
+
+	Vector correlate(const Vector& x, const Vector& y, ConvolutionMethod method) {
+		Vector reversed(y.size());
+		std::reverse_copy(y.data, y.data + y.size(), reversed.data);
+		return convolve(x, reversed, method);
+	}
+
+	OverlapAdd::OverlapAdd(const Vector& h, size_t block) : _filter(std::max<size_t>(h.size(), 1)) {
+		_block = block ? block : fft_size(std::max(OLA_FACTOR * _filter, MIN_FFT)) - _filter + 1;
+		_plan = RealFftPlan::get(fft_size(_block + _filter - 1));
+		size_t len = _plan->size();
+		_work.assign(len, 0.0);
+		std::copy(h.data, h.data + h.size(), _work.begin());
+		_h_re.resize(_plan->bins());
+		_h_im.resize(_plan->bins());
+		_plan->forward(_work.data(), _h_re.data(), _h_im.data());
+		_input.resize(_block);
+		_tail.assign(_filter - 1, 0.0);
+	}
+
+	size_t OverlapAdd::block() const {
+		return _block;
+	}
+
+	size_t OverlapAdd::filter_size() const {
+		return _filter;
+	}
+
+	size_t OverlapAdd::fft_length() const {
+		return _plan->size();
+	}
+
+	Vector OverlapAdd::push(const Vector& chunk) {
+		return push(chunk.data, chunk.size());
+	}
+
+	Vector OverlapAdd::push(const double* chunk, size_t count) {
+		Vector out((_filled + count) / _block * _block);
+		_started |= count > 0;
+		size_t written = 0;
+		while (count) {
+			size_t take = std::min(count, _block - _filled);
+			std::memcpy(_input.data() + _filled, chunk, take * sizeof(double));
+			_filled += take;
+			chunk += take;
+			count -= take;
+			if (_filled == _block) {
+				emit(out.data + written, _block);
+				written += _block;
+			}
+		}
+		return out;
+	}
+
+	Vector OverlapAdd::flush() {
+		if (!_started) return Vector(0);
+		Vector out(_filled + _filter - 1);
+		emit(out.data, out.size());
+		reset();
+		return out;
+	}
+
+	void OverlapAdd::reset() {
+		_filled = 0;
+		_started = false;
+		std::fill(_tail.begin(), _tail.end(), 0.0);
+	}
+
+	void OverlapAdd::convolve_block(const double* x, size_t len, double* y) const {
+		size_t n = _plan->size(), bins = _plan->bins();
+		thread_local std::vector<double> buffer;
+		if (buffer.size() < n + 2 * bins) buffer.resize(n + 2 * bins);
+		double* signal = buffer.data(), * re = signal + n, * im = re + bins;
+		std::memcpy(signal, x, len * sizeof(double));
+		std::fill(signal + len, signal + n, 0.0);
+		_plan->forward(signal, re, im);
+		for (size_t k = 0; k < bins; k++) {
+			double r = re[k] * _h_re[k] - im[k] * _h_im[k];
+			im[k] = re[k] * _h_im[k] + im[k] * _h_re[k];
+			re[k] = r;
+		}
+		_plan->inverse(re, im, signal);
+		std::memcpy(y, signal, (len + _filter - 1) * sizeof(double));
+	}
+
+	// -Хвост предыдущего блока прибавляется к началу текущего; count
+	// отсчётов уходят в out, следующие _filter - 1 становятся новым хвостом
+	void OverlapAdd::emit(double* out, size_t count) {
+		MAT_VEC_SCOPE("OverlapAdd::push");
+		convolve_block(_input.data(), _filled, _work.data());
+		for (size_t i = 0; i < _filter - 1; i++) _work[i] += _tail[i];
+		std::memcpy(out, _work.data(), count * sizeof(double));
+		if (count <= _filled) {
+			std::copy(_work.begin() + count, _work.begin() + count + _filter - 1, _tail.begin());
+		}
+		_filled = 0;
+	}
+
+} // namespace mat_vec
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Base.h"
+#include "Fft.h"
+#include "Vector.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace mat_vec {
+
+	enum class ConvolutionMethod {
+		AUTO,       // по оценке стоимости, см. choose_convolution
+		DIRECT,     // по определению, O(n m)
+		FFT         // перекрытием с суммированием через БПФ, O(n log m)
+	};
+
+	// Что выберет AUTO для сигналов длины n и m: прямой способ, пока
+	// короткий сигнал мал или n m меньше оценки стоимости БПФ
+	ConvolutionMethod choose_convolution(size_t n, size_t m);
+
+	// Полная линейная свёртка: n + m - 1 отсчётов,
+	// y[k] = sum_i x[i] h[k - i]. Для пустого сигнала -- пустой вектор
+	Vector convolve(const Vector& x, const Vector& h, ConvolutionMethod method = ConvolutionMethod::AUTO);
+
+	// Полная взаимная корреляция: n + m - 1 отсчётов,
+	// r[k] = sum_i x[i + k - (m - 1)] y[i], то есть r[m - 1] -- нулевой сдвиг
+	Vector correlate(const Vector& x, const Vector& y, ConvolutionMethod method = ConvolutionMethod::AUTO);
+
+	// Потоковая свёртка с фиксированным фильтром h методом перекрытия
+	// с суммированием. Вход приходит кусками любой длины; отсчёты
+	// результата выдаются блоками по block() по мере накопления входа,
+	// а flush() выдаёт остаток. Склеенные выходы push и flush равны
+	// convolve(весь вход, h).
+	// Спектр фильтра считается один раз в конструкторе
+	class OverlapAdd {
+	public:
+		// block -- число входных отсчётов на одно БПФ; 0 -- выбрать по длине h.
+		// Пустой h считается фильтром из одного нуля
+		explicit OverlapAdd(const Vector& h, size_t block = 0);
+
+		size_t block() const;
+		size_t filter_size() const;
+
+		// Длина БПФ: block() + filter_size() - 1, округлённая вверх до fft_size
+		size_t fft_length() const;
+
+		// Добавляет отсчёты сигнала; возвращает готовые отсчёты результата
+		// (кратно block(), возможно ни одного)
+		Vector push(const Vector& chunk);
+		Vector push(const double* chunk, size_t count);
+
+		// Завершает сигнал: возвращает оставшиеся отсчёты и готовит
+		// объект к новому сигналу
+		Vector flush();
+
+		// Забывает текущий сигнал
+		void reset();
+
+		// Свёртка одного блока без учёта потока: y (len + filter_size() - 1
+		// отсчётов) = x (len <= block() отсчётов) * h. Не меняет состояние,
+		// можно вызывать из нескольких потоков сразу
+		void convolve_block(const double* x, size_t len, double* y) const;
+
+	private:
+		// Обрабатывает накопленный блок длины _filled, выдаёт count отсчётов в out
+		void emit(double* out, size_t count);
+
+		size_t _block, _filter;
+		std::shared_ptr<const RealFftPlan> _plan;
+		std::vector<double> _h_re, _h_im;
+		std::vector<double> _input;     // накапливаемый блок
+		std::vector<double> _tail;      // перекрытие: хвост предыдущего блока
+		std::vector<double> _work;
+		size_t _filled = 0;
+		bool _started = false;
+	};
+
+} // namespace mat_vec
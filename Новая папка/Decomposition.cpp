@@ -0,0 +1,490 @@
+#include "Decomposition.h"
+#include "Gemm.h"
+#include "Parallel.h"
+#include "Transpose.h"
+#include "TriangularMatrix.h"
+#include "Vector.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Ширина панели блочных LU и Холецкого
+		const size_t NB = 64;
+
+		// Строк панели Холецкого на задачу
+		const size_t PANEL_GRAIN = 32;
+
+		// Ширина блочного столбца при обновлении остатка в Холецком
+		const size_t UPDATE_BLOCK = 128;
+
+		// Предел QL-итераций на одно собственное значение
+		const size_t QL_MAX_ITERATIONS = 60;
+
+		// -Хаусхолдер (tred2). Работает с Z = V^T: все обращения V[k][j]
+		// алгоритма становятся Z[j][k], и внутренние циклы идут по строкам.
+		// На выходе d -- диагональ, e[1..] -- поддиагональ, строки Z --
+		// накопленные отражения
+		void tridiagonalize(double** z, size_t n, double* d, double* e) {
+			for (size_t j = 0; j < n; j++) d[j] = z[j][n - 1];
+			for (size_t i = n - 1; i > 0; i--) {
+				double scale = 0, h = 0;
+				for (size_t k = 0; k < i; k++) scale += std::abs(d[k]);
+				if (scale == 0) {
+					e[i] = d[i - 1];
+					for (size_t j = 0; j < i; j++) {
+						d[j] = z[j][i - 1];
+						z[j][i] = 0;
+						z[i][j] = 0;
+					}
+				}
+				else {
+					for (size_t k = 0; k < i; k++) {
+						d[k] /= scale;
+						h += d[k] * d[k];
+					}
+					double f = d[i - 1], g = std::sqrt(h);
+					if (f > 0) g = -g;
+					e[i] = scale * g;
+					h -= f * g;
+					d[i - 1] = f - g;
+					for (size_t j = 0; j < i; j++) e[j] = 0;
+					for (size_t j = 0; j < i; j++) {
+						f = d[j];
+						z[i][j] = f;
+						g = e[j] + z[j][j] * f;
+						const double* zj = z[j];
+						for (size_t k = j + 1; k < i; k++) {
+							g += zj[k] * d[k];
+							e[k] += zj[k] * f;
+						}
+						e[j] = g;
+					}
+					f = 0;
+					for (size_t j = 0; j < i; j++) {
+						e[j] /= h;
+						f += e[j] * d[j];
+					}
+					double hh = f / (h + h);
+					for (size_t j = 0; j < i; j++) e[j] -= hh * d[j];
+					for (size_t j = 0; j < i; j++) {
+						f = d[j];
+						g = e[j];
+						double* zj = z[j];
+						for (size_t k = j; k < i; k++) zj[k] -= f * e[k] + g * d[k];
+						d[j] = zj[i - 1];
+						zj[i] = 0;
+					}
+				}
+				d[i] = h;
+			}
+			for (size_t i = 0; i + 1 < n; i++) {
+				z[i][n - 1] = z[i][i];
+				z[i][i] = 1;
+				double h = d[i + 1];
+				if (h != 0) {
+					for (size_t k = 0; k <= i; k++) d[k] = z[i + 1][k] / h;
+					for (size_t j = 0; j <= i; j++) {
+						double g = 0;
+						for (size_t k = 0; k <= i; k++) g += z[i + 1][k] * z[j][k];
+						for (size_t k = 0; k <= i; k++) z[j][k] -= g * d[k];
+					}
+				}
+				for (size_t k = 0; k <= i; k++) z[i + 1][k] = 0;
+			}
+			for (size_t j = 0; j < n; j++) {
+				d[j] = z[j][n - 1];
+				z[j][n - 1] = 0;
+			}
+			z[n - 1][n - 1] = 1;
+			e[0] = 0;
+		}
+
+		// -Неявный QL со сдвигами Уилкинсона (tql2); вращения применяются
+		// к строкам z. false, если значение не сошлось за QL_MAX_ITERATIONS
+		bool ql_implicit(double** z, size_t n, double* d, double* e) {
+			for (size_t i = 1; i < n; i++) e[i - 1] = e[i];
+			e[n - 1] = 0;
+			double f = 0, tst1 = 0;
+			const double eps = std::ldexp(1.0, -52);
+			for (size_t l = 0; l < n; l++) {
+				tst1 = std::max(tst1, std::abs(d[l]) + std::abs(e[l]));
+				size_t m = l;
+				while (m < n - 1 && std::abs(e[m]) > eps * tst1) m++;
+				if (m > l) {
+					size_t iterations = 0;
+					do {
+						if (++iterations > QL_MAX_ITERATIONS) return false;
+						double g = d[l];
+						double p = (d[l + 1] - g) / (2 * e[l]);
+						double r = std::hypot(p, 1.0);
+						if (p < 0) r = -r;
+						d[l] = e[l] / (p + r);
+						d[l + 1] = e[l] * (p + r);
+						double dl1 = d[l + 1], h = g - d[l];
+						for (size_t i = l + 2; i < n; i++) d[i] -= h;
+						f += h;
+						p = d[m];
+						double c = 1, c2 = c, c3 = c, el1 = e[l + 1], s = 0, s2 = 0;
+						for (size_t i = m; i-- > l;) {
+							c3 = c2;
+							c2 = c;
+							s2 = s;
+							g = c * e[i];
+							h = c * p;
+							r = std::hypot(p, e[i]);
+							e[i + 1] = s * r;
+							s = e[i] / r;
+							c = p / r;
+							p = c * d[i] - s * g;
+							d[i + 1] = h + s * (c * g + s * d[i]);
+							double* zi = z[i], * zi1 = z[i + 1];
+							for (size_t k = 0; k < n; k++) {
+								h = zi1[k];
+								zi1[k] = s * zi[k] + c * h;
+								zi[k] = c * zi[k] - s * h;
+							}
+						}
+						p = -s * s2 * c3 * el1 * e[l] / dl1;
+						e[l] = s * p;
+						d[l] = c * p;
+					} while (std::abs(e[l]) > eps * tst1);
+				}
+				d[l] += f;
+				e[l] = 0;
+			}
+			return true;
+		}
+	}
+
+	// -LU-разложение окна на месте
+	bool lu_factor(const MatrixRef& A, size_t* pivots) {
+		MAT_VEC_SCOPE("lu_factor");
+		size_t n = A.n_rows;
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)n * n * n / 3);
+		bool regular = true;
+		for (size_t k0 = 0; k0 < n; k0 += NB) {
+			size_t kb = std::min(NB, n - k0);
+			for (size_t k = k0; k < k0 + kb; k++) {
+				size_t p = k;
+				for (size_t i = k + 1; i < n; i++)
+					if (std::fabs(A.at(i, k)) > std::fabs(A.at(p, k))) p = i;
+				pivots[k] = p;
+				if (p != k) std::swap_ranges(A.row(k), A.row(k) + n, A.row(p));
+				double pivot = A.at(k, k);
+				if (pivot == 0) {
+					regular = false;
+					continue;
+				}
+				const double* rk = A.row(k);
+				for (size_t i = k + 1; i < n; i++) {
+					double* ri = A.row(i);
+					double l = ri[k] /= pivot;
+					for (size_t j = k + 1; j < k0 + kb; j++) ri[j] -= l * rk[j];
+				}
+			}
+			size_t rest = n - k0 - kb;
+			if (rest) {
+				trsm(A.block(k0, k0, kb, kb), true, true, A.block(k0, k0 + kb, kb, rest));
+				gemm(-1.0, A.block(k0 + kb, k0, rest, kb), A.block(k0, k0 + kb, kb, rest), 1.0,
+					A.block(k0 + kb, k0 + kb, rest, rest));
+			}
+		}
+		return regular;
+	}
+
+	// -Решение A X = B по результату lu_factor
+	void lu_solve(const MatrixRef& lu, const size_t* pivots, const MatrixRef& B) {
+		size_t n = lu.n_rows;
+		for (size_t k = 0; k < n; k++)
+			if (pivots[k] != k) std::swap_ranges(B.row(k), B.row(k) + B.n_cols, B.row(pivots[k]));
+		trsm(lu, true, true, B);
+		trsm(lu, false, false, B);
+	}
+
+	// -LU-разложение
+	LU::LU(const Matrix& a) : _lu(a), _perm(a._size.first), _sign(1), _singular(false) {
+		MAT_VEC_SCOPE("LU");
+		size_t n = _lu._size.first;
+		std::vector<size_t> pivots(n);
+		_singular = !lu_factor(view(_lu), pivots.data());
+		for (size_t i = 0; i < n; i++) _perm[i] = i;
+		for (size_t k = 0; k < n; k++)
+			if (pivots[k] != k) {
+				std::swap(_perm[k], _perm[pivots[k]]);
+				_sign = -_sign;
+			}
+	}
+
+	// -Размер матрицы
+	size_t LU::size() const { return _perm.size(); }
+
+	// -true, если встретился нулевой ведущий элемент
+	bool LU::singular() const { return _singular; }
+
+	// -Решение A x = b
+	Vector LU::solve(const Vector& b) const {
+		size_t n = _perm.size();
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)n * n);
+		Vector x(n, 0);
+		for (size_t i = 0; i < n; i++) x[i] = b[_perm[i]];
+		for (size_t i = 0; i < n; i++) {
+			const double* r = _lu.a[i];
+			double s = x[i];
+			for (size_t j = 0; j < i; j++) s -= r[j] * x[j];
+			x[i] = s;
+		}
+		for (size_t i = n; i-- > 0;) {
+			const double* r = _lu.a[i];
+			double s = x[i];
+			for (size_t j = i + 1; j < n; j++) s -= r[j] * x[j];
+			x[i] = s / r[i];
+		}
+		return x;
+	}
+
+	// -Решение A X = B
+	Matrix LU::solve(const Matrix& b) const {
+		size_t n = _perm.size();
+		Matrix x(n, b._size.second, 0.0);
+		for (size_t i = 0; i < n; i++)
+			std::copy(b.a[_perm[i]], b.a[_perm[i]] + b._size.second, x.a[i]);
+		trsm(view(_lu), true, true, view(x));
+		trsm(view(_lu), false, false, view(x));
+		return x;
+	}
+
+	// -Определитель
+	double LU::det() const {
+		double d = _sign;
+		for (size_t i = 0; i < _perm.size(); i++) d *= _lu.a[i][i];
+		return d;
+	}
+
+	// -Обратная матрица
+	Matrix LU::inv() const {
+		return solve(Matrix::eye(_perm.size()));
+	}
+
+	// -Обновление разложения до A + u v^T
+	void LU::update(const Vector& u, const Vector& v) {
+		MAT_VEC_SCOPE("LU::update");
+		size_t n = _perm.size();
+		MAT_VEC_COUNT_FLOPS(4 * (uint64_t)n * n);
+		// P (A + u v^T) = L U + (P u) v^T
+		std::vector<double> x(n), y(n);
+		for (size_t i = 0; i < n; i++) {
+			x[i] = u[_perm[i]];
+			y[i] = v[i];
+		}
+		double** a = _lu.a;
+		for (size_t j = 0; j < n; j++) {
+			double old = a[j][j];
+			double d = old + x[j] * y[j];
+			for (size_t i = j + 1; i < n; i++) {
+				double l = a[i][j];
+				a[i][j] = (old * l + y[j] * x[i]) / d;
+				x[i] -= x[j] * l;
+			}
+			for (size_t k = j + 1; k < n; k++) {
+				double r = a[j][k];
+				a[j][k] = r + x[j] * y[k];
+				y[k] = (old * y[k] - y[j] * r) / d;
+			}
+			a[j][j] = d;
+		}
+		_singular = false;
+		for (size_t i = 0; i < n; i++) _singular = _singular || a[i][i] == 0;
+	}
+
+	// -Упакованные множители L и U
+	const Matrix& LU::factors() const { return _lu; }
+
+	// -Перестановка строк
+	const std::vector<size_t>& LU::perm() const { return _perm; }
+
+	// -Разложение Холецкого
+	Cholesky::Cholesky(const Matrix& a) : _l(a._size.first, 0.0), _ok(true) {
+		MAT_VEC_SCOPE("Cholesky");
+		size_t n = a._size.first;
+		MAT_VEC_COUNT_FLOPS((uint64_t)n * n * n / 3);
+		double** l = _l.a;
+		for (size_t i = 0; i < n; i++) std::copy(a.a[i], a.a[i] + i + 1, l[i]);
+		MatrixRef L = view(_l);
+		for (size_t k0 = 0; k0 < n; k0 += NB) {
+			size_t kb = std::min(NB, n - k0);
+			for (size_t j = k0; j < k0 + kb; j++) {
+				const double* lj = l[j];
+				double s = lj[j];
+				for (size_t k = k0; k < j; k++) s -= lj[k] * lj[k];
+				if (!(s > 0)) {
+					_ok = false;
+					break;
+				}
+				double d = std::sqrt(s);
+				l[j][j] = d;
+				for (size_t i = j + 1; i < k0 + kb; i++) {
+					const double* li = l[i];
+					double t = li[j];
+					for (size_t k = k0; k < j; k++) t -= li[k] * lj[k];
+					l[i][j] = t / d;
+				}
+			}
+			size_t rest = n - k0 - kb;
+			if (!_ok || !rest) break;
+			// строки панели под блоком решаются независимо
+			parallel_for(k0 + kb, n, PANEL_GRAIN, [&](size_t from, size_t to) {
+				for (size_t i = from; i < to; i++) {
+					double* li = l[i];
+					for (size_t j = k0; j < k0 + kb; j++) {
+						const double* lj = l[j];
+						double t = li[j];
+						for (size_t k = k0; k < j; k++) t -= li[k] * lj[k];
+						li[j] = t / lj[j];
+					}
+				}
+			});
+			// остаток -= L21 L21^T только в нижнем треугольнике: блочные
+			// столбцы от диагонали вниз, вдвое меньше умножений, чем у
+			// полного произведения. Над диагональю в диагональных блоках
+			// получается мусор, он обнуляется в конце
+			MatrixRef L21 = L.block(k0 + kb, k0, rest, kb);
+			Matrix t(kb, rest, 0.0);
+			MatrixRef T = view(t);
+			transpose(L21, T);
+			for (size_t j0 = 0; j0 < rest; j0 += UPDATE_BLOCK) {
+				size_t jb = std::min(UPDATE_BLOCK, rest - j0);
+				gemm(-1.0, L21.block(j0, 0, rest - j0, kb), T.block(0, j0, kb, jb), 1.0,
+					L.block(k0 + kb + j0, k0 + kb + j0, rest - j0, jb));
+			}
+		}
+		for (size_t i = 0; i < n; i++) std::fill(l[i] + i + 1, l[i] + n, 0.0);
+	}
+
+	// -false, если матрица не положительно определена
+	bool Cholesky::ok() const { return _ok; }
+
+	// -Решение A x = b
+	Vector Cholesky::solve(const Vector& b) const {
+		size_t n = _l._size.first;
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)n * n);
+		Vector x = b;
+		for (size_t i = 0; i < n; i++) {
+			const double* r = _l.a[i];
+			double s = x[i];
+			for (size_t j = 0; j < i; j++) s -= r[j] * x[j];
+			x[i] = s / r[i];
+		}
+		// L^T x = y: по строкам L, вычитая найденный x[i] из предыдущих
+		for (size_t i = n; i-- > 0;) {
+			const double* r = _l.a[i];
+			x[i] /= r[i];
+			for (size_t j = 0; j < i; j++) x[j] -= r[j] * x[i];
+		}
+		return x;
+	}
+
+	// -Решение A X = B
+	Matrix Cholesky::solve(const Matrix& b) const {
+		size_t n = _l._size.first, m = b._size.second;
+		Matrix x = b;
+		trsm(view(_l), true, false, view(x));
+		for (size_t i = n; i-- > 0;) {
+			const double* r = _l.a[i];
+			double* xi = x.a[i];
+			double d = 1 / r[i];
+			for (size_t c = 0; c < m; c++) xi[c] *= d;
+			for (size_t j = 0; j < i; j++) {
+				double* xj = x.a[j];
+				for (size_t c = 0; c < m; c++) xj[c] -= r[j] * xi[c];
+			}
+		}
+		return x;
+	}
+
+	// -Определитель
+	double Cholesky::det() const {
+		double d = 1;
+		for (int i = 0; i < _l._size.first; i++) d *= _l.a[i][i] * _l.a[i][i];
+		return d;
+	}
+
+	// -Обновление до A + x x^T
+	void Cholesky::update(const Vector& x) {
+		MAT_VEC_SCOPE("Cholesky::update");
+		size_t n = _l._size.first;
+		std::vector<double> w(n);
+		for (size_t i = 0; i < n; i++) w[i] = x[i];
+		double** l = _l.a;
+		for (size_t k = 0; k < n; k++) {
+			double r = std::hypot(l[k][k], w[k]);
+			double c = r / l[k][k], s = w[k] / l[k][k];
+			l[k][k] = r;
+			for (size_t i = k + 1; i < n; i++) {
+				l[i][k] = (l[i][k] + s * w[i]) / c;
+				w[i] = c * w[i] - s * l[i][k];
+			}
+		}
+	}
+
+	// -Обновление до A - x x^T
+	bool Cholesky::downdate(const Vector& x) {
+		MAT_VEC_SCOPE("Cholesky::downdate");
+		size_t n = _l._size.first;
+		Matrix saved = _l;
+		std::vector<double> w(n);
+		for (size_t i = 0; i < n; i++) w[i] = x[i];
+		double** l = _l.a;
+		for (size_t k = 0; k < n; k++) {
+			double r2 = l[k][k] * l[k][k] - w[k] * w[k];
+			if (!(r2 > 0)) {
+				_l = saved;
+				return false;
+			}
+			double r = std::sqrt(r2);
+			double c = r / l[k][k], s = w[k] / l[k][k];
+			l[k][k] = r;
+			for (size_t i = k + 1; i < n; i++) {
+				l[i][k] = (l[i][k] - s * w[i]) / c;
+				w[i] = c * w[i] - s * l[i][k];
+			}
+		}
+		return true;
+	}
+
+	// -Нижний треугольный множитель
+	const Matrix& Cholesky::factor() const { return _l; }
+
+	// -Z = A^T (нижний треугольник A -- верхний Z), трёхдиагонализация,
+	// QL, сортировка по убыванию; строки Z -- собственные векторы
+	SymmetricEigen::SymmetricEigen(const Matrix& a)
+		: _values(a._size.first), _vectors(a._size.first, a._size.first, 0.0), _ok(true) {
+		MAT_VEC_SCOPE("SymmetricEigen");
+		size_t n = a._size.first;
+		if (n == 0) return;
+		Matrix z(n, n, 0.0);
+		transpose(view(a), view(z));
+		std::vector<double> d(n), e(n);
+		tridiagonalize(z.a, n, d.data(), e.data());
+		_ok = ql_implicit(z.a, n, d.data(), e.data());
+		std::vector<size_t> order(n);
+		for (size_t i = 0; i < n; i++) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) { return d[x] > d[y]; });
+		for (size_t k = 0; k < n; k++) {
+			_values[k] = d[order[k]];
+			const double* v = z.a[order[k]];
+			for (size_t i = 0; i < n; i++) _vectors.a[i][k] = v[i];
+		}
+	}
+
+	bool SymmetricEigen::ok() const { return _ok; }
+
+	const Vector& SymmetricEigen::values() const { return _values; }
+
+	const Matrix& SymmetricEigen::vectors() const { return _vectors; }
+
+} // namespace mat_vec
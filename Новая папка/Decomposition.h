@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Base.h"
+#include "Gemm.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include <cstddef>
+#include <vector>
+
+namespace mat_vec {
+
+	// LU-разложение квадратного окна на месте, без выделения памяти.
+	// pivots (длины n) -- на шаге k строка k переставлена со строкой pivots[k].
+	// false, если встретился нулевой ведущий элемент
+	bool lu_factor(const MatrixRef& A, size_t* pivots);
+
+	// B = A^{-1} B по результату lu_factor
+	void lu_solve(const MatrixRef& lu, const size_t* pivots, const MatrixRef& B);
+
+	// LU-разложение с частичным выбором ведущего элемента: P A = L U.
+	// L (с единичной диагональю) и U хранятся в одной матрице.
+	// Блочный алгоритм: панели раскладываются построчно, остаток -- через trsm и gemm
+	class LU {
+	public:
+		explicit LU(const Matrix& a);
+
+		// Размер матрицы
+		size_t size() const;
+
+		// true, если встретился нулевой ведущий элемент
+		bool singular() const;
+
+		// Решение A x = b
+		Vector solve(const Vector& b) const;
+
+		// Решение A X = B
+		Matrix solve(const Matrix& b) const;
+
+		// Определитель
+		double det() const;
+
+		// Обратная матрица
+		Matrix inv() const;
+
+		// Обновление разложения до A + u v^T за O(n^2) (алгоритм Беннета).
+		// Новых перестановок строк не делается, поэтому после многих
+		// обновлений точность может падать
+		void update(const Vector& u, const Vector& v);
+
+		// Упакованные множители L и U
+		const Matrix& factors() const;
+
+		// Строка i матрицы P A -- строка perm()[i] матрицы A
+		const std::vector<size_t>& perm() const;
+
+	private:
+		Matrix _lu;
+		std::vector<size_t> _perm;
+		int _sign;
+		bool _singular;
+	};
+
+	// Разложение Холецкого симметричной положительно определённой матрицы: A = L L^T.
+	// Используется нижний треугольник A. Блочный алгоритм, как у LU: строки
+	// панели считаются параллельно, остаток обновляется через gemm
+	class Cholesky {
+	public:
+		explicit Cholesky(const Matrix& a);
+
+		// false, если матрица не положительно определена
+		bool ok() const;
+
+		// Решение A x = b
+		Vector solve(const Vector& b) const;
+
+		// Решение A X = B
+		Matrix solve(const Matrix& b) const;
+
+		// Определитель
+		double det() const;
+
+		// Обновление до A + x x^T за O(n^2)
+		void update(const Vector& x);
+
+		// Обновление до A - x x^T за O(n^2); false (и разложение не меняется),
+		// если результат не положительно определён
+		bool downdate(const Vector& x);
+
+		// Нижний треугольный множитель L (над диагональю -- нули)
+		const Matrix& factor() const;
+
+	private:
+		Matrix _l;
+		bool _ok;
+	};
+
+	// Разложение симметричной матрицы: A = V diag(values) V^T, V ортогональна.
+	// Используется нижний треугольник A. Приведение к трёхдиагональному виду
+	// отражениями Хаусхолдера и неявный QL-алгоритм со сдвигами (tred2 и tql2
+	// из EISPACK); собственные векторы хранятся строками, так что вращения
+	// идут по непрерывной памяти
+	class SymmetricEigen {
+	public:
+		explicit SymmetricEigen(const Matrix& a);
+
+		// false, если QL-итерация не сошлась
+		bool ok() const;
+
+		// Собственные значения по убыванию
+		const Vector& values() const;
+
+		// Собственные векторы -- столбцы, в порядке values()
+		const Matrix& vectors() const;
+
+	private:
+		Vector _values;
+		Matrix _vectors;
+		bool _ok;
+	};
+
+} // namespace mat_vec
@@ -0,0 +1,74 @@
+#include "DiagonalMatrix.h"
+#include "Matrix.h"
+#include "Profiler.h"
+
+namespace mat_vec {
+
+	// -Конструирует матрицу size x size со значениями value на диагонали
+	DiagonalMatrix::DiagonalMatrix(size_t size, double value) : _diag(size, value) {}
+
+	// -Конструирует матрицу с диагональю diag
+	DiagonalMatrix::DiagonalMatrix(const Vector& diag) : _diag(diag) {}
+
+	// -Размер матрицы
+	size_t DiagonalMatrix::size() const { return _diag.size(); }
+
+	// -Доступ к n-му элементу диагонали
+	double DiagonalMatrix::operator[](size_t n) const { return _diag[n]; }
+	double& DiagonalMatrix::operator[](size_t n) { return _diag[n]; }
+
+	// -Возвращает элемент на позиции [row, col]
+	double DiagonalMatrix::get(size_t row, size_t col) const { return row == col ? _diag[row] : 0; }
+
+	// -Умножение на вектор
+	Vector DiagonalMatrix::operator*(const Vector& vec) const {
+		return _diag ^ vec;
+	}
+
+	// -Умножение на матрицу слева
+	Matrix DiagonalMatrix::operator*(const Matrix& mat) const {
+		MAT_VEC_COUNT_FLOPS((uint64_t)mat._size.first * mat._size.second);
+		Matrix c = mat;
+		for (int i = 0; i < c._size.first; i++)
+			for (int j = 0; j < c._size.second; j++) c.a[i][j] *= _diag[i];
+		return c;
+	}
+
+	// -Решение D x = b
+	Vector DiagonalMatrix::solve(const Vector& b) const {
+		Vector x = b;
+		for (size_t i = 0; i < x.size(); i++) x[i] /= _diag[i];
+		return x;
+	}
+
+	// -Определитель
+	double DiagonalMatrix::det() const {
+		double d = 1;
+		for (size_t i = 0; i < _diag.size(); i++) d *= _diag[i];
+		return d;
+	}
+
+	// -Обратная матрица
+	DiagonalMatrix DiagonalMatrix::inv() const {
+		DiagonalMatrix d(_diag.size());
+		for (size_t i = 0; i < _diag.size(); i++) d._diag[i] = 1 / _diag[i];
+		return d;
+	}
+
+	// -Плотная матрица с той же диагональю
+	Matrix DiagonalMatrix::to_dense() const {
+		Matrix m(_diag.size(), 0.0);
+		for (size_t i = 0; i < _diag.size(); i++) m.a[i][i] = _diag[i];
+		return m;
+	}
+
+	// -Умножение матрицы на диагональную справа
+	Matrix operator*(const Matrix& mat, const DiagonalMatrix& d) {
+		MAT_VEC_COUNT_FLOPS((uint64_t)mat._size.first * mat._size.second);
+		Matrix c = mat;
+		for (int i = 0; i < c._size.first; i++)
+			for (int j = 0; j < c._size.second; j++) c.a[i][j] *= d[j];
+		return c;
+	}
+
+} // namespace mat_vec
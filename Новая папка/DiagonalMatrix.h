@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Base.h"
+#include "Vector.h"
+#include <cstddef>
+
+namespace mat_vec {
+
+	// Диагональная матрица; хранит только диагональ
+	class DiagonalMatrix {
+	public:
+		// Конструирует матрицу size x size со значениями value на диагонали
+		explicit DiagonalMatrix(size_t size, double value = 0);
+
+		// Конструирует матрицу с диагональю diag
+		explicit DiagonalMatrix(const Vector& diag);
+
+		// Размер матрицы
+		size_t size() const;
+
+		// Доступ к n-му элементу диагонали
+		double operator[](size_t n) const;
+		double& operator[](size_t n);
+
+		// Возвращает элемент на позиции [row, col]
+		double get(size_t row, size_t col) const;
+
+		// Умножение на вектор, O(n)
+		Vector operator*(const Vector& vec) const;
+
+		// Умножение на матрицу слева (масштабирование строк)
+		Matrix operator*(const Matrix& mat) const;
+
+		// Решение D x = b
+		Vector solve(const Vector& b) const;
+
+		// Определитель
+		double det() const;
+
+		// Обратная матрица
+		DiagonalMatrix inv() const;
+
+		// Плотная матрица с той же диагональю
+		Matrix to_dense() const;
+
+	private:
+		Vector _diag;
+	};
+
+	// Умножение матрицы на диагональную справа (масштабирование столбцов)
+	Matrix operator*(const Matrix& mat, const DiagonalMatrix& d);
+
+} // namespace mat_vec
@@ -0,0 +1,190 @@
+#include "Distance.h"
+#include "Gemm.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Transpose.h"
+#include <algorithm>
+#include <cmath>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Наименьшая сторона блока, даже если block_bytes меньше
+		const size_t MIN_TILE = 64;
+
+		// Строк на задачу при досчёте метрики
+		const size_t ROW_GRAIN = 16;
+
+		struct Tiling {
+			size_t rows;
+			size_t cols;
+		};
+
+		// Полоса B^T -- dim x cols, блок произведений -- rows x cols (если нужен)
+		Tiling tiling(size_t na, size_t nb, size_t dim, size_t bytes, bool with_tile) {
+			size_t budget = std::max<size_t>(bytes / sizeof(double), 1);
+			size_t d = std::max<size_t>(dim, 1);
+			Tiling t;
+			t.cols = std::min(nb, std::max(MIN_TILE, budget / (2 * d)));
+			t.rows = na;
+			if (with_tile) {
+				size_t rest = budget > d * t.cols ? budget - d * t.cols : 0;
+				t.rows = std::min(na, std::max(MIN_TILE, rest / t.cols));
+			}
+			return t;
+		}
+
+		// Отрицательный остаток сокращения -- ноль; NaN сохраняется
+		double non_negative(double v) {
+			return v < 0 ? 0 : v;
+		}
+
+		// g[j] = metric по скалярным произведениям g[j], норме x и нормам y[j]
+		void finish_row(Metric metric, double* g, size_t n, double x, const double* y) {
+			switch (metric) {
+			case Metric::SQUARED_L2:
+				for (size_t j = 0; j < n; j++) g[j] = non_negative(x + y[j] - 2 * g[j]);
+				break;
+			case Metric::L2:
+				for (size_t j = 0; j < n; j++) g[j] = std::sqrt(non_negative(x + y[j] - 2 * g[j]));
+				break;
+			case Metric::DOT:
+				break;
+			case Metric::COSINE_SIMILARITY:
+			case Metric::COSINE_DISTANCE: {
+				double sx = std::sqrt(x);
+				double shift = metric == Metric::COSINE_DISTANCE ? 1 : 0;
+				double sign = metric == Metric::COSINE_DISTANCE ? -1 : 1;
+				for (size_t j = 0; j < n; j++) {
+					double den = sx * std::sqrt(y[j]);
+					g[j] = shift + sign * (den > 0 ? g[j] / den : 0);
+				}
+				break;
+			}
+			}
+		}
+
+		// Диагональ при совпадающих наборах: a.a = ||a||^2 точно
+		void fix_diagonal(Metric metric, const double* norms, size_t i, double& value) {
+			double g = norms[i];
+			finish_row(metric, &g, 1, norms[i], norms + i);
+			value = g;
+		}
+
+		// Строки b [j0, j0 + cols) транспонируются в полосу bt
+		MatrixRef pack_columns(const MatrixRef& b, size_t j0, size_t cols, const Matrix& bt) {
+			MatrixRef dst = view(bt).block(0, 0, b.n_cols, cols);
+			transpose(b.block(j0, 0, cols, b.n_cols), dst);
+			return dst;
+		}
+
+		bool same(const MatrixRef& a, const MatrixRef& b) {
+			return a.rows == b.rows && a.col == b.col && a.n_rows == b.n_rows && a.n_cols == b.n_cols;
+		}
+	}
+
+	bool is_similarity(Metric metric) {
+		return metric == Metric::DOT || metric == Metric::COSINE_SIMILARITY;
+	}
+
+	// -Запоминает квадраты норм строк
+	PointSet::PointSet(const Matrix& rows) : _rows(rows), _norms(rows._size.first, 0) {
+		size_t n = size(), d = dim();
+		parallel_for(0, n, ROW_GRAIN * 16, [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; i++) {
+				const double* r = rows.a[i];
+				double s = 0;
+				for (size_t j = 0; j < d; j++) s += r[j] * r[j];
+				_norms[i] = s;
+			}
+		});
+	}
+
+	const Matrix& PointSet::rows() const { return _rows; }
+	size_t PointSet::size() const { return _rows._size.first; }
+	size_t PointSet::dim() const { return _rows._size.second; }
+	const Vector& PointSet::squared_norms() const { return _norms; }
+
+	// -Полная матрица метрики, полосами по столбцам
+	Matrix pairwise(const PointSet& a, const PointSet& b, const DistanceOptions& opt) {
+		MAT_VEC_SCOPE("pairwise");
+		size_t na = a.size(), nb = b.size(), d = a.dim();
+		Matrix out(na, nb, 0.0);
+		if (na == 0 || nb == 0) return out;
+		Tiling t = tiling(na, nb, d, opt.block_bytes, false);
+		Matrix bt(d, t.cols, 0.0);
+		const Vector& an = a.squared_norms();
+		const Vector& bn = b.squared_norms();
+		for (size_t j0 = 0; j0 < nb; j0 += t.cols) {
+			size_t cols = std::min(t.cols, nb - j0);
+			MatrixRef btv = pack_columns(view(b.rows()), j0, cols, bt);
+			gemm(1.0, view(a.rows()), btv, 0.0, view(out).block(0, j0, na, cols));
+			parallel_for(0, na, ROW_GRAIN, [&](size_t from, size_t to) {
+				for (size_t i = from; i < to; i++) finish_row(opt.metric, out.a[i] + j0, cols, an[i], bn.data + j0);
+			});
+			if (&a == &b)
+				for (size_t i = j0; i < j0 + cols && i < na; i++) fix_diagonal(opt.metric, an.data, i, out.a[i][i]);
+		}
+		return out;
+	}
+
+	// -k ближайших: блок произведений rows x cols, по куче на строку
+	std::vector<std::vector<Neighbor>> top_k(const PointSet& a, const PointSet& b, size_t k,
+		const DistanceOptions& opt) {
+		return top_k(view(a.rows()), a.squared_norms().data, view(b.rows()), b.squared_norms().data, k, opt);
+	}
+
+	std::vector<std::vector<Neighbor>> top_k(const MatrixRef& a, const double* an,
+		const MatrixRef& b, const double* bn, size_t k, const DistanceOptions& opt) {
+		MAT_VEC_SCOPE("top_k");
+		size_t na = a.n_rows, nb = b.n_rows, d = a.n_cols;
+		bool self = same(a, b);
+		std::vector<std::vector<Neighbor>> result(na);
+		k = std::min(k, nb);
+		if (na == 0 || k == 0) return result;
+
+		bool larger = is_similarity(opt.metric);
+		// x лучше y; вершина кучи -- худший из найденных
+		auto better = [larger](const Neighbor& x, const Neighbor& y) {
+			if (x.distance != y.distance) return larger ? x.distance > y.distance : x.distance < y.distance;
+			return x.index < y.index;
+		};
+		for (auto& r : result) r.reserve(k);
+
+		Tiling t = tiling(na, nb, d, opt.block_bytes, true);
+		Matrix bt(d, t.cols, 0.0), tile(t.rows, t.cols, 0.0);
+		for (size_t j0 = 0; j0 < nb; j0 += t.cols) {
+			size_t cols = std::min(t.cols, nb - j0);
+			MatrixRef btv = pack_columns(b, j0, cols, bt);
+			for (size_t i0 = 0; i0 < na; i0 += t.rows) {
+				size_t rows = std::min(t.rows, na - i0);
+				gemm(1.0, a.block(i0, 0, rows, d), btv, 0.0, view(tile).block(0, 0, rows, cols));
+				parallel_for(0, rows, ROW_GRAIN, [&](size_t from, size_t to) {
+					for (size_t r = from; r < to; r++) {
+						size_t i = i0 + r;
+						double* g = tile.a[r];
+						finish_row(opt.metric, g, cols, an[i], bn + j0);
+						if (self && i >= j0 && i < j0 + cols) fix_diagonal(opt.metric, an, i, g[i - j0]);
+						std::vector<Neighbor>& heap = result[i];
+						for (size_t j = 0; j < cols; j++) {
+							Neighbor c = { j0 + j, g[j] };
+							if (heap.size() < k) {
+								heap.push_back(c);
+								std::push_heap(heap.begin(), heap.end(), better);
+							}
+							else if (better(c, heap.front())) {
+								std::pop_heap(heap.begin(), heap.end(), better);
+								heap.back() = c;
+								std::push_heap(heap.begin(), heap.end(), better);
+							}
+						}
+					}
+				});
+			}
+		}
+		for (auto& r : result) std::sort_heap(r.begin(), r.end(), better);
+		return result;
+	}
+
+} // namespace mat_vec
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Base.h"
+#include "Gemm.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include <cstddef>
+#include <vector>
+
+namespace mat_vec {
+
+	// Мера близости строк
+	enum class Metric {
+		SQUARED_L2,         // ||a - b||^2
+		L2,                 // ||a - b||
+		DOT,                // a . b (сходство)
+		COSINE_SIMILARITY,  // a . b / (||a|| ||b||); для нулевой строки 0
+		COSINE_DISTANCE     // 1 - COSINE_SIMILARITY
+	};
+
+	// true, если для метрики ближе -- больше (DOT, COSINE_SIMILARITY)
+	bool is_similarity(Metric metric);
+
+	// Набор точек -- строки матрицы -- с запомненными квадратами норм строк.
+	// Матрица не копируется и должна жить дольше набора
+	class PointSet {
+	public:
+		explicit PointSet(const Matrix& rows);
+
+		const Matrix& rows() const;
+		size_t size() const;
+		size_t dim() const;
+
+		// ||row_i||^2
+		const Vector& squared_norms() const;
+
+	private:
+		const Matrix& _rows;
+		Vector _norms;
+	};
+
+	struct DistanceOptions {
+		Metric metric = Metric::L2;
+		// Предел памяти на промежуточные блоки (транспонированная полоса B
+		// и блок скалярных произведений); результат сюда не входит
+		size_t block_bytes = 32 << 20;
+	};
+
+	// Сосед: номер строки и значение метрики
+	struct Neighbor {
+		size_t index;
+		double distance;
+	};
+
+	// Матрица D[i][j] = metric(a_i, b_j) через ||a||^2 + ||b||^2 - 2 a.b:
+	// произведения считаются блоками gemm, нормы берутся из PointSet.
+	// Для очень близких точек L2 теряет относительную точность (вычитание
+	// близких чисел); если a и b -- один и тот же набор, диагональ точная
+	Matrix pairwise(const PointSet& a, const PointSet& b, const DistanceOptions& opt = DistanceOptions());
+
+	// Для каждой строки a -- k ближайших строк b (по возрастанию расстояния
+	// или убыванию сходства; при равенстве -- меньший индекс).
+	// Полная матрица расстояний не строится
+	std::vector<std::vector<Neighbor>> top_k(const PointSet& a, const PointSet& b, size_t k,
+		const DistanceOptions& opt = DistanceOptions());
+
+	// То же для окон a и b с квадратами норм строк a_norms и b_norms
+	std::vector<std::vector<Neighbor>> top_k(const MatrixRef& a, const double* a_norms,
+		const MatrixRef& b, const double* b_norms, size_t k, const DistanceOptions& opt = DistanceOptions());
+
+} // namespace mat_vec
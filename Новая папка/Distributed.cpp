@@ -0,0 +1,544 @@
+#include "Distributed.h"
+#include "Gemm.h"
+#include "Matrix.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define MAT_VEC_POSIX_SOCKETS
+#endif
+
+namespace mat_vec {
+
+	namespace {
+
+		typedef std::chrono::steady_clock clock;
+
+		double seconds_since(clock::time_point t0) {
+			return std::chrono::duration<double>(clock::now() - t0).count();
+		}
+
+		// Типы сообщений
+		const uint32_t MSG_JOB = 1;       // a -- строк, b -- столбцов C у узла, c -- шагов, d -- наибольшая ширина полосы
+		const uint32_t MSG_PANEL = 2;     // a -- ширина полосы; далее строки A (a x ширина) и B (ширина x b)
+		const uint32_t MSG_RESULT = 3;    // a, b -- размеры локального C, c -- полос; далее C и два double времени
+		const uint32_t MSG_SHUTDOWN = 4;
+
+		// Наибольшее число double в одном буфере задания (локальный C,
+		// полоса A и B): 2 ГиБ. Задание с большими размерами отклоняется
+		const uint64_t MAX_JOB_DOUBLES = uint64_t(1) << 28;
+
+		struct MessageHeader {
+			uint32_t type;
+			uint32_t reserved;
+			uint64_t a;
+			uint64_t b;
+			uint64_t c;
+			uint64_t d;
+		};
+
+		// Глобальные номера строк (или столбцов), принадлежащих части part
+		// из parts при циклическом распределении блоками по block
+		std::vector<size_t> owned(size_t n, size_t block, size_t parts, size_t part) {
+			std::vector<size_t> out;
+			for (size_t start = part * block; start < n; start += parts * block)
+				for (size_t i = start; i < std::min(n, start + block); i++) out.push_back(i);
+			return out;
+		}
+
+		// Окно на непрерывный буфер rows x cols (указатели строк в ptrs)
+		MatrixRef contiguous(std::vector<double*>& ptrs, double* data, size_t rows, size_t cols) {
+			ptrs.resize(rows);
+			for (size_t i = 0; i < rows; i++) ptrs[i] = data + i * cols;
+			return { ptrs.data(), 0, rows, cols };
+		}
+
+#ifdef MAT_VEC_POSIX_SOCKETS
+#ifdef MSG_NOSIGNAL
+		const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+		const int SEND_FLAGS = 0;
+#endif
+
+		bool send_all(int fd, const void* data, size_t bytes) {
+			const char* p = static_cast<const char*>(data);
+			while (bytes > 0) {
+				ssize_t k = ::send(fd, p, bytes, SEND_FLAGS);
+				if (k < 0 && errno == EINTR) continue;
+				if (k <= 0) return false;
+				p += k;
+				bytes -= (size_t)k;
+			}
+			return true;
+		}
+
+		bool recv_all(int fd, void* data, size_t bytes) {
+			char* p = static_cast<char*>(data);
+			while (bytes > 0) {
+				ssize_t k = ::recv(fd, p, bytes, 0);
+				if (k < 0 && errno == EINTR) continue;
+				if (k <= 0) return false;
+				p += k;
+				bytes -= (size_t)k;
+			}
+			return true;
+		}
+
+		bool send_header(int fd, uint32_t type, uint64_t a = 0, uint64_t b = 0, uint64_t c = 0, uint64_t d = 0) {
+			MessageHeader h = { type, 0, a, b, c, d };
+			return send_all(fd, &h, sizeof(h));
+		}
+
+		void close_fd(int& fd) {
+			if (fd >= 0) ::close(fd);
+			fd = -1;
+		}
+
+		// Разобранный адрес: unix-сокет или tcp хост:порт
+		struct Endpoint {
+			bool unix_socket = false;
+			std::string path;
+			std::string host;
+			std::string port;
+		};
+
+		bool parse_address(const std::string& address, Endpoint& out) {
+			if (address.compare(0, 5, "unix:") == 0) {
+				out.unix_socket = true;
+				out.path = address.substr(5);
+				return !out.path.empty() && out.path.size() < sizeof(sockaddr_un().sun_path);
+			}
+			if (address.compare(0, 4, "tcp:") == 0) {
+				std::string rest = address.substr(4);
+				size_t colon = rest.rfind(':');
+				if (colon == std::string::npos || colon == 0 || colon + 1 == rest.size()) return false;
+				out.host = rest.substr(0, colon);
+				out.port = rest.substr(colon + 1);
+				return true;
+			}
+			return false;
+		}
+
+		sockaddr_un unix_address(const std::string& path) {
+			sockaddr_un sa;
+			std::memset(&sa, 0, sizeof(sa));
+			sa.sun_family = AF_UNIX;
+			std::memcpy(sa.sun_path, path.c_str(), path.size());
+			return sa;
+		}
+
+		void set_nodelay(int fd) {
+			int one = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		}
+
+		// Открывает соединение с узлом; -1 при ошибке
+		int connect_to(const std::string& address) {
+			Endpoint ep;
+			if (!parse_address(address, ep)) return -1;
+			if (ep.unix_socket) {
+				int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+				if (fd < 0) return -1;
+				sockaddr_un sa = unix_address(ep.path);
+				if (::connect(fd, (sockaddr*)&sa, sizeof(sa)) != 0) close_fd(fd);
+				return fd;
+			}
+			addrinfo hints;
+			std::memset(&hints, 0, sizeof(hints));
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			addrinfo* list = nullptr;
+			if (getaddrinfo(ep.host.c_str(), ep.port.c_str(), &hints, &list) != 0) return -1;
+			int fd = -1;
+			for (addrinfo* ai = list; ai && fd < 0; ai = ai->ai_next) {
+				fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+				if (fd >= 0 && ::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) close_fd(fd);
+			}
+			freeaddrinfo(list);
+			if (fd >= 0) set_nodelay(fd);
+			return fd;
+		}
+
+		// Кольцо буферов полос между потоком приёма и вычислением
+		struct PanelRing {
+			static const size_t SLOTS = 3;
+
+			struct Slot {
+				std::vector<double> a;
+				std::vector<double> b;
+				size_t width = 0;
+			};
+
+			Slot slots[SLOTS];
+			std::mutex lock;
+			std::condition_variable cv;
+			size_t produced = 0;
+			size_t consumed = 0;
+			bool failed = false;
+		};
+
+		// x y <= limit без переполнения
+		bool product_fits(uint64_t x, uint64_t y, uint64_t limit) {
+			return y == 0 || x <= limit / y;
+		}
+
+		// Размеры из заголовка задания допустимы: локальный C и полоса
+		// наибольшей ширины (сообщение MSG_PANEL) не больше MAX_JOB_DOUBLES,
+		// и ширина полосы есть, если есть шаги
+		bool job_fits(const MessageHeader& job) {
+			uint64_t rows = job.a, cols = job.b, steps = job.c, width = job.d;
+			if (rows > MAX_JOB_DOUBLES || cols > MAX_JOB_DOUBLES || (steps > 0) != (width > 0)) return false;
+			return product_fits(rows, cols, MAX_JOB_DOUBLES) && product_fits(rows + cols, width, MAX_JOB_DOUBLES);
+		}
+
+		// Задание узла: приём полос в отдельном потоке, gemm в текущем
+		bool run_job(int fd, const MessageHeader& job) {
+			MAT_VEC_SCOPE("distributed::worker");
+			if (!job_fits(job)) return false;
+			size_t rows = (size_t)job.a, cols = (size_t)job.b, steps = (size_t)job.c, width = (size_t)job.d;
+			Matrix c(rows, cols, 0.0);
+			PanelRing ring;
+			for (auto& s : ring.slots) {
+				s.a.resize(rows * width);
+				s.b.resize(width * cols);
+			}
+
+			std::thread receiver([&] {
+				for (size_t step = 0; step < steps; step++) {
+					{
+						std::unique_lock<std::mutex> guard(ring.lock);
+						ring.cv.wait(guard, [&] { return ring.produced - ring.consumed < PanelRing::SLOTS; });
+					}
+					PanelRing::Slot& s = ring.slots[step % PanelRing::SLOTS];
+					MessageHeader h;
+					bool ok = recv_all(fd, &h, sizeof(h)) && h.type == MSG_PANEL && h.a > 0 && h.a <= width &&
+						recv_all(fd, s.a.data(), rows * h.a * sizeof(double)) &&
+						recv_all(fd, s.b.data(), h.a * cols * sizeof(double));
+					std::lock_guard<std::mutex> guard(ring.lock);
+					if (!ok) {
+						ring.failed = true;
+						ring.cv.notify_all();
+						return;
+					}
+					s.width = (size_t)h.a;
+					ring.produced++;
+					ring.cv.notify_all();
+				}
+			});
+
+			double compute = 0, wait = 0;
+			bool ok = true;
+			std::vector<double*> pa, pb;
+			for (size_t step = 0; step < steps; step++) {
+				clock::time_point t0 = clock::now();
+				{
+					std::unique_lock<std::mutex> guard(ring.lock);
+					ring.cv.wait(guard, [&] { return ring.produced > step || ring.failed; });
+					if (ring.produced <= step) {
+						ok = false;
+						break;
+					}
+				}
+				wait += seconds_since(t0);
+				PanelRing::Slot& s = ring.slots[step % PanelRing::SLOTS];
+				t0 = clock::now();
+				gemm(1.0, contiguous(pa, s.a.data(), rows, s.width), contiguous(pb, s.b.data(), s.width, cols), 1.0, view(c));
+				compute += seconds_since(t0);
+				std::lock_guard<std::mutex> guard(ring.lock);
+				ring.consumed++;
+				ring.cv.notify_all();
+			}
+			receiver.join();
+			if (!ok) return false;
+
+			double times[2] = { compute, wait };
+			return send_header(fd, MSG_RESULT, rows, cols, steps) &&
+				(rows * cols == 0 || send_all(fd, c.a[0], rows * cols * sizeof(double))) &&
+				send_all(fd, times, sizeof(times));
+		}
+#endif
+	}
+
+#ifdef MAT_VEC_POSIX_SOCKETS
+	WorkerServer::~WorkerServer() {
+		close_fd(_fd);
+		if (!_unix_path.empty()) ::unlink(_unix_path.c_str());
+	}
+
+	// -Открывает слушающий сокет
+	bool WorkerServer::listen(const std::string& address) {
+		Endpoint ep;
+		if (_fd >= 0 || !parse_address(address, ep)) return false;
+		if (ep.unix_socket) {
+			_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (_fd < 0) return false;
+			::unlink(ep.path.c_str());
+			sockaddr_un sa = unix_address(ep.path);
+			if (::bind(_fd, (sockaddr*)&sa, sizeof(sa)) != 0 || ::listen(_fd, 16) != 0) {
+				close_fd(_fd);
+				return false;
+			}
+			_unix_path = ep.path;
+			_address = address;
+			return true;
+		}
+
+		addrinfo hints;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_PASSIVE;
+		addrinfo* list = nullptr;
+		if (getaddrinfo(ep.host.c_str(), ep.port.c_str(), &hints, &list) != 0) return false;
+		for (addrinfo* ai = list; ai && _fd < 0; ai = ai->ai_next) {
+			_fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+			if (_fd < 0) continue;
+			int one = 1;
+			setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+			if (::bind(_fd, ai->ai_addr, ai->ai_addrlen) != 0 || ::listen(_fd, 16) != 0) close_fd(_fd);
+		}
+		freeaddrinfo(list);
+		if (_fd < 0) return false;
+
+		// фактический порт (для порта 0 его выбрала система)
+		sockaddr_storage ss;
+		socklen_t len = sizeof(ss);
+		if (getsockname(_fd, (sockaddr*)&ss, &len) != 0) {
+			close_fd(_fd);
+			return false;
+		}
+		unsigned port = ss.ss_family == AF_INET6 ? ntohs(((sockaddr_in6*)&ss)->sin6_port) : ntohs(((sockaddr_in*)&ss)->sin_port);
+		_address = "tcp:" + ep.host + ":" + std::to_string(port);
+		return true;
+	}
+
+	// -Цикл приёма соединений
+	bool WorkerServer::serve() {
+		if (_fd < 0) return false;
+		while (!_stop) {
+			int conn = ::accept(_fd, nullptr, nullptr);
+			if (conn < 0) {
+				if (errno == EINTR) continue;
+				return false;
+			}
+			{
+				std::lock_guard<std::mutex> guard(_lock);
+				if (_stop) {
+					::close(conn);
+					break;
+				}
+				_conn = conn;
+			}
+			if (_unix_path.empty()) set_nodelay(conn);
+			bool more = handle(conn);
+			{
+				std::lock_guard<std::mutex> guard(_lock);
+				_conn = -1;
+			}
+			::close(conn);
+			if (!more) break;
+		}
+		return true;
+	}
+
+	// -Соединение с самим собой будит accept; shutdown обслуживаемого
+	// соединения прерывает recv в handle и в приёме полос задания.
+	// Под _lock соединение не закрывается, и его номер не может быть
+	// переиспользован до вызова shutdown
+	void WorkerServer::stop() {
+		_stop = true;
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			if (_conn >= 0) ::shutdown(_conn, SHUT_RDWR);
+		}
+		int fd = connect_to(_address);
+		close_fd(fd);
+	}
+
+	// -Задания одного координатора; false -- пришла команда остановки
+	bool WorkerServer::handle(int fd) {
+		MessageHeader h;
+		while (recv_all(fd, &h, sizeof(h))) {
+			if (h.type == MSG_SHUTDOWN) return false;
+			if (h.type != MSG_JOB || !run_job(fd, h)) break;
+		}
+		return true;
+	}
+
+	// -Подключается ко всем узлам
+	bool Cluster::connect(const std::vector<std::string>& addresses) {
+		disconnect();
+		for (const auto& address : addresses) {
+			int fd = connect_to(address);
+			if (fd < 0) {
+				disconnect();
+				return false;
+			}
+			_fds.push_back(fd);
+			_addresses.push_back(address);
+		}
+		return true;
+	}
+
+	// -SUMMA: по потоку координатора на узел
+	bool Cluster::multiply(const Matrix& a, const Matrix& b, Matrix& c, const DistributedOptions& opt) {
+		MAT_VEC_SCOPE("Cluster::multiply");
+		size_t m = a._size.first, k = a._size.second, n = b._size.second;
+		size_t nodes = _fds.size();
+		if ((size_t)b._size.first != k || nodes == 0) return false;
+		size_t pr = opt.grid_rows;
+		if (pr == 0)
+			for (size_t d = 1; d * d <= nodes; d++)
+				if (nodes % d == 0) pr = d;
+		if (nodes % pr != 0) return false;
+		size_t pc = nodes / pr;
+		size_t block = std::max<size_t>(opt.block, 1), panel = std::max<size_t>(opt.panel, 1);
+		size_t steps = (k + panel - 1) / panel, width = std::min(panel, k);
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)m * n * k);
+
+		Matrix out(m, n, 0.0);
+		_stats.assign(nodes, NodeStats());
+		std::vector<char> ok(nodes, 0);
+		std::vector<std::thread> threads;
+		for (size_t node = 0; node < nodes; node++) {
+			threads.emplace_back([&, node] {
+				NodeStats& st = _stats[node];
+				st.address = _addresses[node];
+				st.grid_row = node / pc;
+				st.grid_col = node % pc;
+				int fd = _fds[node];
+				std::vector<size_t> rows = owned(m, block, pr, st.grid_row);
+				std::vector<size_t> cols = owned(n, block, pc, st.grid_col);
+				size_t nr = rows.size(), nc = cols.size();
+				clock::time_point t0 = clock::now();
+				if (!send_header(fd, MSG_JOB, nr, nc, steps, width)) return;
+				st.bytes_sent += sizeof(MessageHeader);
+
+				std::vector<double> buf((nr + nc) * width);
+				for (size_t s = 0; s < steps; s++) {
+					size_t k0 = s * panel, kb = std::min(panel, k - k0);
+					double* p = buf.data();
+					for (size_t i : rows) p = std::copy(a.a[i] + k0, a.a[i] + k0 + kb, p);
+					for (size_t q = k0; q < k0 + kb; q++) {
+						const double* src = b.a[q];
+						for (size_t j : cols) *p++ = src[j];
+					}
+					size_t bytes = (nr + nc) * kb * sizeof(double);
+					if (!send_header(fd, MSG_PANEL, kb) || !send_all(fd, buf.data(), bytes)) return;
+					st.bytes_sent += sizeof(MessageHeader) + bytes;
+				}
+
+				MessageHeader h;
+				if (!recv_all(fd, &h, sizeof(h)) || h.type != MSG_RESULT || h.a != nr || h.b != nc) return;
+				std::vector<double> local(nr * nc);
+				double times[2];
+				if (!recv_all(fd, local.data(), local.size() * sizeof(double)) || !recv_all(fd, times, sizeof(times))) return;
+				st.bytes_received = sizeof(MessageHeader) + local.size() * sizeof(double) + sizeof(times);
+				st.panels = (size_t)h.c;
+				st.compute_seconds = times[0];
+				st.wait_seconds = times[1];
+				st.total_seconds = seconds_since(t0);
+				// узлы владеют непересекающимися элементами out
+				for (size_t ii = 0; ii < nr; ii++) {
+					double* dst = out.a[rows[ii]];
+					const double* src = local.data() + ii * nc;
+					for (size_t jj = 0; jj < nc; jj++) dst[cols[jj]] = src[jj];
+				}
+				ok[node] = 1;
+			});
+		}
+		for (auto& t : threads) t.join();
+		if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+			disconnect();
+			return false;
+		}
+		c = out;
+		return true;
+	}
+
+	// -Команда остановки всем узлам
+	void Cluster::shutdown() {
+		for (int fd : _fds) send_header(fd, MSG_SHUTDOWN);
+		disconnect();
+	}
+
+	void Cluster::disconnect() {
+		for (int& fd : _fds) close_fd(fd);
+		_fds.clear();
+		_addresses.clear();
+	}
+
+	// -Узлы в потоках текущего процесса
+	bool LocalCluster::start(size_t n, bool tcp) {
+		static std::atomic<unsigned> counter{ 0 };
+		stop();
+		const char* tmp = std::getenv("TMPDIR");
+		std::string dir = tmp && *tmp ? tmp : "/tmp";
+		unsigned id = counter++;
+		for (size_t i = 0; i < n; i++) {
+			std::unique_ptr<WorkerServer> server(new WorkerServer());
+			std::string address = tcp ? std::string("tcp:127.0.0.1:0") :
+				"unix:" + dir + "/mat_vec_" + std::to_string(getpid()) + "_" + std::to_string(id) + "_" + std::to_string(i) + ".sock";
+			if (!server->listen(address)) {
+				stop();
+				return false;
+			}
+			_addresses.push_back(server->address());
+			_servers.push_back(std::move(server));
+		}
+		for (auto& s : _servers) {
+			WorkerServer* server = s.get();
+			_threads.emplace_back([server] { server->serve(); });
+		}
+		return true;
+	}
+#else
+	WorkerServer::~WorkerServer() {}
+	bool WorkerServer::listen(const std::string&) { return false; }
+	bool WorkerServer::serve() { return false; }
+	void WorkerServer::stop() {}
+	bool WorkerServer::handle(int) { return false; }
+	bool Cluster::connect(const std::vector<std::string>&) { return false; }
+	bool Cluster::multiply(const Matrix&, const Matrix&, Matrix&, const DistributedOptions&) { return false; }
+	void Cluster::shutdown() {}
+	void Cluster::disconnect() {}
+	bool LocalCluster::start(size_t, bool) { return false; }
+#endif
+
+	const std::string& WorkerServer::address() const { return _address; }
+
+	bool serve(const std::string& address) {
+		WorkerServer server;
+		return server.listen(address) && server.serve();
+	}
+
+	Cluster::~Cluster() { disconnect(); }
+	size_t Cluster::size() const { return _fds.size(); }
+	const std::vector<NodeStats>& Cluster::stats() const { return _stats; }
+
+	LocalCluster::~LocalCluster() { stop(); }
+
+	// -Останавливает узлы и дожидается их потоков
+	void LocalCluster::stop() {
+		for (auto& s : _servers) s->stop();
+		for (auto& t : _threads) t.join();
+		_threads.clear();
+		_servers.clear();
+		_addresses.clear();
+	}
+
+	const std::vector<std::string>& LocalCluster::addresses() const { return _addresses; }
+
+} // namespace mat_vec
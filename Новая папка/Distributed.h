@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Base.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mat_vec {
+
+	// Распределённое умножение C = A B по алгоритму SUMMA.
+	//
+	// Узлы образуют решётку grid_rows x grid_cols. Блоки C размером
+	// block x block распределены циклически: блок (I, J) принадлежит узлу
+	// (I mod grid_rows, J mod grid_cols). Общий размер k проходится полосами
+	// шириной panel; на каждом шаге координатор рассылает узлу его строки
+	// полосы A и столбцы полосы B, узел прибавляет их произведение к своим
+	// блокам C. Приём следующей полосы идёт в отдельном потоке параллельно
+	// с вычислением текущей (двойная буферизация), координатор пишет всем
+	// узлам одновременно.
+	//
+	// Адреса узлов: "unix:/путь/к/сокету" или "tcp:хост:порт".
+	// Узлы и координатор должны иметь одинаковый порядок байт (обычно это
+	// одна машина или однотипные машины). Без POSIX-сокетов все вызовы
+	// возвращают false
+
+	struct DistributedOptions {
+		size_t block = 64;       // сторона блока циклического распределения
+		size_t panel = 256;      // ширина полосы по k на шаге SUMMA
+		size_t grid_rows = 0;    // 0 -- решётка, близкая к квадратной
+	};
+
+	// Время и объём обмена одного узла за последнее умножение
+	struct NodeStats {
+		std::string address;
+		size_t grid_row = 0;
+		size_t grid_col = 0;
+		size_t panels = 0;
+		double compute_seconds = 0;   // локальный gemm на узле
+		double wait_seconds = 0;      // узел ждал очередную полосу
+		double total_seconds = 0;     // от отправки задания до получения результата
+		uint64_t bytes_sent = 0;      // координатор -> узел
+		uint64_t bytes_received = 0;  // узел -> координатор
+	};
+
+	// Рабочий узел: слушает адрес и выполняет задания координаторов
+	// (по одному соединению за раз)
+	class WorkerServer {
+	public:
+		WorkerServer() = default;
+		~WorkerServer();
+
+		WorkerServer(const WorkerServer&) = delete;
+		WorkerServer& operator=(const WorkerServer&) = delete;
+
+		// Открывает сокет. Для "tcp:хост:0" порт выбирает система,
+		// address() возвращает фактический адрес
+		bool listen(const std::string& address);
+		const std::string& address() const;
+
+		// Принимает соединения, пока координатор не пришлёт команду остановки
+		// или не будет вызван stop(). false, если сокет не открыт
+		bool serve();
+
+		// Останавливает serve() из другого потока; открытое соединение
+		// с координатором закрывается, задание на нём прерывается
+		void stop();
+
+	private:
+		bool handle(int fd);
+
+		int _fd = -1;
+		std::string _address;
+		std::string _unix_path;
+		std::atomic<bool> _stop{ false };
+		std::mutex _lock;
+		int _conn = -1;          // обслуживаемое соединение (под _lock)
+	};
+
+	// listen + serve; для отдельного процесса-узла
+	bool serve(const std::string& address);
+
+	// Координатор: держит соединения с узлами
+	class Cluster {
+	public:
+		Cluster() = default;
+		~Cluster();
+
+		Cluster(const Cluster&) = delete;
+		Cluster& operator=(const Cluster&) = delete;
+
+		// Подключается ко всем узлам; false, если хотя бы один недоступен
+		bool connect(const std::vector<std::string>& addresses);
+		size_t size() const;
+
+		// c = a b. false при несовпадении размеров или ошибке обмена
+		// (после ошибки соединения закрываются)
+		bool multiply(const Matrix& a, const Matrix& b, Matrix& c,
+			const DistributedOptions& opt = DistributedOptions());
+
+		// Статистика последнего умножения, по узлу на элемент
+		const std::vector<NodeStats>& stats() const;
+
+		// Останавливает узлы и закрывает соединения
+		void shutdown();
+
+		// Закрывает соединения, не останавливая узлы
+		void disconnect();
+
+	private:
+		std::vector<std::string> _addresses;
+		std::vector<int> _fds;
+		std::vector<NodeStats> _stats;
+	};
+
+	// n узлов в потоках текущего процесса, каждый со своим сокетом
+	// (unix -- во временном каталоге, tcp -- на 127.0.0.1 со свободным портом).
+	// Для проверок и для работы на одной машине без запуска процессов
+	class LocalCluster {
+	public:
+		LocalCluster() = default;
+		~LocalCluster();
+
+		LocalCluster(const LocalCluster&) = delete;
+		LocalCluster& operator=(const LocalCluster&) = delete;
+
+		bool start(size_t n, bool tcp = false);
+		void stop();
+
+		const std::vector<std::string>& addresses() const;
+
+	private:
+		std::vector<std::unique_ptr<WorkerServer>> _servers;
+		std::vector<std::thread> _threads;
+		std::vector<std::string> _addresses;
+	};
+
+} // namespace mat_vec
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Matrix.h"
+#include "Parallel.h"
+#include "Vector.h"
+#include "VMath.h"
+#include <cstddef>
+
+namespace mat_vec {
+
+	// Поэлементные операции над Vector и Matrix с произвольной функцией f.
+	// Внутренний цикл -- простой проход по непрерывной памяти, поэтому
+	// лямбды без ветвлений (в том числе с функциями vmath) векторизуются.
+	// Массивы длиннее ELEMENTWISE_GRAIN делятся между потоками пула
+	const size_t ELEMENTWISE_GRAIN = 1 << 15;
+
+	namespace detail {
+
+		template <class F>
+		void map_range(const double* x, double* y, size_t n, F f) {
+			parallel_for(0, n, ELEMENTWISE_GRAIN, [&](size_t from, size_t to) {
+				for (size_t i = from; i < to; i++) y[i] = f(x[i]);
+			});
+		}
+
+		template <class F>
+		void zip_range(const double* x, const double* y, double* z, size_t n, F f) {
+			parallel_for(0, n, ELEMENTWISE_GRAIN, [&](size_t from, size_t to) {
+				for (size_t i = from; i < to; i++) z[i] = f(x[i], y[i]);
+			});
+		}
+
+		inline double* block(const Matrix& m) { return m._size.first > 0 ? m.a[0] : nullptr; }
+		inline size_t count(const Matrix& m) { return (size_t)m._size.first * m._size.second; }
+	}
+
+	// Новый вектор f(x[i])
+	template <class F>
+	Vector map(const Vector& x, F f) {
+		Vector y(x.size());
+		detail::map_range(x.data, y.data, x.size(), f);
+		return y;
+	}
+
+	// x[i] = f(x[i])
+	template <class F>
+	void apply_inplace(Vector& x, F f) {
+		detail::map_range(x.data, x.data, x.size(), f);
+	}
+
+	// Новый вектор f(x[i], y[i]); размеры должны совпадать
+	template <class F>
+	Vector zip_with(const Vector& x, const Vector& y, F f) {
+		Vector z(x.size());
+		detail::zip_range(x.data, y.data, z.data, x.size(), f);
+		return z;
+	}
+
+	// То же для матриц
+	template <class F>
+	Matrix map(const Matrix& x, F f) {
+		Matrix y(x._size.first, x._size.second, 0.0);
+		detail::map_range(detail::block(x), detail::block(y), detail::count(x), f);
+		return y;
+	}
+
+	// Сбрасывает кэш матрицы
+	template <class F>
+	void apply_inplace(Matrix& x, F f) {
+		x.invalidate();
+		detail::map_range(detail::block(x), detail::block(x), detail::count(x), f);
+	}
+
+	template <class F>
+	Matrix zip_with(const Matrix& x, const Matrix& y, F f) {
+		Matrix z(x._size.first, x._size.second, 0.0);
+		detail::zip_range(detail::block(x), detail::block(y), detail::block(z), detail::count(x), f);
+		return z;
+	}
+
+	// Готовые функции активации и элементарные функции на основе vmath
+	inline Vector exp(const Vector& x) { return map(x, [](double v) { return vmath::exp(v); }); }
+	inline Vector log(const Vector& x) { return map(x, [](double v) { return vmath::log(v); }); }
+	inline Vector tanh(const Vector& x) { return map(x, [](double v) { return vmath::tanh(v); }); }
+	inline Vector sigmoid(const Vector& x) { return map(x, [](double v) { return vmath::sigmoid(v); }); }
+	inline Matrix exp(const Matrix& x) { return map(x, [](double v) { return vmath::exp(v); }); }
+	inline Matrix log(const Matrix& x) { return map(x, [](double v) { return vmath::log(v); }); }
+	inline Matrix tanh(const Matrix& x) { return map(x, [](double v) { return vmath::tanh(v); }); }
+	inline Matrix sigmoid(const Matrix& x) { return map(x, [](double v) { return vmath::sigmoid(v); }); }
+
+} // namespace mat_vec
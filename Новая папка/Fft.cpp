@@ -0,0 +1,568 @@
+#include "Fft.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MAT_VEC_SSE2
+#endif
+
+namespace mat_vec {
+
+	namespace {
+
+		const double PI = 3.14159265358979323846;
+
+		// Простые множители больше этого считаются через Блюстейна
+		const size_t MAX_DIRECT_RADIX = 31;
+
+		// Рабочий буфер из списка свободных буферов потока. Список нужен,
+		// потому что Блюстейн и действительное БПФ вызывают вложенное
+		// комплексное, которому тоже нужен буфер
+		class Scratch {
+		public:
+			explicit Scratch(size_t size) {
+				std::vector<std::vector<double>>& list = free_list();
+				if (!list.empty()) {
+					_data.swap(list.back());
+					list.pop_back();
+				}
+				if (_data.size() < size) _data.resize(size);
+			}
+
+			~Scratch() { free_list().push_back(std::move(_data)); }
+
+			Scratch(const Scratch&) = delete;
+			Scratch& operator=(const Scratch&) = delete;
+
+			double* data() { return _data.data(); }
+
+		private:
+			static std::vector<std::vector<double>>& free_list() {
+				thread_local std::vector<std::vector<double>> list;
+				return list;
+			}
+
+			std::vector<double> _data;
+		};
+
+		// e^{-2 pi i k / n} с приведением k по модулю n до умножения на 2 pi
+		void root(size_t k, size_t n, double& re, double& im) {
+			double angle = -2 * PI * (double)(k % n) / (double)n;
+			re = std::cos(angle);
+			im = std::sin(angle);
+		}
+
+		// Раскладывает n на множители: сначала четвёрки, потом двойка, потом нечётные
+		std::vector<size_t> factorize(size_t n) {
+			std::vector<size_t> radices;
+			while (n % 4 == 0) {
+				radices.push_back(4);
+				n /= 4;
+			}
+			if (n % 2 == 0) {
+				radices.push_back(2);
+				n /= 2;
+			}
+			for (size_t p = 3; p * p <= n; p += 2) {
+				while (n % p == 0) {
+					radices.push_back(p);
+					n /= p;
+				}
+			}
+			if (n > 1) radices.push_back(n);
+			return radices;
+		}
+
+		// Этап Стокхэма: length = radix * m, stride = s. Вход x[q + s (p + k m)],
+		// выход y[q + s (radix p + j)], q < s, p < m, k, j < radix.
+		// Поворотные множители w^{jp} этапа -- tw[(j - 1) m + p]
+
+		void radix2(const double* xr, const double* xi, double* yr, double* yi, size_t m, size_t s,
+			const double* twr, const double* twi) {
+			for (size_t p = 0; p < m; p++) {
+				const double* ar = xr + s * p, * ai = xi + s * p;
+				const double* br = xr + s * (p + m), * bi = xi + s * (p + m);
+				double* y0r = yr + s * 2 * p, * y0i = yi + s * 2 * p;
+				double* y1r = y0r + s, * y1i = y0i + s;
+				double wr = twr[p], wi = twi[p];
+				size_t q = 0;
+#ifdef MAT_VEC_SSE2
+				__m128d vwr = _mm_set1_pd(wr), vwi = _mm_set1_pd(wi);
+				for (; q + 2 <= s; q += 2) {
+					__m128d a_r = _mm_loadu_pd(ar + q), a_i = _mm_loadu_pd(ai + q);
+					__m128d b_r = _mm_loadu_pd(br + q), b_i = _mm_loadu_pd(bi + q);
+					_mm_storeu_pd(y0r + q, _mm_add_pd(a_r, b_r));
+					_mm_storeu_pd(y0i + q, _mm_add_pd(a_i, b_i));
+					__m128d d_r = _mm_sub_pd(a_r, b_r), d_i = _mm_sub_pd(a_i, b_i);
+					_mm_storeu_pd(y1r + q, _mm_sub_pd(_mm_mul_pd(d_r, vwr), _mm_mul_pd(d_i, vwi)));
+					_mm_storeu_pd(y1i + q, _mm_add_pd(_mm_mul_pd(d_r, vwi), _mm_mul_pd(d_i, vwr)));
+				}
+#endif
+				for (; q < s; q++) {
+					double dr = ar[q] - br[q], di = ai[q] - bi[q];
+					y0r[q] = ar[q] + br[q];
+					y0i[q] = ai[q] + bi[q];
+					y1r[q] = dr * wr - di * wi;
+					y1i[q] = dr * wi + di * wr;
+				}
+			}
+		}
+
+		void radix4(const double* xr, const double* xi, double* yr, double* yi, size_t m, size_t s,
+			const double* twr, const double* twi) {
+			for (size_t p = 0; p < m; p++) {
+				const double* a0r = xr + s * p, * a0i = xi + s * p;
+				const double* a1r = a0r + s * m, * a1i = a0i + s * m;
+				const double* a2r = a1r + s * m, * a2i = a1i + s * m;
+				const double* a3r = a2r + s * m, * a3i = a2i + s * m;
+				double* y0r = yr + s * 4 * p, * y0i = yi + s * 4 * p;
+				double* y1r = y0r + s, * y1i = y0i + s;
+				double* y2r = y1r + s, * y2i = y1i + s;
+				double* y3r = y2r + s, * y3i = y2i + s;
+				double w1r = twr[p], w1i = twi[p];
+				double w2r = twr[m + p], w2i = twi[m + p];
+				double w3r = twr[2 * m + p], w3i = twi[2 * m + p];
+				size_t q = 0;
+#ifdef MAT_VEC_SSE2
+				__m128d v1r = _mm_set1_pd(w1r), v1i = _mm_set1_pd(w1i);
+				__m128d v2r = _mm_set1_pd(w2r), v2i = _mm_set1_pd(w2i);
+				__m128d v3r = _mm_set1_pd(w3r), v3i = _mm_set1_pd(w3i);
+				for (; q + 2 <= s; q += 2) {
+					__m128d b0r = _mm_loadu_pd(a0r + q), b0i = _mm_loadu_pd(a0i + q);
+					__m128d b1r = _mm_loadu_pd(a1r + q), b1i = _mm_loadu_pd(a1i + q);
+					__m128d b2r = _mm_loadu_pd(a2r + q), b2i = _mm_loadu_pd(a2i + q);
+					__m128d b3r = _mm_loadu_pd(a3r + q), b3i = _mm_loadu_pd(a3i + q);
+					__m128d t0r = _mm_add_pd(b0r, b2r), t0i = _mm_add_pd(b0i, b2i);
+					__m128d t1r = _mm_sub_pd(b0r, b2r), t1i = _mm_sub_pd(b0i, b2i);
+					__m128d t2r = _mm_add_pd(b1r, b3r), t2i = _mm_add_pd(b1i, b3i);
+					// t3 = -i (a1 - a3)
+					__m128d t3r = _mm_sub_pd(b1i, b3i), t3i = _mm_sub_pd(b3r, b1r);
+					_mm_storeu_pd(y0r + q, _mm_add_pd(t0r, t2r));
+					_mm_storeu_pd(y0i + q, _mm_add_pd(t0i, t2i));
+					__m128d ur = _mm_add_pd(t1r, t3r), ui = _mm_add_pd(t1i, t3i);
+					_mm_storeu_pd(y1r + q, _mm_sub_pd(_mm_mul_pd(ur, v1r), _mm_mul_pd(ui, v1i)));
+					_mm_storeu_pd(y1i + q, _mm_add_pd(_mm_mul_pd(ur, v1i), _mm_mul_pd(ui, v1r)));
+					ur = _mm_sub_pd(t0r, t2r);
+					ui = _mm_sub_pd(t0i, t2i);
+					_mm_storeu_pd(y2r + q, _mm_sub_pd(_mm_mul_pd(ur, v2r), _mm_mul_pd(ui, v2i)));
+					_mm_storeu_pd(y2i + q, _mm_add_pd(_mm_mul_pd(ur, v2i), _mm_mul_pd(ui, v2r)));
+					ur = _mm_sub_pd(t1r, t3r);
+					ui = _mm_sub_pd(t1i, t3i);
+					_mm_storeu_pd(y3r + q, _mm_sub_pd(_mm_mul_pd(ur, v3r), _mm_mul_pd(ui, v3i)));
+					_mm_storeu_pd(y3i + q, _mm_add_pd(_mm_mul_pd(ur, v3i), _mm_mul_pd(ui, v3r)));
+				}
+#endif
+				for (; q < s; q++) {
+					double t0r = a0r[q] + a2r[q], t0i = a0i[q] + a2i[q];
+					double t1r = a0r[q] - a2r[q], t1i = a0i[q] - a2i[q];
+					double t2r = a1r[q] + a3r[q], t2i = a1i[q] + a3i[q];
+					double t3r = a1i[q] - a3i[q], t3i = a3r[q] - a1r[q];
+					y0r[q] = t0r + t2r;
+					y0i[q] = t0i + t2i;
+					double ur = t1r + t3r, ui = t1i + t3i;
+					y1r[q] = ur * w1r - ui * w1i;
+					y1i[q] = ur * w1i + ui * w1r;
+					ur = t0r - t2r;
+					ui = t0i - t2i;
+					y2r[q] = ur * w2r - ui * w2i;
+					y2i[q] = ur * w2i + ui * w2r;
+					ur = t1r - t3r;
+					ui = t1i - t3i;
+					y3r[q] = ur * w3r - ui * w3i;
+					y3i[q] = ur * w3i + ui * w3r;
+				}
+			}
+		}
+
+		void radix3(const double* xr, const double* xi, double* yr, double* yi, size_t m, size_t s,
+			const double* twr, const double* twi) {
+			const double c = -0.86602540378443864676; // -sqrt(3) / 2
+			for (size_t p = 0; p < m; p++) {
+				const double* a0r = xr + s * p, * a0i = xi + s * p;
+				const double* a1r = a0r + s * m, * a1i = a0i + s * m;
+				const double* a2r = a1r + s * m, * a2i = a1i + s * m;
+				double* y0r = yr + s * 3 * p, * y0i = yi + s * 3 * p;
+				double* y1r = y0r + s, * y1i = y0i + s;
+				double* y2r = y1r + s, * y2i = y1i + s;
+				double w1r = twr[p], w1i = twi[p];
+				double w2r = twr[m + p], w2i = twi[m + p];
+				for (size_t q = 0; q < s; q++) {
+					double sr = a1r[q] + a2r[q], si = a1i[q] + a2i[q];
+					// i c (a1 - a2)
+					double dr = -c * (a1i[q] - a2i[q]), di = c * (a1r[q] - a2r[q]);
+					double mr = a0r[q] - 0.5 * sr, mi = a0i[q] - 0.5 * si;
+					y0r[q] = a0r[q] + sr;
+					y0i[q] = a0i[q] + si;
+					double ur = mr + dr, ui = mi + di;
+					y1r[q] = ur * w1r - ui * w1i;
+					y1i[q] = ur * w1i + ui * w1r;
+					ur = mr - dr;
+					ui = mi - di;
+					y2r[q] = ur * w2r - ui * w2i;
+					y2i[q] = ur * w2i + ui * w2r;
+				}
+			}
+		}
+
+		void radix5(const double* xr, const double* xi, double* yr, double* yi, size_t m, size_t s,
+			const double* twr, const double* twi) {
+			const double c1 = 0.30901699437494742410, c2 = -0.80901699437494742410;  // cos(2 pi k / 5)
+			const double s1 = 0.95105651629515357212, s2 = 0.58778525229247312917;   // sin(2 pi k / 5)
+			for (size_t p = 0; p < m; p++) {
+				const double* a0r = xr + s * p, * a0i = xi + s * p;
+				const double* a1r = a0r + s * m, * a1i = a0i + s * m;
+				const double* a2r = a1r + s * m, * a2i = a1i + s * m;
+				const double* a3r = a2r + s * m, * a3i = a2i + s * m;
+				const double* a4r = a3r + s * m, * a4i = a3i + s * m;
+				double* y0r = yr + s * 5 * p, * y0i = yi + s * 5 * p;
+				double w[4][2];
+				for (size_t j = 0; j < 4; j++) {
+					w[j][0] = twr[j * m + p];
+					w[j][1] = twi[j * m + p];
+				}
+				for (size_t q = 0; q < s; q++) {
+					double t1r = a1r[q] + a4r[q], t1i = a1i[q] + a4i[q];
+					double t2r = a2r[q] + a3r[q], t2i = a2i[q] + a3i[q];
+					double t3r = a1r[q] - a4r[q], t3i = a1i[q] - a4i[q];
+					double t4r = a2r[q] - a3r[q], t4i = a2i[q] - a3i[q];
+					double m1r = a0r[q] + c1 * t1r + c2 * t2r, m1i = a0i[q] + c1 * t1i + c2 * t2i;
+					double m2r = a0r[q] + c2 * t1r + c1 * t2r, m2i = a0i[q] + c2 * t1i + c1 * t2i;
+					double n1r = s1 * t3r + s2 * t4r, n1i = s1 * t3i + s2 * t4i;
+					double n2r = s2 * t3r - s1 * t4r, n2i = s2 * t3i - s1 * t4i;
+					y0r[q] = a0r[q] + t1r + t2r;
+					y0i[q] = a0i[q] + t1i + t2i;
+					// Y1, Y4 = m1 -+ i n1; Y2, Y3 = m2 -+ i n2
+					double ur[4] = { m1r + n1i, m2r + n2i, m2r - n2i, m1r - n1i };
+					double ui[4] = { m1i - n1r, m2i - n2r, m2i + n2r, m1i + n1r };
+					for (size_t j = 0; j < 4; j++) {
+						y0r[q + s * (j + 1)] = ur[j] * w[j][0] - ui[j] * w[j][1];
+						y0i[q + s * (j + 1)] = ur[j] * w[j][1] + ui[j] * w[j][0];
+					}
+				}
+			}
+		}
+
+		// Остальные простые radix <= MAX_DIRECT_RADIX: ДПФ по определению
+		void radix_any(const double* xr, const double* xi, double* yr, double* yi, size_t radix, size_t m,
+			size_t s, const double* twr, const double* twi) {
+			double rr[MAX_DIRECT_RADIX], ri[MAX_DIRECT_RADIX];
+			for (size_t k = 0; k < radix; k++) root(k, radix, rr[k], ri[k]);
+			double ar[MAX_DIRECT_RADIX], ai[MAX_DIRECT_RADIX];
+			for (size_t p = 0; p < m; p++) {
+				for (size_t q = 0; q < s; q++) {
+					for (size_t k = 0; k < radix; k++) {
+						ar[k] = xr[q + s * (p + k * m)];
+						ai[k] = xi[q + s * (p + k * m)];
+					}
+					for (size_t j = 0; j < radix; j++) {
+						double sr = 0, si = 0;
+						size_t e = 0;
+						for (size_t k = 0; k < radix; k++) {
+							sr += ar[k] * rr[e] - ai[k] * ri[e];
+							si += ar[k] * ri[e] + ai[k] * rr[e];
+							e += j;
+							if (e >= radix) e -= radix;
+						}
+						size_t out = q + s * (radix * p + j);
+						if (j == 0) {
+							yr[out] = sr;
+							yi[out] = si;
+						}
+						else {
+							double wr = twr[(j - 1) * m + p], wi = twi[(j - 1) * m + p];
+							yr[out] = sr * wr - si * wi;
+							yi[out] = sr * wi + si * wr;
+						}
+					}
+				}
+			}
+		}
+
+		template <class Plan>
+		class PlanCache {
+		public:
+			std::shared_ptr<const Plan> get(size_t n) {
+				std::lock_guard<std::mutex> guard(_lock);
+				std::shared_ptr<const Plan>& plan = _plans[n];
+				if (!plan) plan = std::make_shared<const Plan>(n);
+				return plan;
+			}
+
+			size_t size() {
+				std::lock_guard<std::mutex> guard(_lock);
+				return _plans.size();
+			}
+
+			void clear() {
+				std::lock_guard<std::mutex> guard(_lock);
+				_plans.clear();
+			}
+
+		private:
+			std::mutex _lock;
+			std::map<size_t, std::shared_ptr<const Plan>> _plans;
+		};
+
+		PlanCache<FftPlan>& complex_cache() {
+			static PlanCache<FftPlan> cache;
+			return cache;
+		}
+
+		PlanCache<RealFftPlan>& real_cache() {
+			static PlanCache<RealFftPlan> cache;
+			return cache;
+		}
+	}
+
+	FftPlan::FftPlan(size_t n) : _n(n) {
+		if (n <= 1) return;
+		std::vector<size_t> radices = factorize(n);
+		if (radices.back() > MAX_DIRECT_RADIX) {
+			// -Блюстейн: X_k = c_k sum_j (x_j c_j) conj(c_{k - j}), c_k = e^{-pi i k^2 / n}
+			size_t m = 1;
+			while (m < 2 * n - 1) m *= 2;
+			_sub.reset(new FftPlan(m));
+			_chirp_re.resize(n);
+			_chirp_im.resize(n);
+			for (size_t k = 0; k < n; k++) root((k * k) % (2 * n), 2 * n, _chirp_re[k], _chirp_im[k]);
+			_kernel_re.assign(m, 0.0);
+			_kernel_im.assign(m, 0.0);
+			for (size_t k = 0; k < n; k++) {
+				_kernel_re[k] = _chirp_re[k];
+				_kernel_im[k] = -_chirp_im[k];
+				if (k) {
+					_kernel_re[m - k] = _chirp_re[k];
+					_kernel_im[m - k] = -_chirp_im[k];
+				}
+			}
+			_sub->forward(_kernel_re.data(), _kernel_im.data());
+			return;
+		}
+
+		size_t length = n, stride = 1, offset = 0;
+		for (size_t radix : radices) {
+			size_t m = length / radix;
+			_stages.push_back({ radix, length, stride, offset });
+			for (size_t j = 1; j < radix; j++) {
+				for (size_t p = 0; p < m; p++) {
+					double re, im;
+					root(j * p, length, re, im);
+					_tw_re.push_back(re);
+					_tw_im.push_back(im);
+				}
+			}
+			offset += (radix - 1) * m;
+			length = m;
+			stride *= radix;
+		}
+	}
+
+	FftPlan::~FftPlan() = default;
+
+	size_t FftPlan::size() const {
+		return _n;
+	}
+
+	void FftPlan::forward(double* re, double* im) const {
+		if (_n <= 1) return;
+		if (_sub) bluestein(re, im);
+		else transform(re, im);
+	}
+
+	void FftPlan::inverse(double* re, double* im) const {
+		if (_n <= 1) return;
+		// -Обратное преобразование -- прямое с переставленными re и im
+		forward(im, re);
+		double scale = 1.0 / (double)_n;
+		for (size_t i = 0; i < _n; i++) {
+			re[i] *= scale;
+			im[i] *= scale;
+		}
+	}
+
+	std::shared_ptr<const FftPlan> FftPlan::get(size_t n) {
+		return complex_cache().get(n);
+	}
+
+	// -Этапы Стокхэма попеременно из данных в буфер и обратно
+	void FftPlan::transform(double* re, double* im) const {
+		MAT_VEC_SCOPE("FftPlan::forward");
+		MAT_VEC_COUNT_FLOPS((uint64_t)(5 * _n * std::log2((double)_n)));
+		Scratch scratch(2 * _n);
+		double* xr = re, * xi = im;
+		double* yr = scratch.data(), * yi = scratch.data() + _n;
+		for (const Stage& st : _stages) {
+			size_t m = st.length / st.radix;
+			const double* twr = _tw_re.data() + st.twiddles, * twi = _tw_im.data() + st.twiddles;
+			if (st.radix == 4) radix4(xr, xi, yr, yi, m, st.stride, twr, twi);
+			else if (st.radix == 2) radix2(xr, xi, yr, yi, m, st.stride, twr, twi);
+			else if (st.radix == 3) radix3(xr, xi, yr, yi, m, st.stride, twr, twi);
+			else if (st.radix == 5) radix5(xr, xi, yr, yi, m, st.stride, twr, twi);
+			else radix_any(xr, xi, yr, yi, st.radix, m, st.stride, twr, twi);
+			std::swap(xr, yr);
+			std::swap(xi, yi);
+		}
+		if (xr != re) {
+			std::memcpy(re, xr, _n * sizeof(double));
+			std::memcpy(im, xi, _n * sizeof(double));
+		}
+	}
+
+	void FftPlan::bluestein(double* re, double* im) const {
+		MAT_VEC_SCOPE("FftPlan::bluestein");
+		size_t m = _sub->size();
+		Scratch scratch(2 * m);
+		double* ar = scratch.data(), * ai = scratch.data() + m;
+		for (size_t k = 0; k < _n; k++) {
+			ar[k] = re[k] * _chirp_re[k] - im[k] * _chirp_im[k];
+			ai[k] = re[k] * _chirp_im[k] + im[k] * _chirp_re[k];
+		}
+		std::fill(ar + _n, ar + m, 0.0);
+		std::fill(ai + _n, ai + m, 0.0);
+		_sub->forward(ar, ai);
+		for (size_t k = 0; k < m; k++) {
+			double r = ar[k] * _kernel_re[k] - ai[k] * _kernel_im[k];
+			ai[k] = ar[k] * _kernel_im[k] + ai[k] * _kernel_re[k];
+			ar[k] = r;
+		}
+		_sub->inverse(ar, ai);
+		for (size_t k = 0; k < _n; k++) {
+			re[k] = ar[k] * _chirp_re[k] - ai[k] * _chirp_im[k];
+			im[k] = ar[k] * _chirp_im[k] + ai[k] * _chirp_re[k];
+		}
+	}
+
+	RealFftPlan::RealFftPlan(size_t n) : _n(n) {
+		if (n < 2) return;
+		if (n % 2) {
+			_half = FftPlan::get(n);
+			return;
+		}
+		size_t h = n / 2;
+		_half = FftPlan::get(h);
+		_w_re.resize(h + 1);
+		_w_im.resize(h + 1);
+		for (size_t k = 0; k <= h; k++) root(k, n, _w_re[k], _w_im[k]);
+	}
+
+	size_t RealFftPlan::size() const {
+		return _n;
+	}
+
+	size_t RealFftPlan::bins() const {
+		return _n / 2 + 1;
+	}
+
+	// -Чётные и нечётные отсчёты -- действительная и мнимая части сигнала
+	// длины n / 2; его спектр Z разделяется на спектры чётных E и нечётных O:
+	// X_k = E_k + w^k O_k
+	void RealFftPlan::forward(const double* x, double* re, double* im) const {
+		if (_n == 0) return;
+		if (_n == 1) {
+			re[0] = x[0];
+			im[0] = 0;
+			return;
+		}
+		if (_n % 2) {
+			Scratch scratch(2 * _n);
+			double* zr = scratch.data(), * zi = scratch.data() + _n;
+			std::memcpy(zr, x, _n * sizeof(double));
+			std::fill(zi, zi + _n, 0.0);
+			_half->forward(zr, zi);
+			std::memcpy(re, zr, bins() * sizeof(double));
+			std::memcpy(im, zi, bins() * sizeof(double));
+			return;
+		}
+		size_t h = _n / 2;
+		Scratch scratch(2 * h);
+		double* zr = scratch.data(), * zi = scratch.data() + h;
+		for (size_t k = 0; k < h; k++) {
+			zr[k] = x[2 * k];
+			zi[k] = x[2 * k + 1];
+		}
+		_half->forward(zr, zi);
+		for (size_t k = 0; k <= h; k++) {
+			size_t a = k == h ? 0 : k, b = k == 0 ? 0 : h - k;
+			// E = (Z_k + conj Z_{h-k}) / 2, O = (Z_k - conj Z_{h-k}) / 2i
+			double er = 0.5 * (zr[a] + zr[b]), ei = 0.5 * (zi[a] - zi[b]);
+			double or_ = 0.5 * (zi[a] + zi[b]), oi = -0.5 * (zr[a] - zr[b]);
+			re[k] = er + or_ * _w_re[k] - oi * _w_im[k];
+			im[k] = ei + or_ * _w_im[k] + oi * _w_re[k];
+		}
+	}
+
+	void RealFftPlan::inverse(const double* re, const double* im, double* x) const {
+		if (_n == 0) return;
+		if (_n == 1) {
+			x[0] = re[0];
+			return;
+		}
+		if (_n % 2) {
+			Scratch scratch(2 * _n);
+			double* zr = scratch.data(), * zi = scratch.data() + _n;
+			zr[0] = re[0];
+			zi[0] = 0;
+			for (size_t k = 1; k < bins(); k++) {
+				zr[k] = zr[_n - k] = re[k];
+				zi[k] = im[k];
+				zi[_n - k] = -im[k];
+			}
+			_half->inverse(zr, zi);
+			std::memcpy(x, zr, _n * sizeof(double));
+			return;
+		}
+		size_t h = _n / 2;
+		Scratch scratch(2 * h);
+		double* zr = scratch.data(), * zi = scratch.data() + h;
+		for (size_t k = 0; k < h; k++) {
+			double ar = re[k], ai = k == 0 ? 0.0 : im[k];
+			double br = re[h - k], bi = k == 0 ? 0.0 : -im[h - k];
+			// E = (X_k + conj X_{h-k}) / 2, O = (X_k - conj X_{h-k}) conj(w^k) / 2, Z = E + i O
+			double er = 0.5 * (ar + br), ei = 0.5 * (ai + bi);
+			double dr = 0.5 * (ar - br), di = 0.5 * (ai - bi);
+			double or_ = dr * _w_re[k] + di * _w_im[k], oi = di * _w_re[k] - dr * _w_im[k];
+			zr[k] = er - oi;
+			zi[k] = ei + or_;
+		}
+		_half->inverse(zr, zi);
+		for (size_t k = 0; k < h; k++) {
+			x[2 * k] = zr[k];
+			x[2 * k + 1] = zi[k];
+		}
+	}
+
+	std::shared_ptr<const RealFftPlan> RealFftPlan::get(size_t n) {
+		return real_cache().get(n);
+	}
+
+	size_t fft_size(size_t n) {
+		size_t best = SIZE_MAX;
+		for (size_t p5 = 1; ; p5 *= 5) {
+			for (size_t p35 = p5; ; p35 *= 3) {
+				size_t v = 2 * p35;
+				while (v < n) v *= 2;
+				best = std::min(best, v);
+				if (p35 >= n) break;
+			}
+			if (p5 >= n) break;
+		}
+		return best;
+	}
+
+	size_t fft_cache_size() {
+		return complex_cache().size() + real_cache().size();
+	}
+
+	void fft_clear_cache() {
+		real_cache().clear();
+		complex_cache().clear();
+	}
+
+} // namespace mat_vec
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Base.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace mat_vec {
+
+	// Комплексное БПФ длины n. Данные хранятся раздельно: действительные
+	// части в re, мнимые в im -- так бабочки векторизуются по соседним
+	// элементам.
+	//
+	// n раскладывается на множители 4, 2, 3, 5, ...; этапы идут по схеме
+	// Стокхэма (без перестановки битов) с таблицами поворотных множителей,
+	// посчитанными один раз в конструкторе. Если у n есть простой
+	// множитель больше 31, используется алгоритм Блюстейна через БПФ
+	// длины 2^k. План после построения не меняется, и один план можно
+	// использовать из нескольких потоков сразу
+	class FftPlan {
+	public:
+		explicit FftPlan(size_t n);
+		~FftPlan();
+
+		FftPlan(const FftPlan&) = delete;
+		FftPlan& operator=(const FftPlan&) = delete;
+
+		size_t size() const;
+
+		// X_k = sum x_j e^{-2 pi i jk / n}, на месте
+		void forward(double* re, double* im) const;
+
+		// x_j = 1/n sum X_k e^{2 pi i jk / n}, на месте
+		void inverse(double* re, double* im) const;
+
+		// Общий план длины n из кэша: строится при первом запросе
+		static std::shared_ptr<const FftPlan> get(size_t n);
+
+	private:
+		struct Stage {
+			size_t radix;
+			size_t length;            // длина преобразований на этом этапе
+			size_t stride;            // число преобразований
+			size_t twiddles;          // смещение поворотных множителей этапа
+		};
+
+		void transform(double* re, double* im) const;
+		void bluestein(double* re, double* im) const;
+
+		size_t _n;
+		std::vector<Stage> _stages;
+		std::vector<double> _tw_re, _tw_im;
+		// Блюстейн: свёртка длины _sub->size() с чирпом
+		std::unique_ptr<FftPlan> _sub;
+		std::vector<double> _chirp_re, _chirp_im;
+		std::vector<double> _kernel_re, _kernel_im;
+	};
+
+	// БПФ действительного сигнала длины n: n / 2 + 1 комплексных
+	// коэффициентов (остальные -- сопряжённые). Для чётного n считается
+	// через комплексное БПФ длины n / 2, для нечётного -- длины n
+	class RealFftPlan {
+	public:
+		explicit RealFftPlan(size_t n);
+
+		size_t size() const;
+
+		// Число коэффициентов: n / 2 + 1
+		size_t bins() const;
+
+		// x -- n чисел; re, im -- по bins() чисел
+		void forward(const double* x, double* re, double* im) const;
+
+		// Обратное к forward (с делением на n); im[0] и, для чётного n,
+		// im[n / 2] не используются
+		void inverse(const double* re, const double* im, double* x) const;
+
+		static std::shared_ptr<const RealFftPlan> get(size_t n);
+
+	private:
+		size_t _n;
+		std::shared_ptr<const FftPlan> _half;
+		std::vector<double> _w_re, _w_im;   // e^{-2 pi i k / n}, k <= n / 2
+	};
+
+	// Наименьшее чётное число вида 2^a 3^b 5^c, не меньшее n:
+	// длина, на которой БПФ быстрее всего
+	size_t fft_size(size_t n);
+
+	// Число планов в кэше и очистка кэша (планы, которые ещё используются,
+	// живут, пока на них есть ссылки)
+	size_t fft_cache_size();
+	void fft_clear_cache();
+
+} // namespace mat_vec
@@ -0,0 +1,248 @@
+#include "Gemm.h"
+#include "Matrix.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Transpose.h"
+#include <algorithm>
+#include <vector>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Размер микроядра: MR строк A на NR столбцов B
+		const size_t MR = 4;
+		const size_t NR = 8;
+
+		// Меньшие произведения считаются простым циклом без упаковки
+		const size_t SMALL_WORK = 48 * 48 * 48;
+
+		// Начиная с этого объёма работы блоки строк раздаются потокам
+		const size_t PARALLEL_WORK = 128 * 128 * 128;
+
+		// Буфер упаковки B, взятый из списка свободных буферов потока и
+		// возвращаемый туда же: повторные вызовы gemm не выделяют память.
+		// Список, а не один буфер: ожидая в parallel_for, поток может
+		// выполнить чужую задачу со своим вызовом gemm
+		class PackBuffer {
+		public:
+			explicit PackBuffer(size_t size) {
+				std::vector<std::vector<double>>& list = free_list();
+				if (!list.empty()) {
+					_data.swap(list.back());
+					list.pop_back();
+				}
+				if (_data.size() < size) _data.resize(size);
+			}
+
+			~PackBuffer() { free_list().push_back(std::move(_data)); }
+
+			PackBuffer(const PackBuffer&) = delete;
+			PackBuffer& operator=(const PackBuffer&) = delete;
+
+			double* data() { return _data.data(); }
+
+		private:
+			static std::vector<std::vector<double>>& free_list() {
+				thread_local std::vector<std::vector<double>> list;
+				return list;
+			}
+
+			std::vector<double> _data;
+		};
+
+		// Упаковывает блок A[i0.., p0..] размером mc x kc в панели по MR строк
+		void pack_a(const MatrixRef& A, size_t i0, size_t mc, size_t p0, size_t kc, double* dst) {
+			for (size_t ir = 0; ir < mc; ir += MR) {
+				size_t mr = std::min(MR, mc - ir);
+				const double* src[MR];
+				for (size_t r = 0; r < mr; r++) src[r] = A.row(i0 + ir + r) + p0;
+				for (size_t p = 0; p < kc; p++) {
+					size_t r = 0;
+					for (; r < mr; r++) dst[p * MR + r] = src[r][p];
+					for (; r < MR; r++) dst[p * MR + r] = 0;
+				}
+				dst += kc * MR;
+			}
+		}
+
+		// Упаковывает блок B[p0.., j0..] размером kc x nc в панели по NR столбцов
+		void pack_b(const MatrixRef& B, size_t p0, size_t kc, size_t j0, size_t nc, double* dst) {
+			for (size_t jr = 0; jr < nc; jr += NR) {
+				size_t nr = std::min(NR, nc - jr);
+				for (size_t p = 0; p < kc; p++) {
+					const double* src = B.row(p0 + p) + j0 + jr;
+					size_t c = 0;
+					for (; c < nr; c++) dst[p * NR + c] = src[c];
+					for (; c < NR; c++) dst[p * NR + c] = 0;
+				}
+				dst += kc * NR;
+			}
+		}
+
+		// Микроядро: acc = a * b для панелей MR x kc и kc x NR
+		void micro_kernel(size_t kc, const double* a, const double* b, double acc[MR][NR]) {
+			double c[MR][NR] = {};
+			for (size_t p = 0; p < kc; p++) {
+				const double* bp = b + p * NR;
+				for (size_t r = 0; r < MR; r++) {
+					double ar = a[p * MR + r];
+					for (size_t j = 0; j < NR; j++) c[r][j] += ar * bp[j];
+				}
+			}
+			for (size_t r = 0; r < MR; r++)
+				for (size_t j = 0; j < NR; j++) acc[r][j] = c[r][j];
+		}
+
+		// R строк A за один проход по x: R независимых цепочек сложений
+		template <size_t R>
+		size_t gemv_rows(const MatrixRef& A, const double* x, double* y, size_t i) {
+			size_t n = A.n_cols;
+			for (; i + R <= A.n_rows; i += R) {
+				const double* a[R];
+				double s[R];
+				for (size_t r = 0; r < R; r++) {
+					a[r] = A.row(i + r);
+					s[r] = 0;
+				}
+				for (size_t j = 0; j < n; j++) {
+					double xj = x[j];
+					for (size_t r = 0; r < R; r++) s[r] += a[r][j] * xj;
+				}
+				for (size_t r = 0; r < R; r++) y[i + r] = s[r];
+			}
+			return i;
+		}
+
+		// Ширина блочного столбца в syrk: блоки на диагонали считаются
+		// целиком, так что лишняя работа -- примерно SYRK_BLOCK / (2 n)
+		const size_t SYRK_BLOCK = 128;
+
+		void scale(const MatrixRef& C, double beta) {
+			if (beta == 1) return;
+			for (size_t i = 0; i < C.n_rows; i++) {
+				double* c = C.row(i);
+				if (beta == 0) std::fill(c, c + C.n_cols, 0.0);
+				else for (size_t j = 0; j < C.n_cols; j++) c[j] *= beta;
+			}
+		}
+	}
+
+	// -Окно на всю матрицу
+	MatrixRef view(const Matrix& m) {
+		return { m.a, 0, (size_t)m._size.first, (size_t)m._size.second };
+	}
+
+	// -Текущие размеры блоков
+	GemmBlocking& gemm_blocking() {
+		static GemmBlocking blocking;
+		return blocking;
+	}
+
+	// -Текущие параметры gemv
+	GemvBlocking& gemv_blocking() {
+		static GemvBlocking blocking;
+		return blocking;
+	}
+
+	// -y = A x
+	void gemv(const MatrixRef& A, const double* x, double* y) {
+		gemv(A, x, y, gemv_blocking());
+	}
+
+	void gemv(const MatrixRef& A, const double* x, double* y, const GemvBlocking& blocking) {
+		size_t i = 0;
+		if (blocking.rows >= 8) i = gemv_rows<8>(A, x, y, i);
+		if (blocking.rows >= 4) i = gemv_rows<4>(A, x, y, i);
+		if (blocking.rows >= 2) i = gemv_rows<2>(A, x, y, i);
+		gemv_rows<1>(A, x, y, i);
+	}
+
+	// -C = alpha * A * B + beta * C
+	void gemm(double alpha, const MatrixRef& A, const MatrixRef& B, double beta, const MatrixRef& C) {
+		gemm(alpha, A, B, beta, C, gemm_blocking());
+	}
+
+	void gemm(double alpha, const MatrixRef& A, const MatrixRef& B, double beta, const MatrixRef& C,
+		const GemmBlocking& blocking) {
+		MAT_VEC_SCOPE("gemm");
+		size_t m = C.n_rows, n = C.n_cols, k = A.n_cols;
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)m * n * k);
+		scale(C, beta);
+		if (m == 0 || n == 0 || k == 0 || alpha == 0) return;
+
+		if (m * n * k <= SMALL_WORK) {
+			for (size_t i = 0; i < m; i++) {
+				double* c = C.row(i);
+				const double* a = A.row(i);
+				for (size_t p = 0; p < k; p++) {
+					double aip = alpha * a[p];
+					const double* b = B.row(p);
+					for (size_t j = 0; j < n; j++) c[j] += aip * b[j];
+				}
+			}
+			return;
+		}
+
+		size_t mc = std::max(MR, blocking.mc / MR * MR);
+		size_t kc = std::max((size_t)1, blocking.kc);
+		size_t nc = std::max(NR, blocking.nc / NR * NR);
+		PackBuffer b_pack(kc * std::min(nc, (n + NR - 1) / NR * NR));
+		size_t blocks = (m + mc - 1) / mc;
+
+		for (size_t jc = 0; jc < n; jc += nc) {
+			size_t ncur = std::min(nc, n - jc);
+			for (size_t pc = 0; pc < k; pc += kc) {
+				size_t kcur = std::min(kc, k - pc);
+				pack_b(B, pc, kcur, jc, ncur, b_pack.data());
+				size_t grain = m * ncur * kcur >= PARALLEL_WORK ? 1 : blocks;
+				parallel_for(0, blocks, grain, [&](size_t from, size_t to) {
+					thread_local std::vector<double> a_pack;
+					a_pack.resize(kcur * (mc + MR));
+					double acc[MR][NR];
+					for (size_t blk = from; blk < to; blk++) {
+						size_t ic = blk * mc;
+						size_t mcur = std::min(mc, m - ic);
+						pack_a(A, ic, mcur, pc, kcur, a_pack.data());
+						for (size_t jr = 0; jr < ncur; jr += NR) {
+							size_t nr = std::min(NR, ncur - jr);
+							const double* bp = b_pack.data() + jr * kcur;
+							for (size_t ir = 0; ir < mcur; ir += MR) {
+								size_t mr = std::min(MR, mcur - ir);
+								micro_kernel(kcur, a_pack.data() + ir * kcur, bp, acc);
+								for (size_t r = 0; r < mr; r++) {
+									double* c = C.row(ic + ir + r) + jc + jr;
+									for (size_t j = 0; j < nr; j++) c[j] += alpha * acc[r][j];
+								}
+							}
+						}
+					}
+				});
+			}
+		}
+	}
+
+	// -Столбец блоков C[j0.., j0..j0 + nb] нижнего треугольника -- одно
+	// произведение A^T[j0.., :] A[:, j0..j0 + nb]; A^T строится один раз
+	void syrk(double alpha, const MatrixRef& A, double beta, const MatrixRef& C) {
+		MAT_VEC_SCOPE("syrk");
+		size_t k = A.n_rows, n = A.n_cols;
+		if (k == 0 || alpha == 0) {
+			scale(C, beta);
+			return;
+		}
+		PackBuffer buffer(n * k);
+		std::vector<double*> rows(n);
+		for (size_t i = 0; i < n; i++) rows[i] = buffer.data() + i * k;
+		MatrixRef At{ rows.data(), 0, n, k };
+		transpose(A, At);
+		for (size_t j0 = 0; j0 < n; j0 += SYRK_BLOCK) {
+			size_t nb = std::min(SYRK_BLOCK, n - j0);
+			gemm(alpha, At.block(j0, 0, n - j0, k), A.block(0, j0, k, nb), beta, C.block(j0, j0, n - j0, nb));
+		}
+		for (size_t i = 0; i < n; i++) {
+			for (size_t j = i + 1; j < n; j++) C.at(i, j) = C.at(j, i);
+		}
+	}
+
+} // namespace mat_vec
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Base.h"
+#include <cstddef>
+
+namespace mat_vec {
+
+	// Окно матрицы без владения памятью: элемент (i, j) окна -- rows[i][col + j].
+	// Подходит и для Matrix (массив строк), и для непрерывных буферов.
+	struct MatrixRef {
+		double* const* rows;
+		size_t col;
+		size_t n_rows;
+		size_t n_cols;
+
+		double* row(size_t i) const { return rows[i] + col; }
+		double& at(size_t i, size_t j) const { return rows[i][col + j]; }
+
+		// Подокно с левым верхним углом (r, c) и размерами nr x nc
+		MatrixRef block(size_t r, size_t c, size_t nr, size_t nc) const {
+			return { rows + r, col + c, nr, nc };
+		}
+	};
+
+	// Окно на всю матрицу m
+	MatrixRef view(const Matrix& m);
+
+	// Размеры блоков ядра умножения (строки A, общий размер, столбцы B)
+	struct GemmBlocking {
+		size_t mc = 96;
+		size_t kc = 256;
+		size_t nc = 2048;
+	};
+
+	// Текущие размеры блоков (используются всеми вызовами gemm)
+	GemmBlocking& gemm_blocking();
+
+	// C = alpha * A * B + beta * C блочным алгоритмом с упаковкой панелей.
+	// Большие произведения распределяются по потокам ThreadPool::global()
+	void gemm(double alpha, const MatrixRef& A, const MatrixRef& B, double beta, const MatrixRef& C);
+
+	// Как gemm, но с явно заданными размерами блоков
+	void gemm(double alpha, const MatrixRef& A, const MatrixRef& B, double beta, const MatrixRef& C,
+		const GemmBlocking& blocking);
+
+	// C = alpha * A^T * A + beta * C для симметричной C (A.n_cols x A.n_cols):
+	// нижний треугольник считается через gemm по блочным столбцам, примерно
+	// вдвое быстрее полного произведения, верхний копируется из нижнего
+	void syrk(double alpha, const MatrixRef& A, double beta, const MatrixRef& C);
+
+	// Параметры ядра умножения матрицы на вектор: сколько строк A
+	// обрабатывается за один проход по x (1, 2, 4 или 8)
+	struct GemvBlocking {
+		size_t rows = 4;
+	};
+
+	// Текущие параметры (используются всеми вызовами gemv и Matrix * Vector)
+	GemvBlocking& gemv_blocking();
+
+	// y = A x; x длины A.n_cols, y длины A.n_rows. Каждая сумма по строке
+	// считается слева направо, так что результат не зависит от параметров
+	void gemv(const MatrixRef& A, const double* x, double* y);
+	void gemv(const MatrixRef& A, const double* x, double* y, const GemvBlocking& blocking);
+
+} // namespace mat_vec
@@ -0,0 +1,446 @@
+#include "Graph.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Vector.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <mutex>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Вершин на задачу в поэлементных проходах
+		const size_t VERTEX_GRAIN = 4096;
+
+		// Вершин фронта на задачу в шаге BFS сверху вниз
+		const size_t FRONTIER_GRAIN = 256;
+
+		// Размер блока чтения списка рёбер
+		const size_t READ_BLOCK = 1 << 16;
+
+		double seconds_since(std::chrono::steady_clock::time_point start) {
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		void finish(GraphStats* stats, size_t iterations, uint64_t edges, std::chrono::steady_clock::time_point start) {
+			if (!stats) return;
+			stats->iterations = iterations;
+			stats->edges_processed = edges;
+			stats->seconds = seconds_since(start);
+			stats->edges_per_second = stats->seconds > 0 ? edges / stats->seconds : 0;
+		}
+
+		// CSR из списка рёбер: подсчёт по строкам, затем сортировка и
+		// склейка повторов внутри каждой строки
+		SparseMatrix build_csr(size_t n, const std::vector<uint32_t>& src, const std::vector<uint32_t>& dst,
+			bool undirected) {
+			std::vector<size_t> ptr(n + 1, 0);
+			size_t m = std::min(src.size(), dst.size());
+			auto inside = [&](size_t e) { return src[e] < n && dst[e] < n; };
+			for (size_t e = 0; e < m; e++) {
+				if (!inside(e)) continue;
+				ptr[src[e] + 1]++;
+				if (undirected && src[e] != dst[e]) ptr[dst[e] + 1]++;
+			}
+			for (size_t i = 0; i < n; i++) ptr[i + 1] += ptr[i];
+			std::vector<uint32_t> cols(ptr[n]);
+			std::vector<size_t> next(ptr.begin(), ptr.end() - 1);
+			for (size_t e = 0; e < m; e++) {
+				if (!inside(e)) continue;
+				cols[next[src[e]]++] = dst[e];
+				if (undirected && src[e] != dst[e]) cols[next[dst[e]]++] = src[e];
+			}
+			// next[i] -- новый конец строки i после склейки
+			parallel_for(0, n, VERTEX_GRAIN, [&](size_t from, size_t to) {
+				for (size_t i = from; i < to; i++) {
+					auto first = cols.begin() + ptr[i], last = cols.begin() + ptr[i + 1];
+					std::sort(first, last);
+					next[i] = ptr[i] + (std::unique(first, last) - first);
+				}
+			});
+			size_t w = 0;
+			for (size_t i = 0; i < n; i++) {
+				size_t from = ptr[i];
+				ptr[i] = w;
+				for (size_t p = from; p < next[i]; p++) cols[w++] = cols[p];
+			}
+			ptr[n] = w;
+			cols.resize(w);
+			cols.shrink_to_fit();
+			std::vector<double> ones(w, 1.0);
+			return SparseMatrix(n, n, std::move(ptr), std::move(cols), std::move(ones));
+		}
+
+		// Сумма fn(i) по [0, n) с фиксированным разбиением (результат не зависит от числа потоков)
+		template <class F>
+		double parallel_sum(size_t n, const F& fn) {
+			size_t chunks = (n + VERTEX_GRAIN - 1) / VERTEX_GRAIN;
+			std::vector<double> part(chunks, 0.0);
+			parallel_for(0, chunks, 1, [&](size_t from, size_t to) {
+				for (size_t c = from; c < to; c++) {
+					double s = 0;
+					for (size_t i = c * VERTEX_GRAIN; i < std::min(n, (c + 1) * VERTEX_GRAIN); i++) s += fn(i);
+					part[c] = s;
+				}
+			});
+			double s = 0;
+			for (double x : part) s += x;
+			return s;
+		}
+
+		void atomic_add(std::atomic<double>& a, double x) {
+			double cur = a.load(std::memory_order_relaxed);
+			while (!a.compare_exchange_weak(cur, cur + x, std::memory_order_relaxed)) {}
+		}
+
+		// Корень множества с сокращением пути вдвое; корень -- наименьшая вершина множества
+		uint32_t find_root(std::vector<std::atomic<uint32_t>>& p, uint32_t x) {
+			for (;;) {
+				uint32_t q = p[x].load(std::memory_order_relaxed);
+				if (q == x) return x;
+				uint32_t g = p[q].load(std::memory_order_relaxed);
+				if (g != q) p[x].compare_exchange_weak(q, g, std::memory_order_relaxed);
+				x = g;
+			}
+		}
+
+		// Объединение: больший корень подвешивается к меньшему
+		void unite(std::vector<std::atomic<uint32_t>>& p, uint32_t u, uint32_t v) {
+			for (;;) {
+				u = find_root(p, u);
+				v = find_root(p, v);
+				if (u == v) return;
+				if (u < v) std::swap(u, v);
+				uint32_t expected = u;
+				if (p[u].compare_exchange_strong(expected, v, std::memory_order_relaxed)) return;
+			}
+		}
+
+		// Разбор строки списка рёбер: 1 -- ребро, 0 -- пропуск, -1 -- ошибка
+		int parse_edge(const char* p, const char* end, uint64_t& u, uint64_t& v) {
+			auto space = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == ','; };
+			auto digit = [](char c) { return c >= '0' && c <= '9'; };
+			while (p < end && space(*p)) p++;
+			if (p == end || *p == '#' || *p == '%') return 0;
+			uint64_t* out[2] = { &u, &v };
+			for (int k = 0; k < 2; k++) {
+				if (k) {
+					const char* q = p;
+					while (p < end && space(*p)) p++;
+					if (p == q) return -1;
+				}
+				if (p == end || !digit(*p)) return -1;
+				uint64_t x = 0;
+				for (; p < end && digit(*p); p++) x = x * 10 + (uint64_t)(*p - '0');
+				*out[k] = x;
+			}
+			return p == end || space(*p) ? 1 : -1;
+		}
+	}
+
+	Graph::Graph() {}
+
+	// -Граф по списку рёбер
+	Graph::Graph(size_t n, const std::vector<uint32_t>& src, const std::vector<uint32_t>& dst, bool undirected) {
+		MAT_VEC_SCOPE("Graph");
+		_out = build_csr(n, src, dst, undirected);
+		_in = undirected ? _out : _out.transposed();
+	}
+
+	// -Граф по матрице смежности
+	Graph::Graph(const SparseMatrix& adjacency) {
+		if (adjacency.rows() != adjacency.cols()) return;
+		_out = SparseMatrix(adjacency.rows(), adjacency.cols(), adjacency.row_ptr(), adjacency.cols_idx(),
+			std::vector<double>(adjacency.nnz(), 1.0));
+		_in = _out.transposed();
+	}
+
+	size_t Graph::vertices() const { return _out.rows(); }
+	size_t Graph::edges() const { return _out.nnz(); }
+	const SparseMatrix& Graph::out() const { return _out; }
+	const SparseMatrix& Graph::in() const { return _in; }
+	size_t Graph::out_degree(size_t v) const { return _out.row_nnz(v); }
+	size_t Graph::in_degree(size_t v) const { return _in.row_nnz(v); }
+
+	// -Плотный номер вершины, новый при первом появлении
+	uint32_t EdgeLoader::map(uint64_t id) {
+		auto res = _index.emplace(id, (uint32_t)_ids.size());
+		if (res.second) _ids.push_back(id);
+		return res.first->second;
+	}
+
+	void EdgeLoader::add(uint64_t from, uint64_t to) {
+		uint32_t u = map(from);
+		_src.push_back(u);
+		_dst.push_back(map(to));
+	}
+
+	// -Чтение списка рёбер блоками
+	bool EdgeLoader::read(std::istream& in) {
+		MAT_VEC_SCOPE("EdgeLoader::read");
+		auto start = std::chrono::steady_clock::now();
+		size_t before = _src.size();
+		std::vector<char> buf(READ_BLOCK);
+		size_t have = 0;
+		bool ok = true, eof = false;
+		while (ok && !eof) {
+			// строка длиннее буфера -- буфер растёт
+			if (have == buf.size()) buf.resize(buf.size() * 2);
+			in.read(buf.data() + have, (std::streamsize)(buf.size() - have));
+			size_t got = (size_t)in.gcount();
+			have += got;
+			eof = got == 0;
+			const char* p = buf.data();
+			const char* end = p + have;
+			while (p < end) {
+				const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+				if (!nl && !eof) break;
+				const char* line_end = nl ? nl : end;
+				uint64_t u, v;
+				int r = parse_edge(p, line_end, u, v);
+				if (r < 0) {
+					ok = false;
+					break;
+				}
+				if (r > 0) add(u, v);
+				p = nl ? nl + 1 : end;
+			}
+			have = end - p;
+			std::memmove(buf.data(), p, have);
+		}
+		double t = seconds_since(start);
+		_rate = t > 0 ? (_src.size() - before) / t : 0;
+		return ok;
+	}
+
+	bool EdgeLoader::read_file(const std::string& path) {
+		std::ifstream in(path, std::ios::binary);
+		return in && read(in);
+	}
+
+	size_t EdgeLoader::vertices() const { return _ids.size(); }
+	size_t EdgeLoader::edges() const { return _src.size(); }
+
+	uint32_t EdgeLoader::index(uint64_t id) const {
+		auto it = _index.find(id);
+		return it == _index.end() ? NO_VERTEX : it->second;
+	}
+
+	uint64_t EdgeLoader::id(size_t index) const { return _ids[index]; }
+	double EdgeLoader::edges_per_second() const { return _rate; }
+
+	// -Граф из прочитанных рёбер
+	Graph EdgeLoader::build(bool undirected) {
+		Graph g(_ids.size(), _src, _dst, undirected);
+		std::vector<uint32_t>().swap(_src);
+		std::vector<uint32_t>().swap(_dst);
+		return g;
+	}
+
+	// -PageRank степенным методом
+	Vector pagerank(const Graph& g, const PageRankOptions& opt, GraphStats* stats) {
+		MAT_VEC_SCOPE("pagerank");
+		auto start = std::chrono::steady_clock::now();
+		size_t n = g.vertices();
+		if (n == 0) {
+			finish(stats, 0, 0, start);
+			return Vector(0);
+		}
+		Vector rank(n, 1.0 / n);
+		const SparseMatrix& out = g.out();
+		const std::vector<size_t>& ptr = out.row_ptr();
+		const std::vector<uint32_t>& idx = out.cols_idx();
+		Vector contrib(n, 0), next(n, 0);
+		std::vector<std::atomic<double>> acc(opt.mode == PageRankMode::PUSH ? n : 0);
+		double d = opt.damping;
+		size_t it = 0;
+		uint64_t edges = 0;
+		while (it < opt.max_iterations) {
+			it++;
+			// вклад каждой вершины на одно исходящее ребро; висячие вершины
+			// отдают ранг всем поровну
+			double dangling = parallel_sum(n, [&](size_t u) {
+				size_t deg = ptr[u + 1] - ptr[u];
+				contrib[u] = deg ? rank[u] / deg : 0.0;
+				return deg ? 0.0 : rank[u];
+			});
+			if (opt.mode == PageRankMode::PULL) {
+				g.in().multiply(contrib.data, next.data);
+			}
+			else {
+				parallel_for(0, n, VERTEX_GRAIN, [&](size_t from, size_t to) {
+					for (size_t v = from; v < to; v++) acc[v].store(0, std::memory_order_relaxed);
+				});
+				parallel_for(0, n, VERTEX_GRAIN, [&](size_t from, size_t to) {
+					for (size_t u = from; u < to; u++) {
+						double c = contrib[u];
+						for (size_t p = ptr[u]; p < ptr[u + 1]; p++) atomic_add(acc[idx[p]], c);
+					}
+				});
+				parallel_for(0, n, VERTEX_GRAIN, [&](size_t from, size_t to) {
+					for (size_t v = from; v < to; v++) next[v] = acc[v].load(std::memory_order_relaxed);
+				});
+			}
+			edges += out.nnz();
+			double base = (1 - d) / n + d * dangling / n;
+			double change = parallel_sum(n, [&](size_t v) {
+				double x = base + d * next[v];
+				double diff = std::fabs(x - rank[v]);
+				rank[v] = x;
+				return diff;
+			});
+			if (change < opt.tolerance) break;
+		}
+		finish(stats, it, edges, start);
+		return rank;
+	}
+
+	// -Поиск в ширину с переключением направления
+	bool bfs(const Graph& g, size_t source, BfsResult& result, const BfsOptions& opt, GraphStats* stats) {
+		MAT_VEC_SCOPE("bfs");
+		auto start = std::chrono::steady_clock::now();
+		size_t n = g.vertices();
+		if (source >= n) return false;
+		const std::vector<size_t>& optr = g.out().row_ptr();
+		const std::vector<uint32_t>& oidx = g.out().cols_idx();
+		const std::vector<size_t>& iptr = g.in().row_ptr();
+		const std::vector<uint32_t>& iidx = g.in().cols_idx();
+
+		result = BfsResult();
+		result.parent.assign(n, NO_VERTEX);
+		std::vector<std::atomic<uint32_t>> depth(n);
+		parallel_for(0, n, VERTEX_GRAIN, [&](size_t from, size_t to) {
+			for (size_t v = from; v < to; v++) depth[v].store(NO_VERTEX, std::memory_order_relaxed);
+		});
+		depth[source] = 0;
+		result.parent[source] = (uint32_t)source;
+
+		std::vector<uint32_t> queue(1, (uint32_t)source);
+		std::vector<uint8_t> front, next_front;
+		bool bottom_up = false;
+		size_t front_size = 1;
+		uint64_t front_edges = optr[source + 1] - optr[source];
+		uint64_t unexplored = g.edges() - front_edges;
+		std::atomic<uint64_t> scanned{ 0 };
+		std::mutex lock;
+		uint32_t level = 0;
+
+		while (front_size) {
+			if (!bottom_up && front_edges > unexplored / opt.alpha) {
+				bottom_up = true;
+				front.assign(n, 0);
+				for (uint32_t v : queue) front[v] = 1;
+			}
+			else if (bottom_up && front_size < n / opt.beta) {
+				bottom_up = false;
+				queue.clear();
+				for (size_t v = 0; v < n; v++)
+					if (front[v]) queue.push_back((uint32_t)v);
+			}
+			std::atomic<size_t> count{ 0 };
+			std::atomic<uint64_t> degrees{ 0 };
+			if (bottom_up) {
+				// каждая непосещённая вершина ищет родителя во фронте
+				result.bottom_up_steps++;
+				next_front.assign(n, 0);
+				parallel_for(0, n, VERTEX_GRAIN, [&](size_t from, size_t to) {
+					size_t c = 0;
+					uint64_t deg = 0, edges = 0;
+					for (size_t v = from; v < to; v++) {
+						if (depth[v].load(std::memory_order_relaxed) != NO_VERTEX) continue;
+						for (size_t p = iptr[v]; p < iptr[v + 1]; p++) {
+							edges++;
+							uint32_t u = iidx[p];
+							if (!front[u]) continue;
+							depth[v].store(level + 1, std::memory_order_relaxed);
+							result.parent[v] = u;
+							next_front[v] = 1;
+							c++;
+							deg += optr[v + 1] - optr[v];
+							break;
+						}
+					}
+					count += c;
+					degrees += deg;
+					scanned += edges;
+				});
+				front.swap(next_front);
+			}
+			else {
+				// вершины фронта захватывают непосещённых соседей
+				result.top_down_steps++;
+				std::vector<uint32_t> next_queue;
+				parallel_for(0, queue.size(), FRONTIER_GRAIN, [&](size_t from, size_t to) {
+					std::vector<uint32_t> local;
+					uint64_t deg = 0, edges = 0;
+					for (size_t k = from; k < to; k++) {
+						uint32_t u = queue[k];
+						for (size_t p = optr[u]; p < optr[u + 1]; p++) {
+							edges++;
+							uint32_t v = oidx[p];
+							uint32_t expected = NO_VERTEX;
+							if (depth[v].load(std::memory_order_relaxed) != NO_VERTEX
+								|| !depth[v].compare_exchange_strong(expected, level + 1, std::memory_order_relaxed))
+								continue;
+							result.parent[v] = u;
+							local.push_back(v);
+							deg += optr[v + 1] - optr[v];
+						}
+					}
+					degrees += deg;
+					scanned += edges;
+					std::lock_guard<std::mutex> guard(lock);
+					next_queue.insert(next_queue.end(), local.begin(), local.end());
+				});
+				count = next_queue.size();
+				queue.swap(next_queue);
+			}
+			front_size = count;
+			front_edges = degrees;
+			unexplored -= std::min(unexplored, front_edges);
+			result.reached += front_size;
+			level++;
+		}
+		result.reached++;
+		result.depth.resize(n);
+		for (size_t v = 0; v < n; v++) result.depth[v] = depth[v].load(std::memory_order_relaxed);
+		finish(stats, level, scanned, start);
+		return true;
+	}
+
+	// -Компоненты слабой связности через параллельное объединение множеств
+	size_t connected_components(const Graph& g, std::vector<uint32_t>& label, GraphStats* stats) {
+		MAT_VEC_SCOPE("connected_components");
+		auto start = std::chrono::steady_clock::now();
+		size_t n = g.vertices();
+		const std::vector<size_t>& ptr = g.out().row_ptr();
+		const std::vector<uint32_t>& idx = g.out().cols_idx();
+		std::vector<std::atomic<uint32_t>> parent(n);
+		parallel_for(0, n, VERTEX_GRAIN, [&](size_t from, size_t to) {
+			for (size_t v = from; v < to; v++) parent[v].store((uint32_t)v, std::memory_order_relaxed);
+		});
+		parallel_for(0, n, VERTEX_GRAIN, [&](size_t from, size_t to) {
+			for (size_t u = from; u < to; u++)
+				for (size_t p = ptr[u]; p < ptr[u + 1]; p++) unite(parent, (uint32_t)u, idx[p]);
+		});
+		label.resize(n);
+		std::atomic<size_t> components{ 0 };
+		parallel_for(0, n, VERTEX_GRAIN, [&](size_t from, size_t to) {
+			size_t c = 0;
+			for (size_t v = from; v < to; v++) {
+				label[v] = find_root(parent, (uint32_t)v);
+				if (label[v] == v) c++;
+			}
+			components += c;
+		});
+		finish(stats, 1, g.edges(), start);
+		return components;
+	}
+
+} // namespace mat_vec
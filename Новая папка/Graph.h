@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Base.h"
+#include "SparseMatrix.h"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mat_vec {
+
+	// Анализ графов на разреженной матрице смежности.
+	//
+	// Вершины нумеруются 0..n-1, ребро u -> v -- ненулевой элемент (u, v)
+	// матрицы out(); in() -- её транспонированная (входящие рёбра).
+	// Для неориентированного графа каждое ребро хранится в обе стороны.
+	// Кратные рёбра склеиваются, петли сохраняются
+
+	// Вершина не найдена или не достигнута
+	const uint32_t NO_VERTEX = UINT32_MAX;
+
+	class Graph {
+	public:
+		// Граф без вершин
+		Graph();
+
+		// n вершин и рёбра src[i] -> dst[i]; рёбра с концами вне 0..n-1 отбрасываются
+		Graph(size_t n, const std::vector<uint32_t>& src, const std::vector<uint32_t>& dst, bool undirected = false);
+
+		// По квадратной матрице смежности: ненулевой (i, j) -- ребро i -> j
+		explicit Graph(const SparseMatrix& adjacency);
+
+		size_t vertices() const;
+		size_t edges() const;
+
+		const SparseMatrix& out() const;
+		const SparseMatrix& in() const;
+
+		size_t out_degree(size_t v) const;
+		size_t in_degree(size_t v) const;
+
+	private:
+		SparseMatrix _out;
+		SparseMatrix _in;
+	};
+
+	// Потоковая загрузка списка рёбер.
+	//
+	// Текст читается блоками, без построчного копирования; строка -- два
+	// неотрицательных целых (исходные номера вершин), дальше в строке может
+	// быть что угодно (например, вес). Пустые строки и строки, начинающиеся
+	// с # или %, пропускаются. Исходные номера -- произвольные 64-битные
+	// числа, они переводятся в плотные 0..n-1 в порядке первого появления
+	class EdgeLoader {
+	public:
+		EdgeLoader() = default;
+
+		// Читает поток до конца; false при ошибке формата (прочитанное
+		// до ошибки остаётся)
+		bool read(std::istream& in);
+		bool read_file(const std::string& path);
+
+		void add(uint64_t from, uint64_t to);
+
+		size_t vertices() const;
+		size_t edges() const;
+
+		// Плотный номер вершины (NO_VERTEX, если её нет) и обратно
+		uint32_t index(uint64_t id) const;
+		uint64_t id(size_t index) const;
+
+		// Скорость последнего read(), рёбер в секунду
+		double edges_per_second() const;
+
+		// Строит граф и освобождает память рёбер; соответствие номеров
+		// вершин остаётся
+		Graph build(bool undirected = false);
+
+	private:
+		uint32_t map(uint64_t id);
+
+		std::unordered_map<uint64_t, uint32_t> _index;
+		std::vector<uint64_t> _ids;
+		std::vector<uint32_t> _src;
+		std::vector<uint32_t> _dst;
+		double _rate = 0;
+	};
+
+	// Сколько работы сделал алгоритм
+	struct GraphStats {
+		size_t iterations = 0;          // итераций PageRank или уровней BFS
+		uint64_t edges_processed = 0;   // просмотренных рёбер
+		double seconds = 0;
+		double edges_per_second = 0;
+	};
+
+	enum class PageRankMode {
+		PULL,   // вершина собирает вклад входящих рёбер: умножение in() на вектор
+		PUSH    // вершина рассылает вклад по исходящим рёбрам (атомарное сложение)
+	};
+
+	struct PageRankOptions {
+		double damping = 0.85;
+		double tolerance = 1e-10;     // останов, когда L1-норма изменения меньше
+		size_t max_iterations = 100;
+		PageRankMode mode = PageRankMode::PULL;
+	};
+
+	// PageRank; сумма рангов равна 1, ранг вершин без исходящих рёбер
+	// распределяется поровну между всеми вершинами
+	Vector pagerank(const Graph& g, const PageRankOptions& opt = PageRankOptions(), GraphStats* stats = nullptr);
+
+	struct BfsOptions {
+		// Переход сверху вниз -> снизу вверх, когда рёбер у фронта больше
+		// чем (непросмотренные рёбра) / alpha; обратно, когда фронт меньше
+		// n / beta (Beamer и др.)
+		double alpha = 14;
+		double beta = 24;
+	};
+
+	struct BfsResult {
+		std::vector<uint32_t> parent;   // NO_VERTEX -- не достигнута; у источника -- он сам
+		std::vector<uint32_t> depth;    // NO_VERTEX -- не достигнута
+		size_t reached = 0;
+		size_t top_down_steps = 0;
+		size_t bottom_up_steps = 0;
+	};
+
+	// Поиск в ширину с переключением направления; false, если source вне графа
+	bool bfs(const Graph& g, size_t source, BfsResult& result, const BfsOptions& opt = BfsOptions(),
+		GraphStats* stats = nullptr);
+
+	// Компоненты слабой связности: label[v] -- наименьший номер вершины
+	// в компоненте v. Возвращает число компонент
+	size_t connected_components(const Graph& g, std::vector<uint32_t>& label, GraphStats* stats = nullptr);
+
+} // namespace mat_vec
@@ -0,0 +1,531 @@
+#include "KnnIndex.h"
+#include "Matrix.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Vector.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace mat_vec {
+
+	// Формат файла (little-endian). Каждая секция начинается с границы 64 байт,
+	// поэтому файл можно отобразить в память и читать секции на месте:
+	//   FileHeader
+	//   ids      -- uint64 x count
+	//   vectors  -- double x count x dim, строки подряд
+	// для HNSW дополнительно:
+	//   levels   -- int32 x count
+	//   links0   -- uint32 x count x (2M + 1)
+	//   offsets  -- uint64 x count, начало уровней узла в upper
+	//   upper    -- uint32 x upper_size, по M + 1 на уровень
+	namespace {
+
+		const char MAGIC[8] = { 'M', 'V', 'K', 'N', 'N', 'I', 'D', 'X' };
+		const uint32_t VERSION = 1;
+		const size_t ALIGN = 64;
+
+		enum Kind : uint32_t { FLAT = 0, HNSW = 1 };
+
+		struct FileHeader {
+			char magic[8];
+			uint32_t version;
+			uint32_t kind;
+			uint32_t metric;
+			uint32_t reserved;
+			uint64_t dim;
+			uint64_t count;
+			uint64_t M;
+			uint64_t ef_construction;
+			uint64_t ef_search;
+			uint64_t entry;
+			int64_t max_level;
+			uint64_t upper_size;
+		};
+
+		// Дописывает нули до границы ALIGN
+		bool pad(std::ostream& out) {
+			static const char zeros[ALIGN] = {};
+			size_t at = (size_t)out.tellp();
+			if (at % ALIGN) out.write(zeros, ALIGN - at % ALIGN);
+			return (bool)out;
+		}
+
+		bool skip_pad(std::istream& in) {
+			size_t at = (size_t)in.tellg();
+			if (at % ALIGN) in.seekg(ALIGN - at % ALIGN, std::ios::cur);
+			return (bool)in;
+		}
+
+		template <class T>
+		bool write_section(std::ostream& out, const T* data, size_t n) {
+			if (n) out.write(reinterpret_cast<const char*>(data), n * sizeof(T));
+			return pad(out);
+		}
+
+		template <class T>
+		bool read_section(std::istream& in, T* data, size_t n) {
+			if (n) in.read(reinterpret_cast<char*>(data), n * sizeof(T));
+			return in && skip_pad(in);
+		}
+
+		FileHeader make_header(Kind kind, const VectorStore& store) {
+			FileHeader h;
+			std::memset(&h, 0, sizeof(h));
+			std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+			h.version = VERSION;
+			h.kind = kind;
+			h.metric = (uint32_t)store.metric();
+			h.dim = store.dim();
+			h.count = store.size();
+			return h;
+		}
+
+		bool read_header(std::istream& in, Kind kind, FileHeader& h) {
+			in.read(reinterpret_cast<char*>(&h), sizeof(h));
+			return in && std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.version == VERSION &&
+				h.kind == kind && h.metric <= (uint32_t)Metric::COSINE_DISTANCE && skip_pad(in);
+		}
+
+		// Значение метрики по внутреннему расстоянию (меньше -- ближе)
+		double report(Metric metric, double d) {
+			switch (metric) {
+			case Metric::L2: return std::sqrt(d);
+			case Metric::DOT: return -d;
+			case Metric::COSINE_SIMILARITY: return 1 - d;
+			default: return d;
+			}
+		}
+
+		double squared(const double* x, size_t n) {
+			double s = 0;
+			for (size_t i = 0; i < n; i++) s += x[i] * x[i];
+			return s;
+		}
+
+		// Строки запросов и квадраты их норм
+		std::vector<double> query_norms(const Matrix& q) {
+			std::vector<double> n(q._size.first);
+			for (size_t i = 0; i < n.size(); i++) n[i] = squared(q.a[i], q._size.second);
+			return n;
+		}
+
+		// Метки посещённых узлов для поиска по графу, своя копия у каждого потока
+		struct Visited {
+			std::vector<uint32_t> tags;
+			uint32_t epoch = 0;
+
+			void reset(size_t n) {
+				if (tags.size() < n) tags.resize(n, 0);
+				if (++epoch == 0) {
+					std::fill(tags.begin(), tags.end(), 0);
+					epoch = 1;
+				}
+			}
+			bool visit(uint32_t node) {
+				if (tags[node] == epoch) return false;
+				tags[node] = epoch;
+				return true;
+			}
+		};
+
+		Visited& visited() {
+			static thread_local Visited v;
+			return v;
+		}
+	}
+
+	// ---- VectorStore ----
+
+	VectorStore::VectorStore(size_t dim, Metric metric) : _dim(dim), _metric(metric) {}
+
+	VectorStore::VectorStore(const VectorStore& src)
+		: _dim(src._dim), _metric(src._metric), _data(src._data), _norms(src._norms),
+		_ids(src._ids), _index(src._index) {
+		relink();
+	}
+
+	VectorStore& VectorStore::operator=(const VectorStore& rhs) {
+		if (this == &rhs) return *this;
+		_dim = rhs._dim;
+		_metric = rhs._metric;
+		_data = rhs._data;
+		_norms = rhs._norms;
+		_ids = rhs._ids;
+		_index = rhs._index;
+		relink();
+		return *this;
+	}
+
+	size_t VectorStore::dim() const { return _dim; }
+	size_t VectorStore::size() const { return _ids.size(); }
+	Metric VectorStore::metric() const { return _metric; }
+
+	// -Добавляет строку; при перевыделении буфера указатели строк пересчитываются
+	bool VectorStore::add(VectorId id, const double* v) {
+		if (_index.count(id)) return false;
+		const double* old = _data.data();
+		_data.insert(_data.end(), v, v + _dim);
+		_index[id] = _ids.size();
+		_ids.push_back(id);
+		_norms.push_back(squared(v, _dim));
+		if (_data.data() != old) relink();
+		else _rows.push_back(_data.data() + (_ids.size() - 1) * _dim);
+		return true;
+	}
+
+	bool VectorStore::contains(VectorId id) const { return _index.count(id) != 0; }
+
+	size_t VectorStore::find(VectorId id) const {
+		auto it = _index.find(id);
+		return it == _index.end() ? size() : it->second;
+	}
+
+	VectorId VectorStore::id(size_t row) const { return _ids[row]; }
+	const double* VectorStore::row(size_t i) const { return _rows[i]; }
+	double VectorStore::squared_norm(size_t i) const { return _norms[i]; }
+	const double* VectorStore::squared_norms() const { return _norms.data(); }
+
+	MatrixRef VectorStore::rows() const { return { _rows.data(), 0, size(), _dim }; }
+
+	bool VectorStore::write(std::ostream& out) const {
+		return write_section(out, _ids.data(), _ids.size()) && write_section(out, _data.data(), _data.size());
+	}
+
+	bool VectorStore::read(std::istream& in, size_t count) {
+		_ids.resize(count);
+		_data.resize(count * _dim);
+		if (!read_section(in, _ids.data(), count) || !read_section(in, _data.data(), _data.size())) return false;
+		_index.clear();
+		_norms.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			_index[_ids[i]] = i;
+			_norms[i] = squared(_data.data() + i * _dim, _dim);
+		}
+		relink();
+		return _index.size() == count;
+	}
+
+	void VectorStore::relink() {
+		_rows.resize(_ids.size());
+		for (size_t i = 0; i < _rows.size(); i++) _rows[i] = _data.data() + i * _dim;
+	}
+
+	// ---- FlatIndex ----
+
+	FlatIndex::FlatIndex(size_t dim, Metric metric) : _store(dim, metric) {}
+
+	bool FlatIndex::add(VectorId id, const Vector& v) {
+		return v.size() == _store.dim() && _store.add(id, v.data);
+	}
+
+	size_t FlatIndex::size() const { return _store.size(); }
+	const VectorStore& FlatIndex::store() const { return _store; }
+
+	std::vector<SearchResult> FlatIndex::search(const Vector& q, size_t k) const {
+		if (q.size() != _store.dim()) return {};
+		Matrix m(1, q.size(), 0.0);
+		std::copy(q.data, q.data + q.size(), m.a[0]);
+		return search(m, k)[0];
+	}
+
+	std::vector<std::vector<SearchResult>> FlatIndex::search(const Matrix& queries, size_t k) const {
+		MAT_VEC_SCOPE("FlatIndex::search");
+		if ((size_t)queries._size.second != _store.dim())
+			return std::vector<std::vector<SearchResult>>(queries._size.first);
+		std::vector<double> qn = query_norms(queries);
+		DistanceOptions opt;
+		opt.metric = _store.metric();
+		auto nn = top_k(view(queries), qn.data(), _store.rows(), _store.squared_norms(), k, opt);
+		std::vector<std::vector<SearchResult>> out(nn.size());
+		for (size_t i = 0; i < nn.size(); i++)
+			for (const Neighbor& n : nn[i]) out[i].push_back({ _store.id(n.index), n.distance });
+		return out;
+	}
+
+	bool FlatIndex::save(const std::string& path) const {
+		std::ofstream out(path, std::ios::binary);
+		FileHeader h = make_header(FLAT, _store);
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		return pad(out) && _store.write(out);
+	}
+
+	bool FlatIndex::load(const std::string& path, FlatIndex& out) {
+		std::ifstream in(path, std::ios::binary);
+		FileHeader h;
+		if (!read_header(in, FLAT, h)) return false;
+		FlatIndex index(h.dim, (Metric)h.metric);
+		if (!index._store.read(in, h.count)) return false;
+		out = index;
+		return true;
+	}
+
+	// ---- HnswIndex ----
+
+	HnswIndex::HnswIndex(size_t dim, Metric metric, const HnswOptions& opt)
+		: _store(dim, metric), _opt(opt), _rng(opt.seed) {
+		_opt.M = std::max<size_t>(_opt.M, 2);
+	}
+
+	size_t HnswIndex::size() const { return _store.size(); }
+	const VectorStore& HnswIndex::store() const { return _store; }
+	void HnswIndex::set_ef_search(size_t ef) { _opt.ef_search = std::max<size_t>(ef, 1); }
+	size_t HnswIndex::ef_search() const { return _opt.ef_search; }
+
+	// -Внутреннее расстояние: меньше -- ближе
+	double HnswIndex::distance(const double* q, double q_norm, uint32_t node) const {
+		const double* x = _store.row(node);
+		size_t d = _store.dim();
+		double s = 0;
+		Metric m = _store.metric();
+		if (m == Metric::SQUARED_L2 || m == Metric::L2) {
+			for (size_t j = 0; j < d; j++) {
+				double t = q[j] - x[j];
+				s += t * t;
+			}
+			return s;
+		}
+		for (size_t j = 0; j < d; j++) s += q[j] * x[j];
+		if (m == Metric::DOT) return -s;
+		double den = std::sqrt(q_norm) * std::sqrt(_store.squared_norm(node));
+		return 1 - (den > 0 ? s / den : 0);
+	}
+
+	size_t HnswIndex::max_links(int level) const { return level == 0 ? 2 * _opt.M : _opt.M; }
+
+	uint32_t* HnswIndex::links(uint32_t node, int level) {
+		if (level == 0) return &_links0[node * (2 * _opt.M + 1)];
+		return &_upper[node][(level - 1) * (_opt.M + 1)];
+	}
+
+	const uint32_t* HnswIndex::links(uint32_t node, int level) const {
+		return const_cast<HnswIndex*>(this)->links(node, level);
+	}
+
+	// -Жадный спуск по уровням from..to
+	uint32_t HnswIndex::greedy(const double* q, double q_norm, uint32_t entry, int from, int to) const {
+		double best = distance(q, q_norm, entry);
+		for (int level = from; level >= to; level--) {
+			bool moved = true;
+			while (moved) {
+				moved = false;
+				const uint32_t* l = links(entry, level);
+				for (uint32_t i = 1; i <= l[0]; i++) {
+					double d = distance(q, q_norm, l[i]);
+					if (d < best) {
+						best = d;
+						entry = l[i];
+						moved = true;
+					}
+				}
+			}
+		}
+		return entry;
+	}
+
+	// -Поиск ef ближайших на уровне level; результат по возрастанию расстояния
+	std::vector<HnswIndex::Candidate> HnswIndex::search_layer(const double* q, double q_norm, uint32_t entry,
+		size_t ef, int level) const {
+		auto closer = [](const Candidate& a, const Candidate& b) { return a.distance > b.distance; };
+		auto farther = [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; };
+		Visited& seen = visited();
+		seen.reset(size());
+		seen.visit(entry);
+
+		Candidate start = { distance(q, q_norm, entry), entry };
+		std::vector<Candidate> frontier(1, start); // куча: вершина -- ближайший
+		std::vector<Candidate> found(1, start);    // куча: вершина -- дальний
+		while (!frontier.empty()) {
+			Candidate c = frontier.front();
+			if (c.distance > found.front().distance && found.size() >= ef) break;
+			std::pop_heap(frontier.begin(), frontier.end(), closer);
+			frontier.pop_back();
+			const uint32_t* l = links(c.node, level);
+			for (uint32_t i = 1; i <= l[0]; i++) {
+				uint32_t n = l[i];
+				if (!seen.visit(n)) continue;
+				double d = distance(q, q_norm, n);
+				if (found.size() < ef || d < found.front().distance) {
+					frontier.push_back({ d, n });
+					std::push_heap(frontier.begin(), frontier.end(), closer);
+					found.push_back({ d, n });
+					std::push_heap(found.begin(), found.end(), farther);
+					if (found.size() > ef) {
+						std::pop_heap(found.begin(), found.end(), farther);
+						found.pop_back();
+					}
+				}
+			}
+		}
+		std::sort_heap(found.begin(), found.end(), farther);
+		return found;
+	}
+
+	// -Эвристика выбора соседей: кандидат берётся, если он ближе к узлу,
+	// чем к любому уже выбранному; недобор дополняется ближайшими из отброшенных
+	std::vector<uint32_t> HnswIndex::select(const std::vector<Candidate>& candidates, size_t m) const {
+		std::vector<uint32_t> chosen, rejected;
+		for (const Candidate& c : candidates) {
+			if (chosen.size() >= m) break;
+			const double* x = _store.row(c.node);
+			double xn = _store.squared_norm(c.node);
+			bool good = true;
+			for (uint32_t s : chosen)
+				if (distance(x, xn, s) < c.distance) {
+					good = false;
+					break;
+				}
+			(good ? chosen : rejected).push_back(c.node);
+		}
+		for (size_t i = 0; i < rejected.size() && chosen.size() < m; i++) chosen.push_back(rejected[i]);
+		return chosen;
+	}
+
+	// -Добавляет ребро node -> neighbor, при переполнении список прореживается
+	void HnswIndex::connect(uint32_t node, uint32_t neighbor, int level) {
+		uint32_t* l = links(node, level);
+		size_t cap = max_links(level);
+		if (l[0] < cap) {
+			l[++l[0]] = neighbor;
+			return;
+		}
+		const double* x = _store.row(node);
+		double xn = _store.squared_norm(node);
+		std::vector<Candidate> c;
+		c.push_back({ distance(x, xn, neighbor), neighbor });
+		for (uint32_t i = 1; i <= l[0]; i++) c.push_back({ distance(x, xn, l[i]), l[i] });
+		std::sort(c.begin(), c.end(), [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+		std::vector<uint32_t> keep = select(c, cap);
+		l[0] = (uint32_t)keep.size();
+		std::copy(keep.begin(), keep.end(), l + 1);
+	}
+
+	// -Вставка: уровень ~ -ln(U) / ln(M), спуск к уровню узла, связывание на каждом уровне ниже
+	bool HnswIndex::add(VectorId id, const Vector& v) {
+		MAT_VEC_SCOPE("HnswIndex::add");
+		if (v.size() != _store.dim() || !_store.add(id, v.data)) return false;
+		uint32_t node = (uint32_t)(size() - 1);
+		double u = std::uniform_real_distribution<double>(0.0, 1.0)(_rng);
+		int level = (int)std::floor(-std::log(1 - u) / std::log((double)_opt.M));
+		_levels.push_back(level);
+		_links0.resize(_links0.size() + 2 * _opt.M + 1, 0);
+		_upper.emplace_back(level * (_opt.M + 1), 0);
+		if (_max_level < 0) {
+			_entry = node;
+			_max_level = level;
+			return true;
+		}
+
+		const double* q = _store.row(node);
+		double qn = _store.squared_norm(node);
+		uint32_t ep = _entry;
+		if (_max_level > level) ep = greedy(q, qn, ep, _max_level, level + 1);
+		for (int l = std::min(level, _max_level); l >= 0; l--) {
+			std::vector<Candidate> found = search_layer(q, qn, ep, _opt.ef_construction, l);
+			for (uint32_t n : select(found, _opt.M)) {
+				connect(node, n, l);
+				connect(n, node, l);
+			}
+			ep = found[0].node;
+		}
+		if (level > _max_level) {
+			_max_level = level;
+			_entry = node;
+		}
+		return true;
+	}
+
+	std::vector<SearchResult> HnswIndex::search_one(const double* q, size_t k) const {
+		std::vector<SearchResult> out;
+		if (_max_level < 0 || k == 0) return out;
+		double qn = squared(q, _store.dim());
+		uint32_t ep = greedy(q, qn, _entry, _max_level, 1);
+		std::vector<Candidate> found = search_layer(q, qn, ep, std::max(_opt.ef_search, k), 0);
+		for (size_t i = 0; i < found.size() && i < k; i++)
+			out.push_back({ _store.id(found[i].node), report(_store.metric(), found[i].distance) });
+		return out;
+	}
+
+	std::vector<SearchResult> HnswIndex::search(const Vector& q, size_t k) const {
+		MAT_VEC_SCOPE("HnswIndex::search");
+		if (q.size() != _store.dim()) return {};
+		return search_one(q.data, k);
+	}
+
+	std::vector<std::vector<SearchResult>> HnswIndex::search(const Matrix& queries, size_t k) const {
+		MAT_VEC_SCOPE("HnswIndex::search");
+		std::vector<std::vector<SearchResult>> out(queries._size.first);
+		if ((size_t)queries._size.second != _store.dim()) return out;
+		parallel_for(0, out.size(), 4, [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; i++) out[i] = search_one(queries.a[i], k);
+		});
+		return out;
+	}
+
+	bool HnswIndex::save(const std::string& path) const {
+		std::ofstream out(path, std::ios::binary);
+		size_t n = size();
+		std::vector<int32_t> levels(_levels.begin(), _levels.end());
+		std::vector<uint64_t> offsets(n);
+		std::vector<uint32_t> upper;
+		for (size_t i = 0; i < n; i++) {
+			offsets[i] = upper.size();
+			upper.insert(upper.end(), _upper[i].begin(), _upper[i].end());
+		}
+		FileHeader h = make_header(HNSW, _store);
+		h.M = _opt.M;
+		h.ef_construction = _opt.ef_construction;
+		h.ef_search = _opt.ef_search;
+		h.entry = _entry;
+		h.max_level = _max_level;
+		h.upper_size = upper.size();
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		return pad(out) && _store.write(out) && write_section(out, levels.data(), n) &&
+			write_section(out, _links0.data(), _links0.size()) && write_section(out, offsets.data(), n) &&
+			write_section(out, upper.data(), upper.size());
+	}
+
+	bool HnswIndex::load(const std::string& path, HnswIndex& out) {
+		std::ifstream in(path, std::ios::binary);
+		FileHeader h;
+		if (!read_header(in, HNSW, h) || h.M < 2) return false;
+		HnswOptions opt;
+		opt.M = h.M;
+		opt.ef_construction = h.ef_construction;
+		opt.ef_search = h.ef_search;
+		opt.seed = out._opt.seed + h.count;
+		HnswIndex index(h.dim, (Metric)h.metric, opt);
+		size_t n = h.count;
+		std::vector<int32_t> levels(n);
+		std::vector<uint64_t> offsets(n);
+		std::vector<uint32_t> upper(h.upper_size);
+		index._links0.resize(n * (2 * opt.M + 1));
+		if (!index._store.read(in, n) || !read_section(in, levels.data(), n) ||
+			!read_section(in, index._links0.data(), index._links0.size()) ||
+			!read_section(in, offsets.data(), n) || !read_section(in, upper.data(), upper.size()))
+			return false;
+		index._levels.assign(levels.begin(), levels.end());
+		index._upper.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			size_t len = levels[i] * (opt.M + 1);
+			if (levels[i] < 0 || offsets[i] + len > upper.size()) return false;
+			index._upper[i].assign(upper.begin() + offsets[i], upper.begin() + offsets[i] + len);
+		}
+		// номера соседей и их число проверяются, чтобы повреждённый файл не дал выход за границы
+		for (size_t i = 0; i < n; i++)
+			for (int l = 0; l <= levels[i]; l++) {
+				const uint32_t* nb = index.links((uint32_t)i, l);
+				if (nb[0] > index.max_links(l)) return false;
+				for (uint32_t j = 1; j <= nb[0]; j++)
+					if (nb[j] >= n || levels[nb[j]] < l) return false;
+			}
+		index._entry = (uint32_t)h.entry;
+		index._max_level = (int)h.max_level;
+		if (n == 0 ? index._max_level != -1 : index._entry >= n || index._levels[index._entry] != index._max_level)
+			return false;
+		out = index;
+		return true;
+	}
+
+} // namespace mat_vec
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Base.h"
+#include "Distance.h"
+#include "Gemm.h"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mat_vec {
+
+	// Внешний идентификатор вектора в индексе
+	typedef uint64_t VectorId;
+
+	// Результат поиска: идентификатор и значение метрики
+	struct SearchResult {
+		VectorId id;
+		double distance;
+	};
+
+	// Хранилище векторов индекса: строки подряд в одном буфере,
+	// квадраты норм и отображение идентификатор -> номер строки
+	class VectorStore {
+	public:
+		VectorStore(size_t dim, Metric metric);
+
+		// Копия получает собственные указатели на строки
+		VectorStore(const VectorStore& src);
+		VectorStore& operator=(const VectorStore& rhs);
+
+		size_t dim() const;
+		size_t size() const;
+		Metric metric() const;
+
+		// Добавляет вектор; false, если id уже есть или размер не совпадает
+		bool add(VectorId id, const double* v);
+
+		bool contains(VectorId id) const;
+
+		// Номер строки для id (size() -- если нет)
+		size_t find(VectorId id) const;
+
+		VectorId id(size_t row) const;
+		const double* row(size_t i) const;
+		double squared_norm(size_t i) const;
+		const double* squared_norms() const;
+
+		// Окно на все строки
+		MatrixRef rows() const;
+
+		// Запись и чтение секций идентификаторов и векторов
+		bool write(std::ostream& out) const;
+		bool read(std::istream& in, size_t count);
+
+	private:
+		void relink();
+
+		size_t _dim;
+		Metric _metric;
+		std::vector<double> _data;
+		std::vector<double*> _rows;
+		std::vector<double> _norms;
+		std::vector<VectorId> _ids;
+		std::unordered_map<VectorId, size_t> _index;
+	};
+
+	// Точный поиск полным перебором: запросы обрабатываются пачкой
+	// через блочный gemm (top_k из Distance.h)
+	class FlatIndex {
+	public:
+		explicit FlatIndex(size_t dim, Metric metric = Metric::SQUARED_L2);
+
+		bool add(VectorId id, const Vector& v);
+		size_t size() const;
+		const VectorStore& store() const;
+
+		// k ближайших к q (по возрастанию расстояния или убыванию сходства);
+		// пусто, если длина q не равна размерности индекса
+		std::vector<SearchResult> search(const Vector& q, size_t k) const;
+
+		// То же для каждой строки queries; при неверном числе столбцов
+		// списки всех запросов пусты
+		std::vector<std::vector<SearchResult>> search(const Matrix& queries, size_t k) const;
+
+		// Двоичный файл, см. KnnIndex.cpp; false при ошибке ввода-вывода или формата
+		bool save(const std::string& path) const;
+		static bool load(const std::string& path, FlatIndex& out);
+
+	private:
+		VectorStore _store;
+	};
+
+	// Параметры графа HNSW
+	struct HnswOptions {
+		size_t M = 16;                // соседей на верхних уровнях (на нулевом -- 2M)
+		size_t ef_construction = 200; // ширина поиска при вставке
+		size_t ef_search = 64;        // ширина поиска по умолчанию; больше -- выше полнота
+		uint64_t seed = 42;           // генератор уровней
+	};
+
+	// Приближённый поиск по иерархическому графу малого мира (HNSW).
+	// Вставки последовательные, поиск можно вести из нескольких потоков
+	class HnswIndex {
+	public:
+		HnswIndex(size_t dim, Metric metric = Metric::SQUARED_L2, const HnswOptions& opt = HnswOptions());
+
+		bool add(VectorId id, const Vector& v);
+		size_t size() const;
+		const VectorStore& store() const;
+
+		void set_ef_search(size_t ef);
+		size_t ef_search() const;
+
+		// Пусто, если длина q не равна размерности индекса
+		std::vector<SearchResult> search(const Vector& q, size_t k) const;
+
+		// Запросы распределяются по потокам пула; при неверном числе
+		// столбцов списки всех запросов пусты
+		std::vector<std::vector<SearchResult>> search(const Matrix& queries, size_t k) const;
+
+		bool save(const std::string& path) const;
+		static bool load(const std::string& path, HnswIndex& out);
+
+	private:
+		struct Candidate {
+			double distance;
+			uint32_t node;
+		};
+
+		double distance(const double* q, double q_norm, uint32_t node) const;
+		uint32_t* links(uint32_t node, int level);
+		const uint32_t* links(uint32_t node, int level) const;
+		size_t max_links(int level) const;
+		uint32_t greedy(const double* q, double q_norm, uint32_t entry, int from, int to) const;
+		std::vector<Candidate> search_layer(const double* q, double q_norm, uint32_t entry, size_t ef, int level) const;
+		std::vector<uint32_t> select(const std::vector<Candidate>& candidates, size_t m) const;
+		void connect(uint32_t node, uint32_t neighbor, int level);
+		std::vector<SearchResult> search_one(const double* q, size_t k) const;
+
+		VectorStore _store;
+		HnswOptions _opt;
+		std::mt19937_64 _rng;
+		std::vector<int> _levels;
+		std::vector<uint32_t> _links0;                // по 2M + 1 на узел: число соседей и соседи
+		std::vector<std::vector<uint32_t>> _upper;    // по M + 1 на уровень выше нулевого
+		uint32_t _entry = 0;
+		int _max_level = -1;
+	};
+
+} // namespace mat_vec
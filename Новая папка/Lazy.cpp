@@ -0,0 +1,441 @@
+#include "Lazy.h"
+#include "Gemm.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Transpose.h"
+#include "VMath.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Элементов в куске слитого ядра: регистры кусков живут в L1
+		const size_t CHUNK = 256;
+
+		// Кусков на задачу пула
+		const size_t CHUNK_GRAIN = 16;
+
+		bool elementwise(LazyOp op) {
+			return op != LazyOp::INPUT && op != LazyOp::MATMUL && op != LazyOp::TRANSPOSE;
+		}
+
+		bool binary(LazyOp op) {
+			return op == LazyOp::MATMUL || op == LazyOp::ADD || op == LazyOp::SUB || op == LazyOp::HADAMARD;
+		}
+
+		uint64_t bits(double x) {
+			uint64_t b;
+			std::memcpy(&b, &x, sizeof(b));
+			return b;
+		}
+
+		// Одна операция слитого ядра над куском длины n
+		void run_op(LazyOp op, const double* x, const double* y, double s, double* z, size_t n) {
+			switch (op) {
+			case LazyOp::ADD: for (size_t i = 0; i < n; i++) z[i] = x[i] + y[i]; break;
+			case LazyOp::SUB: for (size_t i = 0; i < n; i++) z[i] = x[i] - y[i]; break;
+			case LazyOp::HADAMARD: for (size_t i = 0; i < n; i++) z[i] = x[i] * y[i]; break;
+			case LazyOp::SCALE: for (size_t i = 0; i < n; i++) z[i] = x[i] * s; break;
+			case LazyOp::NEG: for (size_t i = 0; i < n; i++) z[i] = -x[i]; break;
+			case LazyOp::EXP: for (size_t i = 0; i < n; i++) z[i] = vmath::exp(x[i]); break;
+			case LazyOp::LOG: for (size_t i = 0; i < n; i++) z[i] = vmath::log(x[i]); break;
+			case LazyOp::TANH: for (size_t i = 0; i < n; i++) z[i] = vmath::tanh(x[i]); break;
+			case LazyOp::SIGMOID: for (size_t i = 0; i < n; i++) z[i] = vmath::sigmoid(x[i]); break;
+			default: break;
+			}
+		}
+	}
+
+	bool LazyExpr::valid() const { return _graph && _graph->valid(_id); }
+	std::pair<size_t, size_t> LazyExpr::shape() const { return _graph ? _graph->shape(_id) : std::make_pair<size_t, size_t>(0, 0); }
+
+	// -Новый узел или уже записанный с тем же ключом
+	LazyExpr LazyGraph::record(LazyOp op, size_t a, size_t b, double scalar, size_t rows, size_t cols, bool ok,
+		const Matrix* input) {
+		Key key((int)op, a, b, bits(scalar), input);
+		auto it = _index.find(key);
+		if (it != _index.end()) {
+			_reused++;
+			return LazyExpr(this, it->second);
+		}
+		Node node = { op, a, b, scalar, ok ? rows : 0, ok ? cols : 0, ok, input };
+		_nodes.push_back(node);
+		_index.emplace(key, _nodes.size() - 1);
+		return LazyExpr(this, _nodes.size() - 1);
+	}
+
+	bool LazyGraph::owns(const LazyExpr& e) const { return e.graph() == this && e.id() < _nodes.size(); }
+
+	LazyExpr LazyGraph::input(const Matrix& m) {
+		return record(LazyOp::INPUT, 0, 0, 0, m._size.first, m._size.second, true, &m);
+	}
+
+	LazyExpr LazyGraph::input(const Vector& v) {
+		_owned.emplace_back(v.size(), 1, 0.0);
+		Matrix& col = _owned.back();
+		for (size_t i = 0; i < v.size(); i++) col.a[i][0] = v.data[i];
+		return input(col);
+	}
+
+	LazyExpr LazyGraph::matmul(const LazyExpr& a, const LazyExpr& b) {
+		if (!owns(a) || !owns(b)) return LazyExpr();
+		const Node &x = _nodes[a.id()], &y = _nodes[b.id()];
+		return record(LazyOp::MATMUL, a.id(), b.id(), 0, x.rows, y.cols, x.valid && y.valid && x.cols == y.rows);
+	}
+
+	// -transpose(transpose(x)) = x
+	LazyExpr LazyGraph::transpose(const LazyExpr& a) {
+		if (!owns(a)) return LazyExpr();
+		const Node& x = _nodes[a.id()];
+		if (x.op == LazyOp::TRANSPOSE) return LazyExpr(this, x.a);
+		return record(LazyOp::TRANSPOSE, a.id(), 0, 0, x.cols, x.rows, x.valid);
+	}
+
+	// -Сложение и hadamard коммутативны: аргументы упорядочиваются
+	LazyExpr LazyGraph::add(const LazyExpr& a, const LazyExpr& b) {
+		if (!owns(a) || !owns(b)) return LazyExpr();
+		size_t i = std::min(a.id(), b.id()), j = std::max(a.id(), b.id());
+		const Node &x = _nodes[i], &y = _nodes[j];
+		return record(LazyOp::ADD, i, j, 0, x.rows, x.cols, x.valid && y.valid && x.rows == y.rows && x.cols == y.cols);
+	}
+
+	LazyExpr LazyGraph::sub(const LazyExpr& a, const LazyExpr& b) {
+		if (!owns(a) || !owns(b)) return LazyExpr();
+		const Node &x = _nodes[a.id()], &y = _nodes[b.id()];
+		return record(LazyOp::SUB, a.id(), b.id(), 0, x.rows, x.cols, x.valid && y.valid && x.rows == y.rows && x.cols == y.cols);
+	}
+
+	LazyExpr LazyGraph::hadamard(const LazyExpr& a, const LazyExpr& b) {
+		if (!owns(a) || !owns(b)) return LazyExpr();
+		size_t i = std::min(a.id(), b.id()), j = std::max(a.id(), b.id());
+		const Node &x = _nodes[i], &y = _nodes[j];
+		return record(LazyOp::HADAMARD, i, j, 0, x.rows, x.cols, x.valid && y.valid && x.rows == y.rows && x.cols == y.cols);
+	}
+
+	LazyExpr LazyGraph::scale(const LazyExpr& a, double k) {
+		if (!owns(a)) return LazyExpr();
+		const Node& x = _nodes[a.id()];
+		return record(LazyOp::SCALE, a.id(), 0, k, x.rows, x.cols, x.valid);
+	}
+
+	// -Поэлементные функции одного аргумента; -(-x) = x
+	LazyExpr LazyGraph::unary(LazyOp op, const LazyExpr& a) {
+		if (!owns(a) || !elementwise(op) || binary(op) || op == LazyOp::SCALE) return LazyExpr();
+		const Node& x = _nodes[a.id()];
+		if (op == LazyOp::NEG && x.op == LazyOp::NEG) return LazyExpr(this, x.a);
+		return record(op, a.id(), 0, 0, x.rows, x.cols, x.valid);
+	}
+
+	size_t LazyGraph::size() const { return _nodes.size(); }
+	size_t LazyGraph::reused() const { return _reused; }
+	bool LazyGraph::valid(size_t id) const { return id < _nodes.size() && _nodes[id].valid; }
+
+	std::pair<size_t, size_t> LazyGraph::shape(size_t id) const {
+		if (id >= _nodes.size()) return { 0, 0 };
+		return { _nodes[id].rows, _nodes[id].cols };
+	}
+
+	const LazyStats& LazyGraph::stats() const { return _stats; }
+
+	// -План вычисления: ядра (узлы, результат которых хранится целиком),
+	// их зависимости, слитые программы и порядок
+	struct LazyGraph::Plan {
+		struct Instr {
+			LazyOp op;
+			size_t a;
+			size_t b;
+			double scalar;
+		};
+
+		// Ядро: узел node; для поэлементных -- программа над регистрами,
+		// первые leaves.size() регистров -- входные матрицы
+		struct Kernel {
+			std::vector<size_t> deps;
+			std::vector<size_t> consumers;
+			std::vector<size_t> leaves;
+			std::vector<Instr> program;
+			size_t refs = 0;
+		};
+
+		const LazyGraph& g;
+		std::vector<char> reachable, output, is_kernel;
+		std::vector<size_t> uses, consumer;
+		std::vector<Kernel> kernels;
+		std::vector<size_t> order;
+		std::vector<std::unique_ptr<Matrix>> values;
+		std::mutex lock;
+		size_t live = 0, peak = 0;
+
+		explicit Plan(const LazyGraph& graph) : g(graph) {
+			size_t n = g._nodes.size();
+			reachable.assign(n, 0);
+			output.assign(n, 0);
+			is_kernel.assign(n, 0);
+			uses.assign(n, 0);
+			consumer.assign(n, 0);
+			kernels.resize(n);
+			values.resize(n);
+		}
+
+		const Node& node(size_t id) const { return g._nodes[id]; }
+
+		size_t bytes(size_t id) const {
+			return node(id).op == LazyOp::INPUT ? 0 : node(id).rows * node(id).cols * sizeof(double);
+		}
+
+		const Matrix& value(size_t id) const {
+			return node(id).op == LazyOp::INPUT ? *node(id).input : *values[id];
+		}
+
+		void mark(size_t id) {
+			if (reachable[id]) return;
+			reachable[id] = 1;
+			const Node& x = node(id);
+			if (x.op == LazyOp::INPUT) return;
+			mark(x.a);
+			uses[x.a]++;
+			consumer[x.a] = id;
+			if (binary(x.op)) {
+				mark(x.b);
+				uses[x.b]++;
+				consumer[x.b] = id;
+			}
+		}
+
+		// Поэлементный узел вливается в потребителя, если тот единственный
+		// и тоже поэлементный
+		void choose_kernels() {
+			for (size_t id = 0; id < reachable.size(); id++) {
+				if (!reachable[id]) continue;
+				const Node& x = node(id);
+				bool fused = elementwise(x.op) && !output[id] && uses[id] == 1 && elementwise(node(consumer[id]).op);
+				is_kernel[id] = !fused;
+			}
+		}
+
+		void collect_leaves(size_t id, size_t root, Kernel& k) {
+			if (id != root && is_kernel[id]) {
+				if (std::find(k.leaves.begin(), k.leaves.end(), id) == k.leaves.end()) k.leaves.push_back(id);
+				return;
+			}
+			const Node& x = node(id);
+			collect_leaves(x.a, root, k);
+			if (binary(x.op)) collect_leaves(x.b, root, k);
+		}
+
+		// Номер регистра с результатом id
+		size_t compile(size_t id, size_t root, Kernel& k) {
+			if (id != root && is_kernel[id])
+				return std::find(k.leaves.begin(), k.leaves.end(), id) - k.leaves.begin();
+			const Node& x = node(id);
+			size_t ra = compile(x.a, root, k);
+			size_t rb = binary(x.op) ? compile(x.b, root, k) : 0;
+			k.program.push_back({ x.op, ra, rb, x.scalar });
+			return k.leaves.size() + k.program.size() - 1;
+		}
+
+		void build() {
+			for (size_t id = 0; id < reachable.size(); id++) {
+				if (!reachable[id] || !is_kernel[id]) continue;
+				const Node& x = node(id);
+				Kernel& k = kernels[id];
+				if (x.op == LazyOp::INPUT) continue;
+				if (elementwise(x.op)) {
+					collect_leaves(id, id, k);
+					compile(id, id, k);
+					k.deps = k.leaves;
+				}
+				else {
+					k.deps.push_back(x.a);
+					if (binary(x.op) && x.b != x.a) k.deps.push_back(x.b);
+				}
+				for (size_t d : k.deps) {
+					kernels[d].consumers.push_back(id);
+					kernels[d].refs++;
+				}
+			}
+			for (size_t id = 0; id < reachable.size(); id++)
+				if (output[id]) kernels[id].refs++;
+		}
+
+		// Оценка памяти, нужной для вычисления поддерева: зависимости
+		// в порядке убывания их потребности, затем результат
+		size_t need(size_t id, std::vector<size_t>& memo) {
+			if (memo[id] != SIZE_MAX) return memo[id];
+			std::vector<size_t> deps = sorted_deps(id, memo);
+			size_t acc = 0, top = 0;
+			for (size_t d : deps) {
+				top = std::max(top, acc + need(d, memo));
+				acc += bytes(d);
+			}
+			return memo[id] = std::max(top, acc + bytes(id));
+		}
+
+		std::vector<size_t> sorted_deps(size_t id, std::vector<size_t>& memo) {
+			std::vector<size_t> deps = kernels[id].deps;
+			for (size_t d : deps) need(d, memo);
+			std::stable_sort(deps.begin(), deps.end(), [&](size_t x, size_t y) { return memo[x] > memo[y]; });
+			return deps;
+		}
+
+		void visit(size_t id, std::vector<char>& seen, std::vector<size_t>& memo) {
+			if (seen[id]) return;
+			seen[id] = 1;
+			for (size_t d : sorted_deps(id, memo)) visit(d, seen, memo);
+			if (node(id).op != LazyOp::INPUT) order.push_back(id);
+		}
+
+		void schedule(const std::vector<size_t>& outputs) {
+			std::vector<size_t> memo(reachable.size(), SIZE_MAX);
+			std::vector<size_t> roots = outputs;
+			for (size_t r : roots) need(r, memo);
+			std::stable_sort(roots.begin(), roots.end(), [&](size_t x, size_t y) { return memo[x] > memo[y]; });
+			std::vector<char> seen(reachable.size(), 0);
+			for (size_t r : roots) visit(r, seen, memo);
+		}
+
+		void run_kernel(size_t id) {
+			const Node& x = node(id);
+			std::unique_ptr<Matrix> out(new Matrix(x.rows, x.cols, 0.0));
+			if (x.op == LazyOp::MATMUL) {
+				gemm(1.0, view(value(x.a)), view(value(x.b)), 0.0, view(*out));
+			}
+			else if (x.op == LazyOp::TRANSPOSE) {
+				mat_vec::transpose(view(value(x.a)), view(*out));
+			}
+			else {
+				const Kernel& k = kernels[id];
+				size_t n = x.rows * x.cols, chunks = (n + CHUNK - 1) / CHUNK;
+				size_t regs = k.leaves.size() + k.program.size();
+				double* dst = n ? out->a[0] : nullptr;
+				parallel_for(0, chunks, CHUNK_GRAIN, [&](size_t from, size_t to) {
+					std::vector<double> buf(k.program.size() * CHUNK);
+					std::vector<const double*> reg(regs);
+					for (size_t c = from; c < to; c++) {
+						size_t start = c * CHUNK, len = std::min(CHUNK, n - start);
+						for (size_t l = 0; l < k.leaves.size(); l++) reg[l] = value(k.leaves[l]).a[0] + start;
+						for (size_t i = 0; i < k.program.size(); i++) {
+							const Instr& in = k.program[i];
+							double* z = i + 1 == k.program.size() ? dst + start : buf.data() + i * CHUNK;
+							run_op(in.op, reg[in.a], reg[in.b], in.scalar, z, len);
+							reg[k.leaves.size() + i] = z;
+						}
+					}
+				});
+			}
+			std::lock_guard<std::mutex> guard(lock);
+			values[id] = std::move(out);
+			live += bytes(id);
+			peak = std::max(peak, live);
+		}
+
+		// Зависимости больше не нужны -- их матрицы освобождаются
+		void release_deps(size_t id) {
+			std::lock_guard<std::mutex> guard(lock);
+			for (size_t d : kernels[id].deps) {
+				if (--kernels[d].refs == 0 && values[d]) {
+					live -= bytes(d);
+					values[d].reset();
+				}
+			}
+		}
+
+		void run_sequential() {
+			for (size_t id : order) {
+				run_kernel(id);
+				release_deps(id);
+			}
+		}
+
+		// Ядро запускается, как только готовы его зависимости; готовые
+		// одновременно запускаются в порядке order
+		void run_parallel() {
+			std::vector<size_t> rank(reachable.size(), 0), pending(reachable.size(), 0);
+			for (size_t i = 0; i < order.size(); i++) rank[order[i]] = i;
+			for (size_t id : order)
+				for (size_t d : kernels[id].deps)
+					if (node(d).op != LazyOp::INPUT) pending[id]++;
+			TaskGroup group;
+			std::function<void(size_t)> start = [&](size_t id) {
+				group.run([&, id] {
+					run_kernel(id);
+					release_deps(id);
+					std::vector<size_t> ready;
+					{
+						std::lock_guard<std::mutex> guard(lock);
+						for (size_t c : kernels[id].consumers)
+							if (--pending[c] == 0) ready.push_back(c);
+					}
+					std::sort(ready.begin(), ready.end(), [&](size_t x, size_t y) { return rank[x] < rank[y]; });
+					for (size_t c : ready) start(c);
+				});
+			};
+			// готовые сразу собираются заранее: запущенные ядра уже меняют pending
+			std::vector<size_t> initial;
+			for (size_t id : order)
+				if (pending[id] == 0) initial.push_back(id);
+			for (size_t id : initial) start(id);
+			group.wait();
+		}
+	};
+
+	// -Вычисление выходов по плану
+	bool LazyGraph::evaluate(const std::vector<LazyExpr>& outputs, std::vector<Matrix>& results, const LazyOptions& opt) {
+		MAT_VEC_SCOPE("LazyGraph::evaluate");
+		for (const LazyExpr& e : outputs)
+			if (!owns(e) || !_nodes[e.id()].valid) return false;
+
+		Plan plan(*this);
+		std::vector<size_t> ids;
+		for (const LazyExpr& e : outputs) {
+			plan.mark(e.id());
+			plan.output[e.id()] = 1;
+			ids.push_back(e.id());
+		}
+		plan.choose_kernels();
+		plan.build();
+		plan.schedule(ids);
+		if (opt.parallel) plan.run_parallel();
+		else plan.run_sequential();
+
+		_stats = LazyStats();
+		for (size_t id = 0; id < _nodes.size(); id++) {
+			if (!plan.reachable[id]) continue;
+			_stats.nodes++;
+			_stats.eager_bytes += plan.bytes(id);
+			if (elementwise(_nodes[id].op) && !plan.is_kernel[id]) _stats.fused++;
+		}
+		_stats.kernels = plan.order.size();
+		_stats.peak_bytes = plan.peak;
+
+		results.clear();
+		results.reserve(outputs.size());
+		for (size_t id : ids) results.push_back(plan.value(id));
+		return true;
+	}
+
+	Matrix LazyGraph::evaluate(const LazyExpr& output, const LazyOptions& opt) {
+		std::vector<Matrix> results;
+		if (!evaluate(std::vector<LazyExpr>{ output }, results, opt)) return Matrix(0, 0, 0.0);
+		return results[0];
+	}
+
+	LazyExpr operator+(const LazyExpr& a, const LazyExpr& b) { return a.graph() ? a.graph()->add(a, b) : LazyExpr(); }
+	LazyExpr operator-(const LazyExpr& a, const LazyExpr& b) { return a.graph() ? a.graph()->sub(a, b) : LazyExpr(); }
+	LazyExpr operator-(const LazyExpr& a) { return a.graph() ? a.graph()->unary(LazyOp::NEG, a) : LazyExpr(); }
+	LazyExpr operator*(const LazyExpr& a, const LazyExpr& b) { return a.graph() ? a.graph()->matmul(a, b) : LazyExpr(); }
+	LazyExpr operator*(const LazyExpr& a, double k) { return a.graph() ? a.graph()->scale(a, k) : LazyExpr(); }
+	LazyExpr operator*(double k, const LazyExpr& a) { return a * k; }
+	LazyExpr hadamard(const LazyExpr& a, const LazyExpr& b) { return a.graph() ? a.graph()->hadamard(a, b) : LazyExpr(); }
+	LazyExpr transpose(const LazyExpr& a) { return a.graph() ? a.graph()->transpose(a) : LazyExpr(); }
+	LazyExpr exp(const LazyExpr& a) { return a.graph() ? a.graph()->unary(LazyOp::EXP, a) : LazyExpr(); }
+	LazyExpr log(const LazyExpr& a) { return a.graph() ? a.graph()->unary(LazyOp::LOG, a) : LazyExpr(); }
+	LazyExpr tanh(const LazyExpr& a) { return a.graph() ? a.graph()->unary(LazyOp::TANH, a) : LazyExpr(); }
+	LazyExpr sigmoid(const LazyExpr& a) { return a.graph() ? a.graph()->unary(LazyOp::SIGMOID, a) : LazyExpr(); }
+
+} // namespace mat_vec
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Base.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace mat_vec {
+
+	// Отложенные вычисления: операции записываются в граф и выполняются
+	// только в evaluate().
+	//
+	// При записи одинаковые подвыражения склеиваются (одна и та же операция
+	// над теми же узлами даёт тот же узел; для + и hadamard порядок
+	// аргументов не важен), transpose(transpose(x)) и -(-x) сокращаются.
+	// При вычислении цепочки поэлементных операций сливаются в одно ядро,
+	// которое проходит данные кусками и не создаёт промежуточных матриц;
+	// порядок выбирается так, чтобы одновременно жило меньше временных
+	// матриц (сначала поддерево, которому нужно больше памяти), а
+	// независимые ветви выполняются параллельно на пуле потоков.
+	//
+	// Входы хранятся по ссылке: матрица, переданная в input(), должна
+	// жить и не меняться до конца evaluate()
+
+	enum class LazyOp {
+		INPUT,
+		MATMUL,
+		TRANSPOSE,
+		ADD,
+		SUB,
+		HADAMARD,   // поэлементное произведение
+		SCALE,      // умножение на число
+		NEG,
+		EXP,
+		LOG,
+		TANH,
+		SIGMOID
+	};
+
+	class LazyGraph;
+
+	// Узел графа. Копии ссылаются на тот же узел
+	class LazyExpr {
+	public:
+		LazyExpr() = default;
+
+		LazyGraph* graph() const { return _graph; }
+		size_t id() const { return _id; }
+
+		// false, если размеры операндов не согласованы
+		bool valid() const;
+		std::pair<size_t, size_t> shape() const;
+
+	private:
+		friend class LazyGraph;
+		LazyExpr(LazyGraph* graph, size_t id) : _graph(graph), _id(id) {}
+
+		LazyGraph* _graph = nullptr;
+		size_t _id = 0;
+	};
+
+	struct LazyOptions {
+		bool parallel = true;   // независимые ветви -- в разных потоках
+	};
+
+	// Что получилось при последнем evaluate()
+	struct LazyStats {
+		size_t nodes = 0;        // узлов, нужных для выходов
+		size_t kernels = 0;      // выполненных ядер (gemm, transpose, слитые поэлементные)
+		size_t fused = 0;        // поэлементных узлов, влитых в чужое ядро
+		size_t peak_bytes = 0;   // наибольший объём одновременно живых временных матриц
+		size_t eager_bytes = 0;  // сколько выделило бы пошаговое вычисление
+	};
+
+	class LazyGraph {
+	public:
+		LazyGraph() = default;
+		LazyGraph(const LazyGraph&) = delete;
+		LazyGraph& operator=(const LazyGraph&) = delete;
+
+		// Вход-матрица (по ссылке) и вход-вектор (копируется в столбец n x 1)
+		LazyExpr input(const Matrix& m);
+		LazyExpr input(const Vector& v);
+
+		LazyExpr matmul(const LazyExpr& a, const LazyExpr& b);
+		LazyExpr transpose(const LazyExpr& a);
+		LazyExpr add(const LazyExpr& a, const LazyExpr& b);
+		LazyExpr sub(const LazyExpr& a, const LazyExpr& b);
+		LazyExpr hadamard(const LazyExpr& a, const LazyExpr& b);
+		LazyExpr scale(const LazyExpr& a, double k);
+		LazyExpr unary(LazyOp op, const LazyExpr& a);
+
+		// Число узлов и сколько раз запись вернула уже существующий узел
+		size_t size() const;
+		size_t reused() const;
+
+		bool valid(size_t id) const;
+		std::pair<size_t, size_t> shape(size_t id) const;
+
+		// Вычисляет выходы; false, если какой-то из них невалиден
+		// или принадлежит другому графу
+		bool evaluate(const std::vector<LazyExpr>& outputs, std::vector<Matrix>& results,
+			const LazyOptions& opt = LazyOptions());
+
+		// Один выход; при ошибке -- матрица 0 x 0
+		Matrix evaluate(const LazyExpr& output, const LazyOptions& opt = LazyOptions());
+
+		const LazyStats& stats() const;
+
+	private:
+		struct Node {
+			LazyOp op;
+			size_t a;
+			size_t b;
+			double scalar;
+			size_t rows;
+			size_t cols;
+			bool valid;
+			const Matrix* input;
+		};
+
+		// операция, аргументы, биты числа, вход
+		typedef std::tuple<int, size_t, size_t, uint64_t, const Matrix*> Key;
+
+		struct Plan;
+
+		LazyExpr record(LazyOp op, size_t a, size_t b, double scalar, size_t rows, size_t cols, bool ok,
+			const Matrix* input = nullptr);
+		bool owns(const LazyExpr& e) const;
+
+		std::vector<Node> _nodes;
+		std::map<Key, size_t> _index;
+		std::deque<Matrix> _owned;
+		size_t _reused = 0;
+		LazyStats _stats;
+	};
+
+	// Запись выражений операторами
+	LazyExpr operator+(const LazyExpr& a, const LazyExpr& b);
+	LazyExpr operator-(const LazyExpr& a, const LazyExpr& b);
+	LazyExpr operator-(const LazyExpr& a);
+	LazyExpr operator*(const LazyExpr& a, const LazyExpr& b);   // матричное произведение
+	LazyExpr operator*(const LazyExpr& a, double k);
+	LazyExpr operator*(double k, const LazyExpr& a);
+	LazyExpr hadamard(const LazyExpr& a, const LazyExpr& b);
+	LazyExpr transpose(const LazyExpr& a);
+	LazyExpr exp(const LazyExpr& a);
+	LazyExpr log(const LazyExpr& a);
+	LazyExpr tanh(const LazyExpr& a);
+	LazyExpr sigmoid(const LazyExpr& a);
+
+} // namespace mat_vec
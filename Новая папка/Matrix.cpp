@@ -1,10 +1,42 @@
 ﻿#include <iostream>
 #include "Matrix.h"
 #include "Vector.h"
+#include "Profiler.h"
+#include "Gemm.h"
+#include "Transpose.h"
+#include "Decomposition.h"
+#include "Reduce.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
 #include <utility>
+#include <vector>
 
 namespace mat_vec {
 
+	// Запомненные производные величины матрицы. lock защищает только
+	// поля: вычисления (они могут уйти в пул, а поток, ожидая пул, --
+	// взять задачу, обращающуюся к этой же матрице) идут без него,
+	// результат записывается под lock, если его ещё никто не записал
+	struct MatrixCache {
+		std::mutex lock;
+		std::shared_ptr<const LU> lu;
+		std::unique_ptr<Matrix> inv;
+		std::unique_ptr<Matrix> transposed;
+		bool has_norm = false;
+		double norm = 0;
+		MatrixCacheStats stats;
+
+		void clear() {
+			std::lock_guard<std::mutex> guard(lock);
+			lu.reset();
+			inv.reset();
+			transposed.reset();
+			has_norm = false;
+		}
+	};
+
 	// -Конструирует матрицу с размерами size x size, заполненную value
 	Matrix::Matrix(size_t size, double value ):Matrix(size, size, value) {	}
 
@@ -18,46 +50,68 @@ namespace mat_vec {
 
 	// -Возвращает матрицу с размерами rows x cols, заполненную value
 	Matrix::Matrix(size_t rows, size_t cols, double value) {
-		_size = { rows, cols};
-		a = new double* [_size.first];
-		for (int i = 0; i < _size.first; i++) {
-			a[i] = new double[_size.second];
+		allocate(rows, cols);
+		for (int i = 0; i < _size.first; i++)
 			for (int j = 0; j < _size.second; j++) a[i][j] = value;
-		}
-
 	}
 
 
 	// -Конструктор копирования
 	Matrix::Matrix(const Matrix& src){
-		_size=src._size;
-		//for (int i = 0; i < _size.first; i++) delete[] a[i];
-		//delete[] a;
-		a = new double*[_size.first];
-		for (int i = 0; i < src._size.first; i++) a[i] = new double[_size.second];
+		allocate(src._size.first, src._size.second);
+		if (src._cache) enable_cache();
+		MAT_VEC_COUNT_COPY((uint64_t)_size.first * _size.second * sizeof(double));
 		for (int i = 0; i < src._size.first; i++) for (int j = 0; j < src._size.second; j++) 
 			a[i][j] = src.a[i][j];
 	}
 
 	// -Оператор присваивания
 	Matrix& Matrix::operator=(const Matrix& rhs) {
-		_size = rhs._size;
-		for (int i = 0; i < _size.first; i++) delete[] a[i];
-		delete[] a;
-		a = new double* [_size.first]; 
-			
-		for (int i = 0; i < rhs._size.first; i++) {
-			a[i] = new double[_size.second];
+		if (this == &rhs) return *this;
+		invalidate();
+		if (_size != rhs._size) {
+			release();
+			allocate(rhs._size.first, rhs._size.second);
+		}
+		MAT_VEC_COUNT_COPY((uint64_t)_size.first * _size.second * sizeof(double));
+		for (int i = 0; i < rhs._size.first; i++)
 			for (int j = 0; j < rhs._size.second; j++)
 				a[i][j] = rhs.a[i][j];
-		}
 		return *this;
 	}
 
 	// -Деструктор
 	Matrix::~Matrix() {
-		for (int i = 0; i < _size.first; i++) delete[] a[i];
+		release();
+	}
+
+	// Выделяет непрерывный блок rows x cols и массив указателей на его строки
+	void Matrix::allocate(size_t rows, size_t cols) {
+		_size = { rows, cols };
+		a = new double* [rows];
+		MAT_VEC_COUNT_ALLOC(rows * sizeof(double*));
+		double* block = rows * cols > 0 ? new double[rows * cols] : nullptr;
+		MAT_VEC_COUNT_ALLOC(rows * cols * sizeof(double));
+		for (size_t i = 0; i < rows; i++) a[i] = block + i * cols;
+	}
+
+	// Освобождает память матрицы
+	void Matrix::release() {
+		if (_size.first > 0) delete[] a[0];
 		delete[] a;
+		a = nullptr;
+	}
+
+	// Перестраивает массив указателей на строки блока для размеров rows x cols
+	void Matrix::relink(size_t rows, size_t cols) {
+		double* block = _size.first > 0 ? a[0] : nullptr;
+		if (rows != (size_t)_size.first) {
+			delete[] a;
+			a = new double* [rows];
+			MAT_VEC_COUNT_ALLOC(rows * sizeof(double*));
+		}
+		_size = { rows, cols };
+		for (size_t i = 0; i < rows; i++) a[i] = block + i * cols;
 	}
 
 	// - Изменяет ширину и высоту матрицы, не изменяя при этом
@@ -67,14 +121,13 @@ namespace mat_vec {
 	// [4 5 6] -> [3 4]
 	//            [5 6]
 	void Matrix::reshape(size_t rows, size_t cols){
+		MAT_VEC_SCOPE("Matrix::reshape");
+		invalidate();
 		Matrix c = *this;
-		for (int i = 0; i < _size.first; i++) delete[] a[i];
-		delete[] a;
+		release();
 		int k = 0;
-		_size = { cols, rows};
-		a = new double* [_size.first];
+		allocate(cols, rows);
 		for (int i = 0; i < _size.first; i++) {
-			a[i] = new double[_size.second];
 			for (int j = 0; j < _size.second; j++) a[i][j] = c.a[k % c._size.first][k%c._size.second];
 			k++;
 		}
@@ -88,13 +141,23 @@ namespace mat_vec {
 	// -Возвращает элемент на позиции [row, col]
 	double Matrix::get(size_t row, size_t col) const { return a[row][col];}
 
+	// -Доступ к строке row
+	double* Matrix::operator[](size_t row) {
+		invalidate();
+		return a[row];
+	}
+	const double* Matrix::operator[](size_t row) const { return a[row]; }
+
 	// -Поэлементное сложение
 	Matrix Matrix::operator+(const Matrix& rhs) const {
+		MAT_VEC_SCOPE("Matrix::operator+");
 		Matrix c =*this;
 		c += rhs;
 		return c;
 	}
 	Matrix& Matrix::operator+=(const Matrix& rhs){
+		invalidate();
+		MAT_VEC_COUNT_FLOPS((uint64_t)_size.first * _size.second);
 		for (int i = 0; i < _size.first; i++) for (int j = 0; j < _size.second; j++)
 			a[i][j] += rhs.a[i][j];
 		return *this;
@@ -102,12 +165,15 @@ namespace mat_vec {
 	
 	// -Поэлементное вычитание
 	Matrix Matrix::operator-(const Matrix& rhs) const{
+		MAT_VEC_SCOPE("Matrix::operator-");
 
 		Matrix c = *this;
 		c -= rhs;
 		return c;
 	}
 	Matrix& Matrix::operator-=(const Matrix& rhs){
+		invalidate();
+		MAT_VEC_COUNT_FLOPS((uint64_t)_size.first * _size.second);
 		for (int i = 0; i < _size.first; i++) for (int j = 0; j < _size.second; j++) 
 			a[i][j] -= rhs.a[i][j];
 		return *this;
@@ -115,107 +181,129 @@ namespace mat_vec {
 
 	// -Матричное умножение
 	Matrix Matrix::operator*(const Matrix& rhs) const{
+		MAT_VEC_SCOPE("Matrix::operator*(Matrix)");
 		Matrix c = *this;
 		c *= rhs;
 		return c;
 	}
 	Matrix& Matrix::operator*=(const Matrix& rhs){
-		for (int i = 0; i < _size.first; i++) for (int j = 0; j < _size.second; j++) 
-			a[i][j] *= rhs.a[i][j];
+		invalidate();
+		Matrix c(_size.first, rhs._size.second, 0.0);
+		gemm(1.0, view(*this), view(rhs), 0.0, view(c));
+		*this = c;
 		return *this;
 	}
 
 	// -Умножение всех элементов матрицы на константу
 	Matrix Matrix::operator*(double k) const{
+		MAT_VEC_SCOPE("Matrix::operator*(double)");
 		Matrix c = *this;
 		c *= k;
 		return c;
 	}
 	Matrix& Matrix::operator*=(double k){
+		invalidate();
+		MAT_VEC_COUNT_FLOPS((uint64_t)_size.first * _size.second);
 		for (int i = 0; i < _size.first; i++) for (int j = 0; j < _size.second; j++) a[i][j] *= k;
 		return *this;
 	}
 
 	// -Деление всех элементов матрицы на константу
 	Matrix Matrix::operator/(double k) const{
+		MAT_VEC_SCOPE("Matrix::operator/");
 		Matrix c = *this;
 		c /= k;
 		return c;
 	}
 	Matrix& Matrix::operator/=(double k){
+		invalidate();
+		MAT_VEC_COUNT_FLOPS((uint64_t)_size.first * _size.second);
 		for (int i = 0; i < _size.first; i++) for (int j = 0; j < _size.second; j++) a[i][j] /= k;
 		return *this;
 	}
 
 	// -Возвращает новую матрицу, полученную транспонированием текущей (this)
 	Matrix Matrix::transposed() const{
-		Matrix c = *this;
-		c.transpose();
+		MAT_VEC_SCOPE("Matrix::transposed");
+		if (_cache) {
+			{
+				std::lock_guard<std::mutex> guard(_cache->lock);
+				if (_cache->transposed) {
+					_cache->stats.hits++;
+					return *_cache->transposed;
+				}
+				_cache->stats.misses++;
+			}
+			std::unique_ptr<Matrix> t(new Matrix(_size.second, _size.first, 0.0));
+			mat_vec::transpose(view(*this), view(*t));
+			std::lock_guard<std::mutex> guard(_cache->lock);
+			if (!_cache->transposed) _cache->transposed = std::move(t);
+			return *_cache->transposed;
+		}
+		Matrix c(_size.second, _size.first, 0.0);
+		mat_vec::transpose(view(*this), view(c));
 		return c;
 	}
 
 	//  -Транспонирует текущую матрицу
 	void Matrix::transpose(){
-		Matrix c = *this;
-		for (int i = 0; i < _size.first; i++) delete[] a[i];
-		delete[] a;
-		int k=0;
-		_size = { c._size.second, c._size.first };
-		a = new double* [_size.first];
-		for (int i = 0; i < _size.first; i++) {
-			a[i] = new double[_size.second];
-			for (int j = 0; j < _size.second; j++) a[i][j] = c.a[k % c._size.second][k % c._size.first];
-			k++;
+		MAT_VEC_SCOPE("Matrix::transpose");
+		invalidate();
+		if (_size.first == _size.second) {
+			transpose_square_inplace(view(*this));
+			return;
 		}
+		if (_size.first > 0) transpose_inplace(a[0], _size.first, _size.second);
+		relink(_size.second, _size.first);
 	}
 
-	//Определитель
+	// -Определитель (через LU-разложение, матрица не изменяется)
 	double Matrix::det() const{
-		const double EPS = 1E-9;
-		double d = 1;
-		double c;
-		for (int i=0; i<_size.first; ++i) {
-			int k = i;
-			for (int j=i+1; j< _size.first; ++j)
-				if (abs (a[j][i]) > abs (a[k][i]))
-					k = j;
-			if (abs (a[k][i]) < EPS) {
-				d = 0;
-				break;
-			}
-			for (int jjj = 0; i < _size.first; ++jjj) {
-				c = a[i][jjj];
-				a[i][jjj]= a[k][jjj];
-				a[k][jjj] = c;
-			}
-			if (i != k)
-				d = -d;
-			d *= a[i][i];
-			for (int j=i+1; j< _size.first; ++j)
-				a[i][j] /= a[i][i];
-			for (int j=0; j< _size.first; ++j)
-				if (j != i && abs (a[j][i]) > EPS)
-					for (int k=i+1; k<_size.first; ++k)
-						a[j][k] -= a[i][k] * a[j][i];
+		MAT_VEC_SCOPE("Matrix::det");
+		if (!_cache) return LU(*this).det();
+		std::shared_ptr<const LU> lu;
+		{
+			std::lock_guard<std::mutex> guard(_cache->lock);
+			if (_cache->lu) _cache->stats.hits++;
+			else _cache->stats.misses++;
+			lu = _cache->lu;
 		}
-		return d;
-	
+		if (!lu) {
+			lu = std::make_shared<const LU>(*this);
+			std::lock_guard<std::mutex> guard(_cache->lock);
+			if (!_cache->lu) _cache->lu = lu;
+		}
+		return lu->det();
 	}
 
-	// Обратная матрица
+	// -Обратная матрица
 	Matrix Matrix::inv() const{
-		Matrix c = *this;
-		Matrix dd = *this;
-		double d = dd.det();
-		c.transpose();
-		c *= (1 / d);
-		return c;
+		MAT_VEC_SCOPE("Matrix::inv");
+		if (!_cache) return LU(*this).inv();
+		std::shared_ptr<const LU> lu;
+		{
+			std::lock_guard<std::mutex> guard(_cache->lock);
+			if (_cache->inv) {
+				_cache->stats.hits++;
+				return *_cache->inv;
+			}
+			_cache->stats.misses++;
+			lu = _cache->lu;
+		}
+		if (!lu) lu = std::make_shared<const LU>(*this);
+		std::unique_ptr<Matrix> r(new Matrix(lu->inv()));
+		std::lock_guard<std::mutex> guard(_cache->lock);
+		if (!_cache->lu) _cache->lu = lu;
+		if (!_cache->inv) _cache->inv = std::move(r);
+		return *_cache->inv;
 	}
 
 	// -УМножение матрицы на вектор
 	Vector Matrix::operator*(const Vector& vec) const{
-		Vector c = Vector(vec._size, 0);
-		for (int i = 0; i < _size.first; i++) for (int j = 0; j < _size.second; j++) c.data[j]+=a[i][j]*vec.data[j];
+		MAT_VEC_SCOPE("Matrix::operator*(Vector)");
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)_size.first * _size.second);
+		Vector c = Vector(_size.first, 0);
+		gemv(view(*this), vec.data, c.data);
 		return c;
 	}
 
@@ -230,4 +318,68 @@ namespace mat_vec {
 	bool Matrix::operator!=(const Matrix& rhs) const{
 		return !(*this == rhs);
 	}
-}
\ No newline at end of file
+
+	// -Норма Фробениуса
+	double Matrix::norm() const{
+		MAT_VEC_SCOPE("Matrix::norm");
+		if (_cache) {
+			std::lock_guard<std::mutex> guard(_cache->lock);
+			if (_cache->has_norm) {
+				_cache->stats.hits++;
+				return _cache->norm;
+			}
+			_cache->stats.misses++;
+		}
+		double s = _size.first > 0 ? norm2(a[0], (size_t)_size.first * _size.second) : 0;
+		if (_cache) {
+			std::lock_guard<std::mutex> guard(_cache->lock);
+			_cache->norm = s;
+			_cache->has_norm = true;
+		}
+		return s;
+	}
+
+	// -Максимальная сумма модулей по столбцам
+	double Matrix::norm1() const{
+		MAT_VEC_SCOPE("Matrix::norm1");
+		MAT_VEC_COUNT_FLOPS((uint64_t)_size.first * _size.second);
+		std::vector<double> col(_size.second, 0.0);
+		for (int i = 0; i < _size.first; i++)
+			for (int j = 0; j < _size.second; j++) col[j] += std::fabs(a[i][j]);
+		double m = 0;
+		for (double c : col) m = c > m || std::isnan(c) ? c : m;
+		return m;
+	}
+
+	// -Максимальная сумма модулей по строкам
+	double Matrix::norm_inf() const{
+		MAT_VEC_SCOPE("Matrix::norm_inf");
+		MAT_VEC_COUNT_FLOPS((uint64_t)_size.first * _size.second);
+		double m = 0;
+		for (int i = 0; i < _size.first; i++) {
+			double r = 0;
+			for (int j = 0; j < _size.second; j++) r += std::fabs(a[i][j]);
+			m = r > m || std::isnan(r) ? r : m;
+		}
+		return m;
+	}
+
+	// -Включает или выключает кэш производных величин
+	void Matrix::enable_cache(bool on){
+		if (on && !_cache) _cache.reset(new MatrixCache());
+		if (!on) _cache.reset();
+	}
+	bool Matrix::cache_enabled() const { return _cache != nullptr; }
+
+	// -Сбрасывает запомненные значения
+	void Matrix::invalidate(){
+		if (_cache) _cache->clear();
+	}
+
+	// -Счётчики попаданий и промахов кэша
+	MatrixCacheStats Matrix::cache_stats() const{
+		if (!_cache) return MatrixCacheStats();
+		std::lock_guard<std::mutex> guard(_cache->lock);
+		return _cache->stats;
+	}
+}
@@ -1,11 +1,20 @@
 #pragma once
 
 #include "Base.h"
+#include <memory>
 #include <tuple>
 #include <utility>
 
 namespace mat_vec {
 
+	struct MatrixCache;
+
+	//       
+	struct MatrixCacheStats {
+		size_t hits = 0;
+		size_t misses = 0;
+	};
+
 	class Matrix {
 	public:
 		std::pair<int, int> _size;
@@ -44,6 +53,13 @@ namespace mat_vec {
 		//     [row, col]
 		double get(size_t row, size_t col) const;
 
+		//    row.     
+		//  ,      (  --
+		// get   ).    
+		//     --     invalidate()
+		double* operator[](size_t row);
+		const double* operator[](size_t row) const;
+
 		//  
 		Matrix operator+(const Matrix& rhs) const;
 		Matrix& operator+=(const Matrix& rhs);
@@ -76,6 +92,10 @@ namespace mat_vec {
 		//  
 		Matrix inv() const;
 
+		//    k    
+		// (. MatrixFunctions);   --  
+		Matrix pow(size_t k) const;
+
 		//    
 		Vector operator*(const Vector& vec) const;
 
@@ -83,7 +103,38 @@ namespace mat_vec {
 		bool operator==(const Matrix& rhs) const;
 		bool operator!=(const Matrix& rhs) const;
 
+		//  
+		double norm() const;
+
+		// ,  L1  L-:   
+		//     
+		double norm1() const;
+		double norm_inf() const;
+
+		//  ( )  det(), inv(), transposed(), norm()
+		//  LU-.       operator[],
+		//  , , reshape  transpose.  
+		//   a    --     invalidate()
+		void enable_cache(bool on = true);
+		bool cache_enabled() const;
+
+		//   
+		void invalidate();
+
+		//     
+		MatrixCacheStats cache_stats() const;
+
 	private:
+		std::unique_ptr<MatrixCache> _cache;
+
+		//    rows x cols      
+		void allocate(size_t rows, size_t cols);
+
+		//   
+		void release();
+
+		//          rows x cols
+		void relink(size_t rows, size_t cols);
 	};
 
 } // namespace mat_vec
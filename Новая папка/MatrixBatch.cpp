@@ -0,0 +1,237 @@
+#include "MatrixBatch.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <cmath>
+#include <utility>
+
+namespace mat_vec {
+
+	namespace {
+
+		const size_t L = MatrixBatch::LANES;
+
+		// Групп на одну задачу пула
+		const size_t GRAIN = 64;
+
+		size_t blocks_for(size_t count) { return (count + L - 1) / L; }
+	}
+
+	// -Набор векторов
+	VectorBatch::VectorBatch(size_t count, size_t size, double value)
+		: _count(count), _size(size), _data(blocks_for(count) * size * L, value) {
+		MAT_VEC_COUNT_ALLOC(_data.size() * sizeof(double));
+	}
+
+	size_t VectorBatch::count() const { return _count; }
+	size_t VectorBatch::size() const { return _size; }
+	size_t VectorBatch::blocks() const { return blocks_for(_count); }
+
+	double VectorBatch::get(size_t k, size_t i) const { return _data[(k / L * _size + i) * L + k % L]; }
+	double& VectorBatch::at(size_t k, size_t i) { return _data[(k / L * _size + i) * L + k % L]; }
+
+	void VectorBatch::set(size_t k, const Vector& v) {
+		for (size_t i = 0; i < _size; i++) at(k, i) = v[i];
+	}
+
+	Vector VectorBatch::vector(size_t k) const {
+		Vector v(_size, 0);
+		for (size_t i = 0; i < _size; i++) v[i] = get(k, i);
+		return v;
+	}
+
+	double* VectorBatch::block(size_t b) { return _data.data() + b * _size * L; }
+	const double* VectorBatch::block(size_t b) const { return _data.data() + b * _size * L; }
+
+	// -Набор матриц
+	MatrixBatch::MatrixBatch(size_t count, size_t rows, size_t cols, double value)
+		: _count(count), _rows(rows), _cols(cols), _data(blocks_for(count) * rows * cols * L, value) {
+		MAT_VEC_COUNT_ALLOC(_data.size() * sizeof(double));
+	}
+
+	size_t MatrixBatch::count() const { return _count; }
+	size_t MatrixBatch::rows() const { return _rows; }
+	size_t MatrixBatch::cols() const { return _cols; }
+	size_t MatrixBatch::blocks() const { return blocks_for(_count); }
+
+	double MatrixBatch::get(size_t k, size_t row, size_t col) const {
+		return _data[((k / L * _rows + row) * _cols + col) * L + k % L];
+	}
+	double& MatrixBatch::at(size_t k, size_t row, size_t col) {
+		return _data[((k / L * _rows + row) * _cols + col) * L + k % L];
+	}
+
+	void MatrixBatch::set(size_t k, const Matrix& m) {
+		for (size_t i = 0; i < _rows; i++)
+			for (size_t j = 0; j < _cols; j++) at(k, i, j) = m.a[i][j];
+	}
+
+	Matrix MatrixBatch::matrix(size_t k) const {
+		Matrix m(_rows, _cols, 0.0);
+		for (size_t i = 0; i < _rows; i++)
+			for (size_t j = 0; j < _cols; j++) m.a[i][j] = get(k, i, j);
+		return m;
+	}
+
+	double* MatrixBatch::block(size_t b) { return _data.data() + b * _rows * _cols * L; }
+	const double* MatrixBatch::block(size_t b) const { return _data.data() + b * _rows * _cols * L; }
+
+	// -C_k = A_k * B_k
+	MatrixBatch batch_gemm(const MatrixBatch& a, const MatrixBatch& b) {
+		MAT_VEC_SCOPE("batch_gemm");
+		size_t m = a.rows(), k = a.cols(), n = b.cols();
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)a.count() * m * n * k);
+		MatrixBatch c(a.count(), m, n);
+		parallel_for(0, a.blocks(), GRAIN, [&](size_t from, size_t to) {
+			for (size_t blk = from; blk < to; blk++) {
+				const double* A = a.block(blk);
+				const double* B = b.block(blk);
+				double* C = c.block(blk);
+				for (size_t i = 0; i < m; i++)
+					for (size_t p = 0; p < k; p++) {
+						const double* aip = A + (i * k + p) * L;
+						const double* bp = B + p * n * L;
+						double* ci = C + i * n * L;
+						for (size_t j = 0; j < n; j++)
+							for (size_t l = 0; l < L; l++) ci[j * L + l] += aip[l] * bp[j * L + l];
+					}
+			}
+		});
+		return c;
+	}
+
+	// -y_k = A_k * x_k
+	VectorBatch batch_gemv(const MatrixBatch& a, const VectorBatch& x) {
+		MAT_VEC_SCOPE("batch_gemv");
+		size_t m = a.rows(), n = a.cols();
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)a.count() * m * n);
+		VectorBatch y(a.count(), m);
+		parallel_for(0, a.blocks(), GRAIN, [&](size_t from, size_t to) {
+			for (size_t blk = from; blk < to; blk++) {
+				const double* A = a.block(blk);
+				const double* X = x.block(blk);
+				double* Y = y.block(blk);
+				for (size_t i = 0; i < m; i++) {
+					double acc[L] = {};
+					for (size_t j = 0; j < n; j++)
+						for (size_t l = 0; l < L; l++) acc[l] += A[(i * n + j) * L + l] * X[j * L + l];
+					for (size_t l = 0; l < L; l++) Y[i * L + l] = acc[l];
+				}
+			}
+		});
+		return y;
+	}
+
+	// -LU-разложение всех матриц набора
+	BatchLU::BatchLU(const MatrixBatch& a)
+		: _lu(a), _pivot(a.blocks() * L * a.rows()), _sign(a.blocks() * L, 1) {
+		MAT_VEC_SCOPE("BatchLU");
+		size_t n = a.rows();
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)a.count() * n * n * n / 3);
+		parallel_for(0, _lu.blocks(), GRAIN, [&](size_t from, size_t to) {
+			for (size_t blk = from; blk < to; blk++) {
+				double* A = _lu.block(blk);
+				for (size_t k = 0; k < n; k++) {
+					// выбор ведущего элемента и перестановка строк -- отдельно в каждой матрице
+					for (size_t l = 0; l < L; l++) {
+						size_t p = k;
+						for (size_t i = k + 1; i < n; i++)
+							if (std::fabs(A[(i * n + k) * L + l]) > std::fabs(A[(p * n + k) * L + l])) p = i;
+						_pivot[(blk * L + l) * n + k] = (uint32_t)p;
+						if (p != k) {
+							_sign[blk * L + l] = -_sign[blk * L + l];
+							for (size_t j = 0; j < n; j++) std::swap(A[(k * n + j) * L + l], A[(p * n + j) * L + l]);
+						}
+					}
+					double inv[L];
+					for (size_t l = 0; l < L; l++) inv[l] = 1 / A[(k * n + k) * L + l];
+					for (size_t i = k + 1; i < n; i++) {
+						double f[L];
+						for (size_t l = 0; l < L; l++) {
+							f[l] = A[(i * n + k) * L + l] * inv[l];
+							A[(i * n + k) * L + l] = f[l];
+						}
+						for (size_t j = k + 1; j < n; j++)
+							for (size_t l = 0; l < L; l++) A[(i * n + j) * L + l] -= f[l] * A[(k * n + j) * L + l];
+					}
+				}
+			}
+		});
+	}
+
+	// -Решение A_k x_k = b_k
+	VectorBatch BatchLU::solve(const VectorBatch& b) const {
+		MAT_VEC_SCOPE("BatchLU::solve");
+		size_t n = _lu.rows();
+		VectorBatch x = b;
+		parallel_for(0, _lu.blocks(), GRAIN, [&](size_t from, size_t to) {
+			for (size_t blk = from; blk < to; blk++) {
+				const double* A = _lu.block(blk);
+				double* X = x.block(blk);
+				// перестановки переставляли строки целиком, вместе с уже
+				// найденными множителями L, поэтому применяются все сразу
+				for (size_t k = 0; k < n; k++)
+					for (size_t l = 0; l < L; l++) {
+						size_t p = _pivot[(blk * L + l) * n + k];
+						if (p != k) std::swap(X[k * L + l], X[p * L + l]);
+					}
+				for (size_t k = 0; k < n; k++) {
+					for (size_t i = k + 1; i < n; i++)
+						for (size_t l = 0; l < L; l++) X[i * L + l] -= A[(i * n + k) * L + l] * X[k * L + l];
+				}
+				for (size_t i = n; i-- > 0;) {
+					for (size_t j = i + 1; j < n; j++)
+						for (size_t l = 0; l < L; l++) X[i * L + l] -= A[(i * n + j) * L + l] * X[j * L + l];
+					for (size_t l = 0; l < L; l++) X[i * L + l] /= A[(i * n + i) * L + l];
+				}
+			}
+		});
+		return x;
+	}
+
+	// -Определители всех матриц
+	std::vector<double> BatchLU::det() const {
+		size_t n = _lu.rows();
+		std::vector<double> d(_lu.count());
+		for (size_t k = 0; k < d.size(); k++) {
+			double v = _sign[k];
+			for (size_t i = 0; i < n; i++) v *= _lu.get(k, i, i);
+			d[k] = v;
+		}
+		return d;
+	}
+
+	// -Обратные матрицы
+	MatrixBatch BatchLU::inv() const {
+		MAT_VEC_SCOPE("BatchLU::inv");
+		size_t n = _lu.rows();
+		MatrixBatch res(_lu.count(), n, n);
+		for (size_t j = 0; j < n; j++) {
+			VectorBatch e(_lu.count(), n);
+			for (size_t blk = 0; blk < e.blocks(); blk++)
+				for (size_t l = 0; l < L; l++) e.block(blk)[j * L + l] = 1;
+			VectorBatch col = solve(e);
+			for (size_t blk = 0; blk < res.blocks(); blk++)
+				for (size_t i = 0; i < n; i++)
+					for (size_t l = 0; l < L; l++) res.block(blk)[(i * n + j) * L + l] = col.block(blk)[i * L + l];
+		}
+		return res;
+	}
+
+	// -Решение A_k x_k = b_k
+	VectorBatch batch_solve(const MatrixBatch& a, const VectorBatch& b) {
+		return BatchLU(a).solve(b);
+	}
+
+	// -Определители A_k
+	std::vector<double> batch_det(const MatrixBatch& a) {
+		return BatchLU(a).det();
+	}
+
+	// -Обратные матрицы A_k^-1
+	MatrixBatch batch_inv(const MatrixBatch& a) {
+		return BatchLU(a).inv();
+	}
+
+} // namespace mat_vec
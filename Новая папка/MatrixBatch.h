@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Base.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mat_vec {
+
+	// Набор count векторов одинакового размера.
+	// Хранение как у MatrixBatch: элемент i группы из LANES векторов занимает LANES подряд идущих чисел
+	class VectorBatch {
+	public:
+		VectorBatch(size_t count, size_t size, double value = 0);
+
+		size_t count() const;
+		size_t size() const;
+
+		// Элемент i вектора k
+		double get(size_t k, size_t i) const;
+		double& at(size_t k, size_t i);
+
+		// Запись и чтение вектора k целиком
+		void set(size_t k, const Vector& v);
+		Vector vector(size_t k) const;
+
+		// Начало группы block (LANES векторов)
+		double* block(size_t block);
+		const double* block(size_t block) const;
+		size_t blocks() const;
+
+	private:
+		size_t _count, _size;
+		std::vector<double> _data;
+	};
+
+	// Набор count матриц rows x cols в чередующемся (structure-of-arrays) хранении:
+	// матрицы группируются по LANES, элемент (i, j) группы -- LANES чисел подряд,
+	// поэтому операции над группой векторизуются по номеру матрицы
+	class MatrixBatch {
+	public:
+		// Число матриц в группе (ширина вектора AVX2 для double)
+		static const size_t LANES = 4;
+
+		MatrixBatch(size_t count, size_t rows, size_t cols, double value = 0);
+
+		size_t count() const;
+		size_t rows() const;
+		size_t cols() const;
+
+		// Элемент (row, col) матрицы k
+		double get(size_t k, size_t row, size_t col) const;
+		double& at(size_t k, size_t row, size_t col);
+
+		// Запись и чтение матрицы k целиком
+		void set(size_t k, const Matrix& m);
+		Matrix matrix(size_t k) const;
+
+		// Начало группы block (LANES матриц)
+		double* block(size_t block);
+		const double* block(size_t block) const;
+		size_t blocks() const;
+
+	private:
+		size_t _count, _rows, _cols;
+		std::vector<double> _data;
+	};
+
+	// LU-разложение всех матриц набора с выбором ведущего элемента в каждой матрице
+	class BatchLU {
+	public:
+		explicit BatchLU(const MatrixBatch& a);
+
+		// Решение A_k x_k = b_k для всех k
+		VectorBatch solve(const VectorBatch& b) const;
+
+		// Определители всех матриц
+		std::vector<double> det() const;
+
+		// Обратные матрицы
+		MatrixBatch inv() const;
+
+	private:
+		MatrixBatch _lu;
+		std::vector<uint32_t> _pivot;        // _pivot[k * n + step]
+		std::vector<signed char> _sign;
+	};
+
+	// C_k = A_k * B_k
+	MatrixBatch batch_gemm(const MatrixBatch& a, const MatrixBatch& b);
+
+	// y_k = A_k * x_k
+	VectorBatch batch_gemv(const MatrixBatch& a, const VectorBatch& x);
+
+	// Решение A_k x_k = b_k
+	VectorBatch batch_solve(const MatrixBatch& a, const VectorBatch& b);
+
+	// Определители A_k
+	std::vector<double> batch_det(const MatrixBatch& a);
+
+	// Обратные матрицы A_k^-1
+	MatrixBatch batch_inv(const MatrixBatch& a);
+
+} // namespace mat_vec
@@ -0,0 +1,420 @@
+#include "MatrixFunctions.h"
+#include "Decomposition.h"
+#include "Gemm.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Коэффициенты числителя Паде [m/m] для e^x, m = 3, 5, 7, 9, 13
+		const double PADE3[] = { 120, 60, 12, 1 };
+		const double PADE5[] = { 30240, 15120, 3360, 420, 30, 1 };
+		const double PADE7[] = { 17297280, 8648640, 1995840, 277200, 25200, 1512, 56, 1 };
+		const double PADE9[] = { 17643225600., 8821612800., 2075673600., 302702400., 30270240., 2162160., 110880.,
+			3960., 90., 1. };
+		const double PADE13[] = { 64764752532480000., 32382376266240000., 7771770303897600., 1187353796428800.,
+			129060195264000., 10559470521600., 670442572800., 33522128640., 1323241920., 40840800., 960960.,
+			16380., 182., 1. };
+
+		// Наибольшая 1-норма, при которой Паде степени m точна в double (Хайэм, 2005)
+		const double THETA3 = 1.495585217958292e-2;
+		const double THETA5 = 2.539398330063230e-1;
+		const double THETA7 = 9.504178996162932e-1;
+		const double THETA9 = 2.097847961257068e0;
+		const double THETA13 = 5.371920351148152e0;
+
+		// logm: корни извлекаются, пока ||X - I||_1 больше этого; тогда
+		// Паде степени LOG_DEGREE точна в double
+		const double LOG_THETA = 0.25;
+		const size_t LOG_DEGREE = 8;
+		const size_t MAX_SQUARE_ROOTS = 64;
+
+		// Итерация Денмана-Биверса
+		const size_t DB_MAX_ITERATIONS = 100;
+		const double DB_TOLERANCE = 1e-13;
+		const double DB_SCALING_UNTIL = 1e-2;   // масштабирование до этого относительного шага
+
+		typedef std::pair<double, const MatrixRef*> Term;
+
+		void copy(const MatrixRef& dst, const MatrixRef& src) {
+			for (size_t i = 0; i < src.n_rows; i++) std::copy(src.row(i), src.row(i) + src.n_cols, dst.row(i));
+		}
+
+		// dst = diag * I + sum c X
+		void combine(const MatrixRef& dst, double diag, std::initializer_list<Term> terms) {
+			size_t n = dst.n_rows;
+			for (size_t i = 0; i < n; i++) {
+				double* d = dst.row(i);
+				for (size_t j = 0; j < n; j++) {
+					double s = i == j ? diag : 0.0;
+					for (const Term& t : terms) s += t.first * t.second->row(i)[j];
+					d[j] = s;
+				}
+			}
+		}
+
+		double norm1(const MatrixRef& a) {
+			double best = 0;
+			for (size_t j = 0; j < a.n_cols; j++) {
+				double s = 0;
+				for (size_t i = 0; i < a.n_rows; i++) s += std::fabs(a.row(i)[j]);
+				best = std::max(best, s);
+			}
+			return best;
+		}
+
+		// ||A - I||_1
+		double distance_to_identity(const MatrixRef& a) {
+			double best = 0;
+			for (size_t j = 0; j < a.n_cols; j++) {
+				double s = 0;
+				for (size_t i = 0; i < a.n_rows; i++) s += std::fabs(a.row(i)[j] - (i == j ? 1.0 : 0.0));
+				best = std::max(best, s);
+			}
+			return best;
+		}
+
+		// Узлы и веса Гаусса-Лежандра на [0, 1]
+		struct GaussLegendre {
+			double x[LOG_DEGREE];
+			double w[LOG_DEGREE];
+
+			GaussLegendre() {
+				const double pi = 3.14159265358979323846;
+				size_t m = LOG_DEGREE;
+				for (size_t i = 0; i < m; i++) {
+					double z = std::cos(pi * (i + 0.75) / (m + 0.5)), dp = 1;
+					for (int it = 0; it < 100; it++) {
+						// P_m(z) и P_m'(z) по рекуррентной формуле
+						double p0 = 1, p1 = z;
+						for (size_t k = 2; k <= m; k++) {
+							double p2 = ((2 * k - 1) * z * p1 - (k - 1) * p0) / k;
+							p0 = p1;
+							p1 = p2;
+						}
+						dp = m * (z * p1 - p0) / (z * z - 1);
+						double dz = p1 / dp;
+						z -= dz;
+						if (std::fabs(dz) < 1e-16) break;
+					}
+					x[i] = (1 - z) / 2;
+					w[i] = 1 / ((1 - z * z) * dp * dp);
+				}
+			}
+		};
+
+		void ensure_size(Matrix& m, size_t n) {
+			if ((size_t)m._size.first != n || (size_t)m._size.second != n) m = Matrix(n, n, 0.0);
+		}
+	}
+
+	const MatrixFunctionStats& MatrixFunctions::stats() const { return _stats; }
+	size_t MatrixFunctions::allocations() const { return _allocations; }
+
+	// -Рабочие матрицы n x n в количестве не меньше count
+	void MatrixFunctions::reserve(size_t n, size_t count) {
+		if (n != _n) {
+			_work.clear();
+			_pivots.assign(n, 0);
+			_n = n;
+		}
+		while (_work.size() < count) {
+			_work.emplace_back(n, n, 0.0);
+			_allocations++;
+		}
+	}
+
+	MatrixRef MatrixFunctions::work(size_t i) const { return view(_work[i]); }
+
+	void MatrixFunctions::multiply(const MatrixRef& a, const MatrixRef& b, const MatrixRef& c) {
+		gemm(1.0, a, b, 0.0, c);
+		_stats.products++;
+	}
+
+	// -b = a^{-1} b; lu -- рабочая матрица
+	bool MatrixFunctions::solve(const MatrixRef& a, const MatrixRef& b, const MatrixRef& lu) {
+		copy(lu, a);
+		_stats.solves++;
+		if (!lu_factor(lu, _pivots.data())) return false;
+		lu_solve(lu, _pivots.data(), b);
+		return true;
+	}
+
+	// -inv = a^{-1} и log|det a|
+	bool MatrixFunctions::invert(const MatrixRef& a, const MatrixRef& inv, const MatrixRef& lu, double* log_det) {
+		combine(inv, 1.0, {});
+		if (!solve(a, inv, lu)) return false;
+		double s = 0;
+		for (size_t i = 0; i < a.n_rows; i++) s += std::log(std::fabs(lu.row(i)[i]));
+		*log_det = s;
+		return true;
+	}
+
+	// -a^k
+	bool MatrixFunctions::pow(const Matrix& a, size_t k, Matrix& result) {
+		MAT_VEC_SCOPE("MatrixFunctions::pow");
+		_stats = MatrixFunctionStats();
+		size_t n = a._size.first;
+		if ((size_t)a._size.second != n) return false;
+		ensure_size(result, n);
+		reserve(n, 4);
+		// основание и накопленное произведение переходят между парами буферов
+		MatrixRef base = work(0), base_spare = work(1), acc = work(2), acc_spare = work(3);
+		copy(base, view(a));
+		bool started = false;
+		while (k) {
+			if (k & 1) {
+				if (started) {
+					multiply(acc, base, acc_spare);
+					std::swap(acc, acc_spare);
+				}
+				else {
+					copy(acc, base);
+					started = true;
+				}
+			}
+			k >>= 1;
+			if (k) {
+				multiply(base, base, base_spare);
+				std::swap(base, base_spare);
+			}
+		}
+		if (started) copy(view(result), acc);
+		else combine(view(result), 1.0, {});
+		return true;
+	}
+
+	// -e^a: Паде с масштабированием и возведением в квадрат
+	bool MatrixFunctions::expm(const Matrix& a, Matrix& result) {
+		MAT_VEC_SCOPE("MatrixFunctions::expm");
+		_stats = MatrixFunctionStats();
+		size_t n = a._size.first;
+		if ((size_t)a._size.second != n) return false;
+		ensure_size(result, n);
+		reserve(n, 9);
+		MatrixRef A = work(0), A2 = work(1), A4 = work(2), A6 = work(3), A8 = work(4);
+		MatrixRef U = work(5), V = work(6), T = work(7), LU = work(8), R = view(result);
+
+		double norm = norm1(view(a));
+		size_t s = 0;
+		if (norm > THETA9) s = (size_t)std::max(0.0, std::ceil(std::log2(norm / THETA13)));
+		copy(A, view(a));
+		if (s) combine(A, 0.0, { { std::ldexp(1.0, -(int)s), &A } });
+		multiply(A, A, A2);
+
+		const double* b;
+		if (norm <= THETA3) {
+			b = PADE3;
+			_stats.pade_degree = 3;
+			combine(T, b[1], { { b[3], &A2 } });
+			combine(V, b[0], { { b[2], &A2 } });
+		}
+		else if (norm <= THETA5) {
+			b = PADE5;
+			_stats.pade_degree = 5;
+			multiply(A2, A2, A4);
+			combine(T, b[1], { { b[5], &A4 }, { b[3], &A2 } });
+			combine(V, b[0], { { b[4], &A4 }, { b[2], &A2 } });
+		}
+		else if (norm <= THETA7) {
+			b = PADE7;
+			_stats.pade_degree = 7;
+			multiply(A2, A2, A4);
+			multiply(A4, A2, A6);
+			combine(T, b[1], { { b[7], &A6 }, { b[5], &A4 }, { b[3], &A2 } });
+			combine(V, b[0], { { b[6], &A6 }, { b[4], &A4 }, { b[2], &A2 } });
+		}
+		else if (norm <= THETA9) {
+			b = PADE9;
+			_stats.pade_degree = 9;
+			multiply(A2, A2, A4);
+			multiply(A4, A2, A6);
+			multiply(A6, A2, A8);
+			combine(T, b[1], { { b[9], &A8 }, { b[7], &A6 }, { b[5], &A4 }, { b[3], &A2 } });
+			combine(V, b[0], { { b[8], &A8 }, { b[6], &A6 }, { b[4], &A4 }, { b[2], &A2 } });
+		}
+		else {
+			// степень 13: A6 (b13 A6 + b11 A4 + b9 A2) + ... -- шесть умножений
+			b = PADE13;
+			_stats.pade_degree = 13;
+			multiply(A2, A2, A4);
+			multiply(A4, A2, A6);
+			combine(T, 0.0, { { b[13], &A6 }, { b[11], &A4 }, { b[9], &A2 } });
+			multiply(A6, T, U);
+			combine(T, b[1], { { 1.0, &U }, { b[7], &A6 }, { b[5], &A4 }, { b[3], &A2 } });
+			combine(A8, 0.0, { { b[12], &A6 }, { b[10], &A4 }, { b[8], &A2 } });
+			multiply(A6, A8, V);
+			combine(V, b[0], { { 1.0, &V }, { b[6], &A6 }, { b[4], &A4 }, { b[2], &A2 } });
+		}
+		multiply(A, T, U);
+
+		// (V - U) R = V + U
+		combine(T, 0.0, { { 1.0, &V }, { -1.0, &U } });
+		combine(R, 0.0, { { 1.0, &V }, { 1.0, &U } });
+		if (!solve(T, R, LU)) {
+			_stats.converged = false;
+			return false;
+		}
+		for (size_t i = 0; i < s; i++) {
+			multiply(R, R, T);
+			copy(R, T);
+		}
+		_stats.squarings = s;
+		return true;
+	}
+
+	// -Итерация Денмана-Биверса: y = a^{1/2}; рабочие матрицы first .. first + 4
+	bool MatrixFunctions::sqrt_db(const MatrixRef& a, const MatrixRef& y, size_t first) {
+		size_t n = a.n_rows;
+		MatrixRef Y = work(first), Z = work(first + 1), Yi = work(first + 2), Zi = work(first + 3);
+		MatrixRef LU = work(first + 4);
+		copy(Y, a);
+		combine(Z, 1.0, {});
+		bool scaling = true;
+		for (size_t it = 0; it < DB_MAX_ITERATIONS; it++) {
+			_stats.iterations++;
+			double ldy, ldz;
+			if (!invert(Y, Yi, LU, &ldy) || !invert(Z, Zi, LU, &ldz)) return false;
+			// масштаб |det Y det Z|^{-1/(2n)} ускоряет начальную фазу
+			double g = scaling ? std::exp(-(ldy + ldz) / (2.0 * n)) : 1.0;
+			if (!std::isfinite(g)) g = 1.0;
+			double diff = 0, norm = 0;
+			for (size_t i = 0; i < n; i++) {
+				double* yr = Y.row(i);
+				double* zr = Z.row(i);
+				const double* yi = Yi.row(i);
+				const double* zi = Zi.row(i);
+				for (size_t j = 0; j < n; j++) {
+					double ny = 0.5 * (g * yr[j] + zi[j] / g);
+					double nz = 0.5 * (g * zr[j] + yi[j] / g);
+					diff += (ny - yr[j]) * (ny - yr[j]);
+					norm += ny * ny;
+					yr[j] = ny;
+					zr[j] = nz;
+				}
+			}
+			if (!std::isfinite(norm)) return false;
+			diff = std::sqrt(diff);
+			norm = std::sqrt(norm);
+			if (diff <= DB_TOLERANCE * norm) {
+				copy(y, Y);
+				return true;
+			}
+			if (diff <= DB_SCALING_UNTIL * norm) scaling = false;
+		}
+		return false;
+	}
+
+	// -Главный квадратный корень
+	bool MatrixFunctions::sqrtm(const Matrix& a, Matrix& result) {
+		MAT_VEC_SCOPE("MatrixFunctions::sqrtm");
+		_stats = MatrixFunctionStats();
+		size_t n = a._size.first;
+		if ((size_t)a._size.second != n) return false;
+		ensure_size(result, n);
+		reserve(n, 5);
+		_stats.converged = sqrt_db(view(a), view(result), 0);
+		return _stats.converged;
+	}
+
+	// -Главный логарифм обратным масштабированием
+	bool MatrixFunctions::logm(const Matrix& a, Matrix& result) {
+		MAT_VEC_SCOPE("MatrixFunctions::logm");
+		static const GaussLegendre nodes;
+		_stats = MatrixFunctionStats();
+		size_t n = a._size.first;
+		if ((size_t)a._size.second != n) return false;
+		ensure_size(result, n);
+		reserve(n, 9);
+		MatrixRef X = work(5), E = work(6), T = work(7), Q = work(8), LU = work(0), R = view(result);
+		copy(X, view(a));
+		size_t s = 0;
+		while (distance_to_identity(X) > LOG_THETA) {
+			if (s == MAX_SQUARE_ROOTS || !sqrt_db(X, X, 0)) {
+				_stats.converged = false;
+				return false;
+			}
+			s++;
+		}
+		_stats.squarings = s;
+		_stats.pade_degree = LOG_DEGREE;
+
+		// log(I + E) ~ sum w_j E (I + x_j E)^{-1}
+		combine(E, -1.0, { { 1.0, &X } });
+		combine(R, 0.0, {});
+		for (size_t j = 0; j < LOG_DEGREE; j++) {
+			combine(T, 1.0, { { nodes.x[j], &E } });
+			copy(Q, E);
+			if (!solve(T, Q, LU)) {
+				_stats.converged = false;
+				return false;
+			}
+			combine(R, 0.0, { { 1.0, &R }, { nodes.w[j], &Q } });
+		}
+		if (s) combine(R, 0.0, { { std::ldexp(1.0, (int)s), &R } });
+		return true;
+	}
+
+	namespace {
+
+		// Рабочая память обёрток, взятая из списка свободных объектов потока
+		// и возвращаемая туда же, как PackBuffer в gemm. Список, а не один
+		// объект: ожидая в parallel_for внутри gemm, поток может выполнить
+		// чужую задачу со своим вызовом expm
+		class ThreadFunctions {
+		public:
+			ThreadFunctions() {
+				std::vector<std::unique_ptr<MatrixFunctions>>& list = free_list();
+				if (list.empty()) {
+					_f.reset(new MatrixFunctions());
+				}
+				else {
+					_f = std::move(list.back());
+					list.pop_back();
+				}
+			}
+
+			~ThreadFunctions() { free_list().push_back(std::move(_f)); }
+
+			ThreadFunctions(const ThreadFunctions&) = delete;
+			ThreadFunctions& operator=(const ThreadFunctions&) = delete;
+
+			MatrixFunctions& get() { return *_f; }
+
+		private:
+			static std::vector<std::unique_ptr<MatrixFunctions>>& free_list() {
+				thread_local std::vector<std::unique_ptr<MatrixFunctions>> list;
+				return list;
+			}
+
+			std::unique_ptr<MatrixFunctions> _f;
+		};
+
+		template <class F>
+		Matrix call(const Matrix& a, F fn) {
+			Matrix res(a._size.first, a._size.second, 0.0);
+			ThreadFunctions f;
+			if (!(f.get().*fn)(a, res)) return Matrix(0, 0, 0.0);
+			return res;
+		}
+	}
+
+	// -Возведение в степень
+	Matrix Matrix::pow(size_t k) const {
+		Matrix res(_size.first, _size.second, 0.0);
+		ThreadFunctions f;
+		f.get().pow(*this, k, res);
+		return res;
+	}
+
+	Matrix expm(const Matrix& a) { return call(a, &MatrixFunctions::expm); }
+	Matrix sqrtm(const Matrix& a) { return call(a, &MatrixFunctions::sqrtm); }
+	Matrix logm(const Matrix& a) { return call(a, &MatrixFunctions::logm); }
+
+} // namespace mat_vec
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Base.h"
+#include "Gemm.h"
+#include "Matrix.h"
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+namespace mat_vec {
+
+	// Что сделал последний вызов
+	struct MatrixFunctionStats {
+		size_t products = 0;       // умножений матриц (gemm)
+		size_t solves = 0;         // LU-разложений
+		size_t pade_degree = 0;    // степень Паде в expm и logm
+		size_t squarings = 0;      // возведений в квадрат (expm) или извлечённых корней (logm)
+		size_t iterations = 0;     // итераций Денмана-Биверса (всего)
+		bool converged = true;
+	};
+
+	// Функции квадратных матриц с переиспользуемой рабочей памятью.
+	//
+	// Временные матрицы создаются при первом вызове для данного размера
+	// и дальше только переиспользуются; result выделяется заново, только
+	// если его размер не совпадает. Так что повторные вызовы с матрицами
+	// одного размера не выделяют память под матрицы. Все произведения --
+	// через блочный gemm, решения систем -- через lu_factor/lu_solve.
+	//
+	// Все функции возвращают false для неквадратной матрицы; sqrtm и logm --
+	// ещё и если итерация не сошлась (собственные значения на отрицательной
+	// полуоси или в нуле, корень и логарифм не определены)
+	class MatrixFunctions {
+	public:
+		MatrixFunctions() = default;
+
+		// a^k повторным возведением в квадрат
+		bool pow(const Matrix& a, size_t k, Matrix& result);
+
+		// e^a: аппроксимация Паде степени 3..13 с масштабированием и
+		// возведением в квадрат (Хайэм, 2005)
+		bool expm(const Matrix& a, Matrix& result);
+
+		// Главный квадратный корень итерацией Денмана-Биверса с масштабированием
+		// по определителю
+		bool sqrtm(const Matrix& a, Matrix& result);
+
+		// Главный логарифм: обратное масштабирование (квадратные корни, пока
+		// a не станет близка к I), затем Паде для log(I + X) в форме суммы
+		// дробей по узлам Гаусса-Лежандра
+		bool logm(const Matrix& a, Matrix& result);
+
+		const MatrixFunctionStats& stats() const;
+
+		// Сколько раз выделялась рабочая память
+		size_t allocations() const;
+
+	private:
+		void reserve(size_t n, size_t count);
+		MatrixRef work(size_t i) const;
+		void multiply(const MatrixRef& a, const MatrixRef& b, const MatrixRef& c);
+		bool solve(const MatrixRef& a, const MatrixRef& b, const MatrixRef& lu);
+		bool invert(const MatrixRef& a, const MatrixRef& inv, const MatrixRef& lu, double* log_det);
+		bool sqrt_db(const MatrixRef& a, const MatrixRef& y, size_t first);
+
+		std::deque<Matrix> _work;
+		std::vector<size_t> _pivots;
+		size_t _n = 0;
+		size_t _allocations = 0;
+		MatrixFunctionStats _stats;
+	};
+
+	// Обёртки, выделяющие результат. Рабочая память берётся из списка
+	// свободных объектов потока (его же использует Matrix::pow), так что
+	// вызов из задачи пула, начатой во время другого вызова, её не портит.
+	// При ошибке -- матрица 0 x 0
+	Matrix expm(const Matrix& a);
+	Matrix sqrtm(const Matrix& a);
+	Matrix logm(const Matrix& a);
+
+} // namespace mat_vec
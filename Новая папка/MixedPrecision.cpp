@@ -0,0 +1,273 @@
+#include "MixedPrecision.h"
+#include "Decomposition.h"
+#include "Gemm.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MAT_VEC_SSE2
+#endif
+
+namespace mat_vec {
+
+	namespace {
+
+		// Ширина панели
+		const size_t NB = 64;
+
+		// Строк ядра обновления и ширина его полосы столбцов: 4 x 8 сумм
+		// во float -- восемь регистров SSE
+		const size_t KR = 4;
+		const size_t KC = 8;
+
+		// Групп по KR строк на задачу при обновлении остатка
+		const size_t UPDATE_GRAIN = 8;
+
+		// y -= alpha x
+		void axpy(float* y, const float* x, float alpha, size_t count) {
+			size_t j = 0;
+#ifdef MAT_VEC_SSE2
+			__m128 a = _mm_set1_ps(alpha);
+			for (; j + 4 <= count; j += 4) {
+				_mm_storeu_ps(y + j, _mm_sub_ps(_mm_loadu_ps(y + j), _mm_mul_ps(a, _mm_loadu_ps(x + j))));
+			}
+#endif
+			for (; j < count; j++) y[j] -= alpha * x[j];
+		}
+
+		// -A[i.., c0..] -= L[i.., k0..k0 + kb] U[k0..k0 + kb, c0..] для R <= KR
+		// строк: полоса R x KC сумм держится в регистрах на всю панель
+		template <size_t R>
+		void update_rows(float* a, size_t n, size_t i, size_t k0, size_t kb, size_t c0) {
+			float* c[R];
+			const float* l[R];
+			for (size_t r = 0; r < R; r++) {
+				c[r] = a + (i + r) * n;
+				l[r] = c[r] + k0;
+			}
+			const float* u = a + k0 * n;
+			size_t j = c0;
+#ifdef MAT_VEC_SSE2
+			for (; j + KC <= n; j += KC) {
+				__m128 acc[R][2];
+				for (size_t r = 0; r < R; r++) {
+					acc[r][0] = _mm_loadu_ps(c[r] + j);
+					acc[r][1] = _mm_loadu_ps(c[r] + j + 4);
+				}
+				for (size_t p = 0; p < kb; p++) {
+					__m128 u0 = _mm_loadu_ps(u + p * n + j), u1 = _mm_loadu_ps(u + p * n + j + 4);
+					for (size_t r = 0; r < R; r++) {
+						__m128 lr = _mm_set1_ps(l[r][p]);
+						acc[r][0] = _mm_sub_ps(acc[r][0], _mm_mul_ps(lr, u0));
+						acc[r][1] = _mm_sub_ps(acc[r][1], _mm_mul_ps(lr, u1));
+					}
+				}
+				for (size_t r = 0; r < R; r++) {
+					_mm_storeu_ps(c[r] + j, acc[r][0]);
+					_mm_storeu_ps(c[r] + j + 4, acc[r][1]);
+				}
+			}
+#endif
+			for (; j < n; j++) {
+				float acc[R];
+				for (size_t r = 0; r < R; r++) acc[r] = c[r][j];
+				for (size_t p = 0; p < kb; p++) {
+					float up = u[p * n + j];
+					for (size_t r = 0; r < R; r++) acc[r] -= l[r][p] * up;
+				}
+				for (size_t r = 0; r < R; r++) c[r][j] = acc[r];
+			}
+		}
+
+		// -Блочное LU во float на месте (строки по n чисел), перестановки -- как у lu_factor
+		bool factor(float* a, size_t n, size_t* pivots) {
+			for (size_t k0 = 0; k0 < n; k0 += NB) {
+				size_t kb = std::min(NB, n - k0), c0 = k0 + kb;
+				// -панель: столбцы k0 .. c0 по всем строкам ниже k0
+				for (size_t k = k0; k < c0; k++) {
+					size_t p = k;
+					for (size_t i = k + 1; i < n; i++) {
+						if (std::abs(a[i * n + k]) > std::abs(a[p * n + k])) p = i;
+					}
+					pivots[k] = p;
+					if (a[p * n + k] == 0) return false;
+					if (p != k) std::swap_ranges(a + k * n, a + (k + 1) * n, a + p * n);
+					float inv = 1.0f / a[k * n + k];
+					for (size_t i = k + 1; i < n; i++) {
+						float* row = a + i * n;
+						row[k] *= inv;
+						axpy(row + k + 1, a + k * n + k + 1, row[k], c0 - k - 1);
+					}
+				}
+				if (c0 == n) break;
+				// -U12 = L11^{-1} A12
+				for (size_t k = k0; k < c0; k++) {
+					for (size_t i = k + 1; i < c0; i++) axpy(a + i * n + c0, a + k * n + c0, a[i * n + k], n - c0);
+				}
+				// -A22 -= L21 U12 группами по KR строк
+				size_t rows = n - c0, groups = (rows + KR - 1) / KR;
+				parallel_for(0, groups, UPDATE_GRAIN, [&](size_t from, size_t to) {
+					for (size_t g = from; g < to; g++) {
+						size_t i = c0 + g * KR, r = std::min(KR, n - i);
+						if (r == 4) update_rows<4>(a, n, i, k0, kb, c0);
+						else if (r == 3) update_rows<3>(a, n, i, k0, kb, c0);
+						else if (r == 2) update_rows<2>(a, n, i, k0, kb, c0);
+						else update_rows<1>(a, n, i, k0, kb, c0);
+					}
+				});
+			}
+			return true;
+		}
+
+		double norm_inf(const Matrix& a) {
+			double best = 0;
+			for (int i = 0; i < a._size.first; i++) {
+				double s = 0;
+				for (int j = 0; j < a._size.second; j++) s += std::abs(a.a[i][j]);
+				best = std::max(best, s);
+			}
+			return best;
+		}
+
+		double norm_inf(const double* x, size_t n) {
+			double best = 0;
+			for (size_t i = 0; i < n; i++) best = std::max(best, std::abs(x[i]));
+			return best;
+		}
+
+		// ||b - A x||_inf / (||A||_inf ||x||_inf); r -- рабочий вектор длины n
+		double backward_error(const Matrix& a, double a_norm, const Vector& b, const Vector& x, double* r) {
+			size_t n = b.size();
+			gemv(view(a), x.data, r);
+			for (size_t i = 0; i < n; i++) r[i] = b[i] - r[i];
+			double denominator = a_norm * norm_inf(x.data, n);
+			double residual = norm_inf(r, n);
+			return denominator > 0 ? residual / denominator : residual;
+		}
+	}
+
+	FloatLU::FloatLU(const Matrix& a) : _n(a._size.first), _lu(_n * _n), _pivots(_n), _singular(false) {
+		MAT_VEC_SCOPE("FloatLU");
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)_n * _n * _n / 3);
+		const float limit = std::numeric_limits<float>::max();
+		for (size_t i = 0; i < _n; i++) {
+			for (size_t j = 0; j < _n; j++) {
+				double v = a.a[i][j];
+				if (!(std::abs(v) <= limit)) _singular = true;
+				_lu[i * _n + j] = (float)v;
+			}
+		}
+		if (!_singular) _singular = !factor(_lu.data(), _n, _pivots.data());
+	}
+
+	size_t FloatLU::size() const { return _n; }
+
+	bool FloatLU::singular() const { return _singular; }
+
+	void FloatLU::solve(float* b) const {
+		size_t n = _n;
+		for (size_t k = 0; k < n; k++) std::swap(b[k], b[_pivots[k]]);
+		for (size_t i = 0; i < n; i++) {
+			const float* r = _lu.data() + i * n;
+			float s = b[i];
+			for (size_t j = 0; j < i; j++) s -= r[j] * b[j];
+			b[i] = s;
+		}
+		for (size_t i = n; i-- > 0;) {
+			const float* r = _lu.data() + i * n;
+			float s = b[i];
+			for (size_t j = i + 1; j < n; j++) s -= r[j] * b[j];
+			b[i] = s / r[i];
+		}
+	}
+
+	size_t FloatLU::bytes() const { return _lu.size() * sizeof(float); }
+
+	// -Уточнение: d = A^{-1} r во float (r заранее делится на ||r||_inf,
+	// чтобы не выйти за диапазон float), x += d, r = b - A x в double.
+	// Остановка -- по порогу; отказ -- если невязка перестала убывать
+	bool solve_mixed(const Matrix& a, const Vector& b, Vector& x, MixedSolveStats* stats, const MixedSolveOptions& opt) {
+		MAT_VEC_SCOPE("solve_mixed");
+		typedef std::chrono::steady_clock clock;
+		clock::time_point start = clock::now();
+		MixedSolveStats st;
+		size_t n = (size_t)a._size.first;
+		if ((size_t)a._size.second != n || b.size() != n) return false;
+
+		double a_norm = norm_inf(a);
+		double tolerance = opt.tolerance > 0 ? opt.tolerance
+			: std::sqrt((double)n) * std::numeric_limits<double>::epsilon();
+		Vector sol(n, 0.0);
+		std::vector<double> r(b.data, b.data + n);
+		std::vector<float> d(n);
+		FloatLU lu(a);
+		if (!lu.singular()) {
+			double previous = std::numeric_limits<double>::infinity();
+			for (size_t it = 0;; it++) {
+				double r_norm = norm_inf(r.data(), n);
+				if (r_norm == 0) {
+					st.converged = true;
+					break;
+				}
+				for (size_t i = 0; i < n; i++) d[i] = (float)(r[i] / r_norm);
+				lu.solve(d.data());
+				for (size_t i = 0; i < n; i++) sol[i] += r_norm * (double)d[i];
+				st.iterations = it;
+				st.backward_error = backward_error(a, a_norm, b, sol, r.data());
+				if (st.backward_error <= tolerance) {
+					st.converged = true;
+					break;
+				}
+				r_norm = norm_inf(r.data(), n);
+				if (it >= opt.max_iterations || !(r_norm < previous)) break;
+				previous = r_norm;
+			}
+		}
+
+		bool solved = st.converged;
+		if (!solved && opt.fallback) {
+			LU dlu(a);
+			if (!dlu.singular()) {
+				sol = dlu.solve(b);
+				st.fallback = true;
+				st.backward_error = backward_error(a, a_norm, b, sol, r.data());
+				solved = true;
+			}
+		}
+		x = sol;
+		st.seconds = std::chrono::duration<double>(clock::now() - start).count();
+		if (stats) *stats = st;
+		return solved;
+	}
+
+	MixedSolveReport compare_solve(const Matrix& a, const Vector& b, size_t repeats) {
+		typedef std::chrono::steady_clock clock;
+		repeats = std::max<size_t>(repeats, 1);
+		MixedSolveReport rep;
+		Vector x(b.size()), y(b.size());
+		double mixed = 0;
+		for (size_t r = 0; r < repeats; r++) {
+			solve_mixed(a, b, x, &rep.stats);
+			mixed += rep.stats.seconds;
+		}
+		clock::time_point t0 = clock::now();
+		for (size_t r = 0; r < repeats; r++) y = LU(a).solve(b);
+		clock::time_point t1 = clock::now();
+
+		rep.stats.seconds = mixed / repeats;
+		rep.double_seconds = std::chrono::duration<double>(t1 - t0).count() / repeats;
+		rep.speedup = rep.stats.seconds > 0 ? rep.double_seconds / rep.stats.seconds : 0;
+		std::vector<double> r(b.size());
+		rep.double_backward_error = backward_error(a, norm_inf(a), b, y, r.data());
+		rep.max_difference = 0;
+		for (size_t i = 0; i < b.size(); i++) rep.max_difference = std::max(rep.max_difference, std::abs(x[i] - y[i]));
+		return rep;
+	}
+
+} // namespace mat_vec
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Base.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include <cstddef>
+#include <vector>
+
+namespace mat_vec {
+
+	// LU-разложение с частичным выбором ведущего элемента в одинарной
+	// точности: вдвое больше чисел на регистр SIMD и вдвое меньше памяти,
+	// чем у LU. Блочный алгоритм, как у lu_factor; остаток обновляется
+	// ядром во float
+	class FloatLU {
+	public:
+		explicit FloatLU(const Matrix& a);
+
+		size_t size() const;
+
+		// true, если встретился нулевой ведущий элемент или элемент a
+		// не помещается во float
+		bool singular() const;
+
+		// b = A^{-1} b во float, на месте
+		void solve(float* b) const;
+
+		// Память под множители
+		size_t bytes() const;
+
+	private:
+		size_t _n;
+		std::vector<float> _lu;
+		std::vector<size_t> _pivots;
+		bool _singular;
+	};
+
+	struct MixedSolveOptions {
+		size_t max_iterations = 30;
+		// Порог ||b - A x||_inf <= tolerance ||A||_inf ||x||_inf;
+		// 0 -- sqrt(n) * eps double, как в LAPACK dsgesv
+		double tolerance = 0;
+		// Если уточнение не сошлось -- решить заново через LU в double
+		bool fallback = true;
+	};
+
+	struct MixedSolveStats {
+		size_t iterations = 0;       // шагов уточнения (решений во float после первого)
+		bool converged = false;      // уточнение достигло порога
+		bool fallback = false;       // решение получено через LU в double
+		double backward_error = 0;   // ||b - A x||_inf / (||A||_inf ||x||_inf)
+		double seconds = 0;
+	};
+
+	// A x = b: разложение во float, затем итерационное уточнение с
+	// невязкой в double до точности double. Если уточнение расходится,
+	// не сходится за max_iterations или A не представима во float --
+	// разложение в double (если разрешено). false, если система не решена
+	bool solve_mixed(const Matrix& a, const Vector& b, Vector& x, MixedSolveStats* stats = nullptr,
+		const MixedSolveOptions& opt = MixedSolveOptions());
+
+	// Сравнение solve_mixed с решением через LU в double
+	struct MixedSolveReport {
+		MixedSolveStats stats;
+		double double_seconds;          // LU(a).solve(b), на один вызов
+		double speedup;                 // double_seconds / stats.seconds
+		double double_backward_error;
+		double max_difference;          // max |x_mixed - x_double|
+	};
+
+	MixedSolveReport compare_solve(const Matrix& a, const Vector& b, size_t repeats = 3);
+
+} // namespace mat_vec
@@ -0,0 +1,366 @@
+#include "Ordering.h"
+#include "Matrix.h"
+#include "Profiler.h"
+#include "Vector.h"
+#include <algorithm>
+#include <set>
+#include <utility>
+
+namespace mat_vec {
+
+	namespace {
+
+		const uint32_t NONE = UINT32_MAX;
+
+		// Структура A + A^T без диагонали: соседи вершины v --
+		// idx[ptr[v] .. ptr[v + 1]), по возрастанию
+		struct Adjacency {
+			std::vector<size_t> ptr;
+			std::vector<uint32_t> idx;
+
+			size_t degree(size_t v) const { return ptr[v + 1] - ptr[v]; }
+		};
+
+		Adjacency symmetric_pattern(const SparseMatrix& a) {
+			size_t n = a.rows();
+			SparseMatrix t = a.transposed();
+			Adjacency g;
+			g.ptr.assign(n + 1, 0);
+			g.idx.reserve(2 * a.nnz());
+			for (size_t i = 0; i < n; i++) {
+				// слияние двух упорядоченных строк
+				const uint32_t* x = a.cols_idx().data() + a.row_ptr()[i];
+				const uint32_t* xe = a.cols_idx().data() + a.row_ptr()[i + 1];
+				const uint32_t* y = t.cols_idx().data() + t.row_ptr()[i];
+				const uint32_t* ye = t.cols_idx().data() + t.row_ptr()[i + 1];
+				while (x < xe || y < ye) {
+					uint32_t j = y == ye || (x < xe && *x < *y) ? *x : *y;
+					if (x < xe && *x == j) x++;
+					if (y < ye && *y == j) y++;
+					if (j != i) g.idx.push_back(j);
+				}
+				g.ptr[i + 1] = g.idx.size();
+			}
+			return g;
+		}
+
+		// Обход в ширину по вершинам с пометкой, отличной от stamp;
+		// возвращает последний уровень и число уровней
+		size_t bfs_levels(const Adjacency& g, uint32_t root, std::vector<uint32_t>& mark, uint32_t stamp,
+			std::vector<uint32_t>& queue, std::vector<uint32_t>& last) {
+			queue.assign(1, root);
+			mark[root] = stamp;
+			size_t levels = 0, begin = 0;
+			while (begin < queue.size()) {
+				size_t end = queue.size();
+				last.assign(queue.begin() + begin, queue.begin() + end);
+				for (size_t k = begin; k < end; k++)
+					for (size_t p = g.ptr[queue[k]]; p < g.ptr[queue[k] + 1]; p++) {
+						uint32_t v = g.idx[p];
+						if (mark[v] == stamp) continue;
+						mark[v] = stamp;
+						queue.push_back(v);
+					}
+				begin = end;
+				levels++;
+			}
+			return levels;
+		}
+
+		// Псевдопериферийная вершина компоненты root (Джордж-Лю): конец самого
+		// длинного найденного пути; повторяет обход из вершины наименьшей
+		// степени последнего уровня, пока число уровней растёт
+		uint32_t pseudo_peripheral(const Adjacency& g, uint32_t root, std::vector<uint32_t>& mark, uint32_t& stamp) {
+			std::vector<uint32_t> queue, last;
+			size_t levels = bfs_levels(g, root, mark, ++stamp, queue, last);
+			for (;;) {
+				uint32_t x = *std::min_element(last.begin(), last.end(), [&](uint32_t u, uint32_t v) {
+					return g.degree(u) != g.degree(v) ? g.degree(u) < g.degree(v) : u < v;
+				});
+				size_t lx = bfs_levels(g, x, mark, ++stamp, queue, last);
+				if (lx <= levels) return root;
+				root = x;
+				levels = lx;
+			}
+		}
+	}
+
+	// -Тождественная перестановка
+	Permutation::Permutation(size_t n) : _order(n), _position(n) {
+		for (size_t i = 0; i < n; i++) _order[i] = _position[i] = (uint32_t)i;
+	}
+
+	// -Перестановка из порядка старых номеров
+	Permutation::Permutation(std::vector<uint32_t> order) : _order(std::move(order)), _position(_order.size(), NONE) {
+		for (size_t i = 0; i < _order.size() && _valid; i++) {
+			uint32_t old = _order[i];
+			_valid = old < _order.size() && _position[old] == NONE;
+			if (_valid) _position[old] = (uint32_t)i;
+		}
+		if (!_valid) {
+			_order.clear();
+			_position.clear();
+		}
+	}
+
+	bool Permutation::valid() const { return _valid; }
+	size_t Permutation::size() const { return _order.size(); }
+	uint32_t Permutation::operator[](size_t i) const { return _order[i]; }
+	uint32_t Permutation::position(size_t old) const { return _position[old]; }
+	const std::vector<uint32_t>& Permutation::order() const { return _order; }
+	Permutation Permutation::inverse() const { return Permutation(_position); }
+
+	// -Обратный Катхилл-Макки
+	Permutation rcm(const SparseMatrix& a) {
+		MAT_VEC_SCOPE("rcm");
+		if (a.rows() != a.cols()) return Permutation();
+		size_t n = a.rows();
+		Adjacency g = symmetric_pattern(a);
+		std::vector<uint32_t> mark(n, 0), order;
+		std::vector<bool> done(n, false);
+		std::vector<uint32_t> next;
+		order.reserve(n);
+		uint32_t stamp = 0;
+		for (size_t s = 0; s < n; s++) {
+			if (done[s]) continue;
+			uint32_t root = pseudo_peripheral(g, (uint32_t)s, mark, stamp);
+			size_t begin = order.size();
+			order.push_back(root);
+			done[root] = true;
+			for (size_t k = begin; k < order.size(); k++) {
+				uint32_t u = order[k];
+				next.clear();
+				for (size_t p = g.ptr[u]; p < g.ptr[u + 1]; p++)
+					if (!done[g.idx[p]]) {
+						done[g.idx[p]] = true;
+						next.push_back(g.idx[p]);
+					}
+				std::sort(next.begin(), next.end(), [&](uint32_t x, uint32_t y) {
+					return g.degree(x) != g.degree(y) ? g.degree(x) < g.degree(y) : x < y;
+				});
+				order.insert(order.end(), next.begin(), next.end());
+			}
+		}
+		std::reverse(order.begin(), order.end());
+		return Permutation(std::move(order));
+	}
+
+	// -Приближённая минимальная степень
+	Permutation amd(const SparseMatrix& a) {
+		MAT_VEC_SCOPE("amd");
+		if (a.rows() != a.cols()) return Permutation();
+		size_t n = a.rows();
+		Adjacency g = symmetric_pattern(a);
+
+		// вершина -- переменная, пока не исключена; исключённая вершина p
+		// становится элементом (кликой L_p), а поглощённый элемент исчезает
+		enum Status : uint8_t { VARIABLE, ELEMENT, ABSORBED };
+		std::vector<Status> status(n, VARIABLE);
+		std::vector<std::vector<uint32_t>> vars(n), elems(n), members(n);
+		std::vector<size_t> degree(n);
+		std::set<std::pair<size_t, uint32_t>> queue;
+		for (size_t v = 0; v < n; v++) {
+			vars[v].assign(g.idx.begin() + g.ptr[v], g.idx.begin() + g.ptr[v + 1]);
+			degree[v] = vars[v].size();
+			queue.insert({ degree[v], (uint32_t)v });
+		}
+		std::vector<uint32_t>().swap(g.idx);
+
+		std::vector<uint32_t> tag(n, NONE), order, lp;
+		std::vector<size_t> outside(n, 0);   // |L_e \ L_p| на текущем шаге
+		order.reserve(n);
+		for (size_t k = 0; k < n; k++) {
+			uint32_t p = queue.begin()->second;
+			queue.erase(queue.begin());
+			order.push_back(p);
+			uint32_t stamp = (uint32_t)k;
+			tag[p] = stamp;
+
+			// новый элемент: соседи-переменные и переменные поглощаемых элементов
+			lp.clear();
+			for (uint32_t v : vars[p])
+				if (status[v] == VARIABLE && tag[v] != stamp) {
+					tag[v] = stamp;
+					lp.push_back(v);
+				}
+			for (uint32_t e : elems[p]) {
+				if (status[e] != ELEMENT) continue;
+				for (uint32_t v : members[e])
+					if (status[v] == VARIABLE && tag[v] != stamp) {
+						tag[v] = stamp;
+						lp.push_back(v);
+					}
+				status[e] = ABSORBED;
+				std::vector<uint32_t>().swap(members[e]);
+			}
+			status[p] = ELEMENT;
+			members[p] = lp;
+			std::vector<uint32_t>().swap(vars[p]);
+			std::vector<uint32_t>().swap(elems[p]);
+
+			// |L_e \ L_p| для элементов, задетых L_p
+			for (uint32_t i : lp)
+				for (uint32_t e : elems[i]) {
+					if (status[e] != ELEMENT) continue;
+					if (tag[e] != stamp) {
+						tag[e] = stamp;
+						outside[e] = members[e].size();
+					}
+					outside[e]--;
+				}
+
+			// соседи из L_p достижимы через элемент p -- из списков
+			// переменных они убираются; степень оценивается сверху
+			size_t remaining = n - k - 1;
+			for (uint32_t i : lp) {
+				auto& ev = elems[i];
+				ev.erase(std::remove_if(ev.begin(), ev.end(), [&](uint32_t e) { return status[e] != ELEMENT; }), ev.end());
+				auto& vv = vars[i];
+				vv.erase(std::remove_if(vv.begin(), vv.end(), [&](uint32_t v) {
+					return status[v] != VARIABLE || tag[v] == stamp;
+				}), vv.end());
+				size_t d = vv.size() + lp.size() - 1;
+				for (uint32_t e : ev) d += outside[e];
+				ev.push_back(p);
+				d = std::min(d, std::min(remaining - 1, degree[i] + lp.size() - 1));
+				queue.erase({ degree[i], i });
+				degree[i] = d;
+				queue.insert({ d, i });
+			}
+		}
+		return Permutation(std::move(order));
+	}
+
+	// -P A P^T
+	SparseMatrix permute(const SparseMatrix& a, const Permutation& p) {
+		MAT_VEC_SCOPE("permute");
+		size_t n = a.rows();
+		if (n != a.cols() || p.size() != n) return SparseMatrix(0, 0);
+		std::vector<size_t> ptr(n + 1, 0);
+		std::vector<uint32_t> cols(a.nnz());
+		std::vector<double> values(a.nnz());
+		std::vector<std::pair<uint32_t, double>> row;
+		for (size_t i = 0; i < n; i++) {
+			size_t old = p[i];
+			row.clear();
+			for (size_t q = a.row_ptr()[old]; q < a.row_ptr()[old + 1]; q++)
+				row.push_back({ p.position(a.cols_idx()[q]), a.values()[q] });
+			std::sort(row.begin(), row.end(), [](const std::pair<uint32_t, double>& x, const std::pair<uint32_t, double>& y) {
+				return x.first < y.first;
+			});
+			for (size_t k = 0; k < row.size(); k++) {
+				cols[ptr[i] + k] = row[k].first;
+				values[ptr[i] + k] = row[k].second;
+			}
+			ptr[i + 1] = ptr[i] + row.size();
+		}
+		return SparseMatrix(n, n, std::move(ptr), std::move(cols), std::move(values));
+	}
+
+	BandStats band_stats(const SparseMatrix& a) {
+		return band_stats(a, Permutation(a.rows()));
+	}
+
+	// -Лента и профиль P A P^T по ненулевым a
+	BandStats band_stats(const SparseMatrix& a, const Permutation& p) {
+		BandStats res;
+		size_t n = a.rows();
+		if (n != a.cols() || p.size() != n) return res;
+		std::vector<uint32_t> first(n);
+		for (size_t i = 0; i < n; i++) first[i] = (uint32_t)i;
+		double total = 0;
+		for (size_t i = 0; i < n; i++) {
+			size_t ni = p.position(i);
+			for (size_t q = a.row_ptr()[i]; q < a.row_ptr()[i + 1]; q++) {
+				size_t nj = p.position(a.cols_idx()[q]);
+				size_t d = ni > nj ? ni - nj : nj - ni;
+				res.bandwidth = std::max(res.bandwidth, d);
+				total += d;
+				if (nj < first[ni]) first[ni] = (uint32_t)nj;
+			}
+		}
+		for (size_t i = 0; i < n; i++) res.profile += i - first[i];
+		res.mean_distance = a.nnz() ? total / a.nnz() : 0;
+		return res;
+	}
+
+	// -Число ненулевых множителя Холецкого: дерево исключения и поддеревья строк
+	uint64_t cholesky_nnz(const SparseMatrix& a, const Permutation& p) {
+		MAT_VEC_SCOPE("cholesky_nnz");
+		size_t n = a.rows();
+		if (n != a.cols() || p.size() != n) return 0;
+		Adjacency g = symmetric_pattern(a);
+		std::vector<uint32_t> parent(n, NONE), ancestor(n, NONE);
+		for (size_t i = 0; i < n; i++) {
+			uint32_t old = p[i];
+			for (size_t q = g.ptr[old]; q < g.ptr[old + 1]; q++) {
+				uint32_t r = p.position(g.idx[q]);
+				if (r >= i) continue;
+				// подъём с сокращением пути к текущему корню
+				while (ancestor[r] != NONE && ancestor[r] != i) {
+					uint32_t next = ancestor[r];
+					ancestor[r] = (uint32_t)i;
+					r = next;
+				}
+				if (ancestor[r] == NONE) {
+					ancestor[r] = (uint32_t)i;
+					parent[r] = (uint32_t)i;
+				}
+			}
+		}
+		// строка i множителя -- объединение путей в дереве от её ненулевых до i
+		std::vector<uint32_t> mark(n, NONE);
+		uint64_t count = n;
+		for (size_t i = 0; i < n; i++) {
+			mark[i] = (uint32_t)i;
+			uint32_t old = p[i];
+			for (size_t q = g.ptr[old]; q < g.ptr[old + 1]; q++) {
+				uint32_t x = p.position(g.idx[q]);
+				if (x >= i) continue;
+				for (; mark[x] != i; x = parent[x]) {
+					mark[x] = (uint32_t)i;
+					count++;
+				}
+			}
+		}
+		return count;
+	}
+
+	PermutedVector::PermutedVector(const Vector& v, const Permutation& p) : _data(v.data), _p(p) {}
+	size_t PermutedVector::size() const { return _p.size(); }
+	double PermutedVector::operator[](size_t i) const { return _data[_p[i]]; }
+
+	Vector PermutedVector::copy() const {
+		Vector res(size(), 0);
+		for (size_t i = 0; i < size(); i++) res[i] = _data[_p[i]];
+		return res;
+	}
+
+	// -Возврат к исходному порядку
+	void scatter(const Vector& x, const Permutation& p, Vector& out) {
+		for (size_t i = 0; i < p.size(); i++) out[p[i]] = x[i];
+	}
+
+	PermutedMatrix::PermutedMatrix(const Matrix& m, const Permutation& p) : PermutedMatrix(m, p, p) {}
+
+	PermutedMatrix::PermutedMatrix(const Matrix& m, const Permutation& rows, const Permutation& cols)
+		: _rows(rows.size()), _cols(cols) {
+		for (size_t i = 0; i < rows.size(); i++) _rows[i] = m.a[rows[i]];
+	}
+
+	size_t PermutedMatrix::n_rows() const { return _rows.size(); }
+	size_t PermutedMatrix::n_cols() const { return _cols.size(); }
+	double PermutedMatrix::operator()(size_t i, size_t j) const { return _rows[i][_cols[j]]; }
+
+	MatrixRef PermutedMatrix::rows_view() const {
+		return { _rows.data(), 0, _rows.size(), _cols.size() };
+	}
+
+	Matrix PermutedMatrix::copy() const {
+		Matrix res(n_rows(), n_cols(), 0.0);
+		for (size_t i = 0; i < n_rows(); i++)
+			for (size_t j = 0; j < n_cols(); j++) res.a[i][j] = _rows[i][_cols[j]];
+		return res;
+	}
+
+} // namespace mat_vec
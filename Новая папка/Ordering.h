@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Base.h"
+#include "Gemm.h"
+#include "SparseMatrix.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mat_vec {
+
+	// Перестановка: на новом месте i стоит старый элемент (*this)[i]
+	class Permutation {
+	public:
+		Permutation() = default;
+
+		// Тождественная перестановка n элементов
+		explicit Permutation(size_t n);
+
+		// Из порядка старых номеров; valid() == false, если это не перестановка
+		explicit Permutation(std::vector<uint32_t> order);
+
+		bool valid() const;
+		size_t size() const;
+
+		// Старый номер элемента на новом месте i
+		uint32_t operator[](size_t i) const;
+
+		// Новое место старого элемента
+		uint32_t position(size_t old) const;
+
+		const std::vector<uint32_t>& order() const;
+		Permutation inverse() const;
+
+	private:
+		std::vector<uint32_t> _order;
+		std::vector<uint32_t> _position;
+		bool _valid = true;
+	};
+
+	// Переставляющие упорядочения симметричных разреженных матриц.
+	// Используется структура A + A^T, диагональ не учитывается.
+
+	// Обратный алгоритм Катхилла-Макки: уменьшает ширину ленты. Каждая
+	// компонента связности обходится в ширину от псевдопериферийной
+	// вершины (Джордж-Лю), соседи -- по возрастанию степени
+	Permutation rcm(const SparseMatrix& a);
+
+	// Приближённая минимальная степень (AMD): уменьшает заполнение при
+	// разложении Холецкого. Частный граф с поглощением элементов и
+	// приближённой внешней степенью; без склейки неразличимых вершин
+	Permutation amd(const SparseMatrix& a);
+
+	// P A P^T: элемент (i, j) результата -- элемент (p[i], p[j]) матрицы a
+	SparseMatrix permute(const SparseMatrix& a, const Permutation& p);
+
+	// Ширина ленты и профиль нижнего треугольника
+	struct BandStats {
+		size_t bandwidth = 0;           // max |i - j| по ненулевым
+		uint64_t profile = 0;           // сумма по строкам i - (первый столбец строки)
+		double mean_distance = 0;       // средний |i - j| по ненулевым
+	};
+
+	BandStats band_stats(const SparseMatrix& a);
+
+	// То же для P A P^T, без построения переставленной матрицы
+	BandStats band_stats(const SparseMatrix& a, const Permutation& p);
+
+	// Число ненулевых элементов множителя Холецкого L (с диагональю) для
+	// P A P^T -- символьно, через дерево исключения
+	uint64_t cholesky_nnz(const SparseMatrix& a, const Permutation& p);
+
+	// Вектор в переставленном порядке без копирования: элемент i -- v[p[i]].
+	// Перестановка копируется; v должен жить, пока жив вид
+	class PermutedVector {
+	public:
+		PermutedVector(const Vector& v, const Permutation& p);
+
+		size_t size() const;
+		double operator[](size_t i) const;
+
+		// Копия в новом порядке
+		Vector copy() const;
+
+	private:
+		const double* _data;
+		Permutation _p;
+	};
+
+	// out[p[i]] = x[i] -- возврат решения переставленной системы к исходному порядку
+	void scatter(const Vector& x, const Permutation& p, Vector& out);
+
+	// Матрица с переставленными строками и столбцами без копирования данных:
+	// элемент (i, j) -- m(rows[i], cols[j]). Хранятся указатели на строки m
+	// и копия перестановки столбцов: m должна жить, пока жив вид
+	class PermutedMatrix {
+	public:
+		// Симметричная перестановка P M P^T
+		PermutedMatrix(const Matrix& m, const Permutation& p);
+		PermutedMatrix(const Matrix& m, const Permutation& rows, const Permutation& cols);
+
+		size_t n_rows() const;
+		size_t n_cols() const;
+		double operator()(size_t i, size_t j) const;
+
+		// Окно для gemm и trsm с переставленными строками (P M);
+		// перестановка столбцов в нём не учитывается
+		MatrixRef rows_view() const;
+
+		Matrix copy() const;
+
+	private:
+		std::vector<double*> _rows;
+		Permutation _cols;
+	};
+
+} // namespace mat_vec
@@ -0,0 +1,287 @@
+#include "Parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Сколько раз свободный поток уступает процессор, прежде чем уснуть
+		const int SPIN = 16;
+
+		const size_t NO_WORKER = (size_t)-1;
+
+		// Пул и номер рабочего потока, в котором выполняется код
+		thread_local const ThreadPool* tls_pool = nullptr;
+		thread_local size_t tls_index = NO_WORKER;
+
+		// Начальная жертва для обхода чужих очередей
+		size_t next_victim() {
+			thread_local uint32_t x = 2463534242u ^ (uint32_t)(uintptr_t)&x;
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			return x;
+		}
+
+		uint64_t elapsed_ns(std::chrono::steady_clock::time_point since) {
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - since).count();
+		}
+	}
+
+	// -Создаёт пул из threads рабочих потоков
+	ThreadPool::ThreadPool(size_t threads) {
+		for (size_t i = 0; i < threads; i++) _queues.emplace_back(new Worker());
+		for (size_t i = 0; i < threads; i++)
+			_workers.emplace_back([this, i] { worker_loop(i); });
+	}
+
+	// -Останавливает потоки
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			_stop = true;
+		}
+		_cv.notify_all();
+		for (auto& w : _workers) w.join();
+	}
+
+	// -Общий пул
+	ThreadPool& ThreadPool::global() {
+		static ThreadPool pool([] {
+			const char* env = std::getenv("MAT_VEC_NUM_THREADS");
+			if (env) return (size_t)std::strtoul(env, nullptr, 10);
+			size_t n = std::thread::hardware_concurrency();
+			return n > 1 ? n : (size_t)1;
+		}());
+		return pool;
+	}
+
+	// -Число рабочих потоков
+	size_t ThreadPool::size() const { return _workers.size(); }
+
+	// -Ставит задачу в очередь
+	void ThreadPool::submit(std::function<void()> task) {
+		if (_workers.empty()) {
+			task();
+			return;
+		}
+		// счётчик растёт раньше, чем задача появится в очереди: уснувший
+		// поток увидит его и не пропустит задачу
+		_queued++;
+		size_t index = current();
+		if (index != NO_WORKER) {
+			Worker& w = *_queues[index];
+			std::lock_guard<std::mutex> guard(w.lock);
+			w.tasks.push_back(std::move(task));
+		}
+		else {
+			std::lock_guard<std::mutex> guard(_lock);
+			_tasks.push_back(std::move(task));
+		}
+		if (_sleeping.load() != 0) {
+			// поток, проверивший условие под _lock, уже ждёт на _cv
+			{ std::lock_guard<std::mutex> guard(_lock); }
+			_cv.notify_one();
+		}
+	}
+
+	// -Выполняет одну задачу в текущем потоке
+	bool ThreadPool::try_run_one() {
+		size_t index = current();
+		std::function<void()> task;
+		if (!find_task(index, task)) return false;
+		task();
+		if (index != NO_WORKER) _queues[index]->executed++;
+		return true;
+	}
+
+	// -Счётчики рабочих потоков
+	std::vector<WorkerStats> ThreadPool::stats() const {
+		std::vector<WorkerStats> res(_queues.size());
+		for (size_t i = 0; i < res.size(); i++) {
+			const Worker& w = *_queues[i];
+			res[i].tasks = w.executed.load();
+			res[i].steals = w.steals.load();
+			res[i].failed_steals = w.failed_steals.load();
+			res[i].idle_seconds = w.idle_ns.load() * 1e-9;
+		}
+		return res;
+	}
+
+	// -Обнуляет счётчики
+	void ThreadPool::reset_stats() {
+		for (auto& w : _queues) {
+			w->executed = 0;
+			w->steals = 0;
+			w->failed_steals = 0;
+			w->idle_ns = 0;
+		}
+	}
+
+	// -Номер рабочего потока этого пула, в котором выполняется код
+	size_t ThreadPool::current() const {
+		return tls_pool == this ? tls_index : NO_WORKER;
+	}
+
+	// -Своя очередь с конца, затем общая, затем чужие с начала
+	bool ThreadPool::find_task(size_t index, std::function<void()>& task) {
+		if (_queued.load() == 0) return false;
+		if (index != NO_WORKER) {
+			Worker& w = *_queues[index];
+			std::lock_guard<std::mutex> guard(w.lock);
+			if (!w.tasks.empty()) {
+				task = std::move(w.tasks.back());
+				w.tasks.pop_back();
+				_queued--;
+				return true;
+			}
+		}
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			if (!_tasks.empty()) {
+				task = std::move(_tasks.front());
+				_tasks.pop_front();
+				_queued--;
+				return true;
+			}
+		}
+		return steal(index, task);
+	}
+
+	// -Забирает самую старую задачу из чужой очереди
+	bool ThreadPool::steal(size_t index, std::function<void()>& task) {
+		size_t n = _queues.size();
+		size_t first = next_victim() % n;
+		for (size_t k = 0; k < n; k++) {
+			size_t victim = (first + k) % n;
+			if (victim == index) continue;
+			Worker& w = *_queues[victim];
+			std::lock_guard<std::mutex> guard(w.lock);
+			if (w.tasks.empty()) continue;
+			task = std::move(w.tasks.front());
+			w.tasks.pop_front();
+			_queued--;
+			if (index != NO_WORKER) _queues[index]->steals++;
+			return true;
+		}
+		if (index != NO_WORKER) _queues[index]->failed_steals++;
+		return false;
+	}
+
+	void ThreadPool::worker_loop(size_t index) {
+		tls_pool = this;
+		tls_index = index;
+		Worker& self = *_queues[index];
+		std::function<void()> task;
+		for (;;) {
+			if (find_task(index, task)) {
+				task();
+				task = nullptr;
+				self.executed++;
+				continue;
+			}
+			auto idle = std::chrono::steady_clock::now();
+			bool found = false;
+			for (int i = 0; i < SPIN && !found; i++) {
+				std::this_thread::yield();
+				found = find_task(index, task);
+			}
+			if (!found) {
+				std::unique_lock<std::mutex> guard(_lock);
+				_sleeping++;
+				_cv.wait(guard, [this] { return _stop || _queued.load() != 0; });
+				_sleeping--;
+				if (_stop && _queued.load() == 0) {
+					self.idle_ns += elapsed_ns(idle);
+					return;
+				}
+			}
+			self.idle_ns += elapsed_ns(idle);
+			if (found) {
+				task();
+				task = nullptr;
+				self.executed++;
+			}
+		}
+	}
+
+	TaskGroup::TaskGroup(ThreadPool& pool) : _pool(pool) {}
+
+	TaskGroup::~TaskGroup() {
+		while (_pending.load() != 0)
+			if (!_pool.try_run_one()) std::this_thread::yield();
+	}
+
+	// -Запускает задачу в пуле
+	void TaskGroup::run(std::function<void()> task) {
+		_pending++;
+		_pool.submit([this, task = std::move(task)] {
+			try {
+				task();
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> guard(_lock);
+				if (!_error) _error = std::current_exception();
+			}
+			_pending--;
+		});
+	}
+
+	// -Дожидается всех задач группы
+	void TaskGroup::wait() {
+		while (_pending.load() != 0)
+			if (!_pool.try_run_one()) std::this_thread::yield();
+		std::exception_ptr error;
+		{
+			std::lock_guard<std::mutex> guard(_lock);
+			std::swap(error, _error);
+		}
+		if (error) std::rethrow_exception(error);
+	}
+
+	// -Выполняет left и right, возможно параллельно
+	void fork_join(const std::function<void()>& left, const std::function<void()>& right, ThreadPool& pool) {
+		if (pool.size() == 0) {
+			left();
+			right();
+			return;
+		}
+		TaskGroup group(pool);
+		group.run([&right] { right(); });
+		left();
+		group.wait();
+	}
+
+	// -Параллельный цикл по отрезкам
+	void parallel_for(size_t begin, size_t end, size_t grain,
+		const std::function<void(size_t, size_t)>& body, ThreadPool& pool) {
+		if (begin >= end) return;
+		size_t n = end - begin;
+		if (grain == 0) grain = 1;
+		if (pool.size() == 0 || n <= grain) {
+			body(begin, end);
+			return;
+		}
+		size_t chunk = std::max(grain, (n + pool.size() * 4 - 1) / (pool.size() * 4));
+		// split объявлен раньше группы: при исключении из body группа
+		// дожидается задач, которые его вызывают
+		std::function<void(size_t, size_t)> split;
+		TaskGroup group(pool);
+		// правая половина уходит в очередь, левая делится дальше; отрезки
+		// кратны chunk, последний -- от chunk до 2 chunk
+		split = [&](size_t from, size_t to) {
+			while (to - from >= 2 * chunk) {
+				size_t mid = from + (to - from) / chunk / 2 * chunk;
+				group.run([&split, mid, to] { split(mid, to); });
+				to = mid;
+			}
+			body(from, to);
+		};
+		split(begin, end);
+		group.wait();
+	}
+
+} // namespace mat_vec
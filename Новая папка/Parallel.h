@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mat_vec {
+
+	// Счётчики одного рабочего потока
+	struct WorkerStats {
+		uint64_t tasks = 0;          // выполнено задач
+		uint64_t steals = 0;         // из них взято из чужих очередей
+		uint64_t failed_steals = 0;  // обходов чужих очередей, не нашедших работы
+		double idle_seconds = 0;     // время без работы (ожидание и сон)
+	};
+
+	// Пул рабочих потоков библиотеки с перехватом работы.
+	//
+	// У каждого рабочего потока своя очередь: задачи, поставленные из него,
+	// кладутся в конец и берутся им же с конца (последняя поставленная --
+	// первой, её данные ещё в кэше). Свободный поток забирает задачи с
+	// начала чужих очередей -- это самые старые и обычно самые крупные
+	// куски рекурсивного разбиения. Задачи из посторонних потоков попадают
+	// в общую очередь
+	class ThreadPool {
+	public:
+		// Создаёт пул из threads рабочих потоков (0 -- без потоков, всё выполняет вызывающий)
+		explicit ThreadPool(size_t threads);
+
+		// Останавливает потоки, дожидаясь уже поставленных задач
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// Общий пул; размер -- std::thread::hardware_concurrency()
+		// или значение переменной окружения MAT_VEC_NUM_THREADS
+		static ThreadPool& global();
+
+		// Число рабочих потоков
+		size_t size() const;
+
+		// Ставит задачу в очередь
+		void submit(std::function<void()> task);
+
+		// Выполняет одну задачу в текущем потоке: свою, из общей очереди
+		// или чужую. Возвращает false, если задач нет
+		bool try_run_one();
+
+		// Счётчики по рабочим потокам (элемент i -- поток i)
+		std::vector<WorkerStats> stats() const;
+		void reset_stats();
+
+	private:
+		struct Worker {
+			std::mutex lock;
+			std::deque<std::function<void()>> tasks;
+			std::atomic<uint64_t> executed{ 0 };
+			std::atomic<uint64_t> steals{ 0 };
+			std::atomic<uint64_t> failed_steals{ 0 };
+			std::atomic<uint64_t> idle_ns{ 0 };
+		};
+
+		void worker_loop(size_t index);
+		size_t current() const;
+		bool find_task(size_t index, std::function<void()>& task);
+		bool steal(size_t index, std::function<void()>& task);
+
+		std::vector<std::unique_ptr<Worker>> _queues;
+		std::vector<std::thread> _workers;
+		std::deque<std::function<void()>> _tasks;   // общая очередь
+		std::mutex _lock;
+		std::condition_variable _cv;
+		std::atomic<size_t> _queued{ 0 };           // задач во всех очередях
+		std::atomic<size_t> _sleeping{ 0 };
+		bool _stop = false;
+	};
+
+	// Группа задач, завершение которых можно дождаться.
+	// Ожидающий поток сам выполняет задачи из очереди, поэтому
+	// вложенные группы не блокируют пул.
+	class TaskGroup {
+	public:
+		explicit TaskGroup(ThreadPool& pool = ThreadPool::global());
+
+		// Дожидается незавершённых задач
+		~TaskGroup();
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		// Запускает задачу в пуле
+		void run(std::function<void()> task);
+
+		// Дожидается всех задач группы; пробрасывает первое исключение
+		void wait();
+
+	private:
+		ThreadPool& _pool;
+		std::atomic<size_t> _pending{ 0 };
+		std::mutex _lock;
+		std::exception_ptr _error;
+	};
+
+	// Выполняет left и right, возможно параллельно: right ставится в очередь
+	// текущего потока, left выполняется сразу. Если right никто не забрал,
+	// его выполняет тот же поток; иначе он, ожидая, берёт другую работу.
+	// Пробрасывает первое исключение
+	void fork_join(const std::function<void()>& left, const std::function<void()>& right,
+		ThreadPool& pool = ThreadPool::global());
+
+	// Вызывает body(from, to) для отрезков [begin, end) длиной не меньше grain,
+	// распределяя их по потокам пула. Диапазон делится пополам рекурсивно,
+	// так что свободные потоки забирают крупные половины
+	void parallel_for(size_t begin, size_t end, size_t grain,
+		const std::function<void(size_t, size_t)>& body, ThreadPool& pool = ThreadPool::global());
+
+} // namespace mat_vec
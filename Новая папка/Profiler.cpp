@@ -0,0 +1,191 @@
+#include "Profiler.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace mat_vec {
+	namespace profiler {
+
+		namespace {
+
+			struct TraceEvent {
+				const char* name;
+				double start_us;
+				double duration_us;
+			};
+
+			// Счётчики одного потока. Пишет в них только владелец,
+			// snapshot() читает под mutex'ом.
+			struct ThreadState {
+				size_t tid = 0;
+				std::atomic<uint64_t> allocations{ 0 };
+				std::atomic<uint64_t> bytes_allocated{ 0 };
+				std::atomic<uint64_t> bytes_copied{ 0 };
+				std::atomic<uint64_t> flops{ 0 };
+				std::mutex lock;
+				std::vector<std::pair<const char*, OpStats>> ops;
+				std::vector<TraceEvent> events;
+			};
+
+			// Предел числа событий трассировки на поток
+			const size_t MAX_EVENTS = 1 << 20;
+
+			std::mutex registry_lock;
+			std::vector<std::shared_ptr<ThreadState>> registry;
+			std::atomic<TraceHook> trace_hook{ nullptr };
+			std::atomic<bool> tracing{ false };
+
+			const auto epoch = std::chrono::steady_clock::now();
+
+			double now_us() {
+				return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+			}
+
+			ThreadState& local() {
+				thread_local std::shared_ptr<ThreadState> state;
+				if (!state) {
+					state = std::make_shared<ThreadState>();
+					std::lock_guard<std::mutex> guard(registry_lock);
+					state->tid = registry.size();
+					registry.push_back(state);
+				}
+				return *state;
+			}
+
+			void add_op(Counters& c, const OpStats& op) {
+				for (auto& o : c.ops) {
+					if (o.name == op.name) {
+						o.calls += op.calls;
+						o.total_us += op.total_us;
+						return;
+					}
+				}
+				c.ops.push_back(op);
+			}
+
+			void write_escaped(std::ofstream& out, const char* s) {
+				for (; *s; ++s) {
+					if (*s == '"' || *s == '\\') out << '\\';
+					out << *s;
+				}
+			}
+		}
+
+		bool enabled() {
+#ifdef MAT_VEC_PROFILE
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		void count_alloc(uint64_t bytes) {
+			ThreadState& s = local();
+			s.allocations.fetch_add(1, std::memory_order_relaxed);
+			s.bytes_allocated.fetch_add(bytes, std::memory_order_relaxed);
+		}
+
+		void count_copy(uint64_t bytes) {
+			local().bytes_copied.fetch_add(bytes, std::memory_order_relaxed);
+		}
+
+		void count_flops(uint64_t n) {
+			local().flops.fetch_add(n, std::memory_order_relaxed);
+		}
+
+		Snapshot snapshot() {
+			Snapshot res;
+			std::lock_guard<std::mutex> guard(registry_lock);
+			for (auto& s : registry) {
+				Counters c;
+				c.allocations = s->allocations.load(std::memory_order_relaxed);
+				c.bytes_allocated = s->bytes_allocated.load(std::memory_order_relaxed);
+				c.bytes_copied = s->bytes_copied.load(std::memory_order_relaxed);
+				c.flops = s->flops.load(std::memory_order_relaxed);
+				{
+					std::lock_guard<std::mutex> ops_guard(s->lock);
+					for (auto& op : s->ops) c.ops.push_back(op.second);
+				}
+				res.total.allocations += c.allocations;
+				res.total.bytes_allocated += c.bytes_allocated;
+				res.total.bytes_copied += c.bytes_copied;
+				res.total.flops += c.flops;
+				for (auto& op : c.ops) add_op(res.total, op);
+				res.threads.push_back(std::move(c));
+			}
+			return res;
+		}
+
+		void reset() {
+			std::lock_guard<std::mutex> guard(registry_lock);
+			for (auto& s : registry) {
+				s->allocations = 0;
+				s->bytes_allocated = 0;
+				s->bytes_copied = 0;
+				s->flops = 0;
+				std::lock_guard<std::mutex> ops_guard(s->lock);
+				s->ops.clear();
+				s->events.clear();
+			}
+		}
+
+		void set_trace_hook(TraceHook hook) { trace_hook = hook; }
+
+		void set_tracing(bool on) { tracing = on; }
+
+		bool write_chrome_trace(const std::string& path) {
+			std::ofstream out(path);
+			if (!out) return false;
+			out << "{\"traceEvents\":[";
+			bool first = true;
+			std::lock_guard<std::mutex> guard(registry_lock);
+			for (auto& s : registry) {
+				std::lock_guard<std::mutex> ops_guard(s->lock);
+				for (auto& e : s->events) {
+					if (!first) out << ',';
+					first = false;
+					out << "\n{\"name\":\"";
+					write_escaped(out, e.name);
+					out << "\",\"cat\":\"mat_vec\",\"ph\":\"X\",\"pid\":0,\"tid\":" << s->tid
+						<< ",\"ts\":" << e.start_us << ",\"dur\":" << e.duration_us << '}';
+				}
+			}
+			out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+			return static_cast<bool>(out);
+		}
+
+		Scope::Scope(const char* name) : _name(name), _start(now_us()) {}
+
+		Scope::~Scope() {
+			double duration = now_us() - _start;
+			ThreadState& s = local();
+			{
+				std::lock_guard<std::mutex> guard(s.lock);
+				bool found = false;
+				for (auto& op : s.ops) {
+					if (op.first == _name || std::strcmp(op.first, _name) == 0) {
+						op.second.calls++;
+						op.second.total_us += duration;
+						found = true;
+						break;
+					}
+				}
+				if (!found) {
+					OpStats st;
+					st.name = _name;
+					st.calls = 1;
+					st.total_us = duration;
+					s.ops.emplace_back(_name, st);
+				}
+				if (tracing.load(std::memory_order_relaxed) && s.events.size() < MAX_EVENTS)
+					s.events.push_back({ _name, _start, duration });
+			}
+			TraceHook hook = trace_hook.load(std::memory_order_relaxed);
+			if (hook) hook(_name, _start, duration);
+		}
+
+	} // namespace profiler
+} // namespace mat_vec
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Инструментирование операций mat_vec.
+// Включается определением MAT_VEC_PROFILE при сборке; без него все макросы
+// ниже раскрываются в пустые выражения и ничего не стоят.
+
+#ifdef MAT_VEC_PROFILE
+#define MAT_VEC_COUNT_ALLOC(bytes) ::mat_vec::profiler::count_alloc(bytes)
+#define MAT_VEC_COUNT_COPY(bytes) ::mat_vec::profiler::count_copy(bytes)
+#define MAT_VEC_COUNT_FLOPS(n) ::mat_vec::profiler::count_flops(n)
+#define MAT_VEC_SCOPE_CAT2(a, b) a##b
+#define MAT_VEC_SCOPE_CAT(a, b) MAT_VEC_SCOPE_CAT2(a, b)
+#define MAT_VEC_SCOPE(name) ::mat_vec::profiler::Scope MAT_VEC_SCOPE_CAT(_mat_vec_scope_, __LINE__)(name)
+#else
+#define MAT_VEC_COUNT_ALLOC(bytes) ((void)0)
+#define MAT_VEC_COUNT_COPY(bytes) ((void)0)
+#define MAT_VEC_COUNT_FLOPS(n) ((void)0)
+#define MAT_VEC_SCOPE(name) ((void)0)
+#endif
+
+namespace mat_vec {
+	namespace profiler {
+
+		// Суммарное время и число вызовов одной операции
+		struct OpStats {
+			std::string name;
+			uint64_t calls = 0;
+			double total_us = 0;
+		};
+
+		// Счётчики одного потока (или сумма по всем потокам)
+		struct Counters {
+			uint64_t allocations = 0;
+			uint64_t bytes_allocated = 0;
+			uint64_t bytes_copied = 0;
+			uint64_t flops = 0;
+			std::vector<OpStats> ops;
+		};
+
+		// Снимок счётчиков: итог и разбивка по потокам
+		struct Snapshot {
+			Counters total;
+			std::vector<Counters> threads;
+		};
+
+		// Обработчик, вызываемый по завершении каждой измеряемой операции
+		using TraceHook = void (*)(const char* name, double start_us, double duration_us);
+
+		// true, если библиотека собрана с MAT_VEC_PROFILE
+		bool enabled();
+
+		void count_alloc(uint64_t bytes);
+		void count_copy(uint64_t bytes);
+		void count_flops(uint64_t n);
+
+		// Возвращает накопленные счётчики всех потоков
+		Snapshot snapshot();
+
+		// Обнуляет счётчики и буфер трассировки
+		void reset();
+
+		// Устанавливает обработчик завершения операций (nullptr -- отключить)
+		void set_trace_hook(TraceHook hook);
+
+		// Включает запись событий для Chrome trace (chrome://tracing)
+		void set_tracing(bool on);
+
+		// Записывает накопленные события в формате Chrome trace JSON
+		bool write_chrome_trace(const std::string& path);
+
+		// Измеряет время жизни объекта как одну операцию name
+		class Scope {
+		public:
+			explicit Scope(const char* name);
+			~Scope();
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			const char* _name;
+			double _start;
+		};
+
+	} // namespace profiler
+} // namespace mat_vec
@@ -0,0 +1,280 @@
+#include "Quantized.h"
+#include "Matrix.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Reduce.h"
+#include "Vector.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#define MAT_VEC_VNNI
+#endif
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define MAT_VEC_F16C
+#endif
+
+namespace mat_vec {
+
+	namespace {
+
+		// Строк на задачу пула
+		const size_t ROW_GRAIN = 16;
+
+		// Строк A, которые проходят по одной строке B^T подряд в int8 gemm
+		const size_t ROW_BLOCK = 8;
+
+		uint32_t float_bits(float f) {
+			uint32_t b;
+			std::memcpy(&b, &f, sizeof(b));
+			return b;
+		}
+
+		float bits_float(uint32_t b) {
+			float f;
+			std::memcpy(&f, &b, sizeof(f));
+			return f;
+		}
+
+		// Симметричное квантование n чисел (с шагом stride) в [-127, 127] плюс offset;
+		// возвращает масштаб
+		template <class T>
+		float quantize(const double* x, size_t stride, size_t n, T* q, int offset) {
+			double m = 0;
+			for (size_t i = 0; i < n; i++) m = std::max(m, std::fabs(x[i * stride]));
+			double inv = m > 0 ? 127 / m : 0;
+			for (size_t i = 0; i < n; i++) q[i] = (T)(std::lround(x[i * stride] * inv) + offset);
+			return (float)(m / 127);
+		}
+
+		// Сумма u[k] * s[k] для беззнаковых u и знаковых s
+		int32_t dot_u8s8(const uint8_t* u, const int8_t* s, size_t n) {
+			int32_t r = 0;
+			size_t k = 0;
+#ifdef MAT_VEC_VNNI
+			__m512i acc = _mm512_setzero_si512();
+			for (; k + 64 <= n; k += 64)
+				acc = _mm512_dpbusd_epi32(acc, _mm512_loadu_si512(u + k), _mm512_loadu_si512(s + k));
+			r = _mm512_reduce_add_epi32(acc);
+#endif
+			for (; k < n; k++) r += (int32_t)u[k] * s[k];
+			return r;
+		}
+
+		// Преобразует n чисел fp16 во float
+		void halves_to_floats(const uint16_t* h, float* f, size_t n) {
+			size_t i = 0;
+#ifdef MAT_VEC_F16C
+			for (; i + 8 <= n; i += 8)
+				_mm256_storeu_ps(f + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i))));
+#endif
+			for (; i < n; i++) f[i] = half_to_float(h[i]);
+		}
+
+		template <class Q>
+		QuantizedReport compare(const Q& q, const Matrix& reference, const Vector& x, size_t repeats) {
+			typedef std::chrono::steady_clock clock;
+			repeats = std::max<size_t>(repeats, 1);
+			Vector yq = gemv(q, x), y = reference * x;
+			clock::time_point t0 = clock::now();
+			for (size_t r = 0; r < repeats; r++) yq = gemv(q, x);
+			clock::time_point t1 = clock::now();
+			for (size_t r = 0; r < repeats; r++) y = reference * x;
+			clock::time_point t2 = clock::now();
+
+			QuantizedReport rep;
+			rep.seconds = std::chrono::duration<double>(t1 - t0).count() / repeats;
+			rep.double_seconds = std::chrono::duration<double>(t2 - t1).count() / repeats;
+			rep.speedup = rep.seconds > 0 ? rep.double_seconds / rep.seconds : 0;
+			Vector diff = yq - y;
+			rep.max_abs_error = norm_inf(diff);
+			double ny = y.norm();
+			rep.relative_error = ny > 0 ? diff.norm() / ny : diff.norm();
+			rep.bytes = q.bytes();
+			rep.double_bytes = (size_t)reference._size.first * reference._size.second * sizeof(double);
+			return rep;
+		}
+	}
+
+	// -float -> half: нормальные числа -- сдвигом порядка с округлением,
+	// малые -- сложением с 0.5f, которое выравнивает мантиссу
+	uint16_t float_to_half(float f) {
+		uint32_t x = float_bits(f);
+		uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+		x &= 0x7fffffff;
+		if (x >= 0x7f800000) return sign | 0x7c00 | (x > 0x7f800000 ? 0x200 : 0);
+		if (x >= 0x477ff000) return sign | 0x7c00;
+		if (x < 0x38800000) return sign | (uint16_t)(float_bits(bits_float(x) + 0.5f) - 0x3f000000);
+		uint32_t odd = (x >> 13) & 1;
+		x += 0xc8000fff + odd;
+		return sign | (uint16_t)(x >> 13);
+	}
+
+	// -half -> float
+	float half_to_float(uint16_t h) {
+		uint32_t o = (uint32_t)(h & 0x7fff) << 13;
+		uint32_t exp = o & 0x0f800000;
+		o += (127 - 15) << 23;
+		if (exp == 0x0f800000) o += (128 - 16) << 23;
+		else if (exp == 0) o = float_bits(bits_float(o + (1 << 23)) - bits_float(113 << 23));
+		return bits_float(o | (uint32_t)(h & 0x8000) << 16);
+	}
+
+	// ---- Int8Matrix ----
+
+	Int8Matrix::Int8Matrix(const Matrix& m)
+		: _rows(m._size.first), _cols(m._size.second), _data(_rows * _cols), _scales(_rows), _row_sums(_rows) {
+		MAT_VEC_SCOPE("Int8Matrix::Int8Matrix");
+		parallel_for(0, _rows, ROW_GRAIN, [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; i++) {
+				int8_t* q = &_data[i * _cols];
+				_scales[i] = quantize(m.a[i], 1, _cols, q, 0);
+				int32_t s = 0;
+				for (size_t j = 0; j < _cols; j++) s += q[j];
+				_row_sums[i] = s;
+			}
+		});
+	}
+
+	std::pair<size_t, size_t> Int8Matrix::shape() const { return { _rows, _cols }; }
+	const int8_t* Int8Matrix::row(size_t i) const { return &_data[i * _cols]; }
+	float Int8Matrix::scale(size_t i) const { return _scales[i]; }
+
+	Matrix Int8Matrix::dequantize() const {
+		Matrix m(_rows, _cols, 0.0);
+		for (size_t i = 0; i < _rows; i++)
+			for (size_t j = 0; j < _cols; j++) m.a[i][j] = (double)_scales[i] * _data[i * _cols + j];
+		return m;
+	}
+
+	size_t Int8Matrix::bytes() const {
+		return _data.size() + _scales.size() * sizeof(float) + _row_sums.size() * sizeof(int32_t);
+	}
+
+	// -y_i = s_a(i) s_x (sum (q_x + 128) q_a - 128 sum q_a)
+	Vector gemv(const Int8Matrix& a, const Vector& x) {
+		MAT_VEC_SCOPE("gemv(int8)");
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)a._rows * a._cols);
+		std::vector<uint8_t> u(a._cols);
+		float sx = quantize(x.data, 1, a._cols, u.data(), 128);
+		Vector y(a._rows, 0);
+		parallel_for(0, a._rows, ROW_GRAIN * 16, [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; i++) {
+				int32_t acc = dot_u8s8(u.data(), a.row(i), a._cols) - 128 * a._row_sums[i];
+				y.data[i] = (double)acc * a._scales[i] * sx;
+			}
+		});
+		return y;
+	}
+
+	// -Столбцы B квантуются и транспонируются: C_ij = s_a(i) s_b(j) (B^T_j . A_i)
+	Matrix gemm(const Int8Matrix& a, const Matrix& b) {
+		MAT_VEC_SCOPE("gemm(int8)");
+		size_t m = a._rows, k = a._cols, n = b._size.second;
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)m * n * k);
+		std::vector<uint8_t> bt(n * k);
+		std::vector<float> sb(n);
+		parallel_for(0, n, ROW_GRAIN, [&](size_t from, size_t to) {
+			for (size_t j = from; j < to; j++) sb[j] = k ? quantize(b.a[0] + j, n, k, &bt[j * k], 128) : 0;
+		});
+		Matrix c(m, n, 0.0);
+		size_t blocks = (m + ROW_BLOCK - 1) / ROW_BLOCK;
+		parallel_for(0, blocks, 1, [&](size_t from, size_t to) {
+			for (size_t blk = from; blk < to; blk++) {
+				size_t i0 = blk * ROW_BLOCK, i1 = std::min(m, i0 + ROW_BLOCK);
+				for (size_t j = 0; j < n; j++)
+					for (size_t i = i0; i < i1; i++) {
+						int32_t acc = dot_u8s8(&bt[j * k], a.row(i), k) - 128 * a._row_sums[i];
+						c.a[i][j] = (double)acc * a._scales[i] * sb[j];
+					}
+			}
+		});
+		return c;
+	}
+
+	// ---- HalfMatrix ----
+
+	HalfMatrix::HalfMatrix(const Matrix& m) : _rows(m._size.first), _cols(m._size.second), _data(_rows * _cols) {
+		MAT_VEC_SCOPE("HalfMatrix::HalfMatrix");
+		for (size_t i = 0; i < _rows; i++)
+			for (size_t j = 0; j < _cols; j++) _data[i * _cols + j] = float_to_half((float)m.a[i][j]);
+	}
+
+	std::pair<size_t, size_t> HalfMatrix::shape() const { return { _rows, _cols }; }
+	const uint16_t* HalfMatrix::row(size_t i) const { return &_data[i * _cols]; }
+	size_t HalfMatrix::bytes() const { return _data.size() * sizeof(uint16_t); }
+
+	Matrix HalfMatrix::dequantize() const {
+		Matrix m(_rows, _cols, 0.0);
+		for (size_t i = 0; i < _rows; i++)
+			for (size_t j = 0; j < _cols; j++) m.a[i][j] = half_to_float(_data[i * _cols + j]);
+		return m;
+	}
+
+	// -Строка A переводится во float кусками, сумма -- в 8 float-дорожках
+	Vector gemv(const HalfMatrix& a, const Vector& x) {
+		MAT_VEC_SCOPE("gemv(fp16)");
+		size_t m = a.shape().first, n = a.shape().second;
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)m * n);
+		std::vector<float> xf(x.data, x.data + n);
+		Vector y(m, 0);
+		parallel_for(0, m, ROW_GRAIN * 16, [&](size_t from, size_t to) {
+			const size_t CHUNK = 256;
+			float buf[CHUNK];
+			for (size_t i = from; i < to; i++) {
+				const uint16_t* r = a.row(i);
+				float acc[8] = {};
+				for (size_t k0 = 0; k0 < n; k0 += CHUNK) {
+					size_t len = std::min(CHUNK, n - k0);
+					halves_to_floats(r + k0, buf, len);
+					const float* xk = xf.data() + k0;
+					size_t k = 0;
+					for (; k + 8 <= len; k += 8)
+						for (size_t l = 0; l < 8; l++) acc[l] += buf[k + l] * xk[k + l];
+					for (; k < len; k++) acc[0] += buf[k] * xk[k];
+				}
+				y.data[i] = ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+			}
+		});
+		return y;
+	}
+
+	// -B переводится во float один раз, строки C накапливаются во float
+	Matrix gemm(const HalfMatrix& a, const Matrix& b) {
+		MAT_VEC_SCOPE("gemm(fp16)");
+		size_t m = a.shape().first, k = a.shape().second, n = b._size.second;
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)m * n * k);
+		std::vector<float> bf(k * n);
+		for (size_t p = 0; p < k; p++)
+			for (size_t j = 0; j < n; j++) bf[p * n + j] = (float)b.a[p][j];
+		Matrix c(m, n, 0.0);
+		parallel_for(0, m, ROW_GRAIN, [&](size_t from, size_t to) {
+			std::vector<float> ar(k), cr(n);
+			for (size_t i = from; i < to; i++) {
+				halves_to_floats(a.row(i), ar.data(), k);
+				std::fill(cr.begin(), cr.end(), 0.0f);
+				for (size_t p = 0; p < k; p++) {
+					float ap = ar[p];
+					const float* br = &bf[p * n];
+					for (size_t j = 0; j < n; j++) cr[j] += ap * br[j];
+				}
+				for (size_t j = 0; j < n; j++) c.a[i][j] = cr[j];
+			}
+		});
+		return c;
+	}
+
+	QuantizedReport compare_gemv(const Int8Matrix& q, const Matrix& reference, const Vector& x, size_t repeats) {
+		return compare(q, reference, x, repeats);
+	}
+
+	QuantizedReport compare_gemv(const HalfMatrix& q, const Matrix& reference, const Vector& x, size_t repeats) {
+		return compare(q, reference, x, repeats);
+	}
+
+} // namespace mat_vec
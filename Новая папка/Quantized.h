@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Base.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace mat_vec {
+
+	// Преобразования float <-> IEEE half (округление к ближайшему чётному,
+	// денормализованные числа, inf и NaN сохраняются)
+	uint16_t float_to_half(float f);
+	float half_to_float(uint16_t h);
+
+	// Матрица int8 с симметричным масштабом на строку:
+	// a[i][j] ~ scale(i) * q[i][j], q в [-127, 127]
+	class Int8Matrix {
+	public:
+		explicit Int8Matrix(const Matrix& m);
+
+		std::pair<size_t, size_t> shape() const;
+		const int8_t* row(size_t i) const;
+		float scale(size_t i) const;
+
+		// Обратное преобразование в double
+		Matrix dequantize() const;
+
+		// Память под данные и масштабы
+		size_t bytes() const;
+
+	private:
+		friend Vector gemv(const Int8Matrix& a, const Vector& x);
+		friend Matrix gemm(const Int8Matrix& a, const Matrix& b);
+
+		size_t _rows;
+		size_t _cols;
+		std::vector<int8_t> _data;
+		std::vector<float> _scales;
+		std::vector<int32_t> _row_sums; // суммы q по строкам для ядра u8 x s8
+	};
+
+	// Матрица в половинной точности (fp16)
+	class HalfMatrix {
+	public:
+		explicit HalfMatrix(const Matrix& m);
+
+		std::pair<size_t, size_t> shape() const;
+		const uint16_t* row(size_t i) const;
+		Matrix dequantize() const;
+		size_t bytes() const;
+
+	private:
+		size_t _rows;
+		size_t _cols;
+		std::vector<uint16_t> _data;
+	};
+
+	// y = A x. Для int8 вектор x квантуется целиком с одним масштабом,
+	// произведения накапливаются в int32 (AVX-512 VNNI, если доступен при
+	// сборке, иначе обычный цикл). Для fp16 накопление во float
+	Vector gemv(const Int8Matrix& a, const Vector& x);
+	Vector gemv(const HalfMatrix& a, const Vector& x);
+
+	// C = A B. Для int8 столбцы B квантуются каждый со своим масштабом
+	Matrix gemm(const Int8Matrix& a, const Matrix& b);
+	Matrix gemm(const HalfMatrix& a, const Matrix& b);
+
+	// Сравнение квантованного gemv с double-путём (Matrix * Vector)
+	struct QuantizedReport {
+		double seconds;         // квантованный gemv, на один вызов
+		double double_seconds;  // Matrix * Vector, на один вызов
+		double speedup;         // double_seconds / seconds
+		double max_abs_error;
+		double relative_error;  // ||y_q - y||_2 / ||y||_2
+		size_t bytes;
+		size_t double_bytes;
+	};
+
+	QuantizedReport compare_gemv(const Int8Matrix& q, const Matrix& reference, const Vector& x, size_t repeats = 10);
+	QuantizedReport compare_gemv(const HalfMatrix& q, const Matrix& reference, const Vector& x, size_t repeats = 10);
+
+} // namespace mat_vec
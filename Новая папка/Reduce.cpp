@@ -0,0 +1,257 @@
+#include "Reduce.h"
+#include "Vector.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Число независимых сумм внутри блока
+		const size_t LANES = 8;
+
+		// Блоков на одну задачу пула
+		const size_t GRAIN = 16;
+
+		// Сумма с поправкой: точное значение ~ hi + lo
+		struct Partial {
+			double hi;
+			double lo;
+		};
+
+		// hi + lo = a + b точно
+		inline void two_sum(double a, double b, double& hi, double& lo) {
+			hi = a + b;
+			double bp = hi - a;
+			lo = (a - (hi - bp)) + (b - bp);
+		}
+
+		Partial combine(const Partial& a, const Partial& b) {
+			Partial r;
+			double e;
+			two_sum(a.hi, b.hi, r.hi, e);
+			r.lo = a.lo + b.lo + e;
+			return r;
+		}
+
+		// Частичная сумма блока: x[i] или x[i] * y[i]
+		Partial chunk_sum(const double* x, const double* y, size_t n, Summation mode) {
+			double s[LANES] = {}, c[LANES] = {};
+			size_t i = 0;
+			if (mode == Summation::PAIRWISE) {
+				for (; i + LANES <= n; i += LANES)
+					for (size_t l = 0; l < LANES; l++) s[l] += y ? x[i + l] * y[i + l] : x[i + l];
+				for (size_t l = 0; i < n; i++, l++) s[l] += y ? x[i] * y[i] : x[i];
+				// попарное сложение дорожек
+				for (size_t w = LANES / 2; w > 0; w /= 2)
+					for (size_t l = 0; l < w; l++) s[l] += s[l + w];
+				return { s[0], 0 };
+			}
+			for (; i < n; i += LANES) {
+				size_t m = std::min(LANES, n - i);
+				for (size_t l = 0; l < m; l++) {
+					double v = x[i + l], err = 0;
+					if (y) {
+						double p = v * y[i + l];
+						err = std::fma(v, y[i + l], -p);
+						v = p;
+					}
+					double hi, lo;
+					two_sum(s[l], v, hi, lo);
+					s[l] = hi;
+					c[l] += lo + err;
+				}
+			}
+			Partial r = { s[0], c[0] };
+			for (size_t l = 1; l < LANES; l++) r = combine(r, { s[l], c[l] });
+			return r;
+		}
+
+		// Считает chunk(begin, end) для блоков длины REDUCE_CHUNK (параллельно в pool)
+		// и объединяет результаты merge по фиксированному двоичному дереву.
+		// Один блок считается сразу, без буфера и пула
+		template <class T, class Chunk, class Merge>
+		T chunk_reduce(size_t n, const Chunk& chunk, const Merge& merge, ThreadPool& pool) {
+			size_t chunks = (n + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+			if (chunks == 0) return T();
+			if (chunks == 1) return chunk(0, n);
+			std::vector<T> p(chunks);
+			parallel_for(0, chunks, GRAIN, [&](size_t from, size_t to) {
+				for (size_t c = from; c < to; c++)
+					p[c] = chunk(c * REDUCE_CHUNK, std::min(n, (c + 1) * REDUCE_CHUNK));
+			}, pool);
+			for (size_t w = 1; w < chunks; w *= 2)
+				for (size_t i = 0; i + w < chunks; i += 2 * w) p[i] = merge(p[i], p[i + w]);
+			return p[0];
+		}
+
+		double reduce_sum(const double* x, const double* y, size_t n, Summation mode, ThreadPool& pool) {
+			Partial r = chunk_reduce<Partial>(n, [&](size_t begin, size_t end) {
+				return chunk_sum(x + begin, y ? y + begin : nullptr, end - begin, mode);
+			}, combine, pool);
+			return mode == Summation::PAIRWISE ? r.hi : r.hi + r.lo;
+		}
+
+		// Лучший из двух кандидатов; NaN проигрывает, при равенстве -- меньший индекс
+		ArgResult better(const ArgResult& a, const ArgResult& b, bool greater) {
+			if (std::isnan(b.value)) return a;
+			if (std::isnan(a.value)) return b;
+			bool take_b = greater ? b.value > a.value : b.value < a.value;
+			if (!take_b && b.value == a.value && b.index < a.index) take_b = true;
+			return take_b ? b : a;
+		}
+
+		ArgResult reduce_arg(const double* x, size_t n, bool greater, ThreadPool& pool) {
+			return chunk_reduce<ArgResult>(n, [&](size_t begin, size_t end) {
+				ArgResult r = { begin, x[begin] };
+				for (size_t i = begin + 1; i < end; i++) r = better(r, { i, x[i] }, greater);
+				return r;
+			}, [&](const ArgResult& a, const ArgResult& b) { return better(a, b, greater); }, pool);
+		}
+
+		// Пороги и множители алгоритма Блю для double (как в LAPACK dnrm2):
+		// |x| < TSML возводится в квадрат после умножения на SSML,
+		// |x| > TBIG -- после умножения на SBIG, остальные -- как есть
+		const double TSML = std::ldexp(1.0, -511);
+		const double TBIG = std::ldexp(1.0, 486);
+		const double SSML = std::ldexp(1.0, 537);
+		const double SBIG = std::ldexp(1.0, -538);
+
+		// Три суммы квадратов алгоритма Блю
+		struct BlueSums {
+			double sml = 0;
+			double med = 0;
+			double big = 0;
+		};
+
+		BlueSums merge_blue(const BlueSums& a, const BlueSums& b) {
+			BlueSums r;
+			r.sml = a.sml + b.sml;
+			r.med = a.med + b.med;
+			r.big = a.big + b.big;
+			return r;
+		}
+
+		// Суммы квадратов блока без ветвлений, по LANES дорожек
+		BlueSums chunk_blue(const double* x, size_t n) {
+			double s[LANES] = {}, m[LANES] = {}, b[LANES] = {};
+			for (size_t i = 0; i < n; i += LANES) {
+				size_t len = std::min(LANES, n - i);
+				for (size_t l = 0; l < len; l++) {
+					double ax = std::fabs(x[i + l]);
+					bool big = ax > TBIG, sml = ax < TSML;
+					double yb = ax * SBIG, ys = ax * SSML;
+					b[l] += big ? yb * yb : 0.0;
+					s[l] += sml ? ys * ys : 0.0;
+					m[l] += big || sml ? 0.0 : ax * ax;
+				}
+			}
+			for (size_t w = LANES / 2; w > 0; w /= 2)
+				for (size_t l = 0; l < w; l++) {
+					s[l] += s[l + w];
+					m[l] += m[l + w];
+					b[l] += b[l + w];
+				}
+			BlueSums r;
+			r.sml = s[0];
+			r.med = m[0];
+			r.big = b[0];
+			return r;
+		}
+
+		// Итоговая норма по трём суммам
+		double finish_blue(BlueSums a) {
+			double scale = 1, sumsq = a.med;
+			if (a.big > 0) {
+				if (a.med > 0 || std::isnan(a.med)) a.big += a.med * SBIG * SBIG;
+				scale = 1 / SBIG;
+				sumsq = a.big;
+			}
+			else if (a.sml > 0) {
+				if (a.med > 0 || std::isnan(a.med)) {
+					double med = std::sqrt(a.med), sml = std::sqrt(a.sml) / SSML;
+					double ymin = std::min(med, sml), ymax = std::max(med, sml);
+					sumsq = ymax * ymax * (1 + (ymin / ymax) * (ymin / ymax));
+				}
+				else {
+					scale = 1 / SSML;
+					sumsq = a.sml;
+				}
+			}
+			return scale * std::sqrt(sumsq);
+		}
+	}
+
+	double sum(const double* x, size_t n, Summation mode, ThreadPool& pool) {
+		MAT_VEC_SCOPE("sum");
+		MAT_VEC_COUNT_FLOPS(n);
+		return reduce_sum(x, nullptr, n, mode, pool);
+	}
+
+	double dot(const double* x, const double* y, size_t n, Summation mode, ThreadPool& pool) {
+		MAT_VEC_SCOPE("dot");
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)n);
+		return reduce_sum(x, y, n, mode, pool);
+	}
+
+	ArgResult argmin(const double* x, size_t n, ThreadPool& pool) { return reduce_arg(x, n, false, pool); }
+	ArgResult argmax(const double* x, size_t n, ThreadPool& pool) { return reduce_arg(x, n, true, pool); }
+
+	double norm2(const double* x, size_t n, ThreadPool& pool) {
+		MAT_VEC_SCOPE("norm2");
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)n);
+		return finish_blue(chunk_reduce<BlueSums>(n, [&](size_t begin, size_t end) {
+			return chunk_blue(x + begin, end - begin);
+		}, merge_blue, pool));
+	}
+
+	double norm1(const double* x, size_t n, ThreadPool& pool) {
+		MAT_VEC_SCOPE("norm1");
+		MAT_VEC_COUNT_FLOPS(n);
+		return chunk_reduce<double>(n, [&](size_t begin, size_t end) {
+			double s[LANES] = {};
+			for (size_t i = begin; i < end; i += LANES) {
+				size_t len = std::min(LANES, end - i);
+				for (size_t l = 0; l < len; l++) s[l] += std::fabs(x[i + l]);
+			}
+			for (size_t w = LANES / 2; w > 0; w /= 2)
+				for (size_t l = 0; l < w; l++) s[l] += s[l + w];
+			return s[0];
+		}, [](double a, double b) { return a + b; }, pool);
+	}
+
+	double norm_inf(const double* x, size_t n, ThreadPool& pool) {
+		MAT_VEC_SCOPE("norm_inf");
+		return chunk_reduce<double>(n, [&](size_t begin, size_t end) {
+			double m = 0;
+			for (size_t i = begin; i < end; i++) {
+				double ax = std::fabs(x[i]);
+				m = ax > m || std::isnan(ax) ? ax : m;
+			}
+			return m;
+		}, [](double a, double b) { return std::isnan(a) || a > b ? a : b; }, pool);
+	}
+
+	double normalize(const double* x, double* y, size_t n, ThreadPool& pool) {
+		MAT_VEC_SCOPE("normalize");
+		double l2 = norm2(x, n, pool);
+		MAT_VEC_COUNT_FLOPS(n);
+		parallel_for(0, n, GRAIN * REDUCE_CHUNK, [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; i++) y[i] = x[i] / l2;
+		}, pool);
+		return l2;
+	}
+
+	double sum(const Vector& v, Summation mode) { return sum(v.data, v.size(), mode); }
+	double dot(const Vector& x, const Vector& y, Summation mode) { return dot(x.data, y.data, x.size(), mode); }
+	ArgResult argmin(const Vector& v) { return argmin(v.data, v.size()); }
+	ArgResult argmax(const Vector& v) { return argmax(v.data, v.size()); }
+	double min(const Vector& v) { return argmin(v).value; }
+	double max(const Vector& v) { return argmax(v).value; }
+	double norm1(const Vector& v) { return norm1(v.data, v.size()); }
+	double norm_inf(const Vector& v) { return norm_inf(v.data, v.size()); }
+
+} // namespace mat_vec
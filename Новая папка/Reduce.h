@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Base.h"
+#include "Parallel.h"
+#include <cstddef>
+
+namespace mat_vec {
+
+	// Способ суммирования в редукциях
+	enum class Summation {
+		PAIRWISE,     // 8 независимых сумм в блоке, попарное сложение блоков
+		COMPENSATED   // то же, но каждая сумма хранит поправку (TwoSum/TwoProduct)
+	};
+
+	// Все редукции делят данные на блоки фиксированного размера REDUCE_CHUNK
+	// и складывают результаты блоков по фиксированному двоичному дереву.
+	// Форма дерева не зависит от числа потоков, поэтому результат побитово
+	// одинаков при любом размере пула; pool -- пул, в котором считаются блоки
+	const size_t REDUCE_CHUNK = 2048;
+
+	// Индекс и значение экстремума; при равенстве -- меньший индекс
+	struct ArgResult {
+		size_t index;
+		double value;
+	};
+
+	double sum(const double* x, size_t n, Summation mode = Summation::PAIRWISE,
+		ThreadPool& pool = ThreadPool::global());
+	double dot(const double* x, const double* y, size_t n, Summation mode = Summation::PAIRWISE,
+		ThreadPool& pool = ThreadPool::global());
+
+	// Минимум и максимум (n > 0); NaN пропускаются
+	ArgResult argmin(const double* x, size_t n, ThreadPool& pool = ThreadPool::global());
+	ArgResult argmax(const double* x, size_t n, ThreadPool& pool = ThreadPool::global());
+
+	// Евклидова норма без переполнения и потери точности в подпорогах:
+	// алгоритм Блю, один проход, три суммы квадратов с масштабированием
+	double norm2(const double* x, size_t n, ThreadPool& pool = ThreadPool::global());
+
+	// Сумма модулей и максимум модуля
+	double norm1(const double* x, size_t n, ThreadPool& pool = ThreadPool::global());
+	double norm_inf(const double* x, size_t n, ThreadPool& pool = ThreadPool::global());
+
+	// y = x / ||x||_2 (y может совпадать с x); возвращает ||x||_2
+	double normalize(const double* x, double* y, size_t n, ThreadPool& pool = ThreadPool::global());
+
+	// То же для векторов
+	double sum(const Vector& v, Summation mode = Summation::PAIRWISE);
+	double dot(const Vector& x, const Vector& y, Summation mode = Summation::PAIRWISE);
+	ArgResult argmin(const Vector& v);
+	ArgResult argmax(const Vector& v);
+	double min(const Vector& v);
+	double max(const Vector& v);
+	double norm1(const Vector& v);
+	double norm_inf(const Vector& v);
+
+} // namespace mat_vec
@@ -0,0 +1,298 @@
+#include "SharedMemory.h"
+#include "Matrix.h"
+#include "Profiler.h"
+#include "Vector.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAT_VEC_POSIX_SHM
+#endif
+
+namespace mat_vec {
+
+	// -Заголовок сегмента; данные начинаются со смещения DATA_OFFSET
+	struct SharedHeader {
+		char magic[8];
+		uint32_t kind;
+		uint32_t reserved;
+		uint64_t rows;
+		uint64_t cols;
+		std::atomic<uint64_t> sequence;
+	};
+
+	namespace {
+
+		const char MAGIC[8] = { 'M', 'V', 'S', 'H', 'M', 'E', 'M', '1' };
+		const size_t DATA_OFFSET = 64;
+
+		const uint32_t KIND_MATRIX = 1;
+		const uint32_t KIND_VECTOR = 2;
+
+		static_assert(sizeof(SharedHeader) <= DATA_OFFSET, "header does not fit");
+		static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "seqlock needs a lock-free 64-bit counter");
+
+		// Имена POSIX начинаются с '/'
+		std::string posix_name(const std::string& name) {
+			return !name.empty() && name[0] == '/' ? name : "/" + name;
+		}
+
+		bool segment_bytes(size_t rows, size_t cols, size_t& bytes) {
+			if (cols != 0 && rows > (SIZE_MAX - DATA_OFFSET) / sizeof(double) / cols) return false;
+			bytes = DATA_OFFSET + rows * cols * sizeof(double);
+			return true;
+		}
+	}
+
+	SharedSegment::~SharedSegment() { close(); }
+
+	SharedSegment::SharedSegment(SharedSegment&& src) noexcept { *this = std::move(src); }
+
+	SharedSegment& SharedSegment::operator=(SharedSegment&& rhs) noexcept {
+		if (this != &rhs) {
+			close();
+			_name = std::move(rhs._name);
+			_map = rhs._map;
+			_bytes = rhs._bytes;
+			_header = rhs._header;
+			_data = rhs._data;
+			_writable = rhs._writable;
+			rhs._map = nullptr;
+			rhs._header = nullptr;
+			rhs._data = nullptr;
+			rhs._bytes = 0;
+			rhs._writable = false;
+		}
+		return *this;
+	}
+
+	const std::string& SharedSegment::name() const { return _name; }
+	bool SharedSegment::valid() const { return _header != nullptr; }
+	bool SharedSegment::writable() const { return _writable; }
+	double* SharedSegment::data() const { return _data; }
+	size_t SharedSegment::rows() const { return _header ? (size_t)_header->rows : 0; }
+	size_t SharedSegment::cols() const { return _header ? (size_t)_header->cols : 0; }
+
+	// -Число завершённых записей
+	uint64_t SharedSegment::version() const {
+		return _header ? _header->sequence.load(std::memory_order_acquire) / 2 : 0;
+	}
+
+	// -Счётчик становится нечётным до первой записи данных
+	void SharedSegment::begin_write() {
+		if (!_writable || !_header) return;
+		_header->sequence.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	// -Чётный счётчик публикует данные
+	void SharedSegment::end_write() {
+		if (!_writable || !_header) return;
+		_header->sequence.fetch_add(1, std::memory_order_release);
+	}
+
+	uint64_t SharedSegment::read_begin() const {
+		return _header ? _header->sequence.load(std::memory_order_acquire) : 1;
+	}
+
+	bool SharedSegment::read_validate(uint64_t sequence) const {
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return _header && _header->sequence.load(std::memory_order_relaxed) == sequence;
+	}
+
+	// -Копирует данные, повторяя попытку, если писатель вмешался
+	bool SharedSegment::snapshot(double* dst, size_t max_attempts) const {
+		if (!_header) return false;
+		size_t n = rows() * cols();
+		for (size_t attempt = 0; attempt < max_attempts; attempt++) {
+			uint64_t s = read_begin();
+			if ((s & 1) == 0) {
+				if (n) std::memcpy(dst, _data, n * sizeof(double));
+				if (read_validate(s)) {
+					MAT_VEC_COUNT_COPY(n * sizeof(double));
+					return true;
+				}
+			}
+			std::this_thread::yield();
+		}
+		return false;
+	}
+
+#ifdef MAT_VEC_POSIX_SHM
+	// -Новый сегмент: O_EXCL, чтобы не затереть чужие данные
+	bool SharedSegment::create(const std::string& name, uint32_t kind, size_t rows, size_t cols) {
+		close();
+		size_t bytes;
+		if (!segment_bytes(rows, cols, bytes)) return false;
+		std::string path = posix_name(name);
+		int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+		if (fd < 0) return false;
+		void* map = MAP_FAILED;
+		if (ftruncate(fd, (off_t)bytes) == 0)
+			map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (map == MAP_FAILED) {
+			shm_unlink(path.c_str());
+			return false;
+		}
+		// ftruncate заполнил сегмент нулями; метка пишется последней,
+		// чтобы читатель не принял недописанный заголовок
+		SharedHeader* h = new (map) SharedHeader;
+		h->kind = kind;
+		h->reserved = 0;
+		h->rows = rows;
+		h->cols = cols;
+		h->sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(h->magic, MAGIC, sizeof(MAGIC));
+
+		_name = path;
+		_map = map;
+		_bytes = bytes;
+		_header = h;
+		_data = reinterpret_cast<double*>(static_cast<char*>(map) + DATA_OFFSET);
+		_writable = true;
+		return true;
+	}
+
+	// -Отображение только на чтение; проверяются метка, тип и размер
+	bool SharedSegment::attach(const std::string& name, uint32_t kind) {
+		close();
+		std::string path = posix_name(name);
+		int fd = shm_open(path.c_str(), O_RDONLY, 0);
+		if (fd < 0) return false;
+		struct stat st;
+		void* map = MAP_FAILED;
+		size_t size = 0;
+		if (fstat(fd, &st) == 0 && (size_t)st.st_size >= DATA_OFFSET) {
+			size = (size_t)st.st_size;
+			map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		}
+		::close(fd);
+		if (map == MAP_FAILED) return false;
+
+		SharedHeader* h = static_cast<SharedHeader*>(map);
+		size_t bytes;
+		bool ok = std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 && h->kind == kind &&
+			segment_bytes((size_t)h->rows, (size_t)h->cols, bytes) && bytes <= size;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (!ok) {
+			munmap(map, size);
+			return false;
+		}
+		_name = path;
+		_map = map;
+		_bytes = size;
+		_header = h;
+		_data = reinterpret_cast<double*>(static_cast<char*>(map) + DATA_OFFSET);
+		_writable = false;
+		return true;
+	}
+
+	void SharedSegment::close() {
+		if (_map) munmap(_map, _bytes);
+		_map = nullptr;
+		_header = nullptr;
+		_data = nullptr;
+		_bytes = 0;
+		_writable = false;
+	}
+
+	bool SharedSegment::unlink() {
+		return !_name.empty() && shm_unlink(_name.c_str()) == 0;
+	}
+
+	bool SharedSegment::remove(const std::string& name) {
+		return shm_unlink(posix_name(name).c_str()) == 0;
+	}
+#else
+	bool SharedSegment::create(const std::string&, uint32_t, size_t, size_t) { return false; }
+	bool SharedSegment::attach(const std::string&, uint32_t) { return false; }
+	void SharedSegment::close() {}
+	bool SharedSegment::unlink() { return false; }
+	bool SharedSegment::remove(const std::string&) { return false; }
+#endif
+
+	// -Новая матрица в разделяемой памяти
+	bool SharedMatrix::create(const std::string& name, size_t rows, size_t cols, SharedMatrix& out) {
+		if (!out.SharedSegment::create(name, KIND_MATRIX, rows, cols)) return false;
+		out.link();
+		return true;
+	}
+
+	bool SharedMatrix::attach(const std::string& name, SharedMatrix& out) {
+		if (!out.SharedSegment::attach(name, KIND_MATRIX)) return false;
+		out.link();
+		return true;
+	}
+
+	// -Указатели на строки в адресах этого процесса
+	void SharedMatrix::link() {
+		size_t r = rows(), c = cols();
+		_rows.resize(r);
+		for (size_t i = 0; i < r; i++) _rows[i] = data() + i * c;
+	}
+
+	std::pair<size_t, size_t> SharedMatrix::shape() const { return { rows(), cols() }; }
+
+	MatrixRef SharedMatrix::view() const {
+		return { _rows.data(), 0, rows(), cols() };
+	}
+
+	// -Запись целиком в скобках seqlock
+	bool SharedMatrix::publish(const Matrix& m) {
+		MAT_VEC_SCOPE("SharedMatrix::publish");
+		if (!writable() || m.shape() != shape()) return false;
+		size_t n = rows() * cols();
+		begin_write();
+		if (n) std::memcpy(data(), m.a[0], n * sizeof(double));
+		end_write();
+		MAT_VEC_COUNT_COPY(n * sizeof(double));
+		return true;
+	}
+
+	bool SharedMatrix::read(Matrix& out, size_t max_attempts) const {
+		MAT_VEC_SCOPE("SharedMatrix::read");
+		if (!valid()) return false;
+		if (out.shape() != shape()) out = Matrix(rows(), cols(), 0.0);
+		out.invalidate();
+		return snapshot(rows() * cols() != 0 ? out.a[0] : nullptr, max_attempts);
+	}
+
+	// -Новый вектор в разделяемой памяти
+	bool SharedVector::create(const std::string& name, size_t n, SharedVector& out) {
+		return out.SharedSegment::create(name, KIND_VECTOR, 1, n);
+	}
+
+	bool SharedVector::attach(const std::string& name, SharedVector& out) {
+		return out.SharedSegment::attach(name, KIND_VECTOR);
+	}
+
+	size_t SharedVector::size() const { return cols(); }
+	const double* SharedVector::data() const { return SharedSegment::data(); }
+	double* SharedVector::mutable_data() const { return writable() ? SharedSegment::data() : nullptr; }
+
+	bool SharedVector::publish(const Vector& v) {
+		MAT_VEC_SCOPE("SharedVector::publish");
+		if (!writable() || (size_t)v._size != size()) return false;
+		begin_write();
+		if (size()) std::memcpy(SharedSegment::data(), v.data, size() * sizeof(double));
+		end_write();
+		MAT_VEC_COUNT_COPY(size() * sizeof(double));
+		return true;
+	}
+
+	bool SharedVector::read(Vector& out, size_t max_attempts) const {
+		MAT_VEC_SCOPE("SharedVector::read");
+		if (!valid()) return false;
+		if ((size_t)out._size != size()) out = Vector(size());
+		return snapshot(out.data, max_attempts);
+	}
+
+} // namespace mat_vec
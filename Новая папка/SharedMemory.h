@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Base.h"
+#include "Gemm.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mat_vec {
+
+	struct SharedHeader;
+
+	// Именованный сегмент разделяемой памяти POSIX (shm_open + mmap) с
+	// заголовком и данными double. Заголовок содержит счётчик seqlock:
+	// нечётное значение -- идёт запись, каждая завершённая запись
+	// увеличивает его на 2. Писатель один; читателей сколько угодно,
+	// в том числе в других процессах. Без POSIX все вызовы возвращают false
+	class SharedSegment {
+	public:
+		SharedSegment() = default;
+		~SharedSegment();
+
+		SharedSegment(const SharedSegment&) = delete;
+		SharedSegment& operator=(const SharedSegment&) = delete;
+		SharedSegment(SharedSegment&& src) noexcept;
+		SharedSegment& operator=(SharedSegment&& rhs) noexcept;
+
+		// Имя сегмента (с ведущим '/')
+		const std::string& name() const;
+
+		// true, если сегмент подключён; writable -- открыт создателем на запись
+		bool valid() const;
+		bool writable() const;
+
+		// Номер версии: число завершённых записей
+		uint64_t version() const;
+
+		// Скобки записи; между ними читатели видят несогласованное состояние
+		// и повторяют чтение
+		void begin_write();
+		void end_write();
+
+		// Чтение без копирования: read_begin возвращает счётчик (нечётный --
+		// запись идёт, данные читать бессмысленно), read_validate проверяет,
+		// что за время чтения запись не начиналась
+		uint64_t read_begin() const;
+		bool read_validate(uint64_t sequence) const;
+
+		// Удаляет имя сегмента; уже подключённые отображения остаются
+		bool unlink();
+		static bool remove(const std::string& name);
+
+	protected:
+		bool create(const std::string& name, uint32_t kind, size_t rows, size_t cols);
+		bool attach(const std::string& name, uint32_t kind);
+		void close();
+
+		// Согласованная копия данных в dst (rows * cols элементов);
+		// false, если за max_attempts попыток писатель не дал прочитать
+		bool snapshot(double* dst, size_t max_attempts) const;
+
+		double* data() const;
+		size_t rows() const;
+		size_t cols() const;
+
+	private:
+		std::string _name;
+		void* _map = nullptr;
+		size_t _bytes = 0;
+		SharedHeader* _header = nullptr;
+		double* _data = nullptr;
+		bool _writable = false;
+	};
+
+	// Матрица rows x cols в разделяемой памяти
+	class SharedMatrix : public SharedSegment {
+	public:
+		SharedMatrix() = default;
+
+		// Создаёт новый сегмент name (ошибка, если он уже есть), заполненный нулями
+		static bool create(const std::string& name, size_t rows, size_t cols, SharedMatrix& out);
+
+		// Подключает существующий сегмент только для чтения
+		static bool attach(const std::string& name, SharedMatrix& out);
+
+		std::pair<size_t, size_t> shape() const;
+
+		// Окно на данные сегмента без копирования. У читателя память
+		// отображена только на чтение -- писать через окно нельзя
+		MatrixRef view() const;
+
+		// Записывает m целиком внутри скобок записи; false, если размеры
+		// не совпадают или сегмент открыт только на чтение
+		bool publish(const Matrix& m);
+
+		// Согласованный снимок в out (out получает размеры сегмента)
+		bool read(Matrix& out, size_t max_attempts = 1000) const;
+
+		// Вызывает fn(view()) и возвращает true, если за это время
+		// запись не начиналась (иначе результат fn нужно отбросить)
+		template <typename F>
+		bool read_view(F fn) const {
+			uint64_t s = read_begin();
+			if (s & 1) return false;
+			fn(view());
+			return read_validate(s);
+		}
+
+	private:
+		void link();
+
+		std::vector<double*> _rows;
+	};
+
+	// Вектор длины n в разделяемой памяти
+	class SharedVector : public SharedSegment {
+	public:
+		SharedVector() = default;
+
+		static bool create(const std::string& name, size_t n, SharedVector& out);
+		static bool attach(const std::string& name, SharedVector& out);
+
+		size_t size() const;
+
+		// Данные сегмента без копирования
+		const double* data() const;
+		double* mutable_data() const;
+
+		bool publish(const Vector& v);
+		bool read(Vector& out, size_t max_attempts = 1000) const;
+
+		template <typename F>
+		bool read_view(F fn) const {
+			uint64_t s = read_begin();
+			if (s & 1) return false;
+			fn(data(), size());
+			return read_validate(s);
+		}
+	};
+
+} // namespace mat_vec
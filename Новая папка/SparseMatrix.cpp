@@ -0,0 +1,163 @@
+#include "SparseMatrix.h"
+#include "Matrix.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Vector.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Примерное число ненулевых элементов на задачу умножения
+		const size_t NNZ_GRAIN = 1 << 15;
+	}
+
+	SparseMatrix::SparseMatrix() : SparseMatrix(0, 0) {}
+
+	// -Нулевая матрица rows x cols
+	SparseMatrix::SparseMatrix(size_t rows, size_t cols)
+		: _rows(rows), _cols(cols), _valid(true), _row_ptr(rows + 1, 0) {}
+
+	// -Из готовых массивов CSR
+	SparseMatrix::SparseMatrix(size_t rows, size_t cols, std::vector<size_t> row_ptr, std::vector<uint32_t> cols_idx,
+		std::vector<double> values)
+		: _rows(rows), _cols(cols), _valid(true), _row_ptr(std::move(row_ptr)), _cols_idx(std::move(cols_idx)),
+		_values(std::move(values)) {
+		bool ok = _row_ptr.size() == rows + 1 && _row_ptr[0] == 0 && _row_ptr[rows] == _cols_idx.size()
+			&& _values.size() == _cols_idx.size() && cols <= (size_t)UINT32_MAX + 1;
+		for (size_t i = 0; ok && i < rows; i++) {
+			size_t from = _row_ptr[i], to = _row_ptr[i + 1];
+			ok = from <= to && to <= _cols_idx.size();
+			for (size_t p = from; ok && p < to; p++)
+				ok = _cols_idx[p] < cols && (p == from || _cols_idx[p - 1] < _cols_idx[p]);
+		}
+		if (!ok) {
+			*this = SparseMatrix();
+			_valid = false;
+		}
+	}
+
+	// -Из троек
+	SparseMatrix SparseMatrix::from_triplets(size_t rows, size_t cols, std::vector<Triplet> triplets) {
+		MAT_VEC_SCOPE("SparseMatrix::from_triplets");
+		triplets.erase(std::remove_if(triplets.begin(), triplets.end(),
+			[rows, cols](const Triplet& t) { return t.row >= rows || t.col >= cols; }), triplets.end());
+		std::sort(triplets.begin(), triplets.end(), [](const Triplet& a, const Triplet& b) {
+			return a.row != b.row ? a.row < b.row : a.col < b.col;
+		});
+		SparseMatrix res(rows, cols);
+		res._cols_idx.reserve(triplets.size());
+		res._values.reserve(triplets.size());
+		for (size_t k = 0; k < triplets.size(); k++) {
+			const Triplet& t = triplets[k];
+			if (k && t.row == triplets[k - 1].row && t.col == triplets[k - 1].col) {
+				res._values.back() += t.value;
+				continue;
+			}
+			res._cols_idx.push_back((uint32_t)t.col);
+			res._values.push_back(t.value);
+			res._row_ptr[t.row + 1]++;
+		}
+		for (size_t i = 0; i < rows; i++) res._row_ptr[i + 1] += res._row_ptr[i];
+		return res;
+	}
+
+	// -Из плотной матрицы
+	SparseMatrix SparseMatrix::from_dense(const Matrix& m, double eps) {
+		size_t rows = m._size.first, cols = m._size.second;
+		SparseMatrix res(rows, cols);
+		for (size_t i = 0; i < rows; i++) {
+			for (size_t j = 0; j < cols; j++) {
+				if (std::fabs(m.a[i][j]) <= eps) continue;
+				res._cols_idx.push_back((uint32_t)j);
+				res._values.push_back(m.a[i][j]);
+			}
+			res._row_ptr[i + 1] = res._cols_idx.size();
+		}
+		return res;
+	}
+
+	bool SparseMatrix::valid() const { return _valid; }
+	size_t SparseMatrix::rows() const { return _rows; }
+	size_t SparseMatrix::cols() const { return _cols; }
+	size_t SparseMatrix::nnz() const { return _cols_idx.size(); }
+	const std::vector<size_t>& SparseMatrix::row_ptr() const { return _row_ptr; }
+	const std::vector<uint32_t>& SparseMatrix::cols_idx() const { return _cols_idx; }
+	const std::vector<double>& SparseMatrix::values() const { return _values; }
+	std::vector<double>& SparseMatrix::values() { return _values; }
+	size_t SparseMatrix::row_nnz(size_t i) const { return _row_ptr[i + 1] - _row_ptr[i]; }
+
+	// -Элемент (i, j) двоичным поиском по строке
+	double SparseMatrix::get(size_t i, size_t j) const {
+		auto first = _cols_idx.begin() + _row_ptr[i], last = _cols_idx.begin() + _row_ptr[i + 1];
+		auto it = std::lower_bound(first, last, (uint32_t)j);
+		return it != last && *it == j ? _values[it - _cols_idx.begin()] : 0.0;
+	}
+
+	// -y = A x
+	void SparseMatrix::multiply(const double* x, double* y) const {
+		MAT_VEC_SCOPE("SparseMatrix::multiply");
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)nnz());
+		const size_t* ptr = _row_ptr.data();
+		const uint32_t* idx = _cols_idx.data();
+		const double* val = _values.data();
+		auto rows = [&](size_t from, size_t to) {
+			for (size_t i = from; i < to; i++) {
+				double s = 0;
+				for (size_t p = ptr[i]; p < ptr[i + 1]; p++) s += val[p] * x[idx[p]];
+				y[i] = s;
+			}
+		};
+		// части равны по числу ненулевых, а не строк: у степенных графов
+		// несколько строк могут содержать большую долю рёбер
+		size_t parts = std::max<size_t>(1, nnz() / NNZ_GRAIN);
+		if (parts == 1 || _rows < 2) {
+			rows(0, _rows);
+			return;
+		}
+		std::vector<size_t> bounds(parts + 1, _rows);
+		bounds[0] = 0;
+		for (size_t k = 1; k < parts; k++)
+			bounds[k] = std::upper_bound(_row_ptr.begin(), _row_ptr.end(), nnz() / parts * k) - _row_ptr.begin() - 1;
+		parallel_for(0, parts, 1, [&](size_t from, size_t to) {
+			for (size_t k = from; k < to; k++) rows(bounds[k], std::max(bounds[k], bounds[k + 1]));
+		});
+	}
+
+	Vector SparseMatrix::operator*(const Vector& x) const {
+		Vector y(_rows, 0);
+		multiply(x.data, y.data);
+		return y;
+	}
+
+	// -Транспонирование подсчётом столбцов
+	SparseMatrix SparseMatrix::transposed() const {
+		MAT_VEC_SCOPE("SparseMatrix::transposed");
+		SparseMatrix res(_cols, _rows);
+		for (uint32_t j : _cols_idx) res._row_ptr[j + 1]++;
+		for (size_t j = 0; j < _cols; j++) res._row_ptr[j + 1] += res._row_ptr[j];
+		res._cols_idx.resize(nnz());
+		res._values.resize(nnz());
+		std::vector<size_t> next(res._row_ptr.begin(), res._row_ptr.end() - 1);
+		// строки идут по возрастанию, поэтому столбцы результата упорядочены
+		for (size_t i = 0; i < _rows; i++)
+			for (size_t p = _row_ptr[i]; p < _row_ptr[i + 1]; p++) {
+				size_t q = next[_cols_idx[p]]++;
+				res._cols_idx[q] = (uint32_t)i;
+				res._values[q] = _values[p];
+			}
+		return res;
+	}
+
+	// -Плотная копия
+	Matrix SparseMatrix::to_dense() const {
+		Matrix res(_rows, _cols, 0.0);
+		for (size_t i = 0; i < _rows; i++)
+			for (size_t p = _row_ptr[i]; p < _row_ptr[i + 1]; p++) res.a[i][_cols_idx[p]] = _values[p];
+		return res;
+	}
+
+} // namespace mat_vec
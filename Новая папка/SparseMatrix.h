@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Base.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mat_vec {
+
+	// Элемент разреженной матрицы в координатной форме
+	struct Triplet {
+		size_t row;
+		size_t col;
+		double value;
+	};
+
+	// Разреженная матрица в формате CSR: для строки i номера столбцов
+	// ненулевых элементов лежат в cols()[row_ptr()[i] .. row_ptr()[i + 1]),
+	// по возрастанию, значения -- в values() на тех же местах.
+	// Номера столбцов 32-битные: для графов с сотнями миллионов рёбер это
+	// вдвое меньше памяти на индексы
+	class SparseMatrix {
+	public:
+		// Матрица 0 x 0
+		SparseMatrix();
+
+		// Нулевая матрица rows x cols
+		SparseMatrix(size_t rows, size_t cols);
+
+		// Из готовых массивов CSR. Если они не согласованы (длины, границы,
+		// порядок столбцов) -- матрица 0 x 0, valid() == false
+		SparseMatrix(size_t rows, size_t cols, std::vector<size_t> row_ptr, std::vector<uint32_t> cols_idx,
+			std::vector<double> values);
+
+		// Из троек; повторяющиеся позиции складываются, тройки вне матрицы отбрасываются
+		static SparseMatrix from_triplets(size_t rows, size_t cols, std::vector<Triplet> triplets);
+
+		// Из плотной матрицы: элементы с |a_ij| <= eps не хранятся
+		static SparseMatrix from_dense(const Matrix& m, double eps = 0);
+
+		// false, если конструктор из массивов CSR отверг данные
+		bool valid() const;
+
+		size_t rows() const;
+		size_t cols() const;
+		size_t nnz() const;
+
+		const std::vector<size_t>& row_ptr() const;
+		const std::vector<uint32_t>& cols_idx() const;
+		const std::vector<double>& values() const;
+		std::vector<double>& values();
+
+		// Число ненулевых элементов строки i
+		size_t row_nnz(size_t i) const;
+
+		// Элемент (i, j); 0, если он не хранится
+		double get(size_t i, size_t j) const;
+
+		// y = A x (параллельно, строки делятся поровну по числу ненулевых)
+		void multiply(const double* x, double* y) const;
+		Vector operator*(const Vector& x) const;
+
+		SparseMatrix transposed() const;
+		Matrix to_dense() const;
+
+	private:
+		size_t _rows;
+		size_t _cols;
+		bool _valid;
+		std::vector<size_t> _row_ptr;
+		std::vector<uint32_t> _cols_idx;
+		std::vector<double> _values;
+	};
+
+} // namespace mat_vec
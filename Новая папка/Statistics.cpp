@@ -0,0 +1,261 @@
+#include "Statistics.h"
+#include "Decomposition.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Transpose.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <utility>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Строк в пачке: центрированная пачка и её syrk помещаются в кэш,
+		// а поправка Чана O(d^2) делится на достаточно много строк
+		const size_t BATCH = 256;
+
+		// Частей на поток в column_statistics: больше -- ровнее нагрузка,
+		// но у каждой части своя матрица d x d
+		const size_t PARTS_PER_THREAD = 2;
+	}
+
+	RunningCovariance::RunningCovariance(size_t dim, bool full)
+		: _dim(dim), _full(full), _mean(dim, 0.0), _m2(full ? dim * dim : dim, 0.0), _batch_mean(dim) {}
+
+	size_t RunningCovariance::dim() const { return _dim; }
+
+	bool RunningCovariance::full() const { return _full; }
+
+	uint64_t RunningCovariance::count() const { return _count; }
+
+	void RunningCovariance::add(const Vector& row) {
+		add(row.data);
+	}
+
+	// -Уэлфорд: delta = x - mu_old, M2 += delta delta^T (n - 1) / n
+	void RunningCovariance::add(const double* row) {
+		size_t d = _dim;
+		_count++;
+		double inv = 1.0 / (double)_count, weight = (double)(_count - 1) * inv;
+		double* delta = _batch_mean.data();
+		for (size_t j = 0; j < d; j++) {
+			delta[j] = row[j] - _mean[j];
+			_mean[j] += delta[j] * inv;
+		}
+		if (_full) {
+			for (size_t i = 0; i < d; i++) {
+				double di = delta[i] * weight;
+				double* m = _m2.data() + i * d;
+				for (size_t j = 0; j < d; j++) m[j] += di * delta[j];
+			}
+		}
+		else {
+			for (size_t j = 0; j < d; j++) _m2[j] += delta[j] * delta[j] * weight;
+		}
+	}
+
+	void RunningCovariance::add(const Matrix& rows) {
+		add(view(rows));
+	}
+
+	void RunningCovariance::add(const MatrixRef& rows) {
+		MAT_VEC_SCOPE("RunningCovariance::add");
+		size_t d = _dim;
+		for (size_t r0 = 0; r0 < rows.n_rows; r0 += BATCH) {
+			size_t b = std::min(BATCH, rows.n_rows - r0);
+			if (b == 1) {
+				add(rows.row(r0));
+				continue;
+			}
+			if (_centered.size() < BATCH * d) _centered.resize(BATCH * d);
+			double* mean = _batch_mean.data();
+			std::fill(mean, mean + d, 0.0);
+			for (size_t i = 0; i < b; i++) {
+				const double* x = rows.row(r0 + i);
+				for (size_t j = 0; j < d; j++) mean[j] += x[j];
+			}
+			for (size_t j = 0; j < d; j++) mean[j] /= (double)b;
+			for (size_t i = 0; i < b; i++) {
+				const double* x = rows.row(r0 + i);
+				double* c = _centered.data() + i * d;
+				for (size_t j = 0; j < d; j++) c[j] = x[j] - mean[j];
+			}
+			merge_batch(b, mean);
+		}
+	}
+
+	// -Чан: M2 = M2_a + M2_b + delta delta^T n_a n_b / n, delta = mu_b - mu_a.
+	// M2 пачки прибавляется сразу в _m2 через syrk
+	void RunningCovariance::merge_batch(size_t rows, double* batch_mean) {
+		size_t d = _dim;
+		double na = (double)_count, nb = (double)rows, n = na + nb;
+		double weight = na * nb / n;
+		double* delta = batch_mean;
+		for (size_t j = 0; j < d; j++) delta[j] -= _mean[j];
+		if (_full) {
+			_centered_rows.resize(rows);
+			for (size_t i = 0; i < rows; i++) _centered_rows[i] = _centered.data() + i * d;
+			_m2_rows.resize(d);
+			for (size_t i = 0; i < d; i++) _m2_rows[i] = _m2.data() + i * d;
+			syrk(1.0, { _centered_rows.data(), 0, rows, d }, 1.0, { _m2_rows.data(), 0, d, d });
+			for (size_t i = 0; i < d; i++) {
+				double di = delta[i] * weight;
+				double* m = _m2.data() + i * d;
+				for (size_t j = 0; j < d; j++) m[j] += di * delta[j];
+			}
+		}
+		else {
+			for (size_t i = 0; i < rows; i++) {
+				const double* c = _centered.data() + i * d;
+				for (size_t j = 0; j < d; j++) _m2[j] += c[j] * c[j];
+			}
+			for (size_t j = 0; j < d; j++) _m2[j] += delta[j] * delta[j] * weight;
+		}
+		for (size_t j = 0; j < d; j++) _mean[j] += delta[j] * (nb / n);
+		_count += rows;
+	}
+
+	bool RunningCovariance::merge(const RunningCovariance& other) {
+		if (other._dim != _dim || other._full != _full) return false;
+		if (other._count == 0) return true;
+		size_t d = _dim;
+		double na = (double)_count, nb = (double)other._count, n = na + nb;
+		double weight = na * nb / n;
+		double* delta = _batch_mean.data();
+		for (size_t j = 0; j < d; j++) delta[j] = other._mean[j] - _mean[j];
+		if (_full) {
+			for (size_t i = 0; i < d; i++) {
+				double di = delta[i] * weight;
+				double* m = _m2.data() + i * d;
+				const double* mo = other._m2.data() + i * d;
+				for (size_t j = 0; j < d; j++) m[j] += mo[j] + di * delta[j];
+			}
+		}
+		else {
+			for (size_t j = 0; j < d; j++) _m2[j] += other._m2[j] + delta[j] * delta[j] * weight;
+		}
+		for (size_t j = 0; j < d; j++) _mean[j] += delta[j] * (nb / n);
+		_count += other._count;
+		return true;
+	}
+
+	void RunningCovariance::reset() {
+		_count = 0;
+		std::fill(_mean.begin(), _mean.end(), 0.0);
+		std::fill(_m2.begin(), _m2.end(), 0.0);
+	}
+
+	Vector RunningCovariance::mean() const {
+		Vector m(_dim);
+		std::copy(_mean.begin(), _mean.end(), m.data);
+		return m;
+	}
+
+	Vector RunningCovariance::variance(size_t ddof) const {
+		Vector v(_dim);
+		if (_count <= ddof) return v;
+		double scale = 1.0 / (double)(_count - ddof);
+		for (size_t j = 0; j < _dim; j++) v[j] = (_full ? _m2[j * _dim + j] : _m2[j]) * scale;
+		return v;
+	}
+
+	Matrix RunningCovariance::covariance(size_t ddof) const {
+		Matrix c(_dim, _dim, 0.0);
+		if (_count <= ddof) return c;
+		double scale = 1.0 / (double)(_count - ddof);
+		for (size_t i = 0; i < _dim; i++) {
+			if (_full) {
+				for (size_t j = 0; j < _dim; j++) c.a[i][j] = _m2[i * _dim + j] * scale;
+			}
+			else {
+				c.a[i][i] = _m2[i] * scale;
+			}
+		}
+		return c;
+	}
+
+	Matrix RunningCovariance::correlation() const {
+		Matrix c = covariance(0);
+		std::vector<double> s(_dim);
+		for (size_t i = 0; i < _dim; i++) s[i] = c.a[i][i] > 0 ? 1.0 / std::sqrt(c.a[i][i]) : 0.0;
+		for (size_t i = 0; i < _dim; i++) {
+			for (size_t j = 0; j < _dim; j++) c.a[i][j] *= s[i] * s[j];
+			c.a[i][i] = 1;
+		}
+		return c;
+	}
+
+	// -Части сливаются в порядке строк, а не завершения
+	RunningCovariance column_statistics(const Matrix& rows, bool full) {
+		MAT_VEC_SCOPE("column_statistics");
+		MatrixRef all = view(rows);
+		size_t n = all.n_rows, d = all.n_cols;
+		size_t parts = std::max<size_t>(1, ThreadPool::global().size() * PARTS_PER_THREAD);
+		size_t grain = std::max(BATCH, (n + parts - 1) / parts);
+		std::mutex lock;
+		std::vector<std::pair<size_t, RunningCovariance>> done;
+		parallel_for(0, n, grain, [&](size_t from, size_t to) {
+			RunningCovariance part(d, full);
+			part.add(all.block(from, 0, to - from, d));
+			std::lock_guard<std::mutex> guard(lock);
+			done.emplace_back(from, std::move(part));
+		});
+		std::sort(done.begin(), done.end(), [](const std::pair<size_t, RunningCovariance>& a,
+			const std::pair<size_t, RunningCovariance>& b) { return a.first < b.first; });
+		RunningCovariance result(d, full);
+		for (const auto& part : done) result.merge(part.second);
+		return result;
+	}
+
+	Pca::Pca(size_t dim, size_t k)
+		: mean(dim), components(k, dim, 0.0), explained_variance(k), explained_variance_ratio(k) {}
+
+	Matrix Pca::transform(const Matrix& rows) const {
+		size_t n = rows._size.first, d = components._size.second, k = components._size.first;
+		Matrix centered(n, d, 0.0), axes(d, k, 0.0), scores(n, k, 0.0);
+		for (size_t i = 0; i < n; i++) {
+			for (size_t j = 0; j < d; j++) centered.a[i][j] = rows.a[i][j] - mean[j];
+		}
+		transpose(view(components), view(axes));
+		gemm(1.0, view(centered), view(axes), 0.0, view(scores));
+		return scores;
+	}
+
+	Matrix Pca::inverse_transform(const Matrix& scores) const {
+		size_t n = scores._size.first, d = components._size.second;
+		Matrix rows(n, d, 0.0);
+		gemm(1.0, view(scores), view(components), 0.0, view(rows));
+		for (size_t i = 0; i < n; i++) {
+			for (size_t j = 0; j < d; j++) rows.a[i][j] += mean[j];
+		}
+		return rows;
+	}
+
+	Pca pca(const RunningCovariance& stats, size_t components) {
+		MAT_VEC_SCOPE("pca");
+		size_t d = stats.dim(), k = components == 0 ? d : std::min(components, d);
+		Pca result(d, k);
+		result.mean = stats.mean();
+		if (!stats.full() || stats.count() < 2) return result;
+		SymmetricEigen eigen(stats.covariance());
+		if (!eigen.ok()) return result;
+		double total = 0;
+		for (size_t j = 0; j < d; j++) total += std::max(0.0, eigen.values()[j]);
+		for (size_t c = 0; c < k; c++) {
+			double value = std::max(0.0, eigen.values()[c]);
+			result.explained_variance[c] = value;
+			result.explained_variance_ratio[c] = total > 0 ? value / total : 0.0;
+			size_t largest = 0;
+			for (size_t j = 1; j < d; j++) {
+				if (std::abs(eigen.vectors().a[j][c]) > std::abs(eigen.vectors().a[largest][c])) largest = j;
+			}
+			double sign = eigen.vectors().a[largest][c] < 0 ? -1.0 : 1.0;
+			for (size_t j = 0; j < d; j++) result.components.a[c][j] = sign * eigen.vectors().a[j][c];
+		}
+		result.ok = true;
+		return result;
+	}
+
+} // namespace mat_vec
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Base.h"
+#include "Gemm.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mat_vec {
+
+	// Потоковые среднее и ковариация столбцов: строки подаются по одной
+	// (Vector) или пачками (Matrix), всё множество строк не хранится.
+	//
+	// Хранятся число строк n, среднее mu и матрица рассеяния
+	// M2 = sum (x - mu)(x - mu)^T. Одна строка добавляется по Уэлфорду,
+	// пачка -- по формуле Чана: у пачки считаются своё среднее и своя M2
+	// (центрированные строки, syrk), затем она сливается с накопленным.
+	// Так нет вычитания больших близких сумм, как в sum x^2 - n mu^2.
+	//
+	// full == false -- только дисперсии (диагональ M2): O(d) памяти и
+	// работы на строку вместо O(d^2).
+	// Объект не потокобезопасен: каждый поток ведёт свой, потом merge
+	class RunningCovariance {
+	public:
+		explicit RunningCovariance(size_t dim, bool full = true);
+
+		size_t dim() const;
+		bool full() const;
+
+		// Число добавленных строк
+		uint64_t count() const;
+
+		// Строка длины dim()
+		void add(const Vector& row);
+		void add(const double* row);
+
+		// Строки пачки; число столбцов -- dim()
+		void add(const Matrix& rows);
+		void add(const MatrixRef& rows);
+
+		// Добавляет накопленное другим объектом той же размерности и вида
+		// (например, другим потоком); false, если они не совпадают
+		bool merge(const RunningCovariance& other);
+
+		void reset();
+
+		Vector mean() const;
+
+		// M2 / (n - ddof) по диагонали; нули, пока n <= ddof
+		Vector variance(size_t ddof = 1) const;
+
+		// M2 / (n - ddof); для full == false -- диагональная матрица
+		Matrix covariance(size_t ddof = 1) const;
+
+		// Корреляции; для столбца с нулевой дисперсией -- нули (и 1 на диагонали)
+		Matrix correlation() const;
+
+	private:
+		// Сливает пачку из _centered, уже центрированную по её среднему
+		// batch_mean; batch_mean портится
+		void merge_batch(size_t rows, double* batch_mean);
+
+		size_t _dim;
+		bool _full;
+		uint64_t _count = 0;
+		std::vector<double> _mean;
+		std::vector<double> _m2;           // d x d по строкам или диагональ
+		// Рабочая память пачки (центрированные строки, среднее) и окна для
+		// syrk; указатели на строки заполняются перед каждым вызовом
+		std::vector<double> _centered;
+		std::vector<double> _batch_mean;
+		std::vector<double*> _centered_rows, _m2_rows;
+	};
+
+	// Статистики строк матрицы, посчитанные параллельно: пул делит строки
+	// на части, каждая часть накапливается отдельно, части сливаются merge
+	RunningCovariance column_statistics(const Matrix& rows, bool full = true);
+
+	// Главные компоненты
+	struct Pca {
+		Pca(size_t dim, size_t components);
+
+		Vector mean;
+		Matrix components;                 // k x d, строки -- единичные оси по убыванию дисперсии
+		Vector explained_variance;         // k собственных значений ковариации
+		Vector explained_variance_ratio;   // их доли в полной дисперсии
+		bool ok = false;
+
+		// Координаты строк в базисе компонент: (rows - mean) components^T, n x k
+		Matrix transform(const Matrix& rows) const;
+
+		// Обратно: scores components + mean, n x d
+		Matrix inverse_transform(const Matrix& scores) const;
+	};
+
+	// PCA по накопленной ковариации (ddof = 1): собственные векторы
+	// SymmetricEigen, k старших (0 -- все). Знак каждой компоненты выбран
+	// так, чтобы наибольшая по модулю координата была положительной.
+	// ok == false, если ковариация не полная, строк меньше двух или
+	// разложение не сошлось
+	Pca pca(const RunningCovariance& stats, size_t components = 0);
+
+} // namespace mat_vec
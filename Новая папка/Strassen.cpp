@@ -0,0 +1,175 @@
+#include "Strassen.h"
+#include "Arena.h"
+#include "Gemm.h"
+#include "Matrix.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace mat_vec {
+
+	namespace {
+
+		size_t align64(size_t bytes) { return (bytes + 63) & ~(size_t)63; }
+
+		// Байт под временную матрицу r x c вместе с массивом строк
+		size_t matrix_bytes(size_t r, size_t c) {
+			return align64(r * sizeof(double*)) + align64(r * c * sizeof(double));
+		}
+
+		// Размечает временную матрицу r x c в рабочей памяти p
+		MatrixRef take(char*& p, size_t r, size_t c) {
+			double** rows = reinterpret_cast<double**>(p);
+			p += align64(r * sizeof(double*));
+			double* data = reinterpret_cast<double*>(p);
+			p += align64(r * c * sizeof(double));
+			for (size_t i = 0; i < r; i++) rows[i] = data + i * c;
+			return { rows, 0, r, c };
+		}
+
+		// dst = x + sign * y
+		void combine(const MatrixRef& dst, const MatrixRef& x, const MatrixRef& y, double sign) {
+			for (size_t i = 0; i < dst.n_rows; i++) {
+				double* d = dst.row(i);
+				const double* a = x.row(i);
+				const double* b = y.row(i);
+				if (sign > 0) for (size_t j = 0; j < dst.n_cols; j++) d[j] = a[j] + b[j];
+				else for (size_t j = 0; j < dst.n_cols; j++) d[j] = a[j] - b[j];
+			}
+		}
+
+		struct Plan {
+			int depth;
+			int parallel_depth;
+			std::vector<size_t> workspace;   // байт рабочей памяти на уровень
+		};
+
+		// Рабочая память уровня level и всех нижележащих
+		size_t workspace_bytes(size_t m, size_t k, size_t n, int level, const Plan& plan) {
+			if (level == plan.depth) return 0;
+			size_t m2 = m / 2, k2 = k / 2, n2 = n / 2;
+			size_t own = 4 * matrix_bytes(m2, k2) + 4 * matrix_bytes(k2, n2) + 7 * matrix_bytes(m2, n2);
+			size_t child = workspace_bytes(m2, k2, n2, level + 1, plan);
+			return own + (level < plan.parallel_depth ? 7 : 1) * child;
+		}
+
+		// C = A * B, размеры делятся на 2^(depth - level)
+		void multiply(const MatrixRef& A, const MatrixRef& B, const MatrixRef& C,
+			char* ws, int level, const Plan& plan) {
+			if (level == plan.depth) {
+				gemm(1.0, A, B, 0.0, C);
+				return;
+			}
+			size_t m2 = A.n_rows / 2, k2 = A.n_cols / 2, n2 = B.n_cols / 2;
+			MatrixRef A11 = A.block(0, 0, m2, k2), A12 = A.block(0, k2, m2, k2);
+			MatrixRef A21 = A.block(m2, 0, m2, k2), A22 = A.block(m2, k2, m2, k2);
+			MatrixRef B11 = B.block(0, 0, k2, n2), B12 = B.block(0, n2, k2, n2);
+			MatrixRef B21 = B.block(k2, 0, k2, n2), B22 = B.block(k2, n2, k2, n2);
+			MatrixRef C11 = C.block(0, 0, m2, n2), C12 = C.block(0, n2, m2, n2);
+			MatrixRef C21 = C.block(m2, 0, m2, n2), C22 = C.block(m2, n2, m2, n2);
+
+			char* p = ws;
+			MatrixRef S[4], T[4], M[7];
+			for (auto& s : S) s = take(p, m2, k2);
+			for (auto& t : T) t = take(p, k2, n2);
+			for (auto& x : M) x = take(p, m2, n2);
+
+			combine(S[0], A21, A22, 1);
+			combine(S[1], S[0], A11, -1);
+			combine(S[2], A11, A21, -1);
+			combine(S[3], A12, S[1], -1);
+			combine(T[0], B12, B11, -1);
+			combine(T[1], B22, T[0], -1);
+			combine(T[2], B22, B12, -1);
+			combine(T[3], T[1], B21, -1);
+
+			const MatrixRef* lhs[7] = { &A11, &A12, &S[3], &A22, &S[0], &S[1], &S[2] };
+			const MatrixRef* rhs[7] = { &B11, &B21, &B22, &T[3], &T[0], &T[1], &T[2] };
+			size_t child = plan.workspace[level + 1];
+			if (level < plan.parallel_depth) {
+				// первое произведение считает сам поток, остальные может забрать пул
+				TaskGroup group;
+				for (int i = 1; i < 7; i++) {
+					char* child_ws = p + i * child;
+					group.run([&, i, child_ws] { multiply(*lhs[i], *rhs[i], M[i], child_ws, level + 1, plan); });
+				}
+				multiply(*lhs[0], *rhs[0], M[0], p, level + 1, plan);
+				group.wait();
+			}
+			else {
+				for (int i = 0; i < 7; i++) multiply(*lhs[i], *rhs[i], M[i], p, level + 1, plan);
+			}
+
+			combine(C11, M[0], M[1], 1);      // U1 = M1 + M2
+			combine(M[5], M[5], M[0], 1);     // U2 = M1 + M6
+			combine(M[6], M[6], M[5], 1);     // U3 = U2 + M7
+			combine(M[5], M[5], M[4], 1);     // U4 = U2 + M5
+			combine(C12, M[5], M[2], 1);      // U5 = U4 + M3
+			combine(C21, M[6], M[3], -1);     // U6 = U3 - M4
+			combine(C22, M[6], M[4], 1);      // U7 = U3 + M5
+		}
+
+		// Непрерывная матрица r x c из арены, заполненная нулями
+		MatrixRef make_padded(ScratchArena& arena, size_t r, size_t c) {
+			char* p = static_cast<char*>(arena.allocate(matrix_bytes(r, c)));
+			MatrixRef res = take(p, r, c);
+			if (r) std::memset(res.rows[0], 0, r * c * sizeof(double));
+			return res;
+		}
+
+		void copy(const MatrixRef& dst, const MatrixRef& src) {
+			for (size_t i = 0; i < src.n_rows; i++)
+				std::memcpy(dst.row(i), src.row(i), src.n_cols * sizeof(double));
+		}
+	}
+
+	// -Произведение A * B по схеме Штрассена-Винограда
+	Matrix strassen_multiply(const Matrix& A, const Matrix& B, const StrassenOptions& options, StrassenStats* stats) {
+		MAT_VEC_SCOPE("strassen_multiply");
+		auto start = std::chrono::steady_clock::now();
+		size_t m = A._size.first, k = A._size.second, n = B._size.second;
+		Matrix C(m, n, 0.0);
+		ScratchArena& arena = options.arena ? *options.arena : ScratchArena::local();
+		size_t crossover = std::max(options.crossover, (size_t)16);
+
+		Plan plan;
+		plan.depth = 0;
+		while ((std::min(m, std::min(k, n)) >> (plan.depth + 1)) >= crossover) plan.depth++;
+		plan.parallel_depth = std::min(plan.depth, std::max(options.parallel_depth, 0));
+		if (ThreadPool::global().size() == 0) plan.parallel_depth = 0;
+
+		size_t unit = (size_t)1 << plan.depth;
+		size_t mp = (m + unit - 1) / unit * unit, kp = (k + unit - 1) / unit * unit, np = (n + unit - 1) / unit * unit;
+		plan.workspace.resize(plan.depth + 1);
+		for (int level = 0; level <= plan.depth; level++)
+			plan.workspace[level] = workspace_bytes(mp >> level, kp >> level, np >> level, level, plan);
+
+		size_t mark = arena.mark();
+		MatrixRef a = view(A), b = view(B), c = view(C);
+		bool padded = mp != m || kp != k || np != n;
+		if (padded) {
+			a = make_padded(arena, mp, kp);
+			b = make_padded(arena, kp, np);
+			c = make_padded(arena, mp, np);
+			copy(a, view(A));
+			copy(b, view(B));
+		}
+		char* ws = plan.workspace[0] ? static_cast<char*>(arena.allocate(plan.workspace[0])) : nullptr;
+		multiply(a, b, c, ws, 0, plan);
+		if (padded) copy(view(C), c.block(0, 0, m, n));
+		size_t used = arena.mark() - mark;
+		arena.rewind(mark);
+
+		if (stats) {
+			stats->depth = plan.depth;
+			stats->workspace_bytes = used;
+			stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			stats->gflops = stats->seconds > 0 ? 2.0 * m * n * k / stats->seconds * 1e-9 : 0;
+		}
+		return C;
+	}
+
+} // namespace mat_vec
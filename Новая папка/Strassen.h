@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Base.h"
+#include <cstddef>
+
+namespace mat_vec {
+
+	class ScratchArena;
+
+	// Параметры умножения Штрассена-Винограда
+	struct StrassenOptions {
+		// Блоки меньше crossover по любому измерению умножаются через gemm
+		size_t crossover = 512;
+
+		// На первых parallel_depth уровнях рекурсии 7 подпроизведений
+		// выполняются параллельно (требует больше рабочей памяти)
+		int parallel_depth = 1;
+
+		// Арена для рабочей памяти; nullptr -- ScratchArena::local()
+		ScratchArena* arena = nullptr;
+	};
+
+	// Сведения о выполненном умножении
+	struct StrassenStats {
+		int depth = 0;                 // число уровней рекурсии
+		size_t workspace_bytes = 0;    // рабочая память из арены
+		double seconds = 0;
+		double gflops = 0;             // эффективные GFLOP/s, считая 2*m*n*k операций
+	};
+
+	// Произведение A * B по схеме Штрассена-Винограда поверх блочного gemm.
+	// Погрешность выше, чем у обычного умножения, поэтому схема включается
+	// только явным вызовом этой функции.
+	Matrix strassen_multiply(const Matrix& A, const Matrix& B,
+		const StrassenOptions& options = StrassenOptions(), StrassenStats* stats = nullptr);
+
+} // namespace mat_vec
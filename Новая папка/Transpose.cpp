@@ -0,0 +1,169 @@
+#include "Transpose.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MAT_VEC_SSE2
+#endif
+
+namespace mat_vec {
+
+	namespace {
+
+		// Сторона плитки из текущих настроек (не меньше 2)
+		size_t tile_size() {
+			return std::max<size_t>(2, transpose_blocking().tile);
+		}
+
+		// Начиная с этого числа элементов транспонирование идёт в несколько потоков
+		const size_t PARALLEL_SIZE = 256 * 256;
+
+		// Транспонирует плитку src[r0.., c0..] размером nr x nc в dst
+		void transpose_tile(const MatrixRef& src, const MatrixRef& dst, size_t r0, size_t c0, size_t nr, size_t nc) {
+			size_t i = 0;
+#ifdef MAT_VEC_SSE2
+			for (; i + 2 <= nr; i += 2) {
+				const double* s0 = src.row(r0 + i) + c0;
+				const double* s1 = src.row(r0 + i + 1) + c0;
+				size_t j = 0;
+				for (; j + 2 <= nc; j += 2) {
+					__m128d x = _mm_loadu_pd(s0 + j);
+					__m128d y = _mm_loadu_pd(s1 + j);
+					_mm_storeu_pd(dst.row(c0 + j) + r0 + i, _mm_unpacklo_pd(x, y));
+					_mm_storeu_pd(dst.row(c0 + j + 1) + r0 + i, _mm_unpackhi_pd(x, y));
+				}
+				for (; j < nc; j++) {
+					dst.row(c0 + j)[r0 + i] = s0[j];
+					dst.row(c0 + j)[r0 + i + 1] = s1[j];
+				}
+			}
+#endif
+			for (; i < nr; i++) {
+				const double* s = src.row(r0 + i) + c0;
+				for (size_t j = 0; j < nc; j++) dst.row(c0 + j)[r0 + i] = s[j];
+			}
+		}
+
+		// Делит большее измерение пополам, пока блок не станет плиткой
+		void transpose_rec(const MatrixRef& src, const MatrixRef& dst, size_t r0, size_t c0, size_t nr, size_t nc,
+			size_t tile) {
+			if (nr <= tile && nc <= tile) {
+				transpose_tile(src, dst, r0, c0, nr, nc);
+			}
+			else if (nr >= nc) {
+				size_t half = nr / 2;
+				transpose_rec(src, dst, r0, c0, half, nc, tile);
+				transpose_rec(src, dst, r0 + half, c0, nr - half, nc, tile);
+			}
+			else {
+				size_t half = nc / 2;
+				transpose_rec(src, dst, r0, c0, nr, half, tile);
+				transpose_rec(src, dst, r0, c0 + half, nr, nc - half, tile);
+			}
+		}
+
+		// Блоки меньше этого числа элементов не делятся между потоками
+		const size_t TASK_SIZE = 128 * 128;
+
+		// То же, что transpose_rec, но половины крупных блоков
+		// выполняются параллельно
+		void transpose_par(const MatrixRef& src, const MatrixRef& dst, size_t r0, size_t c0, size_t nr, size_t nc,
+			size_t tile) {
+			if (nr * nc <= TASK_SIZE) {
+				transpose_rec(src, dst, r0, c0, nr, nc, tile);
+			}
+			else if (nr >= nc) {
+				size_t half = nr / 2;
+				fork_join([&] { transpose_par(src, dst, r0, c0, half, nc, tile); },
+					[&] { transpose_par(src, dst, r0 + half, c0, nr - half, nc, tile); });
+			}
+			else {
+				size_t half = nc / 2;
+				fork_join([&] { transpose_par(src, dst, r0, c0, nr, half, tile); },
+					[&] { transpose_par(src, dst, r0, c0 + half, nr, nc - half, tile); });
+			}
+		}
+
+		// Транспонирует квадратную плитку на месте
+		void transpose_diag_tile(const MatrixRef& m, size_t r0, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				double* ri = m.row(r0 + i) + r0;
+				for (size_t j = i + 1; j < n; j++) std::swap(ri[j], m.row(r0 + j)[r0 + i]);
+			}
+		}
+
+		// Меняет местами плитку (r0, c0) с транспонированной плиткой (c0, r0)
+		void swap_tiles(const MatrixRef& m, size_t r0, size_t c0, size_t nr, size_t nc) {
+			for (size_t i = 0; i < nr; i++) {
+				double* ri = m.row(r0 + i) + c0;
+				for (size_t j = 0; j < nc; j++) std::swap(ri[j], m.row(c0 + j)[r0 + i]);
+			}
+		}
+	}
+
+	// -Текущие размеры плиток
+	TransposeBlocking& transpose_blocking() {
+		static TransposeBlocking blocking;
+		return blocking;
+	}
+
+	// -dst = src^T
+	void transpose(const MatrixRef& src, const MatrixRef& dst) {
+		MAT_VEC_SCOPE("transpose");
+		size_t rows = src.n_rows, cols = src.n_cols;
+		size_t tile = tile_size();
+		if (rows * cols < PARALLEL_SIZE) {
+			transpose_rec(src, dst, 0, 0, rows, cols, tile);
+			return;
+		}
+		// половины блока независимы: каждая пишет свою часть dst
+		transpose_par(src, dst, 0, 0, rows, cols, tile);
+	}
+
+	// -Транспонирует квадратное окно на месте
+	void transpose_square_inplace(const MatrixRef& m) {
+		MAT_VEC_SCOPE("transpose_square_inplace");
+		size_t n = m.n_rows;
+		size_t tile = tile_size();
+		size_t tiles = (n + tile - 1) / tile;
+		parallel_for(0, tiles, n * n < PARALLEL_SIZE ? tiles : 1, [&](size_t from, size_t to) {
+			for (size_t bi = from; bi < to; bi++) {
+				size_t r0 = bi * tile, nr = std::min(tile, n - r0);
+				transpose_diag_tile(m, r0, nr);
+				for (size_t c0 = r0 + tile; c0 < n; c0 += tile)
+					swap_tiles(m, r0, c0, nr, std::min(tile, n - c0));
+			}
+		});
+	}
+
+	// -Транспонирует на месте непрерывный массив rows x cols
+	void transpose_inplace(double* data, size_t rows, size_t cols) {
+		MAT_VEC_SCOPE("transpose_inplace");
+		size_t n = rows * cols;
+		if (rows <= 1 || cols <= 1) return;
+		if (rows == cols) {
+			std::vector<double*> ptr(rows);
+			for (size_t i = 0; i < rows; i++) ptr[i] = data + i * cols;
+			transpose_square_inplace({ ptr.data(), 0, rows, cols });
+			return;
+		}
+		// элемент с индексом k переходит на место k * rows mod (n - 1)
+		std::vector<bool> visited(n);
+		for (size_t start = 1; start + 1 < n; start++) {
+			if (visited[start]) continue;
+			size_t cur = start;
+			double value = data[start];
+			do {
+				size_t next = (size_t)((unsigned long long)cur * rows % (n - 1));
+				std::swap(value, data[next]);
+				visited[next] = true;
+				cur = next;
+			} while (cur != start);
+		}
+	}
+
+} // namespace mat_vec
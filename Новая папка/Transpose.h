@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Gemm.h"
+#include <cstddef>
+
+namespace mat_vec {
+
+	// Размер плитки транспонирования: сторона квадрата, который целиком
+	// помещается в L1 вместе с парной плиткой назначения
+	struct TransposeBlocking {
+		size_t tile = 32;
+	};
+
+	// Текущие размеры плиток (используются всеми вызовами transpose)
+	TransposeBlocking& transpose_blocking();
+
+	// dst = src^T; dst имеет размеры src.n_cols x src.n_rows.
+	// Рекурсивное (cache-oblivious) деление до плиток, большие матрицы
+	// обрабатываются несколькими потоками
+	void transpose(const MatrixRef& src, const MatrixRef& dst);
+
+	// Транспонирует квадратное окно на месте, переставляя пары плиток
+	void transpose_square_inplace(const MatrixRef& m);
+
+	// Транспонирует на месте непрерывный массив rows x cols (построчно)
+	// обходом циклов перестановки; дополнительная память -- rows * cols бит
+	void transpose_inplace(double* data, size_t rows, size_t cols);
+
+} // namespace mat_vec
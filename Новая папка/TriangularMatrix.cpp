@@ -0,0 +1,222 @@
+#include "TriangularMatrix.h"
+#include "Matrix.h"
+#include "Vector.h"
+#include "Profiler.h"
+#include <algorithm>
+
+namespace mat_vec {
+
+	namespace {
+
+		// Размер диагонального блока в trsm/trmm
+		const size_t NB = 64;
+
+		// b_i -= t * b_p для строк правой части
+		void axpy_row(double* bi, const double* bp, double t, size_t n) {
+			for (size_t j = 0; j < n; j++) bi[j] -= t * bp[j];
+		}
+
+		void scale_row(double* bi, double t, size_t n) {
+			for (size_t j = 0; j < n; j++) bi[j] *= t;
+		}
+	}
+
+	// -B = T^-1 * B
+	void trsm(const MatrixRef& T, bool lower, bool unit_diag, const MatrixRef& B) {
+		MAT_VEC_SCOPE("trsm");
+		size_t n = T.n_rows, m = B.n_cols;
+		MAT_VEC_COUNT_FLOPS((uint64_t)n * n * m);
+		if (lower) {
+			for (size_t k0 = 0; k0 < n; k0 += NB) {
+				size_t kb = std::min(NB, n - k0);
+				for (size_t i = k0; i < k0 + kb; i++) {
+					double* bi = B.row(i);
+					const double* ti = T.row(i);
+					for (size_t p = k0; p < i; p++) axpy_row(bi, B.row(p), ti[p], m);
+					if (!unit_diag) scale_row(bi, 1 / ti[i], m);
+				}
+				size_t rest = n - k0 - kb;
+				if (rest) gemm(-1.0, T.block(k0 + kb, k0, rest, kb), B.block(k0, 0, kb, m), 1.0, B.block(k0 + kb, 0, rest, m));
+			}
+		}
+		else {
+			for (size_t end = n; end > 0;) {
+				size_t kb = std::min(NB, end), k0 = end - kb;
+				for (size_t i = end; i-- > k0;) {
+					double* bi = B.row(i);
+					const double* ti = T.row(i);
+					for (size_t p = i + 1; p < end; p++) axpy_row(bi, B.row(p), ti[p], m);
+					if (!unit_diag) scale_row(bi, 1 / ti[i], m);
+				}
+				if (k0) gemm(-1.0, T.block(0, k0, k0, kb), B.block(k0, 0, kb, m), 1.0, B.block(0, 0, k0, m));
+				end = k0;
+			}
+		}
+	}
+
+	// -B = T * B
+	void trmm(const MatrixRef& T, bool lower, bool unit_diag, const MatrixRef& B) {
+		MAT_VEC_SCOPE("trmm");
+		size_t n = T.n_rows, m = B.n_cols;
+		MAT_VEC_COUNT_FLOPS((uint64_t)n * n * m);
+		if (lower) {
+			// снизу вверх: строки выше текущей ещё не изменены
+			for (size_t end = n; end > 0;) {
+				size_t kb = std::min(NB, end), k0 = end - kb;
+				for (size_t i = end; i-- > k0;) {
+					double* bi = B.row(i);
+					const double* ti = T.row(i);
+					if (!unit_diag) scale_row(bi, ti[i], m);
+					for (size_t p = k0; p < i; p++) axpy_row(bi, B.row(p), -ti[p], m);
+				}
+				if (k0) gemm(1.0, T.block(k0, 0, kb, k0), B.block(0, 0, k0, m), 1.0, B.block(k0, 0, kb, m));
+				end = k0;
+			}
+		}
+		else {
+			// сверху вниз: строки ниже текущей ещё не изменены
+			for (size_t k0 = 0; k0 < n; k0 += NB) {
+				size_t kb = std::min(NB, n - k0);
+				for (size_t i = k0; i < k0 + kb; i++) {
+					double* bi = B.row(i);
+					const double* ti = T.row(i);
+					if (!unit_diag) scale_row(bi, ti[i], m);
+					for (size_t p = i + 1; p < k0 + kb; p++) axpy_row(bi, B.row(p), -ti[p], m);
+				}
+				size_t rest = n - k0 - kb;
+				if (rest) gemm(1.0, T.block(k0, k0 + kb, kb, rest), B.block(k0 + kb, 0, rest, m), 1.0, B.block(k0, 0, kb, m));
+			}
+		}
+	}
+
+	// -Конструирует треугольную матрицу size x size
+	TriangularMatrix::TriangularMatrix(size_t size, bool lower, double value)
+		: _n(size), _lower(lower), _data(size * (size + 1) / 2, value) {
+		MAT_VEC_COUNT_ALLOC(_data.size() * sizeof(double));
+		link();
+	}
+
+	// -Треугольник матрицы mat
+	TriangularMatrix::TriangularMatrix(const Matrix& mat, bool lower)
+		: TriangularMatrix(mat._size.first, lower) {
+		for (size_t i = 0; i < _n; i++) {
+			size_t from = _lower ? 0 : i, to = _lower ? i + 1 : _n;
+			for (size_t j = from; j < to; j++) _rows[i][j] = mat.a[i][j];
+		}
+	}
+
+	// -Конструктор копирования
+	TriangularMatrix::TriangularMatrix(const TriangularMatrix& src)
+		: _n(src._n), _lower(src._lower), _data(src._data) {
+		MAT_VEC_COUNT_COPY(_data.size() * sizeof(double));
+		link();
+	}
+
+	// -Оператор присваивания
+	TriangularMatrix& TriangularMatrix::operator=(const TriangularMatrix& rhs) {
+		_n = rhs._n;
+		_lower = rhs._lower;
+		_data = rhs._data;
+		MAT_VEC_COUNT_COPY(_data.size() * sizeof(double));
+		link();
+		return *this;
+	}
+
+	// Строит указатели так, что _rows[i][j] -- элемент (i, j)
+	void TriangularMatrix::link() {
+		_rows.resize(_n);
+		for (size_t i = 0; i < _n; i++) {
+			size_t offset = _lower ? i * (i + 1) / 2 : i * _n - i * (i - 1) / 2 - i;
+			_rows[i] = _data.data() + offset;
+		}
+	}
+
+	// -Размер матрицы
+	size_t TriangularMatrix::size() const { return _n; }
+
+	// -true для нижней треугольной
+	bool TriangularMatrix::lower() const { return _lower; }
+
+	// -Возвращает элемент на позиции [row, col]
+	double TriangularMatrix::get(size_t row, size_t col) const {
+		if (_lower ? col > row : col < row) return 0;
+		return _rows[row][col];
+	}
+
+	// -Ссылка на элемент внутри треугольника
+	double& TriangularMatrix::at(size_t row, size_t col) { return _rows[row][col]; }
+
+	// -Окно для trsm/trmm
+	MatrixRef TriangularMatrix::ref() const {
+		return { _rows.data(), 0, _n, _n };
+	}
+
+	// -Умножение на вектор
+	Vector TriangularMatrix::operator*(const Vector& vec) const {
+		MAT_VEC_COUNT_FLOPS((uint64_t)_n * (_n + 1));
+		Vector c(_n, 0);
+		for (size_t i = 0; i < _n; i++) {
+			size_t from = _lower ? 0 : i, to = _lower ? i + 1 : _n;
+			const double* r = _rows[i];
+			double s = 0;
+			for (size_t j = from; j < to; j++) s += r[j] * vec[j];
+			c[i] = s;
+		}
+		return c;
+	}
+
+	// -Умножение на плотную матрицу
+	Matrix TriangularMatrix::operator*(const Matrix& mat) const {
+		Matrix c = mat;
+		trmm(ref(), _lower, false, view(c));
+		return c;
+	}
+
+	// -Решение T x = b
+	Vector TriangularMatrix::solve(const Vector& b) const {
+		MAT_VEC_COUNT_FLOPS((uint64_t)_n * (_n + 1));
+		Vector x = b;
+		if (_lower) {
+			for (size_t i = 0; i < _n; i++) {
+				const double* r = _rows[i];
+				double s = x[i];
+				for (size_t j = 0; j < i; j++) s -= r[j] * x[j];
+				x[i] = s / r[i];
+			}
+		}
+		else {
+			for (size_t i = _n; i-- > 0;) {
+				const double* r = _rows[i];
+				double s = x[i];
+				for (size_t j = i + 1; j < _n; j++) s -= r[j] * x[j];
+				x[i] = s / r[i];
+			}
+		}
+		return x;
+	}
+
+	// -Решение T X = B
+	Matrix TriangularMatrix::solve(const Matrix& b) const {
+		Matrix x = b;
+		trsm(ref(), _lower, false, view(x));
+		return x;
+	}
+
+	// -Определитель
+	double TriangularMatrix::det() const {
+		double d = 1;
+		for (size_t i = 0; i < _n; i++) d *= _rows[i][i];
+		return d;
+	}
+
+	// -Плотная матрица
+	Matrix TriangularMatrix::to_dense() const {
+		Matrix m(_n, 0.0);
+		for (size_t i = 0; i < _n; i++) {
+			size_t from = _lower ? 0 : i, to = _lower ? i + 1 : _n;
+			for (size_t j = from; j < to; j++) m.a[i][j] = _rows[i][j];
+		}
+		return m;
+	}
+
+} // namespace mat_vec
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Base.h"
+#include "Gemm.h"
+#include <cstddef>
+#include <vector>
+
+namespace mat_vec {
+
+	// B = T^-1 * B, где T -- нижний (lower) или верхний треугольник окна T.
+	// При unit_diag диагональ T считается единичной и не читается.
+	// Внедиагональные блоки обрабатываются через gemm
+	void trsm(const MatrixRef& T, bool lower, bool unit_diag, const MatrixRef& B);
+
+	// B = T * B для треугольника окна T (на месте)
+	void trmm(const MatrixRef& T, bool lower, bool unit_diag, const MatrixRef& B);
+
+	// Треугольная матрица в упакованном построчном хранении, n(n+1)/2 элементов
+	class TriangularMatrix {
+	public:
+		// Конструирует нижнюю (lower) или верхнюю треугольную матрицу size x size,
+		// заполняя треугольник значением value
+		TriangularMatrix(size_t size, bool lower, double value = 0);
+
+		// Нижний или верхний треугольник (вместе с диагональю) матрицы mat
+		TriangularMatrix(const Matrix& mat, bool lower);
+
+		// Конструктор копирования
+		TriangularMatrix(const TriangularMatrix& src);
+
+		// Оператор присваивания
+		TriangularMatrix& operator=(const TriangularMatrix& rhs);
+
+		// Размер матрицы
+		size_t size() const;
+
+		// true для нижней треугольной
+		bool lower() const;
+
+		// Возвращает элемент на позиции [row, col] (0 вне треугольника)
+		double get(size_t row, size_t col) const;
+
+		// Ссылка на элемент внутри треугольника
+		double& at(size_t row, size_t col);
+
+		// Окно для trsm/trmm; допустимы только элементы треугольника
+		MatrixRef ref() const;
+
+		// Умножение на вектор, n^2/2 умножений
+		Vector operator*(const Vector& vec) const;
+
+		// Умножение на плотную матрицу (trmm)
+		Matrix operator*(const Matrix& mat) const;
+
+		// Решение T x = b прямой или обратной подстановкой
+		Vector solve(const Vector& b) const;
+
+		// Решение T X = B (trsm)
+		Matrix solve(const Matrix& b) const;
+
+		// Определитель -- произведение диагонали
+		double det() const;
+
+		// Плотная матрица с нулями вне треугольника
+		Matrix to_dense() const;
+
+	private:
+		void link();
+
+		size_t _n;
+		bool _lower;
+		std::vector<double> _data;
+		std::vector<double*> _rows;   // _rows[i][j] -- элемент (i, j) треугольника
+	};
+
+} // namespace mat_vec
@@ -0,0 +1,12 @@
+// Отдельная программа настройки ядер. Собирается с MAT_VEC_TUNE_MAIN
+// вместо main.cpp:  tune [--file PATH] [--quick] [--show]
+#ifdef MAT_VEC_TUNE_MAIN
+
+#include "Tuner.h"
+#include <iostream>
+
+int main(int argc, char** argv) {
+	return mat_vec::tune_command(argc, argv, std::cout);
+}
+
+#endif
@@ -0,0 +1,368 @@
+#include "Tuner.h"
+#include "Matrix.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define MAT_VEC_CPUID_MSVC
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define MAT_VEC_CPUID_GNU
+#endif
+
+namespace mat_vec {
+
+	namespace {
+
+		// Варианты, из которых выбирает autotune
+		const size_t KC_CANDIDATES[] = { 128, 192, 256, 384, 512 };
+		const size_t MC_CANDIDATES[] = { 48, 72, 96, 144, 192, 288 };
+		const size_t NC_CANDIDATES[] = { 512, 1024, 2048, 4096 };
+		const size_t TILE_CANDIDATES[] = { 8, 16, 32, 64, 128 };
+		const size_t GEMV_CANDIDATES[] = { 1, 2, 4, 8 };
+
+		std::string trim(const std::string& s) {
+			size_t b = s.find_first_not_of(" \t\r\n");
+			if (b == std::string::npos) return std::string();
+			size_t e = s.find_last_not_of(" \t\r\n");
+			return s.substr(b, e - b + 1);
+		}
+
+		// Строка модели из CPUID (листья 0x80000002..0x80000004)
+		std::string cpuid_brand() {
+			unsigned regs[12] = {};
+#if defined(MAT_VEC_CPUID_MSVC)
+			int r[4];
+			__cpuid(r, 0x80000000);
+			if ((unsigned)r[0] < 0x80000004) return std::string();
+			for (int leaf = 0; leaf < 3; leaf++) {
+				__cpuid(r, 0x80000002 + leaf);
+				for (int k = 0; k < 4; k++) regs[leaf * 4 + k] = (unsigned)r[k];
+			}
+#elif defined(MAT_VEC_CPUID_GNU)
+			if (__get_cpuid_max(0x80000000, nullptr) < 0x80000004) return std::string();
+			for (unsigned leaf = 0; leaf < 3; leaf++) {
+				unsigned* r = regs + leaf * 4;
+				__get_cpuid(0x80000002 + leaf, r, r + 1, r + 2, r + 3);
+			}
+#else
+			return std::string();
+#endif
+			char brand[sizeof(regs) + 1] = {};
+			std::memcpy(brand, regs, sizeof(regs));
+			return trim(brand);
+		}
+
+		// model name из /proc/cpuinfo (Linux без CPUID, например ARM)
+		std::string cpuinfo_model() {
+			std::ifstream in("/proc/cpuinfo");
+			std::string line;
+			while (std::getline(in, line)) {
+				size_t colon = line.find(':');
+				if (colon == std::string::npos) continue;
+				if (trim(line.substr(0, colon)) == "model name") return trim(line.substr(colon + 1));
+			}
+			return std::string();
+		}
+
+		// Лучшее время fn из repeats замеров после одного прогрева
+		template <typename F>
+		double best_time(size_t repeats, F fn) {
+			typedef std::chrono::steady_clock clock;
+			fn();
+			double best = 0;
+			for (size_t r = 0; r < std::max<size_t>(repeats, 1); r++) {
+				clock::time_point t0 = clock::now();
+				fn();
+				double t = std::chrono::duration<double>(clock::now() - t0).count();
+				if (r == 0 || t < best) best = t;
+			}
+			return best;
+		}
+
+		// Перебирает candidates, выставляя value; оставляет самый быстрый
+		template <size_t N, typename F>
+		void pick(const size_t (&candidates)[N], size_t& value, size_t repeats, F fn) {
+			size_t best_value = value;
+			double best = -1;
+			for (size_t c : candidates) {
+				value = c;
+				double t = best_time(repeats, fn);
+				if (best < 0 || t < best) {
+					best = t;
+					best_value = c;
+				}
+			}
+			value = best_value;
+		}
+
+		Matrix random_matrix(size_t rows, size_t cols, std::mt19937_64& rng) {
+			std::uniform_real_distribution<double> dist(-1, 1);
+			Matrix m(rows, cols, 0.0);
+			for (size_t i = 0; i < rows; i++)
+				for (size_t j = 0; j < cols; j++) m.a[i][j] = dist(rng);
+			return m;
+		}
+
+		bool parse_size(const std::string& text, size_t& out) {
+			if (text.empty() || text[0] == '-') return false;
+			char* end = nullptr;
+			unsigned long long v = std::strtoull(text.c_str(), &end, 10);
+			if (*end != 0 || v == 0) return false;
+			out = (size_t)v;
+			return true;
+		}
+
+		// Значение лежит в пределах вариантов, которые перебирает autotune
+		// (candidates по возрастанию): испорченный файл не задаст огромные
+		// буферы упаковки
+		template <size_t N>
+		bool within(const size_t (&candidates)[N], size_t value) {
+			return value >= candidates[0] && value <= candidates[N - 1];
+		}
+
+		// Присваивает field значение, если оно в пределах candidates
+		template <size_t N>
+		bool set_within(const size_t (&candidates)[N], size_t& field, size_t value) {
+			if (!within(candidates, value)) return false;
+			field = value;
+			return true;
+		}
+
+		bool set_field(TuningParams& p, const std::string& key, size_t value) {
+			if (key == "gemm.mc") return set_within(MC_CANDIDATES, p.gemm.mc, value);
+			if (key == "gemm.kc") return set_within(KC_CANDIDATES, p.gemm.kc, value);
+			if (key == "gemm.nc") return set_within(NC_CANDIDATES, p.gemm.nc, value);
+			if (key == "transpose.tile") return set_within(TILE_CANDIDATES, p.transpose.tile, value);
+			if (key == "gemv.rows") {
+				if (std::find(std::begin(GEMV_CANDIDATES), std::end(GEMV_CANDIDATES), value) == std::end(GEMV_CANDIDATES)) return false;
+				p.gemv.rows = value;
+				return true;
+			}
+			return false;
+		}
+
+		void write_entry(std::ostream& out, const std::string& model, const TuningParams& p) {
+			out << '[' << model << "]\n"
+				<< "gemm.mc = " << p.gemm.mc << '\n'
+				<< "gemm.kc = " << p.gemm.kc << '\n'
+				<< "gemm.nc = " << p.gemm.nc << '\n'
+				<< "transpose.tile = " << p.transpose.tile << '\n'
+				<< "gemv.rows = " << p.gemv.rows << '\n';
+		}
+
+		// Параметры из файла применяются до main
+		const bool startup_tuning = [] {
+			const char* env = std::getenv("MAT_VEC_AUTOTUNE");
+			std::string path = tuning_file();
+			if (load_tuning(path)) return true;
+			if (env && std::strcmp(env, "1") == 0) return retune(path);
+			return false;
+		}();
+	}
+
+	// -Текущие параметры
+	TuningParams current_tuning() {
+		TuningParams p;
+		p.gemm = gemm_blocking();
+		p.transpose = transpose_blocking();
+		p.gemv = gemv_blocking();
+		return p;
+	}
+
+	// -Записывает параметры в глобальные настройки ядер
+	void apply_tuning(const TuningParams& params) {
+		gemm_blocking() = params.gemm;
+		transpose_blocking() = params.transpose;
+		gemv_blocking() = params.gemv;
+	}
+
+	// -Модель процессора
+	std::string cpu_model() {
+		std::string model = cpuid_brand();
+		if (model.empty()) model = cpuinfo_model();
+		if (model.empty()) model = "unknown";
+		// имя секции не должно содержать перевода строки
+		std::replace(model.begin(), model.end(), '\n', ' ');
+		return model;
+	}
+
+	// -Маленькие задачи и один замер
+	TuneOptions TuneOptions::quick() {
+		TuneOptions opt;
+		opt.gemm_size = 96;
+		opt.gemm_wide = 256;
+		opt.transpose_size = 256;
+		opt.gemv_size = 256;
+		opt.repeats = 1;
+		return opt;
+	}
+
+	// -Покоординатный перебор: kc, затем mc, затем nc; плитка транспонирования; развёртка gemv
+	TuningParams autotune(const TuneOptions& opt) {
+		std::mt19937_64 rng(1);
+		TuningParams best;
+
+		size_t n = std::max<size_t>(opt.gemm_size, 1);
+		size_t wide = std::max(opt.gemm_wide, n);
+		Matrix a = random_matrix(n, n, rng);
+		Matrix b = random_matrix(n, wide, rng);
+		Matrix c(n, wide, 0.0);
+		MatrixRef bs = view(b).block(0, 0, n, n), cs = view(c).block(0, 0, n, n);
+		auto square = [&] { gemm(1.0, view(a), bs, 0.0, cs, best.gemm); };
+		pick(KC_CANDIDATES, best.gemm.kc, opt.repeats, square);
+		pick(MC_CANDIDATES, best.gemm.mc, opt.repeats, square);
+		// nc влияет только на широкие B
+		pick(NC_CANDIDATES, best.gemm.nc, opt.repeats, [&] { gemm(1.0, view(a), view(b), 0.0, view(c), best.gemm); });
+
+		size_t nt = std::max<size_t>(opt.transpose_size, 1);
+		Matrix src = random_matrix(nt, nt, rng), dst(nt, nt, 0.0);
+		TransposeBlocking saved = transpose_blocking();
+		pick(TILE_CANDIDATES, best.transpose.tile, opt.repeats, [&] {
+			transpose_blocking() = best.transpose;
+			transpose(view(src), view(dst));
+		});
+		transpose_blocking() = saved;
+
+		size_t nv = std::max<size_t>(opt.gemv_size, 1);
+		Matrix m = random_matrix(nv, nv, rng);
+		std::vector<double> x(nv, 1.0), y(nv);
+		pick(GEMV_CANDIDATES, best.gemv.rows, opt.repeats, [&] { gemv(view(m), x.data(), y.data(), best.gemv); });
+		return best;
+	}
+
+	// -Читает файл настроек
+	bool TuningCache::load(const std::string& path) {
+		std::ifstream in(path);
+		if (!in) {
+			_entries.clear();
+			return false;
+		}
+		return read(in);
+	}
+
+	// -Записывает все секции в файл
+	bool TuningCache::save(const std::string& path) const {
+		std::ofstream out(path, std::ios::trunc);
+		if (!out) return false;
+		write(out);
+		out.flush();
+		return (bool)out;
+	}
+
+	// -Разбирает секции; при любой ошибке кэш остаётся пустым
+	bool TuningCache::read(std::istream& in) {
+		_entries.clear();
+		std::map<std::string, TuningParams> entries;
+		TuningParams* current = nullptr;
+		std::string line;
+		while (std::getline(in, line)) {
+			line = trim(line);
+			if (line.empty() || line[0] == '#') continue;
+			if (line[0] == '[') {
+				size_t close = line.rfind(']');
+				if (close == std::string::npos || close != line.size() - 1) return false;
+				current = &entries[trim(line.substr(1, close - 1))];
+				continue;
+			}
+			size_t eq = line.find('=');
+			size_t value = 0;
+			if (!current || eq == std::string::npos || !parse_size(trim(line.substr(eq + 1)), value)) return false;
+			if (!set_field(*current, trim(line.substr(0, eq)), value)) return false;
+		}
+		_entries.swap(entries);
+		return true;
+	}
+
+	void TuningCache::write(std::ostream& out) const {
+		out << "# mat_vec tuning cache\n";
+		for (const auto& e : _entries) {
+			out << '\n';
+			write_entry(out, e.first, e.second);
+		}
+	}
+
+	bool TuningCache::find(const std::string& model, TuningParams& out) const {
+		auto it = _entries.find(model);
+		if (it == _entries.end()) return false;
+		out = it->second;
+		return true;
+	}
+
+	void TuningCache::set(const std::string& model, const TuningParams& params) { _entries[model] = params; }
+	size_t TuningCache::size() const { return _entries.size(); }
+
+	// -Путь к файлу настроек
+	std::string tuning_file() {
+		const char* env = std::getenv("MAT_VEC_TUNING_FILE");
+		if (env && *env) return env;
+		return "mat_vec_tuning.txt";
+	}
+
+	// -Применяет сохранённую запись для этого процессора
+	bool load_tuning(const std::string& path) {
+		TuningCache cache;
+		TuningParams params;
+		if (!cache.load(path) || !cache.find(cpu_model(), params)) return false;
+		apply_tuning(params);
+		return true;
+	}
+
+	// -Подбирает, сохраняет и применяет параметры
+	bool retune(const std::string& path, const TuneOptions& opt) {
+		TuningParams params = autotune(opt);
+		apply_tuning(params);
+		// записи других машин сохраняются; испорченный файл перезаписывается
+		TuningCache cache;
+		cache.load(path);
+		cache.set(cpu_model(), params);
+		return cache.save(path);
+	}
+
+	// -Командная строка настройщика
+	int tune_command(int argc, const char* const* argv, std::ostream& out) {
+		std::string path = tuning_file();
+		bool quick = false, show = false;
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			if (arg == "--quick") quick = true;
+			else if (arg == "--show") show = true;
+			else if (arg == "--file" && i + 1 < argc) path = argv[++i];
+			else {
+				out << "usage: tune [--file PATH] [--quick] [--show]\n";
+				return 2;
+			}
+		}
+
+		std::string model = cpu_model();
+		if (show) {
+			TuningCache cache;
+			TuningParams params;
+			if (!cache.load(path) || !cache.find(model, params)) {
+				out << "no entry for " << model << " in " << path << '\n';
+				return 1;
+			}
+			write_entry(out, model, params);
+			return 0;
+		}
+
+		out << "tuning for " << model << '\n';
+		if (!retune(path, quick ? TuneOptions::quick() : TuneOptions())) {
+			out << "cannot write " << path << '\n';
+			return 1;
+		}
+		write_entry(out, model, current_tuning());
+		out << "saved to " << path << '\n';
+		return 0;
+	}
+
+} // namespace mat_vec
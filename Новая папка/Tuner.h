@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Gemm.h"
+#include "Transpose.h"
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <string>
+
+namespace mat_vec {
+
+	// Настраиваемые параметры ядер
+	struct TuningParams {
+		GemmBlocking gemm;
+		TransposeBlocking transpose;
+		GemvBlocking gemv;
+	};
+
+	// Текущие параметры (gemm_blocking, transpose_blocking, gemv_blocking)
+	TuningParams current_tuning();
+
+	// Записывает параметры в gemm_blocking, transpose_blocking, gemv_blocking
+	void apply_tuning(const TuningParams& params);
+
+	// Модель процессора (строка CPUID или model name из /proc/cpuinfo);
+	// по ней различаются записи в файле настроек
+	std::string cpu_model();
+
+	// Размеры задач для замеров
+	struct TuneOptions {
+		size_t gemm_size = 384;      // A и B -- size x size
+		size_t gemm_wide = 2048;     // столбцов B при подборе nc
+		size_t transpose_size = 2048;
+		size_t gemv_size = 2048;
+		size_t repeats = 3;          // берётся лучшее время из repeats
+
+		// Маленькие задачи и один замер (для проверок)
+		static TuneOptions quick();
+	};
+
+	// Замеряет варианты блоков и развёрток и возвращает лучшие.
+	// Текущие параметры не меняются
+	TuningParams autotune(const TuneOptions& opt = TuneOptions());
+
+	// Файл настроек: по секции [модель процессора] на каждую машину.
+	//   [Intel(R) Xeon(R) ...]
+	//   gemm.mc = 96
+	//   gemm.kc = 256
+	//   gemm.nc = 2048
+	//   transpose.tile = 32
+	//   gemv.rows = 4
+	// Значение вне пределов вариантов, которые перебирает autotune,
+	// считается порчей файла
+	class TuningCache {
+	public:
+		// false, если файла нет или он испорчен (тогда кэш пуст)
+		bool load(const std::string& path);
+		bool save(const std::string& path) const;
+
+		bool read(std::istream& in);
+		void write(std::ostream& out) const;
+
+		bool find(const std::string& model, TuningParams& out) const;
+		void set(const std::string& model, const TuningParams& params);
+		size_t size() const;
+
+	private:
+		std::map<std::string, TuningParams> _entries;
+	};
+
+	// Путь к файлу настроек: переменная окружения MAT_VEC_TUNING_FILE
+	// или mat_vec_tuning.txt в рабочем каталоге
+	std::string tuning_file();
+
+	// Применяет запись для cpu_model() из файла; false, если её нет.
+	// Вызывается при запуске программы; если задана переменная
+	// MAT_VEC_AUTOTUNE=1 и записи нет, параметры подбираются и сохраняются
+	bool load_tuning(const std::string& path = tuning_file());
+
+	// Подбирает параметры заново, сохраняет их в файл под cpu_model()
+	// (остальные записи не трогаются) и применяет. false при ошибке записи
+	bool retune(const std::string& path = tuning_file(), const TuneOptions& opt = TuneOptions());
+
+	// Командная строка настройщика:
+	//   tune [--file PATH] [--quick] [--show]
+	// --show печатает сохранённую запись, не запуская замеры.
+	// Код возврата 0 при успехе
+	int tune_command(int argc, const char* const* argv, std::ostream& out);
+
+} // namespace mat_vec
@@ -0,0 +1,197 @@
+#include "Updatable.h"
+#include "Gemm.h"
+#include "Vector.h"
+#include "Profiler.h"
+#include "Reduce.h"
+#include <algorithm>
+#include <cmath>
+
+namespace mat_vec {
+
+	// -Создаёт разложение матрицы a
+	UpdatableFactorization::UpdatableFactorization(const Matrix& a, Kind kind, double tolerance, size_t check_interval)
+		: _kind(kind), _a(a), _inv(0), _det(0), _tolerance(tolerance),
+		_check_interval(std::max(check_interval, (size_t)1)) {
+		refactor();
+		_refactorizations = 0;
+	}
+
+	// -A += u v^T
+	void UpdatableFactorization::update(const Vector& u, const Vector& v) {
+		MAT_VEC_SCOPE("UpdatableFactorization::update");
+		size_t n = _a._size.first;
+		for (size_t i = 0; i < n; i++)
+			for (size_t j = 0; j < n; j++) _a.a[i][j] += u[i] * v[j];
+
+		if (_kind == INVERSE) {
+			// A^-1 -= (A^-1 u)(v^T A^-1) / (1 + v^T A^-1 u)
+			Vector z = _inv * u;
+			Vector w(n, 0);
+			for (size_t i = 0; i < n; i++)
+				for (size_t j = 0; j < n; j++) w[j] += v[i] * _inv.a[i][j];
+			double den = 1 + (v * z);
+			if (std::fabs(den) < 1e-12 * (1 + norm_inf(v) * norm_inf(z))) {
+				refactor();
+			}
+			else {
+				for (size_t i = 0; i < n; i++) {
+					double zi = z[i] / den;
+					for (size_t j = 0; j < n; j++) _inv.a[i][j] -= zi * w[j];
+				}
+				_det *= den;
+			}
+		}
+		else if (_kind == LU_FACTORS) {
+			_lu->update(u, v);
+		}
+		else {
+			refactor();
+		}
+		after_update();
+	}
+
+	// -A += U V^T
+	void UpdatableFactorization::update(const Matrix& U, const Matrix& V) {
+		MAT_VEC_SCOPE("UpdatableFactorization::update(rank-k)");
+		size_t n = _a._size.first, k = U._size.second;
+		Matrix Vt = V.transposed();
+		gemm(1.0, view(U), view(Vt), 1.0, view(_a));
+
+		if (_kind == INVERSE) {
+			// формула Вудбери: A^-1 -= A^-1 U (I + V^T A^-1 U)^-1 V^T A^-1
+			Matrix Z(n, k, 0.0), W(k, n, 0.0), S = Matrix::eye(k);
+			gemm(1.0, view(_inv), view(U), 0.0, view(Z));
+			gemm(1.0, view(Vt), view(_inv), 0.0, view(W));
+			gemm(1.0, view(Vt), view(Z), 1.0, view(S));
+			LU small(S);
+			if (small.singular()) {
+				refactor();
+			}
+			else {
+				Matrix X = small.solve(W);
+				gemm(-1.0, view(Z), view(X), 1.0, view(_inv));
+				_det *= small.det();
+			}
+		}
+		else if (_kind == LU_FACTORS) {
+			for (size_t c = 0; c < k; c++) {
+				Vector u(n, 0), v(n, 0);
+				for (size_t i = 0; i < n; i++) {
+					u[i] = U.a[i][c];
+					v[i] = V.a[i][c];
+				}
+				_lu->update(u, v);
+			}
+		}
+		else {
+			refactor();
+		}
+		_updates += k > 0 ? k - 1 : 0;
+		after_update();
+	}
+
+	// -A += sign * x x^T
+	void UpdatableFactorization::symmetric_update(const Vector& x, double sign) {
+		if (_kind != CHOLESKY) {
+			update(x * sign, x);
+			return;
+		}
+		size_t n = _a._size.first;
+		for (size_t i = 0; i < n; i++)
+			for (size_t j = 0; j < n; j++) _a.a[i][j] += sign * x[i] * x[j];
+		Vector y = x * std::sqrt(std::fabs(sign));
+		if (sign >= 0) _chol->update(y);
+		else if (!_chol->downdate(y)) refactor();
+		after_update();
+	}
+
+	// -Замена строки i
+	void UpdatableFactorization::replace_row(size_t i, const Vector& row) {
+		size_t n = _a._size.first;
+		Vector u(n, 0), v = row;
+		u[i] = 1;
+		for (size_t j = 0; j < n; j++) v[j] -= _a.a[i][j];
+		update(u, v);
+	}
+
+	// -Замена столбца j
+	void UpdatableFactorization::replace_col(size_t j, const Vector& col) {
+		size_t n = _a._size.first;
+		Vector u = col, v(n, 0);
+		v[j] = 1;
+		for (size_t i = 0; i < n; i++) u[i] -= _a.a[i][j];
+		update(u, v);
+	}
+
+	// -Текущая матрица
+	const Matrix& UpdatableFactorization::matrix() const { return _a; }
+
+	// -Решение A x = b
+	Vector UpdatableFactorization::solve(const Vector& b) const {
+		if (_kind == INVERSE) return _inv * b;
+		if (_kind == LU_FACTORS) return _lu->solve(b);
+		return _chol->solve(b);
+	}
+
+	// -Определитель
+	double UpdatableFactorization::det() const {
+		if (_kind == INVERSE) return _det;
+		if (_kind == LU_FACTORS) return _lu->det();
+		return _chol->det();
+	}
+
+	// -Обратная матрица
+	Matrix UpdatableFactorization::inv() const {
+		if (_kind == INVERSE) return _inv;
+		if (_kind == LU_FACTORS) return _lu->inv();
+		return _chol->solve(Matrix::eye(_a._size.first));
+	}
+
+	// -Относительная невязка последней проверки
+	double UpdatableFactorization::drift() const { return _drift; }
+
+	// -Проверка погрешности по невязке на пробном векторе
+	void UpdatableFactorization::check() {
+		MAT_VEC_SCOPE("UpdatableFactorization::check");
+		_since_check = 0;
+		size_t n = _a._size.first;
+		Vector x(n, 0);
+		unsigned state = 12345;
+		for (size_t i = 0; i < n; i++) {
+			state = state * 1103515245u + 12345u;
+			x[i] = (double)(state >> 16 & 0x7fff) / 0x7fff - 0.5;
+		}
+		Vector b = _a * x;
+		Vector y = solve(b);
+		Vector r = _a * y - b;
+		_drift = norm_inf(r) / (_a.norm_inf() * norm_inf(y) + norm_inf(b));
+		if (!(_drift <= _tolerance)) refactor();
+	}
+
+	// -Пересчёт разложения с нуля
+	void UpdatableFactorization::refactor() {
+		MAT_VEC_SCOPE("UpdatableFactorization::refactor");
+		if (_kind == INVERSE) {
+			LU lu(_a);
+			_inv = lu.inv();
+			_det = lu.det();
+		}
+		else if (_kind == LU_FACTORS) {
+			_lu.reset(new LU(_a));
+		}
+		else {
+			_chol.reset(new Cholesky(_a));
+		}
+		_refactorizations++;
+		_since_check = 0;
+	}
+
+	size_t UpdatableFactorization::updates() const { return _updates; }
+	size_t UpdatableFactorization::refactorizations() const { return _refactorizations; }
+
+	void UpdatableFactorization::after_update() {
+		_updates++;
+		if (++_since_check >= _check_interval) check();
+	}
+
+} // namespace mat_vec
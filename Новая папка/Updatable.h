@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Base.h"
+#include "Decomposition.h"
+#include "Matrix.h"
+#include <cstddef>
+#include <memory>
+
+namespace mat_vec {
+
+	// Разложение матрицы, поддерживаемое при малоранговых изменениях за O(n^2)
+	// вместо O(n^3) на пересчёт. Каждые check_interval обновлений погрешность
+	// проверяется по невязке на пробном векторе; если она выше tolerance,
+	// разложение пересчитывается с нуля
+	class UpdatableFactorization {
+	public:
+		enum Kind {
+			INVERSE,    // явная обратная матрица, формулы Шермана-Моррисона-Вудбери
+			LU_FACTORS, // LU с обновлениями по Беннету
+			CHOLESKY    // Холецкий для симметричных положительно определённых матриц
+		};
+
+		UpdatableFactorization(const Matrix& a, Kind kind = INVERSE,
+			double tolerance = 1e-9, size_t check_interval = 16);
+
+		// A += u v^T. Для CHOLESKY несимметричное обновление ведёт к пересчёту
+		void update(const Vector& u, const Vector& v);
+
+		// A += U V^T для матриц U, V размером n x k
+		void update(const Matrix& U, const Matrix& V);
+
+		// A += sign * x x^T (sign = -1 -- понижение ранга)
+		void symmetric_update(const Vector& x, double sign = 1);
+
+		// Замена строки i и столбца j матрицы A
+		void replace_row(size_t i, const Vector& row);
+		void replace_col(size_t j, const Vector& col);
+
+		// Текущая матрица A
+		const Matrix& matrix() const;
+
+		// Решение A x = b
+		Vector solve(const Vector& b) const;
+
+		// Определитель A
+		double det() const;
+
+		// Обратная матрица A^-1
+		Matrix inv() const;
+
+		// Относительная невязка последней проверки
+		double drift() const;
+
+		// Проверяет погрешность сейчас и при необходимости пересчитывает разложение
+		void check();
+
+		// Пересчитывает разложение с нуля
+		void refactor();
+
+		size_t updates() const;
+		size_t refactorizations() const;
+
+	private:
+		void after_update();
+
+		Kind _kind;
+		Matrix _a;
+		Matrix _inv;                      // для INVERSE
+		double _det;                      // для INVERSE
+		std::unique_ptr<LU> _lu;          // для LU_FACTORS
+		std::unique_ptr<Cholesky> _chol;  // для CHOLESKY
+		double _tolerance;
+		size_t _check_interval;
+		size_t _since_check = 0;
+		size_t _updates = 0;
+		size_t _refactorizations = 0;
+		double _drift = 0;
+	};
+
+} // namespace mat_vec
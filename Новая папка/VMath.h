@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Элементарные функции без ветвлений и обращений к libm: обе ветви
+// вычисляются всегда, а результат выбирается битовой маской, поэтому
+// циклы map/apply_inplace с ними векторизуются компилятором. Погрешность в ULP относительно
+// правильно округлённого результата (проверяется в тестах на
+// равномерной сетке аргументов):
+//   exp, log     <= 1 ULP
+//   expm1        <= 2 ULP
+//   tanh         <= 3 ULP
+//   sigmoid      <= 3 ULP
+// Особые значения: NaN сохраняется, переполнение даёт inf,
+// исчезновение порядка -- денормализованные числа и 0
+namespace mat_vec {
+	namespace vmath {
+
+		namespace detail {
+
+			inline double from_bits(int64_t b) {
+				double d;
+				std::memcpy(&d, &b, sizeof(d));
+				return d;
+			}
+
+			inline int64_t to_bits(double d) {
+				int64_t b;
+				std::memcpy(&b, &d, sizeof(b));
+				return b;
+			}
+
+			// c ? a : b через битовые маски. Обычный ?: над double компилятор
+			// может превратить в переход (арифметика ветви переносится внутрь
+			// условия), и цикл перестаёт векторизоваться
+			inline double select(bool c, double a, double b) {
+				int64_t m = -(int64_t)c;
+				return from_bits((to_bits(a) & m) | (to_bits(b) & ~m));
+			}
+
+			const double LOG2E = 1.4426950408889634;
+			const double LN2_HI = 6.93147180369123816490e-01;
+			const double LN2_LO = 1.90821492927058770002e-10;
+			const double SHIFTER = 6755399441055744.0; // 1.5 * 2^52
+
+			// (double)n для |n| < 2^51 тем же приёмом в обратную сторону
+			inline double to_double(int64_t n) { return from_bits(to_bits(SHIFTER) + n) - SHIFTER; }
+
+			// x = n ln2 + r, |r| <= ln2 / 2. Целое n берётся из младших битов
+			// t = x log2(e) + 1.5 * 2^52: преобразование double -> int64
+			// в SSE/AVX2 не векторизуется
+			inline double reduce(double x, int64_t& n) {
+				double t = x * LOG2E + SHIFTER;
+				double dn = t - SHIFTER;
+				n = to_bits(t) - to_bits(SHIFTER);
+				return (x - dn * LN2_HI) - dn * LN2_LO;
+			}
+
+			// expm1(r) - r - r^2/2 на |r| <= ln2 / 2, ряд Тейлора до r^13
+			inline double expm1_tail(double r) {
+				double p = 1.0 / 6227020800;
+				p = p * r + 1.0 / 479001600;
+				p = p * r + 1.0 / 39916800;
+				p = p * r + 1.0 / 3628800;
+				p = p * r + 1.0 / 362880;
+				p = p * r + 1.0 / 40320;
+				p = p * r + 1.0 / 5040;
+				p = p * r + 1.0 / 720;
+				p = p * r + 1.0 / 120;
+				p = p * r + 1.0 / 24;
+				p = p * r + 1.0 / 6;
+				return r * r * r * p;
+			}
+
+			// 2^n для целого n из [-1022, 1023]
+			inline double pow2(int64_t n) { return from_bits((n + 1023) << 52); }
+		}
+
+		inline double exp(double x) {
+			// ограничение до приведения: NaN и края обрабатываются в конце
+			double xc = detail::select(x > -746.0, x, -746.0);
+			xc = detail::select(xc < 710.0, xc, 710.0);
+			int64_t ni;
+			double r = detail::reduce(xc, ni);
+			double p = 1 + (r + (0.5 * r * r + detail::expm1_tail(r)));
+			// 2^n = 2^n1 * 2^n2, чтобы не выйти за порядок при n = 1024 и n < -1022
+			int64_t n1 = ni >> 1, n2 = ni - n1;
+			double y = p * detail::pow2(n1) * detail::pow2(n2);
+			y = detail::select(x > 709.782712893384, INFINITY, y);
+			y = detail::select(x < -745.1332191019412, 0.0, y);
+			return detail::select(x != x, x, y);
+		}
+
+		inline double expm1(double x) {
+			double xc = detail::select(x > -40.0, x, -40.0);
+			xc = detail::select(xc < 710.0, xc, 710.0);
+			int64_t ni;
+			double r = detail::reduce(xc, ni);
+			double q = r + (0.5 * r * r + detail::expm1_tail(r));
+			int64_t n1 = ni >> 1, n2 = ni - n1;
+			double s1 = detail::pow2(n1), s2 = detail::pow2(n2), s = s1 * s2;
+			// e^x - 1 = 2^n (e^r - 1) + (2^n - 1); при n >= 54 единица не влияет
+			double near = s * q + (s - 1), far = (1 + q) * s1 * s2 - 1;
+			double y = detail::select(ni < 54, near, far);
+			y = detail::select(x > 709.782712893384, INFINITY, y);
+			y = detail::select(x < -40.0, -1.0, y);
+			return detail::select(x != x, x, y);
+		}
+
+		inline double log(double x) {
+			// денормализованные числа приводятся к нормализованным умножением на 2^54
+			bool tiny = x < 2.2250738585072014e-308;
+			double scaled = x * 18014398509481984.0;
+			double xs = detail::select(tiny, scaled, x);
+			int64_t bits = detail::to_bits(xs);
+			int64_t e = ((bits >> 52) & 0x7ff) - 1023 - 54 * (int64_t)tiny;
+			double m = detail::from_bits((bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL);
+			// m в [sqrt(1/2), sqrt(2))
+			bool high = m > 1.4142135623730951;
+			double half = m * 0.5;
+			m = detail::select(high, half, m);
+			e += high;
+			// log(1 + f) = f - (f^2/2 - s (f^2/2 + R)), s = f / (2 + f)
+			double f = m - 1, s = f / (2 + f), z = s * s, hfsq = 0.5 * f * f;
+			double R = 2.0 / 21;
+			R = R * z + 2.0 / 19;
+			R = R * z + 2.0 / 17;
+			R = R * z + 2.0 / 15;
+			R = R * z + 2.0 / 13;
+			R = R * z + 2.0 / 11;
+			R = R * z + 2.0 / 9;
+			R = R * z + 2.0 / 7;
+			R = R * z + 2.0 / 5;
+			R = R * z + 2.0 / 3;
+			R *= z;
+			double de = detail::to_double(e);
+			double y = de * detail::LN2_HI + ((f - (hfsq - (s * (hfsq + R) + de * detail::LN2_LO))));
+			y = detail::select(x == 0, -INFINITY, y);
+			y = detail::select(x < 0, NAN, y);
+			y = detail::select(x == INFINITY, INFINITY, y);
+			return detail::select(x != x, x, y);
+		}
+
+		inline double tanh(double x) {
+			double ax = std::fabs(x);
+			ax = detail::select(ax < 20.0, ax, 20.0);
+			// tanh|x| = e / (e + 2), e = expm1(2|x|)
+			double e = expm1(2 * ax);
+			double y = e / (e + 2);
+			return std::copysign(detail::select(x != x, x, y), x);
+		}
+
+		inline double sigmoid(double x) {
+			// e^-|x| не переполняется, поэтому отрицательные x точны вплоть до денормализованных
+			double e = exp(-std::fabs(x));
+			double pos = 1 / (1 + e), neg = e / (1 + e);
+			return detail::select(x >= 0, pos, neg);
+		}
+
+	} // namespace vmath
+} // namespace mat_vec
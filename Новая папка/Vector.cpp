@@ -2,18 +2,22 @@
 #include <cmath>
 #include "Vector.h"
 #include "Matrix.h"
+#include "Profiler.h"
+#include "Reduce.h"
 
 namespace mat_vec {
 
 	// -   size   value
 	Vector::Vector(size_t size, double value): _size(size){
 		data = new double [_size];
+		MAT_VEC_COUNT_ALLOC(_size * sizeof(double));
 		for (int i = 0; i < _size; i++) 
 			data[i] = value;
 	}
 
 	// - 
 	Vector::Vector(const Vector& src): Vector(src.size()) {
+		MAT_VEC_COUNT_COPY(_size * sizeof(double));
 		for (int i = 0; i < src._size ; i++) data[i] = src.data[i];
 	}
 
@@ -22,6 +26,8 @@ namespace mat_vec {
 		_size = rhs._size;
 		delete[] data;
 		data = new double[_size];
+		MAT_VEC_COUNT_ALLOC(_size * sizeof(double));
+		MAT_VEC_COUNT_COPY(_size * sizeof(double));
 		for (int i = 0; i < rhs._size; i++) data[i] = rhs.data[i];
 		return *this;
 	}
@@ -40,88 +46,98 @@ namespace mat_vec {
 
 	// -L2  
 	double Vector::norm() const{
-		double l2 = 0;
-		for (int i = 0; i < _size; i++) l2+=pow(data[i],2);
-		return sqrt(l2);
+		MAT_VEC_SCOPE("Vector::norm");
+		return norm2(data, _size);
 	}
 
 	// -  ,    (this)
 	Vector Vector::normalized() const{
-		Vector c(*this);
-		c.normalize();
+		Vector c(_size);
+		mat_vec::normalize(data, c.data, _size);
 		return c;
 	}
 
 	// -  
 	void Vector::normalize() {
-		double l2=norm();
-		for (int i = 0; i < _size; i++) data[i] /= l2;
+		MAT_VEC_SCOPE("Vector::normalize");
+		mat_vec::normalize(data, data, _size);
 	}
 
 	// -  
 	Vector Vector::operator+(const Vector& rhs) const{
+		MAT_VEC_SCOPE("Vector::operator+");
 		Vector c = *this;
 		c += rhs;
 		return c;
 	}
 	Vector& Vector::operator+=(const Vector& rhs){
+		MAT_VEC_COUNT_FLOPS(_size);
 		for (int i = 0; i < _size; i++) data[i] += rhs.data[i];
 		return *this;
 	}
 
 	// -  
 	Vector Vector::operator-(const Vector& rhs) const{
+		MAT_VEC_SCOPE("Vector::operator-");
 		Vector c = *this;
 		c -= rhs;
 		return c;
 	}
 	Vector& Vector::operator-=(const Vector& rhs){
+		MAT_VEC_COUNT_FLOPS(_size);
 		for (int i = 0; i < _size; i++) data[i] -= rhs.data[i];
 		return *this;
 	}
 
 	// -  
 	Vector Vector::operator^(const Vector& rhs) const{
+		MAT_VEC_SCOPE("Vector::operator^");
 		Vector c = *this;
 		c ^= rhs;
 		return c;
 	}
 	Vector& Vector::operator^=(const Vector& rhs){
+		MAT_VEC_COUNT_FLOPS(_size);
 		for (int i = 0; i < _size; i++) data[i] *= rhs.data[i];
 		return *this;
 	}
 
 	// - 
 	double Vector::operator*(const Vector& rhs) const{
-		double ab = 0;
-		for (int i = 0; i < _size; i++) ab += data[i] * rhs.data[i];
-		return ab;
+		MAT_VEC_SCOPE("Vector::dot");
+		return dot(data, rhs.data, _size);
 	}
 
 	// -       (v * k)
 	Vector Vector::operator*(double k) const{
+		MAT_VEC_SCOPE("Vector::operator*(double)");
 		Vector res= *this;
 		res *= k;
 		return res;
 	}
 	Vector& Vector::operator*=(double k){
+		MAT_VEC_COUNT_FLOPS(_size);
 		for (int i = 0; i < _size; i++) data[i] *= k;
 		return *this;
 	}
 
 	// -     
 	Vector Vector::operator/(double k) const{
+		MAT_VEC_SCOPE("Vector::operator/");
 		Vector res= *this;
 		res /= k;
 		return res;
 	}
 	Vector& Vector::operator/=(double k){
+		MAT_VEC_COUNT_FLOPS(_size);
 		for (int i = 0; i < _size; i++) data[i] /= k;
 		return *this;
 	}
 
 	// -   
 	Vector Vector::operator*(const Matrix& mat) const{
+		MAT_VEC_SCOPE("Vector::operator*(Matrix)");
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)mat._size.first * mat._size.second);
 		Vector c = Vector(_size, 0);
 		for (int i = 0; i <mat._size.first; i++) 
 			for (int j = 0; j < mat._size.second; j++) 
@@ -129,6 +145,8 @@ namespace mat_vec {
 		return c;
 	}
 	Vector& Vector::operator*=(const Matrix& mat){
+		MAT_VEC_SCOPE("Vector::operator*=(Matrix)");
+		MAT_VEC_COUNT_FLOPS(2 * (uint64_t)mat._size.first * mat._size.second);
 		Vector c = Vector(_size, 0);
 		for (int i = 0; i < mat._size.first; i++) 
 			for (int j = 0; j < mat._size.second; j++) 
@@ -0,0 +1,16 @@
+// Отдельный процесс-узел распределённого умножения. Собирается с
+// MAT_VEC_WORKER_MAIN вместо main.cpp:  worker unix:/путь | tcp:хост:порт
+#ifdef MAT_VEC_WORKER_MAIN
+
+#include "Distributed.h"
+#include <iostream>
+
+int main(int argc, char** argv) {
+	if (argc != 2) {
+		std::cerr << "usage: worker unix:PATH | tcp:HOST:PORT\n";
+		return 2;
+	}
+	return mat_vec::serve(argv[1]) ? 0 : 1;
+}
+
+#endif
@@ -3,6 +3,36 @@
 #include "Matrix.h"
 #include "Vector.h"
 #include "Base.h"
+#include "MixedPrecision.h"
+#include "Statistics.h"
+#include "Convolution.h"
+#include "Fft.h"
+#include "MatrixFunctions.h"
+#include "Ordering.h"
+#include "Graph.h"
+#include "SparseMatrix.h"
+#include "Lazy.h"
+#include "Parallel.h"
+#include "Async.h"
+#include "Distributed.h"
+#include "SharedMemory.h"
+#include "Transpose.h"
+#include "Tuner.h"
+#include "Quantized.h"
+#include "KnnIndex.h"
+#include "Distance.h"
+#include "Elementwise.h"
+#include "Reduce.h"
+#include "Updatable.h"
+#include "Decomposition.h"
+#include "MatrixBatch.h"
+#include "BandedMatrix.h"
+#include "TriangularMatrix.h"
+#include "DiagonalMatrix.h"
+#include "Strassen.h"
+#include "Arena.h"
+#include "Gemm.h"
+#include "Profiler.h"
 
 
 namespace mat_vec {
@@ -180,5 +210,2024 @@ namespace mat_vec {
 
 
 
+	}
+
+	TEST_CASE("Profiler") {
+		profiler::reset();
+		Vector v(100, 1.0);
+		Vector w = v + v;
+		Matrix m(10, 1.0);
+		Matrix t = m.transposed();
+		profiler::Snapshot s = profiler::snapshot();
+		if (profiler::enabled()) {
+			REQUIRE(s.total.allocations > 0);
+			REQUIRE(s.total.bytes_copied >= 2 * 100 * sizeof(double));
+			REQUIRE(s.total.flops >= 100);
+			bool seen = false;
+			for (auto& op : s.total.ops) if (op.name == "Matrix::transposed") seen = op.calls == 1;
+			REQUIRE(seen);
+		}
+		else {
+			REQUIRE(s.total.allocations == 0);
+			REQUIRE(s.total.flops == 0);
+		}
+		REQUIRE(w[0] == 2.0);
+		REQUIRE(t.shape().first == 10);
+	}
+
+	TEST_CASE("Matrix product") {
+		Matrix a(70, 50, 0.0), b(50, 90, 0.0);
+		for (size_t i = 0; i < 70; ++i) for (size_t j = 0; j < 50; ++j) a.a[i][j] = (double)((i * 7 + j * 3) % 11) - 5;
+		for (size_t i = 0; i < 50; ++i) for (size_t j = 0; j < 90; ++j) b.a[i][j] = (double)((i * 5 + j) % 13) - 6;
+		Matrix c = a * b;
+		REQUIRE(c.shape().first == 70);
+		REQUIRE(c.shape().second == 90);
+		bool same = true;
+		for (size_t i = 0; i < 70; ++i) for (size_t j = 0; j < 90; ++j) {
+			double s = 0;
+			for (size_t p = 0; p < 50; ++p) s += a.a[i][p] * b.a[p][j];
+			same = same && s == c.get(i, j);
+		}
+		REQUIRE(same);
+
+		SECTION("Strassen") {
+			Matrix x(100, 1.0), y(100, 1.0);
+			for (size_t i = 0; i < 100; ++i) for (size_t j = 0; j < 100; ++j) {
+				x.a[i][j] = (double)((i + 2 * j) % 7) - 3;
+				y.a[i][j] = (double)((3 * i + j) % 5) - 2;
+			}
+			StrassenOptions opt;
+			opt.crossover = 16;
+			StrassenStats stats;
+			Matrix z = strassen_multiply(x, y, opt, &stats);
+			REQUIRE(stats.depth == 2);
+			REQUIRE(stats.gflops > 0);
+			REQUIRE(z == x * y);
+		}
+		SECTION("Scratch arena") {
+			ScratchArena arena(1024);
+			arena.allocate(512);
+			size_t mark = arena.mark();
+			double* first = nullptr;
+			size_t capacity = 0;
+			for (int it = 0; it < 4; ++it) {
+				double* big = arena.allocate_array<double>(100000);
+				double* small = arena.allocate_array<double>(10);
+				big[99999] = small[9] = 1;
+				if (it == 0) {
+					first = big;
+					capacity = arena.capacity();
+				}
+				// блоки, выросшие после отметки, переиспользуются
+				REQUIRE(big == first);
+				REQUIRE(arena.capacity() == capacity);
+				arena.rewind(mark);
+				REQUIRE(arena.used() == mark);
+			}
+			arena.reset();
+			REQUIRE(arena.used() == 0);
+			REQUIRE(arena.capacity() == capacity);
+		}
+	}
+
+	TEST_CASE("Transpose") {
+		const size_t shapes[][2] = { { 37, 53 }, { 64, 64 }, { 300, 260 }, { 1, 9 } };
+		for (auto& s : shapes) {
+			Matrix m(s[0], s[1], 0.0);
+			for (size_t i = 0; i < s[0]; ++i) for (size_t j = 0; j < s[1]; ++j) m.a[i][j] = (double)(i * 1000 + j);
+			Matrix t = m.transposed();
+			m.transpose();
+			REQUIRE(t.shape().first == s[1]);
+			REQUIRE(m.shape().first == s[1]);
+			REQUIRE(m.shape().second == s[0]);
+			bool same = true;
+			for (size_t i = 0; i < s[1]; ++i) for (size_t j = 0; j < s[0]; ++j)
+				same = same && t.get(i, j) == (double)(j * 1000 + i) && m.get(i, j) == t.get(i, j);
+			REQUIRE(same);
+		}
+	}
+
+	TEST_CASE("Structured matrices") {
+		const size_t n = 150;
+		Matrix dense(n, 0.0);
+		for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j)
+			dense.a[i][j] = i == j ? 10.0 + i % 3 : 1.0 / (1.0 + i + 2 * j);
+		Vector x(n, 0);
+		for (size_t i = 0; i < n; ++i) x[i] = 1.0 + (double)(i % 5);
+		auto dense_mul = [n](const Matrix& m, const Vector& v) {
+			Vector r(n, 0);
+			for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j) r[i] += m.get(i, j) * v[j];
+			return r;
+		};
+		auto close = [n](const Vector& a, const Vector& b) {
+			for (size_t i = 0; i < n; ++i) if (std::abs(a[i] - b[i]) > 1e-9 * (1 + std::abs(b[i]))) return false;
+			return true;
+		};
+
+		SECTION("Diagonal") {
+			DiagonalMatrix d(n, 2.0);
+			REQUIRE(close(d * x, dense_mul(d.to_dense(), x)));
+			REQUIRE(close(d.solve(d * x), x));
+			REQUIRE((d * dense).get(3, 4) == 2 * dense.get(3, 4));
+			REQUIRE((dense * d).get(3, 4) == 2 * dense.get(3, 4));
+		}
+
+		SECTION("Triangular") {
+			for (bool lower : { true, false }) {
+				TriangularMatrix t(dense, lower);
+				Matrix td = t.to_dense();
+				REQUIRE(close(t * x, dense_mul(td, x)));
+				REQUIRE(close(t.solve(t * x), x));
+				Matrix b(n, 3, 1.0);
+				for (size_t i = 0; i < n; ++i) b.a[i][1] = (double)i;
+				Matrix tb = t * b;
+				Matrix ref = td * b;
+				Matrix back = t.solve(tb);
+				bool ok = true;
+				for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < 3; ++j)
+					ok = ok && std::abs(tb.get(i, j) - ref.get(i, j)) < 1e-9 && std::abs(back.get(i, j) - b.get(i, j)) < 1e-9;
+				REQUIRE(ok);
+			}
+		}
+
+		SECTION("Banded") {
+			BandedMatrix tri = BandedMatrix::tridiagonal(Vector(n - 1, -1), Vector(n, 4), Vector(n - 1, -1));
+			REQUIRE(close(tri * x, dense_mul(tri.to_dense(), x)));
+			REQUIRE(close(tri.solve(tri * x), x));
+			BandedMatrix band(dense, 2, 3);
+			band.at(5, 5) = 0;
+			REQUIRE(close(band * x, dense_mul(band.to_dense(), x)));
+			REQUIRE(close(band.solve(band * x), x));
+			BandedMatrix small = BandedMatrix::tridiagonal(Vector(2, -1), Vector(3, 4), Vector(2, -1));
+			REQUIRE(std::abs(small.det() - 56) < 1e-12);
+		}
+	}
+
+	TEST_CASE("Matrix batch") {
+		const size_t count = 37, n = 5;
+		MatrixBatch a(count, n, n);
+		VectorBatch b(count, n);
+		for (size_t k = 0; k < count; ++k) {
+			for (size_t i = 0; i < n; ++i) {
+				b.at(k, i) = (double)(i + k % 3);
+				for (size_t j = 0; j < n; ++j) a.at(k, i, j) = (double)((i * 3 + j * 7 + k) % 11) - 5 + (i == j ? 20.0 : 0.0);
+			}
+		}
+		VectorBatch x = batch_solve(a, b);
+		VectorBatch r = batch_gemv(a, x);
+		MatrixBatch prod = batch_gemm(a, batch_inv(a));
+		std::vector<double> d = batch_det(a);
+		bool ok = true;
+		for (size_t k = 0; k < count; ++k) {
+			for (size_t i = 0; i < n; ++i) {
+				ok = ok && std::abs(r.get(k, i) - b.get(k, i)) < 1e-9;
+				for (size_t j = 0; j < n; ++j) ok = ok && std::abs(prod.get(k, i, j) - (i == j ? 1.0 : 0.0)) < 1e-9;
+			}
+		}
+		REQUIRE(ok);
+
+		MatrixBatch small(2, 3, 3);
+		Matrix m(3, 0.0);
+		m.a[0][0] = 2; m.a[0][1] = -3; m.a[0][2] = 1;
+		m.a[1][0] = 2; m.a[1][1] = 0; m.a[1][2] = -1;
+		m.a[2][0] = 1; m.a[2][1] = 4; m.a[2][2] = 5;
+		small.set(0, m);
+		small.set(1, Matrix::eye(3));
+		std::vector<double> sd = batch_det(small);
+		REQUIRE(std::abs(sd[0] - 49) < 1e-12);
+		REQUIRE(sd[1] == 1);
+		REQUIRE(small.matrix(0) == m);
+
+		// ведущие элементы в строках с номерами больше 255
+		const size_t big = 300;
+		MatrixBatch wide(2, big, big);
+		VectorBatch wb(2, big);
+		for (size_t k = 0; k < 2; ++k)
+			for (size_t i = 0; i < big; ++i) {
+				wb.at(k, i) = (double)(i % 7) - 3;
+				for (size_t j = 0; j < big; ++j) wide.at(k, i, j) = (i + j == big - 1 ? 10.0 : 0.0) + (double)((i * 5 + j * 3 + k) % 13) * 0.001;
+			}
+		VectorBatch wr = batch_gemv(wide, batch_solve(wide, wb));
+		double err = 0;
+		for (size_t k = 0; k < 2; ++k)
+			for (size_t i = 0; i < big; ++i) err = std::max(err, std::abs(wr.get(k, i) - wb.get(k, i)));
+		REQUIRE(err < 1e-9);
+	}
+
+	TEST_CASE("Factorization updates") {
+		const size_t n = 90;
+		Matrix a(n, 0.0);
+		for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j)
+			a.a[i][j] = (i == j ? 2.0 * n : 0.0) + (double)((i * 7 + j * 13) % 17) / 17.0;
+		Matrix spd = a * a.transposed();
+		Vector b(n, 1.0);
+		auto residual = [n](const Matrix& m, const Vector& x, const Vector& rhs) {
+			Vector r = m * x - rhs;
+			double e = 0;
+			for (size_t i = 0; i < n; ++i) e = std::max(e, std::abs(r[i]));
+			return e;
+		};
+
+		SECTION("LU and Cholesky") {
+			Matrix m(3, 0.0);
+			m.a[0][0] = 2; m.a[0][1] = -3; m.a[0][2] = 1;
+			m.a[1][0] = 2; m.a[1][1] = 0; m.a[1][2] = -1;
+			m.a[2][0] = 1; m.a[2][1] = 4; m.a[2][2] = 5;
+			REQUIRE(std::abs(m.det() - 49) < 1e-12);
+			Matrix id = m * m.inv();
+			for (size_t i = 0; i < 3; ++i) for (size_t j = 0; j < 3; ++j)
+				REQUIRE(std::abs(id.get(i, j) - (i == j ? 1.0 : 0.0)) < 1e-12);
+			REQUIRE(Matrix(3, 1.0).det() == 0);
+
+			REQUIRE(residual(a, LU(a).solve(b), b) < 1e-10);
+			Cholesky c(spd);
+			REQUIRE(c.ok());
+			REQUIRE(residual(spd, c.solve(b), b) < 1e-6);
+			Vector x(n, 0.5);
+			c.update(x);
+			REQUIRE(c.downdate(x));
+			REQUIRE(residual(spd, c.solve(b), b) < 1e-6);
+		}
+
+		SECTION("Updates") {
+			for (auto kind : { UpdatableFactorization::INVERSE, UpdatableFactorization::LU_FACTORS }) {
+				UpdatableFactorization f(a, kind, 1e-9, 100);
+				for (size_t step = 0; step < 10; ++step) {
+					Vector row(n, 0);
+					for (size_t j = 0; j < n; ++j) row[j] = a.get(step, j) + (double)((step + j) % 5) - 2;
+					row[step] += 1;
+					f.replace_row(step, row);
+				}
+				Matrix u(n, 2, 0.0), v(n, 2, 0.0);
+				for (size_t i = 0; i < n; ++i) { u.a[i][0] = 1; u.a[i][1] = (double)(i % 3); v.a[i][0] = 0.01; v.a[i][1] = (double)(i % 2); }
+				f.update(u, v);
+				REQUIRE(f.updates() == 12);
+				REQUIRE(f.refactorizations() == 0);
+				REQUIRE(residual(f.matrix(), f.solve(b), b) < 1e-8);
+				double fresh = LU(f.matrix()).det();
+				REQUIRE(std::abs(f.det() - fresh) <= 1e-8 * std::abs(fresh));
+			}
+			UpdatableFactorization chol(spd, UpdatableFactorization::CHOLESKY);
+			Vector x(n, 0.25);
+			chol.symmetric_update(x, 1);
+			chol.symmetric_update(x, -1);
+			REQUIRE(chol.refactorizations() == 0);
+			REQUIRE(residual(spd, chol.solve(b), b) < 1e-6);
+		}
+	}
+
+	TEST_CASE("Matrix cache") {
+		Matrix m(3, 0.0);
+		m.a[0][0] = 2; m.a[0][1] = -3; m.a[0][2] = 1;
+		m.a[1][0] = 2; m.a[1][1] = 0; m.a[1][2] = -1;
+		m.a[2][0] = 1; m.a[2][1] = 4; m.a[2][2] = 5;
+		m.enable_cache();
+		REQUIRE(std::abs(m.det() - 49) < 1e-12);
+		REQUIRE(std::abs(m.det() - 49) < 1e-12);
+		Matrix i1 = m.inv();
+		Matrix i2 = m.inv();
+		REQUIRE(i1 == i2);
+		REQUIRE(m.transposed() == m.transposed());
+		double n1 = m.norm();
+		REQUIRE(m.norm() == n1);
+		REQUIRE(m.cache_stats().hits == 4);
+		REQUIRE(m.cache_stats().misses == 4);
+
+		m[0][0] = 3;
+		REQUIRE(std::abs(m.det() - 53) < 1e-12);
+		REQUIRE(m.transposed().get(0, 0) == 3);
+		m *= 2.0;
+		REQUIRE(std::abs(m.det() - 8 * 53) < 1e-9);
+		REQUIRE(m.cache_stats().misses == 7);
+
+		Matrix plain(2, 1.0);
+		REQUIRE(!plain.cache_enabled());
+		REQUIRE(plain.cache_stats().misses == 0);
+	}
+
+
+	TEST_CASE("Matrix cache in pool tasks") {
+		// задачи, которые поток выполняет, пока ждёт parallel_for внутри
+		// inv или det, сами обращаются к кэшу той же матрицы
+		const size_t n = 300, tasks = 64;
+		Matrix m(n, 0.0);
+		for (size_t i = 0; i < n; ++i)
+			for (size_t j = 0; j < n; ++j) m.a[i][j] = (i == j ? 1.0 : 0.0) + (double)((i * 7 + j * 3) % 11 - 5) * 1e-3;
+		m.enable_cache();
+		Matrix inverse = LU(m).inv();
+		double det = LU(m).det();
+		std::vector<double> errors(tasks, -1);
+		{
+			TaskGroup group;
+			for (size_t t = 0; t < tasks; ++t)
+				group.run([&, t] {
+					if (t % 2) {
+						errors[t] = std::abs(m.det() - det);
+						return;
+					}
+					Matrix x = m.inv();
+					double e = 0;
+					for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j) e = std::max(e, std::abs(x.a[i][j] - inverse.a[i][j]));
+					errors[t] = e;
+				});
+			group.wait();
+		}
+		for (double e : errors) REQUIRE((e >= 0 && e < 1e-12));
+		REQUIRE(m.cache_stats().hits + m.cache_stats().misses == tasks);
+	}
+
+
+	TEST_CASE("Reductions") {
+		SECTION("Sum and dot") {
+			size_t n = 100000;
+			Vector x(n, 0), y(n, 0);
+			for (size_t i = 0; i < n; i++) {
+				x[i] = (double)(i % 7) - 3;
+				y[i] = (double)(i % 5);
+			}
+			double expect = 0;
+			for (size_t i = 0; i < n; i++) expect += x[i] * y[i];
+			REQUIRE(dot(x, y) == expect);
+			REQUIRE(x * y == expect);
+			REQUIRE(dot(x, y, Summation::COMPENSATED) == expect);
+			REQUIRE(sum(y) == 200000.0);
+		}
+		SECTION("Compensated summation") {
+			// 1e16 + 1 + 1 + ... теряет единицы при обычном сложении
+			size_t n = 3 * REDUCE_CHUNK;
+			Vector x(n, 1.0);
+			x[0] = 1e16;
+			x[n - 1] = -1e16;
+			REQUIRE(sum(x, Summation::COMPENSATED) == (double)(n - 2));
+			REQUIRE(dot(x, Vector(n, 1.0), Summation::COMPENSATED) == (double)(n - 2));
+		}
+		SECTION("Repeatable") {
+			size_t n = 1 << 18;
+			Vector x(n, 0);
+			for (size_t i = 0; i < n; i++) x[i] = std::sin((double)i) * 1e-3;
+			double first = x.norm();
+			for (int k = 0; k < 5; k++) REQUIRE(x.norm() == first);
+			REQUIRE(first == Approx(std::sqrt(n * 0.5e-6)).epsilon(1e-3));
+
+			// Одинаковые биты при любом размере пула
+			auto bits = [](double v) {
+				uint64_t b;
+				std::memcpy(&b, &v, sizeof(b));
+				return b;
+			};
+			Vector y(n, 0);
+			for (size_t i = 0; i < n; i++) y[i] = std::cos((double)i * 0.7) * (1.0 + (double)(i % 13));
+			ThreadPool serial(0);
+			double s = sum(x.data, n, Summation::PAIRWISE, serial);
+			double c = sum(x.data, n, Summation::COMPENSATED, serial);
+			double d = dot(x.data, y.data, n, Summation::PAIRWISE, serial);
+			double l1 = norm1(y.data, n, serial), l2 = norm2(y.data, n, serial);
+			for (size_t threads : { 1, 2, 3, 8 }) {
+				ThreadPool pool(threads);
+				REQUIRE(bits(sum(x.data, n, Summation::PAIRWISE, pool)) == bits(s));
+				REQUIRE(bits(sum(x.data, n, Summation::COMPENSATED, pool)) == bits(c));
+				REQUIRE(bits(dot(x.data, y.data, n, Summation::PAIRWISE, pool)) == bits(d));
+				REQUIRE(bits(norm1(y.data, n, pool)) == bits(l1));
+				REQUIRE(bits(norm2(y.data, n, pool)) == bits(l2));
+			}
+		}
+		SECTION("Min and max") {
+			size_t n = 5 * REDUCE_CHUNK + 17;
+			Vector x(n, 0);
+			x[3] = -2;
+			x[REDUCE_CHUNK + 1] = 7;
+			x[4 * REDUCE_CHUNK] = 7;
+			x[n - 1] = -2;
+			REQUIRE(argmax(x).index == REDUCE_CHUNK + 1);
+			REQUIRE(max(x) == 7);
+			REQUIRE(argmin(x).index == 3);
+			REQUIRE(min(x) == -2);
+			x[0] = NAN;
+			REQUIRE(argmax(x).index == REDUCE_CHUNK + 1);
+		}
+	}
+
+
+	TEST_CASE("Norms") {
+		SECTION("No overflow or underflow") {
+			Vector big(4, 3e200), small(4, 3e-200);
+			REQUIRE(big.norm() == Approx(6e200));
+			REQUIRE(small.norm() == Approx(6e-200));
+			Vector mixed(3, 0);
+			mixed[0] = 3e300;
+			mixed[1] = 4e300;
+			mixed[2] = 1e-300;
+			REQUIRE(mixed.norm() == Approx(5e300));
+			Vector n = big.normalized();
+			REQUIRE(n.norm() == Approx(1));
+			REQUIRE(n[0] == Approx(0.5));
+			big[2] = INFINITY;
+			REQUIRE(big.norm() == INFINITY);
+			big[1] = NAN;
+			REQUIRE(std::isnan(big.norm()));
+		}
+		SECTION("Large vector") {
+			size_t n = 100003;
+			Vector x(n, 0);
+			double s = 0;
+			for (size_t i = 0; i < n; i++) {
+				x[i] = std::cos((double)i) * 1e-170;
+				s += (x[i] * 1e170) * (x[i] * 1e170);
+			}
+			REQUIRE(x.norm() == Approx(std::sqrt(s) * 1e-170).epsilon(1e-12));
+			x.normalize();
+			REQUIRE(x.norm() == Approx(1).epsilon(1e-12));
+		}
+		SECTION("L1 and L-inf") {
+			Vector v(3, 0);
+			v[0] = -4;
+			v[1] = 1;
+			v[2] = 2;
+			REQUIRE(norm1(v) == 7);
+			REQUIRE(norm_inf(v) == 4);
+			Matrix m(2, 3, 0.0);
+			m[0][0] = 1; m[0][1] = -2; m[0][2] = 3;
+			m[1][0] = -4; m[1][1] = 5; m[1][2] = -6;
+			REQUIRE(m.norm1() == 9);
+			REQUIRE(m.norm_inf() == 15);
+			REQUIRE(m.norm() == Approx(std::sqrt(91.0)));
+		}
+	}
+
+
+	// Расстояние в ULP между a и эталоном b
+	static double ulp_distance(double a, double b) {
+		if (a == b || (std::isnan(a) && std::isnan(b))) return 0;
+		double u = std::fabs(std::nextafter(b, INFINITY) - b);
+		return std::fabs(a - b) / u;
+	}
+
+	TEST_CASE("Elementwise") {
+		SECTION("ULP error") {
+			// эталон libm сам ошибается до 1 ULP, отсюда +1 к заявленной границе
+			double worst_exp = 0, worst_log = 0, worst_tanh = 0, worst_sigmoid = 0;
+			for (int i = 0; i <= 200000; i++) {
+				double x = -700 + 1400.0 * i / 200000;
+				double t = -20 + 40.0 * i / 200000;
+				double l = std::ldexp(1.0 + i % 1000 / 1000.0, i / 1000 - 100);
+				worst_exp = std::max(worst_exp, ulp_distance(vmath::exp(x), std::exp(x)));
+				worst_log = std::max(worst_log, ulp_distance(vmath::log(l), std::log(l)));
+				worst_tanh = std::max(worst_tanh, ulp_distance(vmath::tanh(t), std::tanh(t)));
+				worst_sigmoid = std::max(worst_sigmoid, ulp_distance(vmath::sigmoid(t), 1 / (1 + std::exp(-t))));
+			}
+			REQUIRE(worst_exp <= 2);
+			REQUIRE(worst_log <= 2);
+			REQUIRE(worst_tanh <= 4);
+			REQUIRE(worst_sigmoid <= 4);
+		}
+		SECTION("Special values") {
+			Vector x(6, 0);
+			x[0] = NAN; x[1] = INFINITY; x[2] = -INFINITY; x[3] = 800; x[4] = -800; x[5] = -744;
+			Vector e = exp(x);
+			REQUIRE(std::isnan(e[0]));
+			REQUIRE(e[1] == INFINITY);
+			REQUIRE(e[2] == 0);
+			REQUIRE(e[3] == INFINITY);
+			REQUIRE(e[4] == 0);
+			REQUIRE(e[5] == std::exp(-744.0));
+			REQUIRE(vmath::log(0) == -INFINITY);
+			REQUIRE(std::isnan(vmath::log(-1)));
+			REQUIRE(vmath::log(4.9e-324) == Approx(std::log(4.9e-324)));
+			REQUIRE(vmath::tanh(-INFINITY) == -1);
+			REQUIRE(vmath::sigmoid(-800) == 0);
+			REQUIRE(vmath::sigmoid(800) == 1);
+		}
+		SECTION("map, apply_inplace, zip_with") {
+			size_t n = 3 * ELEMENTWISE_GRAIN + 5;
+			Vector x(n, 0), y(n, 0);
+			for (size_t i = 0; i < n; i++) {
+				x[i] = (double)i;
+				y[i] = 2.0;
+			}
+			Vector sq = map(x, [](double v) { return v * v; });
+			REQUIRE(sq[n - 1] == (double)(n - 1) * (n - 1));
+			Vector z = zip_with(x, y, [](double a, double b) { return a * b + 1; });
+			REQUIRE(z[12345] == 24691);
+			apply_inplace(x, [](double v) { return -v; });
+			REQUIRE(x[n - 1] == -(double)(n - 1));
+
+			Matrix m(2, 3, 1.0);
+			m.enable_cache();
+			REQUIRE(m.norm() == Approx(std::sqrt(6.0)));
+			apply_inplace(m, [](double v) { return 2 * v; });
+			REQUIRE(m.norm() == Approx(std::sqrt(24.0)));
+			Matrix t = tanh(m);
+			REQUIRE(t.get(1, 2) == Approx(std::tanh(2.0)));
+			Matrix d = zip_with(m, t, [](double a, double b) { return a - b; });
+			REQUIRE(d.get(0, 0) == Approx(2 - std::tanh(2.0)));
+			REQUIRE(map(m, [](double v) { return v + 1; }).get(1, 1) == 3);
+		}
+	}
+
+
+	TEST_CASE("Pairwise distances") {
+		size_t na = 150, nb = 200, d = 7;
+		Matrix A(na, d, 0.0), B(nb, d, 0.0);
+		unsigned state = 7;
+		auto next = [&state]() {
+			state = state * 1103515245u + 12345u;
+			return (double)(state >> 16 & 0x7fff) / 0x7fff - 0.5;
+		};
+		for (size_t i = 0; i < na; i++) for (size_t j = 0; j < d; j++) A[i][j] = next();
+		for (size_t i = 0; i < nb; i++) for (size_t j = 0; j < d; j++) B[i][j] = next();
+		auto row = [d](const Matrix& m, size_t i) {
+			Vector v(d, 0);
+			for (size_t j = 0; j < d; j++) v[j] = m.get(i, j);
+			return v;
+		};
+		PointSet pa(A), pb(B);
+		DistanceOptions small;
+		small.block_bytes = 1; // блоки по 64 строки и столбца
+
+		SECTION("L2 and cosine") {
+			Matrix D = pairwise(pa, pb, small);
+			small.metric = Metric::COSINE_SIMILARITY;
+			Matrix S = pairwise(pa, pb, small);
+			REQUIRE(D.shape() == std::make_pair((size_t)na, (size_t)nb));
+			for (size_t i = 0; i < na; i += 13)
+				for (size_t j = 0; j < nb; j += 7) {
+					Vector x = row(A, i), y = row(B, j);
+					REQUIRE(D.get(i, j) == Approx((x - y).norm()).epsilon(1e-9));
+					REQUIRE(S.get(i, j) == Approx(x * y / (x.norm() * y.norm())).epsilon(1e-9));
+				}
+			Matrix self = pairwise(pa, pa);
+			for (size_t i = 0; i < na; i++) REQUIRE(self.get(i, i) == 0);
+		}
+		SECTION("NaN is not a zero distance") {
+			Matrix C = A;
+			C[3][2] = std::nan("");
+			PointSet pc(C);
+			Matrix D = pairwise(pc, pb, small);
+			small.metric = Metric::SQUARED_L2;
+			Matrix S = pairwise(pc, pb, small);
+			for (size_t j = 0; j < nb; j++) {
+				REQUIRE(std::isnan(D.get(3, j)));
+				REQUIRE(std::isnan(S.get(3, j)));
+				REQUIRE(D.get(4, j) >= 0);
+			}
+		}
+		SECTION("Top-k") {
+			size_t k = 5;
+			auto nn = top_k(pa, pb, k, small);
+			small.metric = Metric::DOT;
+			auto best = top_k(pa, pb, 3, small);
+			REQUIRE(nn.size() == na);
+			for (size_t i = 0; i < na; i += 11) {
+				std::vector<std::pair<double, size_t>> all, dots;
+				for (size_t j = 0; j < nb; j++) {
+					all.push_back({ (row(A, i) - row(B, j)).norm(), j });
+					dots.push_back({ -(row(A, i) * row(B, j)), j });
+				}
+				std::sort(all.begin(), all.end());
+				std::sort(dots.begin(), dots.end());
+				REQUIRE(nn[i].size() == k);
+				for (size_t r = 0; r < k; r++) {
+					REQUIRE(nn[i][r].index == all[r].second);
+					REQUIRE(nn[i][r].distance == Approx(all[r].first).epsilon(1e-9));
+				}
+				for (size_t r = 0; r < 3; r++) REQUIRE(best[i][r].index == dots[r].second);
+			}
+			REQUIRE(top_k(pa, pb, 1000)[0].size() == nb);
+		}
+	}
+
+
+	TEST_CASE("Nearest neighbour index") {
+		size_t n = 2000, d = 16;
+		std::mt19937_64 rng(5);
+		std::normal_distribution<double> gauss;
+		auto random_vector = [&]() {
+			Vector v(d, 0);
+			for (size_t j = 0; j < d; j++) v[j] = gauss(rng);
+			return v;
+		};
+		FlatIndex flat(d);
+		HnswOptions opt;
+		opt.M = 8;
+		opt.ef_construction = 100;
+		HnswIndex hnsw(d, Metric::SQUARED_L2, opt);
+		std::vector<Vector> points;
+		for (size_t i = 0; i < n; i++) {
+			points.push_back(random_vector());
+			VectorId id = 1000000007ull * (i + 1);
+			REQUIRE(flat.add(id, points.back()));
+			REQUIRE(hnsw.add(id, points.back()));
+		}
+		REQUIRE_FALSE(flat.add(1000000007ull, points[0]));
+		REQUIRE_FALSE(hnsw.add(5, Vector(d + 1, 0)));
+		REQUIRE(flat.search(Vector(d + 1, 0), 3).empty());
+		REQUIRE(hnsw.search(Vector(d - 1, 0), 3).empty());
+		auto wrong = hnsw.search(Matrix(2, d + 1, 0.0), 3);
+		REQUIRE(wrong.size() == 2);
+		REQUIRE(wrong[0].empty());
+		REQUIRE(flat.search(Matrix(2, d - 1, 0.0), 3)[1].empty());
+
+		size_t nq = 50, k = 10;
+		Matrix queries(nq, d, 0.0);
+		for (size_t i = 0; i < nq; i++) {
+			Vector q = random_vector();
+			for (size_t j = 0; j < d; j++) queries[i][j] = q[j];
+		}
+
+		SECTION("Flat index is exact") {
+			auto res = flat.search(queries, k);
+			for (size_t i = 0; i < nq; i += 7) {
+				std::vector<std::pair<double, size_t>> all;
+				for (size_t p = 0; p < n; p++) {
+					double s = 0;
+					for (size_t j = 0; j < d; j++) s += (queries.get(i, j) - points[p][j]) * (queries.get(i, j) - points[p][j]);
+					all.push_back({ s, p });
+				}
+				std::sort(all.begin(), all.end());
+				for (size_t r = 0; r < k; r++) {
+					REQUIRE(res[i][r].id == 1000000007ull * (all[r].second + 1));
+					REQUIRE(res[i][r].distance == Approx(all[r].first).epsilon(1e-9));
+				}
+			}
+			FlatIndex one(d, Metric::COSINE_SIMILARITY);
+			one.add(7, points[3]);
+			one.add(8, points[4] * -1.0);
+			REQUIRE(one.search(points[3], 1)[0].id == 7);
+			REQUIRE(one.search(points[3], 1)[0].distance == Approx(1));
+		}
+		SECTION("HNSW recall") {
+			auto exact = flat.search(queries, k);
+			auto approx = hnsw.search(queries, k);
+			size_t hits = 0;
+			for (size_t i = 0; i < nq; i++)
+				for (auto& a : approx[i])
+					for (auto& e : exact[i]) hits += a.id == e.id;
+			REQUIRE(hits >= nq * k * 9 / 10);
+			REQUIRE(hnsw.search(points[17], 1)[0].id == 1000000007ull * 18);
+		}
+		SECTION("Save and load") {
+			std::string fpath = "knn_test_flat.bin", hpath = "knn_test_hnsw.bin";
+			REQUIRE(flat.save(fpath));
+			REQUIRE(hnsw.save(hpath));
+			FlatIndex f2(1);
+			HnswIndex h2(1);
+			REQUIRE(FlatIndex::load(fpath, f2));
+			REQUIRE(HnswIndex::load(hpath, h2));
+			REQUIRE_FALSE(HnswIndex::load(fpath, h2));
+			REQUIRE(f2.size() == n);
+			REQUIRE(h2.size() == n);
+			Vector q = random_vector();
+			auto a = hnsw.search(q, k), b = h2.search(q, k);
+			for (size_t r = 0; r < k; r++) REQUIRE(a[r].id == b[r].id);
+			REQUIRE(f2.search(q, 1)[0].id == flat.search(q, 1)[0].id);
+			REQUIRE(h2.add(1, q));
+			REQUIRE(h2.search(q, 1)[0].id == 1);
+
+			// пустой индекс с уровнем входа в заголовке -- повреждён
+			REQUIRE(HnswIndex(d).save(hpath));
+			REQUIRE(HnswIndex::load(hpath, h2));
+			REQUIRE(h2.search(q, 1).empty());
+			{
+				std::fstream f(hpath, std::ios::binary | std::ios::in | std::ios::out);
+				int64_t level = 0;
+				f.seekp(72); // FileHeader::max_level
+				f.write(reinterpret_cast<const char*>(&level), sizeof(level));
+			}
+			REQUIRE_FALSE(HnswIndex::load(hpath, h2));
+			std::remove(fpath.c_str());
+			std::remove(hpath.c_str());
+		}
+	}
+
+
+	TEST_CASE("Quantized matrices") {
+		SECTION("Half conversion") {
+			REQUIRE(float_to_half(1.0f) == 0x3c00);
+			REQUIRE(float_to_half(-2.0f) == 0xc000);
+			REQUIRE(float_to_half(65504.0f) == 0x7bff);
+			REQUIRE(float_to_half(65520.0f) == 0x7c00);
+			REQUIRE(float_to_half(std::ldexp(1.0f, -24)) == 0x0001);
+			REQUIRE(float_to_half(1.0f + std::ldexp(1.0f, -11)) == 0x3c00); // ничья -- к чётному
+			REQUIRE(std::isnan(half_to_float(float_to_half(NAN))));
+			for (uint32_t h = 0; h < 0x10000; h++) {
+				if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff)) continue;
+				REQUIRE(float_to_half(half_to_float((uint16_t)h)) == h);
+			}
+		}
+		size_t m = 96, k = 200, n = 5;
+		Matrix W(m, k, 0.0), B(k, n, 0.0);
+		Vector x(k, 0);
+		for (size_t i = 0; i < m; i++)
+			for (size_t j = 0; j < k; j++) W[i][j] = std::sin(0.37 * i + 0.11 * j) * (1 + i % 3);
+		for (size_t j = 0; j < k; j++) {
+			x[j] = std::cos(0.05 * j);
+			for (size_t c = 0; c < n; c++) B[j][c] = std::sin(0.3 * j * (c + 1));
+		}
+		Int8Matrix q8(W);
+		HalfMatrix q16(W);
+
+		SECTION("Storage") {
+			REQUIRE(q8.shape() == std::make_pair(m, k));
+			REQUIRE(q8.bytes() < m * k * sizeof(double) / 7);
+			REQUIRE(q16.bytes() == m * k * 2);
+			Matrix back = q8.dequantize();
+			for (size_t i = 0; i < m; i++)
+				for (size_t j = 0; j < k; j++) REQUIRE(std::fabs(back.get(i, j) - W.get(i, j)) <= q8.scale(i) / 2 * 1.0001);
+			REQUIRE(q16.dequantize().get(3, 4) == Approx(W.get(3, 4)).epsilon(1e-3));
+		}
+		SECTION("GEMV and GEMM") {
+			Vector y = W * x;
+			Vector y8 = gemv(q8, x), y16 = gemv(q16, x);
+			REQUIRE((y8 - y).norm() / y.norm() < 0.02);
+			REQUIRE((y16 - y).norm() / y.norm() < 2e-3);
+			Matrix C = W * B;
+			Matrix C8 = gemm(q8, B), C16 = gemm(q16, B);
+			REQUIRE((C8 - C).norm() / C.norm() < 0.05);
+			REQUIRE((C16 - C).norm() / C.norm() < 2e-3);
+			for (size_t c = 0; c < n; c++) {
+				Vector col(k, 0);
+				for (size_t j = 0; j < k; j++) col[j] = B.get(j, c);
+				REQUIRE(gemv(q8, col)[7] == Approx(C8.get(7, c)));
+			}
+		}
+		SECTION("Report") {
+			QuantizedReport r8 = compare_gemv(q8, W, x, 3), r16 = compare_gemv(q16, W, x, 3);
+			REQUIRE(r8.relative_error < 0.02);
+			REQUIRE(r16.relative_error < 2e-3);
+			REQUIRE(r8.max_abs_error > 0);
+			REQUIRE(r8.double_bytes == m * k * sizeof(double));
+			REQUIRE(r16.seconds >= 0);
+		}
+	}
+
+	TEST_CASE("Kernel tuning") {
+		TuningParams saved = current_tuning();
+		std::mt19937 gen(7);
+		std::uniform_real_distribution<double> dist(-1, 1);
+		Matrix A(13, 37, 0.0);
+		for (int i = 0; i < 13; i++)
+			for (int j = 0; j < 37; j++) A.a[i][j] = dist(gen);
+		Vector x(37);
+		for (int j = 0; j < 37; j++) x[j] = dist(gen);
+
+		SECTION("GEMV does not depend on unrolling") {
+			std::vector<double> ref(13);
+			for (int i = 0; i < 13; i++) {
+				double s = 0;
+				for (int j = 0; j < 37; j++) s += A.a[i][j] * x[j];
+				ref[i] = s;
+			}
+			for (size_t rows : { 1, 2, 4, 8 }) {
+				GemvBlocking b;
+				b.rows = rows;
+				std::vector<double> y(13);
+				gemv(view(A), x.data, y.data(), b);
+				for (int i = 0; i < 13; i++) REQUIRE(y[i] == ref[i]);
+			}
+			Vector y = A * x;
+			for (int i = 0; i < 13; i++) REQUIRE(y[i] == ref[i]);
+		}
+		SECTION("Transpose tile") {
+			for (size_t tile : { 2, 5, 64 }) {
+				transpose_blocking().tile = tile;
+				Matrix t(37, 13, 0.0);
+				transpose(view(A), view(t));
+				for (int i = 0; i < 13; i++)
+					for (int j = 0; j < 37; j++) REQUIRE(t.a[j][i] == A.a[i][j]);
+			}
+		}
+		SECTION("Cache file format") {
+			TuningCache cache;
+			TuningParams p;
+			p.gemm.mc = 144;
+			p.gemm.kc = 384;
+			p.transpose.tile = 16;
+			p.gemv.rows = 8;
+			cache.set("CPU [a]", p);
+			cache.set("other", TuningParams());
+			std::stringstream ss;
+			cache.write(ss);
+			TuningCache back;
+			REQUIRE(back.read(ss));
+			REQUIRE(back.size() == 2);
+			TuningParams q;
+			REQUIRE(back.find("CPU [a]", q));
+			REQUIRE(q.gemm.mc == 144);
+			REQUIRE(q.gemm.kc == 384);
+			REQUIRE(q.gemm.nc == GemmBlocking().nc);
+			REQUIRE(q.transpose.tile == 16);
+			REQUIRE(q.gemv.rows == 8);
+			REQUIRE_FALSE(back.find("missing", q));
+
+			std::stringstream bad1("gemm.mc = 4\n"), bad2("[x]\ngemv.rows = 3\n"), bad3("[x]\ngemm.kc = -1\n");
+			std::stringstream bad4("[x]\ngemm.nc = 1000000000000\n"), bad5("[x]\ngemm.kc = 4\n");
+			REQUIRE_FALSE(back.read(bad1));
+			REQUIRE_FALSE(back.read(bad2));
+			REQUIRE_FALSE(back.read(bad3));
+			REQUIRE_FALSE(back.read(bad4));
+			REQUIRE_FALSE(back.read(bad5));
+			REQUIRE(back.size() == 0);
+		}
+		SECTION("Autotune and command line") {
+			REQUIRE_FALSE(cpu_model().empty());
+			TuningParams p = autotune(TuneOptions::quick());
+			REQUIRE(p.gemm.mc % 24 == 0);
+			REQUIRE(p.gemm.kc >= 128);
+			REQUIRE(p.transpose.tile >= 8);
+			REQUIRE(current_tuning().gemm.mc == saved.gemm.mc);
+
+			std::string path = "tuning_test.txt";
+			std::ostringstream out;
+			const char* bad[] = { "tune", "--bogus" };
+			REQUIRE(tune_command(2, bad, out) == 2);
+			const char* show[] = { "tune", "--file", "tuning_test.txt", "--show" };
+			REQUIRE(tune_command(4, show, out) == 1);
+			const char* run[] = { "tune", "--file", "tuning_test.txt", "--quick" };
+			REQUIRE(tune_command(4, run, out) == 0);
+			REQUIRE(tune_command(4, show, out) == 0);
+			REQUIRE(out.str().find(cpu_model()) != std::string::npos);
+
+			TuningParams tuned = current_tuning();
+			apply_tuning(saved);
+			REQUIRE(load_tuning(path));
+			REQUIRE(current_tuning().gemm.kc == tuned.gemm.kc);
+			REQUIRE(current_tuning().gemv.rows == tuned.gemv.rows);
+			std::remove(path.c_str());
+			REQUIRE_FALSE(load_tuning(path));
+		}
+		apply_tuning(saved);
+	}
+
+#if defined(__unix__) || defined(__APPLE__)
+	TEST_CASE("Shared memory matrices") {
+		std::string name = "/mat_vec_test_" + std::to_string(std::random_device()());
+		SharedMatrix writer;
+		REQUIRE(SharedMatrix::create(name, 3, 4, writer));
+		SharedMatrix duplicate;
+		REQUIRE_FALSE(SharedMatrix::create(name, 3, 4, duplicate));
+		SharedMatrix reader;
+		REQUIRE(SharedMatrix::attach(name, reader));
+		REQUIRE_FALSE(reader.writable());
+		REQUIRE(reader.shape() == std::make_pair<size_t, size_t>(3, 4));
+		SharedVector wrong;
+		REQUIRE_FALSE(SharedVector::attach(name, wrong));
+
+		SECTION("Publish and read") {
+			Matrix m(3, 4, 0.0);
+			for (int i = 0; i < 3; i++)
+				for (int j = 0; j < 4; j++) m.a[i][j] = i * 10 + j;
+			REQUIRE(reader.version() == 0);
+			REQUIRE(writer.publish(m));
+			REQUIRE_FALSE(writer.publish(Matrix(2, 2, 0.0)));
+			REQUIRE_FALSE(reader.publish(m));
+			REQUIRE(reader.version() == 1);
+			// окно читателя смотрит прямо в сегмент
+			REQUIRE(reader.view().at(2, 3) == 23);
+			Matrix copy(1, 1, 0.0);
+			REQUIRE(reader.read(copy));
+			REQUIRE(copy == m);
+
+			writer.begin_write();
+			writer.view().at(0, 0) = -1;
+			double seen = 0;
+			REQUIRE_FALSE(reader.read_view([&](const MatrixRef& v) { seen = v.at(0, 0); }));
+			REQUIRE_FALSE(reader.read(copy, 3));
+			writer.end_write();
+			REQUIRE(reader.read_view([&](const MatrixRef& v) { seen = v.at(0, 0); }));
+			REQUIRE(seen == -1);
+			REQUIRE(reader.version() == 2);
+		}
+		SECTION("Consistent snapshots under concurrent writes") {
+			const int updates = 2000;
+			std::atomic<bool> done{ false };
+			std::thread producer([&] {
+				Matrix m(3, 4, 0.0);
+				for (int k = 1; k <= updates; k++) {
+					for (int i = 0; i < 3; i++)
+						for (int j = 0; j < 4; j++) m.a[i][j] = k;
+					writer.publish(m);
+				}
+				done = true;
+			});
+			Matrix snap(1, 1, 0.0);
+			size_t torn = 0, reads = 0;
+			while (!done || reads == 0) {
+				if (!reader.read(snap)) continue;
+				reads++;
+				for (int i = 0; i < 3; i++)
+					for (int j = 0; j < 4; j++) torn += snap.a[i][j] != snap.a[0][0];
+			}
+			producer.join();
+			REQUIRE(torn == 0);
+			REQUIRE(reader.read(snap));
+			REQUIRE(snap.a[2][3] == updates);
+			REQUIRE(reader.version() == (uint64_t)updates);
+		}
+		SECTION("Vectors") {
+			std::string vname = name + "_v";
+			SharedVector wv, rv;
+			REQUIRE(SharedVector::create(vname, 5, wv));
+			REQUIRE(SharedVector::attach(vname, rv));
+			REQUIRE(rv.mutable_data() == nullptr);
+			Vector v(5);
+			for (int i = 0; i < 5; i++) v[i] = i + 0.5;
+			REQUIRE(wv.publish(v));
+			REQUIRE(rv.data()[4] == 4.5);
+			Vector out(1);
+			REQUIRE(rv.read(out));
+			REQUIRE(out == v);
+			REQUIRE(wv.unlink());
+			SharedVector again;
+			REQUIRE_FALSE(SharedVector::attach(vname, again));
+			REQUIRE(rv.data()[4] == 4.5);
+		}
+		REQUIRE(writer.unlink());
+		REQUIRE_FALSE(SharedMatrix::attach(name, reader));
+	}
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+	TEST_CASE("Distributed multiply") {
+		std::mt19937 gen(11);
+		std::uniform_real_distribution<double> dist(-1, 1);
+		auto random_matrix = [&](int r, int c) {
+			Matrix m(r, c, 0.0);
+			for (int i = 0; i < r; i++)
+				for (int j = 0; j < c; j++) m.a[i][j] = dist(gen);
+			return m;
+		};
+		Matrix A = random_matrix(150, 130), B = random_matrix(130, 170);
+		Matrix ref = A * B;
+
+		SECTION("Unix sockets") {
+			LocalCluster local;
+			REQUIRE(local.start(4));
+			Cluster cluster;
+			REQUIRE(cluster.connect(local.addresses()));
+			REQUIRE(cluster.size() == 4);
+			DistributedOptions opt;
+			opt.block = 32;
+			opt.panel = 40;
+			Matrix C(1, 1, 0.0);
+			REQUIRE(cluster.multiply(A, B, C, opt));
+			REQUIRE(C.shape() == ref.shape());
+			REQUIRE((C - ref).norm() <= 1e-12 * ref.norm());
+			const std::vector<NodeStats>& st = cluster.stats();
+			REQUIRE(st.size() == 4);
+			uint64_t sent = 0;
+			for (const NodeStats& s : st) {
+				REQUIRE(s.panels == 4);
+				REQUIRE(s.total_seconds >= s.compute_seconds);
+				sent += s.bytes_sent;
+			}
+			REQUIRE(st[3].grid_row == 1);
+			REQUIRE(st[3].grid_col == 1);
+			REQUIRE(sent > (150 * 130 + 130 * 170) * sizeof(double));
+
+			// соединения переиспользуются; узлы без своих блоков тоже отвечают
+			Matrix small = random_matrix(5, 7), small_b = random_matrix(7, 3);
+			REQUIRE(cluster.multiply(small, small_b, C));
+			REQUIRE((C - small * small_b).norm() <= 1e-12);
+			REQUIRE_FALSE(cluster.multiply(A, A, C));
+			opt.grid_rows = 3;
+			REQUIRE_FALSE(cluster.multiply(A, B, C, opt));
+		}
+		SECTION("Stop with a connected coordinator") {
+			// узлы ждут следующего задания на открытых соединениях
+			Cluster cluster;
+			Matrix C(1, 1, 0.0);
+			{
+				LocalCluster local;
+				REQUIRE(local.start(2));
+				REQUIRE(cluster.connect(local.addresses()));
+				REQUIRE(cluster.multiply(A, B, C));
+			}
+			REQUIRE(cluster.size() == 2);
+			REQUIRE_FALSE(cluster.multiply(A, B, C));
+			REQUIRE(cluster.size() == 0);
+		}
+		SECTION("TCP") {
+			LocalCluster local;
+			REQUIRE(local.start(3, true));
+			REQUIRE(local.addresses()[0].compare(0, 14, "tcp:127.0.0.1:") == 0);
+			Cluster cluster;
+			REQUIRE(cluster.connect(local.addresses()));
+			DistributedOptions opt;
+			opt.grid_rows = 3;
+			Matrix C(1, 1, 0.0);
+			REQUIRE(cluster.multiply(A, B, C, opt));
+			REQUIRE((C - ref).norm() <= 1e-12 * ref.norm());
+			cluster.shutdown();
+			REQUIRE(cluster.size() == 0);
+		}
+		SECTION("Unreachable node") {
+			Cluster cluster;
+			REQUIRE_FALSE(cluster.connect({ "unix:/nonexistent/mat_vec.sock" }));
+			REQUIRE_FALSE(cluster.connect({ "bogus" }));
+		}
+	}
+#endif
+
+	TEST_CASE("Async operations") {
+		std::mt19937 gen(5);
+		std::uniform_real_distribution<double> dist(-1, 1);
+		Matrix A(40, 40, 0.0);
+		for (int i = 0; i < 40; i++) {
+			for (int j = 0; j < 40; j++) A.a[i][j] = dist(gen);
+			A.a[i][i] += 40;
+		}
+		Vector b(40);
+		for (int i = 0; i < 40; i++) b[i] = dist(gen);
+
+		SECTION("Pipelined operations") {
+			Future<Matrix> inv = async_inv(A);
+			Future<Matrix> eye = async_mul(inv, A);
+			Future<Vector> x = async_solve(A, b);
+			Future<Vector> r = async_mul(A, x);
+			Future<double> det = async_det(A);
+			REQUIRE((eye.get() - Matrix::eye(40)).norm() < 1e-12);
+			REQUIRE((r.get() - b).norm() < 1e-12);
+			REQUIRE(det.get() == Approx(A.det()).epsilon(1e-10));
+			REQUIRE(inv.status() == AsyncStatus::DONE);
+			REQUIRE(async_solve(A, A).get().get(5, 5) == Approx(1));
+		}
+		SECTION("Failure propagates") {
+			Future<Matrix> bad = async_call<Matrix>(AsyncOptions(), [](const Matrix&) -> Matrix {
+				throw std::runtime_error("boom");
+			}, Future<Matrix>(A));
+			Future<Matrix> next = async_mul(bad, A);
+			REQUIRE_THROWS_AS(next.get(), std::runtime_error);
+			REQUIRE(bad.status() == AsyncStatus::FAILED);
+			REQUIRE(next.status() == AsyncStatus::FAILED);
+			REQUIRE_FALSE(next.cancel());
+		}
+
+		ThreadPool& pool = ThreadPool::global();
+		if (pool.size() > 0) {
+			// все рабочие потоки заняты, пока не открыт их gate
+			std::atomic<size_t> started{ 0 };
+			std::vector<std::atomic<bool>> gates(pool.size());
+			for (auto& g : gates) g = false;
+			std::vector<Future<int>> blockers;
+			for (size_t i = 0; i < pool.size(); i++)
+				blockers.push_back(async_call<int>(AsyncOptions(), [&, i] {
+					started++;
+					while (!gates[i]) std::this_thread::yield();
+					return 0;
+				}));
+			while (started < pool.size()) std::this_thread::yield();
+
+			SECTION("Priority") {
+				std::mutex lock;
+				std::vector<int> order;
+				std::vector<Future<int>> ops;
+				for (int p : { 1, 5, 3, 5, -2 }) {
+					AsyncOptions opt;
+					opt.priority = p;
+					ops.push_back(async_call<int>(opt, [&, p] {
+						std::lock_guard<std::mutex> guard(lock);
+						order.push_back(p);
+						return p;
+					}));
+				}
+				// освобождается один поток, и операции идут строго по очереди
+				gates[0] = true;
+				for (auto& f : ops)
+					while (!f.ready()) std::this_thread::yield();
+				REQUIRE(order == std::vector<int>({ 5, 5, 3, 1, -2 }));
+			}
+			SECTION("Cancellation") {
+				Future<Matrix> inv = async_inv(A);
+				Future<Matrix> next = async_mul(inv, A);
+				REQUIRE(inv.cancel());
+				REQUIRE_FALSE(inv.cancel());
+				REQUIRE(next.status() == AsyncStatus::CANCELLED);
+				REQUIRE_THROWS_AS(next.get(), AsyncCancelled);
+				REQUIRE_FALSE(blockers[0].cancel());
+			}
+			for (auto& g : gates) g = true;
+			for (auto& f : blockers) REQUIRE(f.get() == 0);
+		}
+	}
+
+	TEST_CASE("Lazy evaluation") {
+		std::mt19937 gen(9);
+		std::uniform_real_distribution<double> dist(-1, 1);
+		auto random_matrix = [&](int r, int c) {
+			Matrix m(r, c, 0.0);
+			for (int i = 0; i < r; i++)
+				for (int j = 0; j < c; j++) m.a[i][j] = dist(gen);
+			return m;
+		};
+		Matrix A = random_matrix(30, 20), B = random_matrix(20, 30), C = random_matrix(30, 30);
+		LazyGraph g;
+		LazyExpr a = g.input(A), b = g.input(B), c = g.input(C);
+
+		SECTION("Fused element-wise chain") {
+			LazyExpr e = sigmoid(a * b + c) * 2.0 - tanh(c);
+			Matrix ref = sigmoid(A * B + C) * 2.0 - tanh(C);
+			for (bool parallel : { true, false }) {
+				LazyOptions opt;
+				opt.parallel = parallel;
+				Matrix r = g.evaluate(e, opt);
+				REQUIRE((r - ref).norm() <= 1e-13 * ref.norm());
+				const LazyStats& st = g.stats();
+				REQUIRE(st.nodes == 9);
+				REQUIRE(st.kernels == 2);
+				REQUIRE(st.fused == 4);
+				REQUIRE(st.peak_bytes == 2 * 30 * 30 * sizeof(double));
+				REQUIRE(st.eager_bytes == 6 * 30 * 30 * sizeof(double));
+			}
+		}
+		SECTION("Common subexpressions") {
+			size_t before = g.size();
+			LazyExpr p = a * b, q = a * b;
+			REQUIRE(p.id() == q.id());
+			REQUIRE((p + c).id() == (c + p).id());
+			REQUIRE((p - c).id() != (c - p).id());
+			REQUIRE(transpose(transpose(a)).id() == a.id());
+			REQUIRE((-(-c)).id() == c.id());
+			REQUIRE((p * 2.0).id() == (2.0 * q).id());
+			REQUIRE((p * 2.0).id() != (p * 3.0).id());
+			REQUIRE(g.reused() >= 3);
+			REQUIRE(g.size() - before == 8);
+
+			// общий узел считается один раз и остаётся целиком
+			LazyExpr s = exp(p * 0.1);
+			std::vector<Matrix> out;
+			REQUIRE(g.evaluate({ p, s, hadamard(s, s) }, out));
+			Matrix AB = A * B, S = exp(AB * 0.1);
+			REQUIRE((out[0] - AB).norm() <= 1e-13 * AB.norm());
+			REQUIRE((out[1] - S).norm() <= 1e-13 * S.norm());
+			REQUIRE(out[2].get(3, 4) == Approx(S.get(3, 4) * S.get(3, 4)));
+			REQUIRE(g.stats().kernels == 3);
+		}
+		SECTION("Independent branches and memory order") {
+			Matrix D = random_matrix(30, 30);
+			LazyExpr d = g.input(D);
+			LazyExpr left = (a * b) * (c * d), right = transpose(c * d) + c;
+			std::vector<Matrix> out;
+			REQUIRE(g.evaluate({ left + right, transpose(a) }, out));
+			Matrix CD = C * D;
+			Matrix ref = (A * B) * CD + CD.transposed() + C;
+			REQUIRE((out[0] - ref).norm() <= 1e-12 * ref.norm());
+			REQUIRE(out[1] == A.transposed());
+			REQUIRE(g.stats().peak_bytes < g.stats().eager_bytes);
+		}
+		SECTION("Vectors and invalid shapes") {
+			Vector v(20);
+			for (int i = 0; i < 20; i++) v[i] = dist(gen);
+			Matrix r = g.evaluate(a * g.input(v));
+			Vector ref = A * v;
+			REQUIRE(r.shape() == std::make_pair<size_t, size_t>(30, 1));
+			for (int i = 0; i < 30; i++) REQUIRE(r.get(i, 0) == Approx(ref[i]));
+
+			LazyExpr bad = a * a;
+			REQUIRE_FALSE(bad.valid());
+			REQUIRE_FALSE((bad + c).valid());
+			std::vector<Matrix> out;
+			REQUIRE_FALSE(g.evaluate({ bad }, out));
+			REQUIRE(g.evaluate(bad).shape() == std::make_pair<size_t, size_t>(0, 0));
+			LazyGraph other;
+			REQUIRE_FALSE((a + other.input(C)).valid());
+		}
+	}
+
+	TEST_CASE("Work stealing") {
+		ThreadPool pool(3);
+
+		SECTION("Fork/join tree") {
+			std::function<size_t(size_t)> leaves = [&](size_t n) -> size_t {
+				if (n < 2) return 1;
+				size_t l = 0, r = 0;
+				fork_join([&] { l = leaves(n - 1); }, [&] { r = leaves(n - 2); }, pool);
+				return l + r;
+			};
+			pool.reset_stats();
+			REQUIRE(leaves(20) == 10946);
+			std::vector<WorkerStats> stats = pool.stats();
+			REQUIRE(stats.size() == 3);
+			uint64_t tasks = 0;
+			for (auto& s : stats) {
+				REQUIRE(s.steals <= s.tasks);
+				REQUIRE(s.idle_seconds >= 0);
+				tasks += s.tasks;
+			}
+			REQUIRE(tasks > 0);
+			pool.reset_stats();
+			for (auto& s : pool.stats()) REQUIRE((s.tasks == 0 && s.steals == 0 && s.idle_seconds == 0));
+		}
+
+		SECTION("Exceptions") {
+			bool other = false;
+			REQUIRE_THROWS_AS(fork_join([&] { other = true; }, [] { throw std::runtime_error("x"); }, pool),
+				std::runtime_error);
+			REQUIRE(other);
+			REQUIRE_THROWS_AS(fork_join([] { throw std::runtime_error("x"); }, [] {}, ThreadPool::global()),
+				std::runtime_error);
+		}
+
+		SECTION("Parallel for") {
+			const size_t n = 10007, grain = 64;
+			std::vector<std::atomic<int>> hits(n);
+			std::atomic<bool> short_piece{ false };
+			parallel_for(0, n, grain, [&](size_t from, size_t to) {
+				if (to - from < grain) short_piece = true;
+				for (size_t i = from; i < to; ++i) hits[i]++;
+			});
+			bool once = true;
+			for (auto& h : hits) once = once && h == 1;
+			REQUIRE(once);
+			REQUIRE(!short_piece);
+		}
+
+		SECTION("Blocked Cholesky") {
+			const size_t n = 200;
+			Matrix a(n, 0.0);
+			for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j)
+				a.a[i][j] = (i == j ? 1.0 * n : 0.0) + (double)((i * 5 + j * 11) % 19) / 19.0;
+			Matrix spd = a * a.transposed();
+			Cholesky c(spd);
+			REQUIRE(c.ok());
+			const Matrix& l = c.factor();
+			bool lower = true;
+			for (size_t i = 0; i < n; ++i) for (size_t j = i + 1; j < n; ++j) lower = lower && l.a[i][j] == 0;
+			REQUIRE(lower);
+			Matrix r = l * l.transposed() - spd;
+			double e = 0;
+			for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j) e = std::max(e, std::abs(r.a[i][j]));
+			REQUIRE(e < 1e-6 * n * n);
+			spd.a[150][150] = -1;
+			REQUIRE(!Cholesky(spd).ok());
+		}
+	}
+
+	TEST_CASE("Graph analytics") {
+		SECTION("Sparse matrix") {
+			SparseMatrix s = SparseMatrix::from_triplets(3, 4,
+				{ { 2, 1, 1.0 }, { 0, 3, 2.0 }, { 0, 0, -1.0 }, { 2, 1, 4.0 }, { 5, 0, 9.0 } });
+			REQUIRE(s.valid());
+			REQUIRE(s.nnz() == 3);
+			REQUIRE(s.get(2, 1) == 5);
+			REQUIRE(s.get(1, 1) == 0);
+			Matrix d = s.to_dense();
+			REQUIRE(SparseMatrix::from_dense(d).to_dense() == d);
+			REQUIRE(s.transposed().to_dense() == d.transposed());
+			Vector x(4, 0);
+			for (size_t i = 0; i < 4; ++i) x[i] = (double)i + 1;
+			REQUIRE(s * x == d * x);
+			REQUIRE(!SparseMatrix(2, 2, { 0, 2, 2 }, { 1, 0 }, { 1.0, 1.0 }).valid());
+
+			const size_t n = 3000;
+			std::vector<Triplet> t;
+			for (size_t i = 0; i < n; ++i)
+				for (size_t k = 0; k < (i % 50 == 0 ? 400 : 5); ++k) t.push_back({ i, (i * 31 + k * 97) % n, 1.0 + k });
+			SparseMatrix big = SparseMatrix::from_triplets(n, n, t);
+			Vector y(n, 1.0);
+			Vector z = big * y;
+			bool same = true;
+			for (size_t i = 0; i < n; ++i) {
+				double s = 0;
+				for (size_t p = big.row_ptr()[i]; p < big.row_ptr()[i + 1]; ++p) s += big.values()[p];
+				same = same && s == z[i];
+			}
+			REQUIRE(same);
+		}
+
+		SECTION("Edge loader") {
+			std::stringstream text;
+			text << "# comment\n% other\n\n1000000000000 7\n7\t42 0.5\r\n42,1000000000000\n7 7";
+			EdgeLoader loader;
+			REQUIRE(loader.read(text));
+			REQUIRE(loader.vertices() == 3);
+			REQUIRE(loader.edges() == 4);
+			REQUIRE(loader.index(1000000000000ull) == 0);
+			REQUIRE(loader.index(42) == 2);
+			REQUIRE(loader.index(5) == NO_VERTEX);
+			REQUIRE(loader.id(1) == 7);
+			REQUIRE(loader.edges_per_second() >= 0);
+			Graph g = loader.build();
+			REQUIRE(loader.edges() == 0);
+			REQUIRE(loader.index(42) == 2);
+			REQUIRE(g.vertices() == 3);
+			REQUIRE(g.edges() == 4);
+			REQUIRE(g.out_degree(1) == 2);
+			REQUIRE(g.in_degree(1) == 2);
+
+			std::stringstream bad("1 2\n3 x\n4 5\n");
+			EdgeLoader partial;
+			REQUIRE(!partial.read(bad));
+			REQUIRE(partial.edges() == 1);
+
+			// строки, разрезанные границей блока чтения
+			std::stringstream many;
+			for (size_t i = 0; i < 20000; ++i) many << i << ' ' << (i * 7 + 1) % 20000 << '\n';
+			EdgeLoader big;
+			REQUIRE(big.read(many));
+			REQUIRE(big.edges() == 20000);
+			REQUIRE(big.vertices() == 20000);
+			REQUIRE(big.id(big.index(12345)) == 12345);
+		}
+
+		// граф: кольцо из 1500 вершин с хордами, висячая вершина и отдельная компонента
+		const uint32_t n = 2000;
+		std::vector<uint32_t> src, dst;
+		for (uint32_t i = 0; i < 1500; ++i) {
+			src.push_back(i); dst.push_back((i + 1) % 1500);
+			if (i % 7 == 0) { src.push_back(i); dst.push_back((i * 13 + 5) % 1500); }
+		}
+		src.push_back(3); dst.push_back(1500);
+		for (uint32_t i = 1600; i < 1999; ++i) { src.push_back(i + 1); dst.push_back(i); }
+		src.push_back(3); dst.push_back(1500);
+		Graph g(n, src, dst);
+
+		SECTION("PageRank") {
+			REQUIRE(g.edges() == src.size() - 1);
+			// эталон: плотный степенной метод
+			Vector ref(n, 1.0 / n);
+			for (int it = 0; it < 200; ++it) {
+				Vector next(n, 0);
+				double dangling = 0;
+				for (uint32_t u = 0; u < n; ++u) {
+					size_t deg = g.out_degree(u);
+					if (!deg) dangling += ref[u];
+					for (size_t p = g.out().row_ptr()[u]; p < g.out().row_ptr()[u + 1]; ++p)
+						next[g.out().cols_idx()[p]] += ref[u] / deg;
+				}
+				for (uint32_t v = 0; v < n; ++v) next[v] = 0.15 / n + 0.85 * (next[v] + dangling / n);
+				ref = next;
+			}
+			for (PageRankMode mode : { PageRankMode::PULL, PageRankMode::PUSH }) {
+				PageRankOptions opt;
+				opt.mode = mode;
+				opt.max_iterations = 300;
+				GraphStats stats;
+				Vector r = pagerank(g, opt, &stats);
+				double total = 0, err = 0;
+				for (uint32_t v = 0; v < n; ++v) {
+					total += r[v];
+					err = std::max(err, std::abs(r[v] - ref[v]));
+				}
+				REQUIRE(std::abs(total - 1) < 1e-9);
+				REQUIRE(err < 1e-9);
+				REQUIRE(stats.iterations > 1);
+				REQUIRE(stats.edges_processed == stats.iterations * g.edges());
+				REQUIRE(stats.edges_per_second > 0);
+			}
+			REQUIRE(pagerank(Graph()).size() == 0);
+		}
+
+		SECTION("BFS") {
+			// эталон: последовательный поиск
+			std::vector<uint32_t> ref(n, NO_VERTEX);
+			std::vector<uint32_t> queue(1, 0);
+			ref[0] = 0;
+			for (size_t k = 0; k < queue.size(); ++k) {
+				uint32_t u = queue[k];
+				for (size_t p = g.out().row_ptr()[u]; p < g.out().row_ptr()[u + 1]; ++p) {
+					uint32_t v = g.out().cols_idx()[p];
+					if (ref[v] == NO_VERTEX) { ref[v] = ref[u] + 1; queue.push_back(v); }
+				}
+			}
+			const double alphas[] = { 14, 1e-12, 1e12 };
+			for (double alpha : alphas) {
+				BfsOptions opt;
+				opt.alpha = alpha;
+				if (alpha > 1e6) opt.beta = 1e12;
+				BfsResult res;
+				GraphStats stats;
+				REQUIRE(bfs(g, 0, res, opt, &stats));
+				REQUIRE(res.depth == ref);
+				REQUIRE(res.reached == queue.size());
+				bool tree = res.parent[0] == 0;
+				for (uint32_t v = 1; v < n; ++v)
+					tree = tree && (ref[v] == NO_VERTEX ? res.parent[v] == NO_VERTEX
+						: ref[res.parent[v]] + 1 == ref[v] && g.out().get(res.parent[v], v) != 0);
+				REQUIRE(tree);
+				if (alpha < 1) REQUIRE(res.bottom_up_steps == 0);
+				if (alpha > 1e6) REQUIRE(res.top_down_steps == 0);
+				REQUIRE(stats.edges_processed > 0);
+			}
+			BfsResult res;
+			REQUIRE(!bfs(g, n, res));
+		}
+
+		SECTION("Connected components") {
+			std::vector<uint32_t> label;
+			GraphStats stats;
+			// 0..1500, 1600..1999 и по одной на 1501..1599
+			REQUIRE(connected_components(g, label, &stats) == 2 + 99);
+			REQUIRE(label[1500] == 0);
+			REQUIRE(label[1234] == 0);
+			REQUIRE(label[1999] == 1600);
+			REQUIRE(label[1550] == 1550);
+			REQUIRE(stats.edges_processed == g.edges());
+			Graph u(n, src, dst, true);
+			REQUIRE(u.edges() == 2 * g.edges());
+			std::vector<uint32_t> label_u;
+			REQUIRE(connected_components(u, label_u) == 101);
+			REQUIRE(label_u == label);
+		}
+	}
+
+	TEST_CASE("Sparse orderings") {
+		// сетка side x side (пятиточечный лапласиан) в перемешанной нумерации
+		auto grid = [](size_t side, const std::vector<uint32_t>& label) {
+			std::vector<Triplet> t;
+			for (size_t y = 0; y < side; ++y) for (size_t x = 0; x < side; ++x) {
+				size_t v = label[y * side + x];
+				t.push_back({ v, v, 4.0 + (double)(v % 3) });
+				if (x + 1 < side) {
+					size_t w = label[y * side + x + 1];
+					t.push_back({ v, w, -1.0 });
+					t.push_back({ w, v, -1.0 });
+				}
+				if (y + 1 < side) {
+					size_t w = label[(y + 1) * side + x];
+					t.push_back({ v, w, -1.0 });
+					t.push_back({ w, v, -1.0 });
+				}
+			}
+			return SparseMatrix::from_triplets(side * side, side * side, t);
+		};
+		auto shuffled = [](size_t n) {
+			std::vector<uint32_t> label(n);
+			for (size_t i = 0; i < n; ++i) label[i] = (uint32_t)i;
+			for (size_t i = n; i-- > 1;) std::swap(label[i], label[(i * 7919 + 13) % (i + 1)]);
+			return label;
+		};
+
+		SECTION("Permutation") {
+			Permutation p(std::vector<uint32_t>{ 2, 0, 1 });
+			REQUIRE(p.valid());
+			REQUIRE(p[0] == 2);
+			REQUIRE(p.position(2) == 0);
+			REQUIRE(p.inverse().order() == std::vector<uint32_t>{ 1, 2, 0 });
+			REQUIRE(!Permutation(std::vector<uint32_t>{ 0, 0, 1 }).valid());
+			REQUIRE(!Permutation(std::vector<uint32_t>{ 0, 3 }).valid());
+			REQUIRE(Permutation(4).order() == std::vector<uint32_t>{ 0, 1, 2, 3 });
+		}
+
+		SECTION("RCM and AMD") {
+			const size_t side = 30, n = side * side;
+			SparseMatrix a = grid(side, shuffled(n));
+			BandStats before = band_stats(a);
+			REQUIRE(before.bandwidth > n / 2);
+
+			Permutation r = rcm(a);
+			REQUIRE(r.valid());
+			REQUIRE(r.size() == n);
+			BandStats after = band_stats(a, r);
+			REQUIRE(after.bandwidth <= 2 * side);
+			REQUIRE(after.profile * 10 < before.profile);
+			SparseMatrix b = permute(a, r);
+			REQUIRE(b.valid());
+			REQUIRE(b.nnz() == a.nnz());
+			BandStats direct = band_stats(b);
+			REQUIRE(direct.bandwidth == after.bandwidth);
+			REQUIRE(direct.profile == after.profile);
+			bool same = true;
+			for (size_t i = 0; i < n; i += 7) for (size_t j = 0; j < n; j += 3)
+				same = same && b.get(i, j) == a.get(r[i], r[j]);
+			REQUIRE(same);
+
+			Permutation m = amd(a);
+			REQUIRE(m.valid());
+			REQUIRE(m.size() == n);
+			uint64_t natural = cholesky_nnz(a, Permutation(n));
+			uint64_t banded = cholesky_nnz(a, r);
+			uint64_t minimum = cholesky_nnz(a, m);
+			REQUIRE(banded < natural);
+			REQUIRE(minimum < banded);
+
+			// несвязный граф и неквадратная матрица
+			SparseMatrix two = SparseMatrix::from_triplets(4, 4, { { 0, 3, 1.0 }, { 3, 0, 1.0 }, { 1, 1, 1.0 } });
+			REQUIRE(rcm(two).valid());
+			REQUIRE(amd(two).valid());
+			REQUIRE(rcm(SparseMatrix(2, 3)).size() == 0);
+		}
+
+		SECTION("Symbolic fill matches numeric Cholesky") {
+			const size_t side = 8, n = side * side;
+			SparseMatrix a = grid(side, shuffled(n));
+			Permutation orders[] = { Permutation(n), rcm(a), amd(a) };
+			for (const Permutation& p : orders) {
+				Matrix l = Cholesky(permute(a, p).to_dense()).factor();
+				uint64_t count = 0;
+				for (size_t i = 0; i < n; ++i) for (size_t j = 0; j <= i; ++j) count += l.a[i][j] != 0;
+				REQUIRE(cholesky_nnz(a, p) == count);
+			}
+		}
+
+		SECTION("Permutation views") {
+			const size_t n = 5;
+			Permutation p(std::vector<uint32_t>{ 3, 0, 4, 1, 2 });
+			Vector v(n, 0);
+			for (size_t i = 0; i < n; ++i) v[i] = 10.0 * i;
+			PermutedVector pv(v, p);
+			REQUIRE(pv.size() == n);
+			REQUIRE(pv[0] == 30);
+			v[3] = -1;
+			REQUIRE(pv[0] == -1);
+			Vector back(n, 0);
+			scatter(pv.copy(), p, back);
+			REQUIRE(back == v);
+
+			Matrix m(n, n, 0.0);
+			for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j) m.a[i][j] = (double)(i * 10 + j);
+			PermutedMatrix pm(m, p);
+			REQUIRE(pm(1, 2) == m.a[0][4]);
+			Matrix dense = pm.copy();
+			REQUIRE(dense == permute(SparseMatrix::from_dense(m), p).to_dense());
+
+			Matrix id = Matrix::eye(n), c(n, n, 0.0);
+			gemm(1.0, PermutedMatrix(m, p, Permutation(n)).rows_view(), view(id), 0.0, view(c));
+			bool rows = true;
+			for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j) rows = rows && c.a[i][j] == m.a[p[i]][j];
+			REQUIRE(rows);
+
+			// виды хранят копию перестановки: временная может быть разрушена
+			PermutedVector from_temporary(v, Permutation(std::vector<uint32_t>{ 3, 0, 4, 1, 2 }));
+			PermutedMatrix cols_temporary(m, p, Permutation(std::vector<uint32_t>{ 4, 3, 2, 1, 0 }));
+			REQUIRE(from_temporary.size() == n);
+			REQUIRE(from_temporary.copy() == pv.copy());
+			REQUIRE(cols_temporary.n_cols() == n);
+			REQUIRE(cols_temporary(1, 0) == m.a[0][4]);
+			REQUIRE(cols_temporary(2, 4) == m.a[4][0]);
+		}
+	}
+
+	TEST_CASE("Matrix functions") {
+		auto max_diff = [](const Matrix& x, const Matrix& y) {
+			double e = 0;
+			for (int i = 0; i < x._size.first; ++i) for (int j = 0; j < x._size.second; ++j)
+				e = std::max(e, std::abs(x.a[i][j] - y.a[i][j]));
+			return e;
+		};
+		const size_t n = 40;
+		Matrix b(n, n, 0.0);
+		for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j)
+			b.a[i][j] = ((double)((i * 17 + j * 29) % 23) - 11) / 23.0 / n;
+		MatrixFunctions f;
+
+		SECTION("Power") {
+			Matrix r(1, 1, 0.0);
+			REQUIRE(f.pow(b, 0, r));
+			REQUIRE(r == Matrix::eye(n));
+			REQUIRE(f.pow(b, 1, r));
+			REQUIRE(r == b);
+			Matrix ref = Matrix::eye(n);
+			Matrix s = b * 4.0;
+			for (size_t k = 1; k <= 13; ++k) {
+				ref = ref * s;
+				REQUIRE(f.pow(s, k, r));
+				REQUIRE(max_diff(r, ref) < 1e-12);
+			}
+			REQUIRE(f.stats().products == 5);
+			REQUIRE(max_diff(s.pow(13), ref) < 1e-12);
+			REQUIRE(!f.pow(Matrix(2, 3, 0.0), 2, r));
+		}
+
+		SECTION("Exponential") {
+			Matrix nil(2, 2, 0.0);
+			nil.a[0][1] = 1;
+			Matrix e = expm(nil);
+			REQUIRE(e.a[0][0] == 1);
+			REQUIRE(e.a[0][1] == 1);
+			REQUIRE(e.a[1][0] == 0);
+
+			// поворот: все степени Паде и масштабирование
+			const double angles[] = { 0.005, 0.1, 0.4, 1.0, 30.0 };
+			const size_t degrees[] = { 3, 5, 7, 9, 13 };
+			for (size_t k = 0; k < 5; ++k) {
+				Matrix g(2, 2, 0.0);
+				g.a[0][1] = -angles[k];
+				g.a[1][0] = angles[k];
+				Matrix r(2, 2, 0.0);
+				REQUIRE(f.expm(g, r));
+				REQUIRE(f.stats().pade_degree == degrees[k]);
+				REQUIRE((k < 4) == (f.stats().squarings == 0));
+				REQUIRE(std::abs(r.a[0][0] - std::cos(angles[k])) < 1e-13);
+				REQUIRE(std::abs(r.a[1][0] - std::sin(angles[k])) < 1e-13);
+			}
+
+			Matrix big = b * 50.0;
+			Matrix prod = expm(big) * expm(big * -1.0);
+			REQUIRE(max_diff(prod, Matrix::eye(n)) < 1e-10);
+			Matrix diag(3, 3, 0.0);
+			for (size_t i = 0; i < 3; ++i) diag.a[i][i] = (double)i - 1;
+			Matrix ed = expm(diag);
+			for (size_t i = 0; i < 3; ++i) REQUIRE(std::abs(ed.a[i][i] - std::exp((double)i - 1)) < 1e-14);
+		}
+
+		SECTION("Square root and logarithm") {
+			Matrix spd = b * b.transposed() + Matrix::eye(n) * 0.5;
+			Matrix r(n, n, 0.0);
+			REQUIRE(f.sqrtm(spd, r));
+			REQUIRE(f.stats().iterations > 1);
+			REQUIRE(max_diff(r * r, spd) < 1e-12);
+
+			Matrix l = logm(expm(b));
+			REQUIRE(l.shape().first == n);
+			REQUIRE(max_diff(l, b) < 1e-12);
+			Matrix far = b * 40.0 + Matrix::eye(n) * 3.0;
+			REQUIRE(f.logm(far, r));
+			REQUIRE(f.stats().squarings > 0);
+			REQUIRE(max_diff(expm(r), far) < 1e-10 * far.norm());
+
+			Matrix neg = Matrix::eye(2);
+			neg.a[1][1] = -4;
+			REQUIRE(!f.sqrtm(neg, r));
+			REQUIRE(!f.stats().converged);
+			REQUIRE(logm(neg).shape().first == 0);
+		}
+
+		SECTION("No steady-state allocation") {
+			Matrix a = b * 20.0, r(n, n, 0.0);
+			REQUIRE(f.expm(a, r));
+			REQUIRE(f.logm(expm(b), r));
+			size_t allocations = f.allocations();
+			const double* data = r.a[0];
+			for (int it = 0; it < 5; ++it) {
+				REQUIRE(f.expm(a, r));
+				REQUIRE(f.pow(a, 7, r));
+				REQUIRE(f.sqrtm(expm(b), r));
+			}
+			REQUIRE(f.allocations() == allocations);
+			REQUIRE(r.a[0] == data);
+		}
+
+		SECTION("Concurrent calls from pool tasks") {
+			// ожидая parallel_for внутри gemm, поток выполняет другие задачи
+			// с expm; у вложенного вызова должна быть своя рабочая память
+			const size_t m = 200, kinds = 4, tasks = 32;
+			std::vector<Matrix> inputs, expected;
+			for (size_t k = 0; k < kinds; ++k) {
+				Matrix a(m, m, 0.0);
+				for (size_t i = 0; i < m; ++i) for (size_t j = 0; j < m; ++j)
+					a.a[i][j] = ((double)((i * 17 + j * 29 + k * 5) % 23) - 11) / 23.0 / m * (double)(k + 1) * 4;
+				inputs.push_back(a);
+				expected.push_back(expm(a));
+			}
+			std::vector<double> errors(tasks, -1);
+			TaskGroup group;
+			for (size_t t = 0; t < tasks; ++t)
+				group.run([&, t] {
+					errors[t] = max_diff(expm(inputs[t % kinds]), expected[t % kinds]);
+				});
+			group.wait();
+			for (double e : errors) REQUIRE((e >= 0 && e < 1e-12));
+		}
+	}
+
+	TEST_CASE("FFT and convolution") {
+		// детерминированный "шум" из [-1, 1]
+		auto signal = [](size_t n, size_t seed) {
+			Vector v(n);
+			for (size_t i = 0; i < n; ++i) v[i] = std::sin(0.37 * (double)(i + 1) * (double)(seed + 1) + (double)seed);
+			return v;
+		};
+		auto max_diff = [](const Vector& a, const Vector& b) {
+			REQUIRE(a.size() == b.size());
+			double d = 0;
+			for (size_t i = 0; i < a.size(); ++i) d = std::max(d, std::abs(a[i] - b[i]));
+			return d;
+		};
+
+		SECTION("Complex and real transforms") {
+			// степени двойки, смешанные длины и простые (Блюстейн)
+			for (size_t n : { 1, 2, 3, 8, 12, 45, 64, 97, 210, 1000, 1031 }) {
+				Vector x = signal(n, 1), y = signal(n, 2);
+				std::vector<double> re(x.data, x.data + n), im(y.data, y.data + n);
+				FftPlan::get(n)->forward(re.data(), im.data());
+				double err = 0;
+				for (size_t k = 0; k < n; ++k) {
+					double sr = 0, si = 0;
+					for (size_t j = 0; j < n; ++j) {
+						double a = -2 * 3.14159265358979323846 * (double)((j * k) % n) / (double)n;
+						sr += x[j] * std::cos(a) - y[j] * std::sin(a);
+						si += x[j] * std::sin(a) + y[j] * std::cos(a);
+					}
+					err = std::max(err, std::max(std::abs(sr - re[k]), std::abs(si - im[k])));
+				}
+				REQUIRE(err < 1e-12 * (double)n);
+
+				FftPlan::get(n)->inverse(re.data(), im.data());
+				for (size_t j = 0; j < n; ++j) {
+					REQUIRE(std::abs(re[j] - x[j]) < 1e-13);
+					REQUIRE(std::abs(im[j] - y[j]) < 1e-13);
+				}
+
+				// действительное БПФ совпадает с первой половиной комплексного
+				RealFftPlan real(n);
+				std::vector<double> rr(real.bins()), ri(real.bins()), cr(x.data, x.data + n), ci(n, 0.0);
+				real.forward(x.data, rr.data(), ri.data());
+				FftPlan::get(n)->forward(cr.data(), ci.data());
+				for (size_t k = 0; k < real.bins(); ++k) {
+					REQUIRE(std::abs(rr[k] - cr[k]) < 1e-12 * (double)n);
+					REQUIRE(std::abs(ri[k] - ci[k]) < 1e-12 * (double)n);
+				}
+				Vector back(n);
+				real.inverse(rr.data(), ri.data(), back.data);
+				REQUIRE(max_diff(back, x) < 1e-13);
+			}
+
+			// план из кэша один на длину
+			REQUIRE(FftPlan::get(1000) == FftPlan::get(1000));
+			REQUIRE(fft_cache_size() > 0);
+			fft_clear_cache();
+			REQUIRE(fft_cache_size() == 0);
+
+			REQUIRE(fft_size(1) == 2);
+			REQUIRE(fft_size(17) == 18);
+			REQUIRE(fft_size(1000001) == 1012500);
+		}
+
+		SECTION("Convolution and correlation") {
+			Vector x(3), h(2);
+			x[0] = 1; x[1] = 2; x[2] = 3;
+			h[0] = 1; h[1] = -1;
+			Vector c = convolve(x, h);
+			REQUIRE(c.size() == 4);
+			REQUIRE(c[0] == 1);
+			REQUIRE(c[1] == 1);
+			REQUIRE(c[2] == 1);
+			REQUIRE(c[3] == -3);
+			// r[m - 1] -- нулевой сдвиг
+			Vector r = correlate(x, x);
+			REQUIRE(r.size() == 5);
+			REQUIRE(r[2] == 14);
+			REQUIRE(r[0] == 3);
+			REQUIRE(r[4] == 3);
+			REQUIRE(convolve(x, Vector(0)).size() == 0);
+
+			for (auto nm : std::vector<std::pair<size_t, size_t>>{ { 100, 40 }, { 1000, 999 }, { 5000, 70 }, { 20000, 600 }, { 50, 3000 } }) {
+				Vector a = signal(nm.first, 3), b = signal(nm.second, 4);
+				Vector direct = convolve(a, b, ConvolutionMethod::DIRECT);
+				Vector fft = convolve(a, b, ConvolutionMethod::FFT);
+				REQUIRE(direct.size() == nm.first + nm.second - 1);
+				REQUIRE(max_diff(direct, fft) < 1e-10);
+				REQUIRE(max_diff(convolve(b, a), direct) < 1e-10);
+				REQUIRE(max_diff(correlate(a, b, ConvolutionMethod::FFT), correlate(a, b, ConvolutionMethod::DIRECT)) < 1e-10);
+			}
+
+			REQUIRE(choose_convolution(1 << 20, 8) == ConvolutionMethod::DIRECT);
+			REQUIRE(choose_convolution(64, 64) == ConvolutionMethod::DIRECT);
+			REQUIRE(choose_convolution(400, 400) == ConvolutionMethod::FFT);
+			REQUIRE(choose_convolution(1 << 20, 1000) == ConvolutionMethod::FFT);
+			REQUIRE(choose_convolution(1000, 1 << 20) == ConvolutionMethod::FFT);
+		}
+
+		SECTION("Overlap-add streaming") {
+			Vector x = signal(10007, 5), h = signal(257, 6);
+			Vector expected = convolve(x, h, ConvolutionMethod::DIRECT);
+			for (size_t block : { 0, 1, 100, 256, 4000 }) {
+				OverlapAdd ola(h, block);
+				REQUIRE(ola.block() >= 1);
+				REQUIRE(ola.fft_length() >= ola.block() + h.size() - 1);
+				std::vector<double> out;
+				size_t pos = 0, step = 1;
+				while (pos < x.size()) {
+					size_t count = std::min(step, x.size() - pos);
+					Vector part = ola.push(x.data + pos, count);
+					REQUIRE(part.size() % ola.block() == 0);
+					out.insert(out.end(), part.data, part.data + part.size());
+					pos += count;
+					step = step * 3 % 1001 + 1;
+				}
+				Vector rest = ola.flush();
+				out.insert(out.end(), rest.data, rest.data + rest.size());
+				REQUIRE(out.size() == expected.size());
+				double err = 0;
+				for (size_t i = 0; i < out.size(); ++i) err = std::max(err, std::abs(out[i] - expected[i]));
+				REQUIRE(err < 1e-10);
+			}
+
+			// после flush объект готов к новому сигналу
+			OverlapAdd ola(h);
+			ola.push(x);
+			ola.flush();
+			REQUIRE(ola.flush().size() == 0);
+			Vector first = ola.push(x);
+			Vector rest = ola.flush();
+			REQUIRE(first.size() + rest.size() == expected.size());
+			REQUIRE(std::abs(rest[rest.size() - 1] - expected[expected.size() - 1]) < 1e-10);
+		}
+	}
+
+	TEST_CASE("Streaming statistics") {
+		// строки со смещением 1e8: наивное sum x^2 - n mu^2 здесь теряет все знаки
+		const size_t n = 3001, d = 7;
+		Matrix data(n, d, 0.0);
+		for (size_t i = 0; i < n; ++i) {
+			double t = std::sin(0.1 * (double)i), u = std::cos(0.37 * (double)i * (double)i);
+			for (size_t j = 0; j < d; ++j) data.a[i][j] = 1e8 + (double)(j + 1) * t + (double)j * (double)j * 0.5 * u + 0.01 * std::sin((double)(i * (j + 3)));
+		}
+		// эталон -- два прохода по точным разностям
+		std::vector<double> mu(d, 0.0);
+		for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < d; ++j) mu[j] += (data.a[i][j] - 1e8);
+		for (size_t j = 0; j < d; ++j) mu[j] = mu[j] / (double)n + 1e8;
+		Matrix expected(d, d, 0.0);
+		for (size_t i = 0; i < n; ++i) for (size_t a = 0; a < d; ++a) for (size_t b = 0; b < d; ++b)
+			expected.a[a][b] += (data.a[i][a] - mu[a]) * (data.a[i][b] - mu[b]) / (double)(n - 1);
+		auto close = [&](const Matrix& c, double tol) {
+			for (size_t a = 0; a < d; ++a) for (size_t b = 0; b < d; ++b) {
+				if (std::abs(c.a[a][b] - expected.a[a][b]) > tol * (1 + std::abs(expected.a[a][b]))) return false;
+			}
+			return true;
+		};
+
+		SECTION("Rows, batches and merging agree") {
+			RunningCovariance rows(d), batch(d), left(d), right(d);
+			for (size_t i = 0; i < n; ++i) rows.add(data.a[i]);
+			batch.add(data);
+			MatrixRef all = view(data);
+			left.add(all.block(0, 0, 1000, d));
+			right.add(all.block(1000, 0, n - 1000, d));
+			REQUIRE(left.merge(right));
+			for (RunningCovariance* s : { &rows, &batch, &left }) {
+				REQUIRE(s->count() == n);
+				Vector m = s->mean();
+				for (size_t j = 0; j < d; ++j) REQUIRE(std::abs(m[j] - mu[j]) < 1e-6);
+				REQUIRE(close(s->covariance(), 1e-7));
+			}
+			REQUIRE(close(column_statistics(data).covariance(), 1e-7));
+
+			// пачка и одна строка вперемешку; дисперсии без полной матрицы
+			RunningCovariance mixed(d), diagonal(d, false);
+			mixed.add(all.block(0, 0, 1, d));
+			mixed.add(all.block(1, 0, 700, d));
+			for (size_t i = 701; i < 705; ++i) mixed.add(data.a[i]);
+			mixed.add(all.block(705, 0, n - 705, d));
+			diagonal.add(data);
+			REQUIRE(close(mixed.covariance(), 1e-7));
+			Vector var = diagonal.variance();
+			for (size_t j = 0; j < d; ++j) REQUIRE(std::abs(var[j] - expected.a[j][j]) < 1e-7 * (1 + expected.a[j][j]));
+			REQUIRE(diagonal.covariance().a[0][1] == 0);
+			REQUIRE_FALSE(diagonal.merge(mixed));
+			REQUIRE(column_statistics(data, false).variance()[3] == Approx(var[3]).epsilon(1e-9));
+
+			Matrix corr = batch.correlation();
+			for (size_t j = 0; j < d; ++j) REQUIRE(corr.a[j][j] == 1);
+			REQUIRE(corr.a[0][1] == Approx(expected.a[0][1] / std::sqrt(expected.a[0][0] * expected.a[1][1])).epsilon(1e-7));
+
+			batch.reset();
+			REQUIRE(batch.count() == 0);
+			REQUIRE(batch.variance()[0] == 0);
+		}
+
+		SECTION("Symmetric eigendecomposition") {
+			for (size_t size : { 1, 2, 5, 40, 130 }) {
+				Matrix a(size, size, 0.0);
+				for (size_t i = 0; i < size; ++i) for (size_t j = 0; j <= i; ++j) {
+					a.a[i][j] = std::sin(1.3 * (double)i + 0.7 * (double)j) + (i == j ? 0.1 * (double)i : 0.0);
+					a.a[j][i] = a.a[i][j];
+				}
+				SymmetricEigen e(a);
+				REQUIRE(e.ok());
+				const Matrix& v = e.vectors();
+				for (size_t k = 0; k < size; ++k) {
+					if (k) REQUIRE(e.values()[k - 1] >= e.values()[k]);
+					for (size_t i = 0; i < size; ++i) {
+						double av = 0, vv = 0;
+						for (size_t j = 0; j < size; ++j) {
+							av += a.a[i][j] * v.a[j][k];
+							vv += v.a[j][i] * v.a[j][k];
+						}
+						REQUIRE(std::abs(av - e.values()[k] * v.a[i][k]) < 1e-12 * (double)size);
+						REQUIRE(std::abs(vv - (i == k ? 1.0 : 0.0)) < 1e-12 * (double)size);
+					}
+				}
+			}
+
+			// syrk совпадает с A^T A
+			Matrix a(300, 150, 0.0), c(150, 150, 1.0);
+			for (size_t i = 0; i < 300; ++i) for (size_t j = 0; j < 150; ++j) a.a[i][j] = std::cos(0.1 * (double)i + 0.01 * (double)(j * j));
+			syrk(2.0, view(a), 0.5, view(c));
+			for (size_t i = 0; i < 150; i += 7) for (size_t j = 0; j < 150; j += 5) {
+				double s = 0;
+				for (size_t k = 0; k < 300; ++k) s += a.a[k][i] * a.a[k][j];
+				REQUIRE(std::abs(c.a[i][j] - (2 * s + 0.5)) < 1e-11);
+			}
+		}
+
+		SECTION("PCA") {
+			// точки на плоскости, натянутой на e1 = (1, 1, 0, 0) / sqrt 2 и e2 = (0, 0, 3, 4) / 5,
+			// с разбросом 3 и 1 по осям и малым шумом
+			const size_t m = 5000;
+			Matrix points(m, 4, 0.0);
+			double s2 = std::sqrt(0.5);
+			for (size_t i = 0; i < m; ++i) {
+				double p = 3 * std::sin(0.013 * (double)i * (double)i), q = std::cos(0.7 * (double)i);
+				double noise = 1e-3 * std::sin(1.9 * (double)i);
+				points.a[i][0] = 10 + p * s2 + noise;
+				points.a[i][1] = -5 + p * s2;
+				points.a[i][2] = q * 0.6;
+				points.a[i][3] = 2 + q * 0.8 - noise;
+			}
+			RunningCovariance stats(4);
+			stats.add(points);
+			Pca r = pca(stats, 2);
+			REQUIRE(r.ok);
+			REQUIRE(r.components.a[0][0] == Approx(s2).epsilon(1e-4));
+			REQUIRE(r.components.a[0][1] == Approx(s2).epsilon(1e-4));
+			REQUIRE(r.components.a[1][3] == Approx(0.8).epsilon(1e-4));
+			REQUIRE(r.components.a[1][2] == Approx(0.6).epsilon(1e-4));
+			REQUIRE(r.explained_variance[0] > r.explained_variance[1]);
+			REQUIRE(r.explained_variance_ratio[0] + r.explained_variance_ratio[1] > 0.999999);
+			REQUIRE(r.mean[0] == Approx(stats.mean()[0]));
+
+			// проекция на две компоненты почти без потерь восстанавливает точки
+			Matrix back = r.inverse_transform(r.transform(points));
+			for (size_t i = 0; i < m; i += 97) for (size_t j = 0; j < 4; ++j) REQUIRE(std::abs(back.a[i][j] - points.a[i][j]) < 1e-2);
+
+			RunningCovariance few(4), diagonal(4, false);
+			few.add(points.a[0]);
+			diagonal.add(points);
+			REQUIRE_FALSE(pca(few).ok);
+			REQUIRE_FALSE(pca(diagonal).ok);
+			REQUIRE(pca(stats).components._size.first == 4);
+		}
+	}
+
+	TEST_CASE("Mixed-precision solve") {
+		auto system = [](size_t n) {
+			Matrix a(n, n, 0.0);
+			for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j)
+				a.a[i][j] = std::sin(1.7 * (double)i + 0.013 * (double)(j * j)) + (i == j ? 2.0 : 0.0);
+			return a;
+		};
+		auto rhs = [](size_t n) {
+			Vector b(n);
+			for (size_t i = 0; i < n; ++i) b[i] = std::sin(0.3 * (double)i);
+			return b;
+		};
+
+		SECTION("Refinement reaches double accuracy") {
+			for (size_t n : { 1, 5, 64, 65, 130, 300 }) {
+				Matrix a = system(n);
+				Vector b = rhs(n), x(n);
+				MixedSolveStats st;
+				REQUIRE(solve_mixed(a, b, x, &st));
+				REQUIRE(st.converged);
+				REQUIRE_FALSE(st.fallback);
+				REQUIRE(st.iterations <= 5);
+				REQUIRE(st.backward_error <= std::sqrt((double)n) * 2.3e-16);
+				Vector y = LU(a).solve(b);
+				for (size_t i = 0; i < n; ++i) REQUIRE(std::abs(x[i] - y[i]) < 1e-10 * (1 + std::abs(y[i])));
+			}
+
+			// float-LU сам по себе точен только до ~1e-7
+			Matrix a = system(100);
+			FloatLU f(a);
+			REQUIRE_FALSE(f.singular());
+			REQUIRE(f.bytes() == 100 * 100 * sizeof(float));
+			Vector b = rhs(100), y = LU(a).solve(b);
+			std::vector<float> xf(b.data, b.data + 100);
+			f.solve(xf.data());
+			double err = 0;
+			for (size_t i = 0; i < 100; ++i) err = std::max(err, std::abs((double)xf[i] - y[i]));
+			REQUIRE(err > 1e-12);
+			REQUIRE(err < 1e-3);
+
+			MixedSolveReport rep = compare_solve(system(200), rhs(200), 1);
+			REQUIRE(rep.stats.converged);
+			REQUIRE(rep.max_difference < 1e-10);
+			REQUIRE(rep.double_seconds > 0);
+			REQUIRE(rep.speedup > 0);
+		}
+
+		SECTION("Fallback to double") {
+			// матрица Гильберта: обусловленность ~1e13, float-LU бесполезен
+			const size_t n = 10;
+			Matrix h(n, n, 0.0);
+			for (size_t i = 0; i < n; ++i) for (size_t j = 0; j < n; ++j) h.a[i][j] = 1.0 / (double)(i + j + 1);
+			Vector b = rhs(n), x(n);
+			MixedSolveStats st;
+			REQUIRE(solve_mixed(h, b, x, &st));
+			REQUIRE_FALSE(st.converged);
+			REQUIRE(st.fallback);
+			REQUIRE(st.backward_error < 1e-15);
+
+			MixedSolveOptions strict;
+			strict.fallback = false;
+			REQUIRE_FALSE(solve_mixed(h, b, x, &st, strict));
+			REQUIRE_FALSE(st.fallback);
+
+			// элемент вне диапазона float
+			Matrix big = system(20);
+			for (size_t i = 0; i < 20; ++i) big.a[i][i] = 1e300;
+			REQUIRE(FloatLU(big).singular());
+			Vector bb = rhs(20), xb(20);
+			REQUIRE(solve_mixed(big, bb, xb, &st));
+			REQUIRE(st.fallback);
+			REQUIRE(xb[1] == Approx(bb[1] / 1e300).epsilon(1e-6));
+
+			// вырожденная и неквадратная
+			Matrix singular(3, 3, 1.0);
+			Vector b3 = rhs(3), x3(3);
+			REQUIRE_FALSE(solve_mixed(singular, b3, x3));
+			REQUIRE_FALSE(solve_mixed(Matrix(2, 3, 1.0), b3, x3));
+		}
 	}
 }